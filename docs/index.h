@@ -41,10 +41,24 @@
  * This group of libraries provide higher level functionality that isn't hardware related or provides a richer
  * set of functionality above the basic hardware interfaces
  * @{
+ * \defgroup pico_adc_stream pico_adc_stream
+ * \defgroup pico_crc pico_crc
+ * \defgroup pico_dvfs pico_dvfs
+ * \defgroup pico_i2c_queue pico_i2c_queue
+ * \defgroup pico_i2c_slave pico_i2c_slave
+ * \defgroup pico_job pico_job
+ * \defgroup pico_lz4 pico_lz4
  * \defgroup pico_multicore pico_multicore
+ * \defgroup pico_pio_stream pico_pio_stream
+ * \defgroup pico_pll_solver pico_pll_solver
+ * \defgroup pico_pwm_player pico_pwm_player
+ * \defgroup pico_rand pico_rand
+ * \defgroup pico_spi_queue pico_spi_queue
  * \defgroup pico_stdlib pico_stdlib
  * \defgroup pico_sync pico_sync
+ * \defgroup pico_task pico_task
  * \defgroup pico_time pico_time
+ * \defgroup pico_uart_transport pico_uart_transport
  * \defgroup pico_unique_id pico_unique_id
  * \defgroup pico_util pico_util
  * @}
@@ -61,6 +75,7 @@
  * @{
  * \defgroup pico_lwip pico_lwip
  * \defgroup pico_cyw43_arch pico_cyw43_arch
+ * \defgroup pico_netcore pico_netcore
  * @}
  *
  * \defgroup runtime Runtime Infrastructure
@@ -93,5 +108,6 @@
  * @{
  * \defgroup boot_picoboot boot_picoboot
  * \defgroup boot_uf2 boot_uf2
+ * \defgroup boot_uf2z boot_uf2z
  * @}
 */
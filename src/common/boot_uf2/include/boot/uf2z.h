@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _BOOT_UF2Z_H
+#define _BOOT_UF2Z_H
+
+#include <stdint.h>
+#include <assert.h>
+
+/** \file uf2z.h
+*  \defgroup boot_uf2z boot_uf2z
+*
+* Header file for the compressed flash image container carried by a compressed UF2.
+*
+* A compressed UF2 (made by <tt>elf2uf2 -z</tt>) is an ordinary RAM UF2 for the RP2040 bootrom. It holds the
+* \c pico_uf2z_loader program, and at \ref UF2Z_CONTAINER_ADDR a container (described here) of LZ4 compressed flash
+* sectors. Once the bootrom has loaded it, the loader decompresses each sector and programs it into flash, then
+* reboots.
+*
+* The container is a \ref uf2z_header followed by \c num_blocks blocks, each a \ref uf2z_block header followed by
+* \c compressed_size bytes of data (padded to a multiple of 4 bytes). A block with \c compressed_size equal to
+* \c size is stored uncompressed; otherwise it is an LZ4 block (see \ref pico_lz4). Each block starts at the start of
+* a flash sector, and the rest of the sector after \c size bytes is left erased.
+*
+* An image too large to compress into one container is split into several parts, each a separate UF2; the loader
+* returns to BOOTSEL mode after programming all but the last part, ready for the next one.
+*/
+
+#define UF2Z_MAGIC 0x5a324655u      // "UF2Z"
+#define UF2Z_VERSION 1u
+
+// where the container is loaded; the loader, including its bss, must fit below this (elf2uf2 checks it does)
+#define UF2Z_CONTAINER_ADDR 0x20010000u
+// the container must end before the last 8K of SRAM, which is used for the stacks
+#define UF2Z_CONTAINER_MAX_SIZE (0x20040000u - UF2Z_CONTAINER_ADDR)
+
+// each block is (at most) one flash sector
+#define UF2Z_BLOCK_SIZE 4096u
+
+// more parts follow this one
+#define UF2Z_FLAG_MORE_PARTS 0x0001u
+
+struct uf2z_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;
+    uint16_t part;              // the number of this part, from 0
+    uint16_t num_parts;
+    uint32_t num_blocks;
+    uint32_t data_size;         // the size of the blocks following the header
+    uint32_t uncompressed_size; // the total size of the blocks when decompressed
+};
+
+struct uf2z_block {
+    uint32_t flash_offset;      // the offset from the start of flash, which is a multiple of UF2Z_BLOCK_SIZE
+    uint16_t size;              // the decompressed size, a multiple of the 256 byte flash page size
+    uint16_t compressed_size;
+};
+
+static_assert(sizeof(struct uf2z_header) == 24, "uf2z_header wrong size");
+static_assert(sizeof(struct uf2z_block) == 8, "uf2z_block wrong size");
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+#include "pico/adc_stream.h"
+#include "pico/time.h"
+
+void adc_stream_init(adc_stream_t *stream, const adc_stream_config_t *config) {
+    invalid_params_if(ADC_STREAM, !config->input_mask || config->input_mask >= (1u << NUM_ADC_CHANNELS));
+    invalid_params_if(ADC_STREAM, !config->sample_rate);
+    // the DMA channels wrap within a block (so the block size must be a power of two bytes no bigger than 32K)
+    invalid_params_if(ADC_STREAM, !config->block_samples || config->block_samples > 16384 ||
+                                  (config->block_samples & (config->block_samples - 1)));
+    invalid_params_if(ADC_STREAM, ((uintptr_t)config->buffer) & (config->block_samples * 2 - 1));
+    // two blocks are always being filled, so at least one more is needed for the application
+    invalid_params_if(ADC_STREAM, config->num_blocks < 3 || config->num_blocks > 0xffff);
+    memset(stream, 0, sizeof(adc_stream_t));
+    stream->config = *config;
+    for (uint input = 0; input < NUM_ADC_CHANNELS; input++) {
+        if (config->input_mask & (1u << input)) {
+            stream->inputs[stream->num_inputs++] = (uint8_t)input;
+        }
+    }
+    queue_init(&stream->free_blocks, sizeof(uint16_t), config->num_blocks);
+    if (!config->callback) {
+        queue_init(&stream->ready_blocks, sizeof(adc_stream_block_t), config->num_blocks);
+    }
+}
+
+void adc_stream_deinit(adc_stream_t *stream) {
+    assert(!stream->running);
+    queue_free(&stream->free_blocks);
+    if (!stream->config.callback) {
+        queue_free(&stream->ready_blocks);
+    }
+}
+
+void adc_stream_start(adc_stream_t *stream) {
+    assert(!stream->running);
+    uint16_t index;
+    while (queue_try_remove(&stream->free_blocks, &index));
+    if (!stream->config.callback) {
+        adc_stream_block_t block;
+        while (queue_try_remove(&stream->ready_blocks, &block));
+    }
+    stream->armed[0] = 0;
+    stream->armed[1] = 1;
+    for (index = 2; index < stream->config.num_blocks; index++) {
+        queue_try_add(&stream->free_blocks, &index);
+    }
+    stream->phase = 0;
+    stream->sequence = 0;
+    stream->running = true;
+    adc_stream_backend_start(stream);
+}
+
+void adc_stream_stop(adc_stream_t *stream) {
+    if (!stream->running) return;
+    adc_stream_backend_stop(stream);
+    stream->running = false;
+}
+
+static void record_delivery(adc_stream_t *stream, const adc_stream_block_t *block) {
+    uint32_t latency_us = time_us_32() - block->completed_us;
+    stream->stats.delivered++;
+    stream->stats.total_latency_us += latency_us;
+    if (latency_us > stream->stats.max_latency_us) stream->stats.max_latency_us = latency_us;
+}
+
+uint __time_critical_func(adc_stream_block_done)(adc_stream_t *stream, uint which, uint irq_delay_samples) {
+    adc_stream_block_t block = {
+        .index = stream->armed[which],
+        .sequence = stream->sequence++,
+        .completed_us = time_us_32(),
+        .phase = stream->phase,
+    };
+    block.samples = stream->config.buffer + block.index * stream->config.block_samples;
+    stream->phase = (uint8_t)((stream->phase + stream->config.block_samples) % stream->num_inputs);
+    stream->stats.blocks++;
+    if (irq_delay_samples > stream->stats.max_irq_delay_samples) {
+        stream->stats.max_irq_delay_samples = irq_delay_samples;
+    }
+    uint16_t next;
+    if (stream->config.callback) {
+        // the block is finished with when the callback returns, so it can be filled again after the one already armed
+        record_delivery(stream, &block);
+        stream->config.callback(stream, &block);
+        next = block.index;
+    } else if (queue_try_remove(&stream->free_blocks, &next)) {
+        // can't fail, as the queue has room for every block
+        queue_try_add(&stream->ready_blocks, &block);
+    } else {
+        // no free block; drop this one rather than overwrite one the application is still using
+        stream->stats.overruns++;
+        next = block.index;
+    }
+    stream->armed[which] = next;
+    return next;
+}
+
+void __time_critical_func(adc_stream_restart_blocks)(adc_stream_t *stream) {
+    // the contents of both blocks being filled are lost, but the channels keep the same blocks
+    stream->sequence += 2;
+    stream->phase = 0;
+    stream->stats.restarts++;
+}
+
+void adc_stream_get_block_blocking(adc_stream_t *stream, adc_stream_block_t *block) {
+    invalid_params_if(ADC_STREAM, stream->config.callback);
+    queue_remove_blocking(&stream->ready_blocks, block);
+    record_delivery(stream, block);
+}
+
+bool adc_stream_try_get_block(adc_stream_t *stream, adc_stream_block_t *block) {
+    invalid_params_if(ADC_STREAM, stream->config.callback);
+    if (!queue_try_remove(&stream->ready_blocks, block)) return false;
+    record_delivery(stream, block);
+    return true;
+}
+
+void adc_stream_release_block(adc_stream_t *stream, const adc_stream_block_t *block) {
+    invalid_params_if(ADC_STREAM, block->index >= stream->config.num_blocks);
+    bool __unused ok = queue_try_add(&stream->free_blocks, &block->index);
+    assert(ok); // a block was released twice
+}
+
+void adc_stream_demux(const adc_stream_t *stream, const adc_stream_block_t *block,
+                      uint16_t *const input_buffers[NUM_ADC_CHANNELS], uint counts[NUM_ADC_CHANNELS]) {
+    uint n = stream->num_inputs;
+    for (uint i = 0; i < n; i++) {
+        // the i'th input of the stream's inputs is first sampled at this offset in the block
+        uint first = (i + n - block->phase) % n;
+        uint input = stream->inputs[i];
+        uint16_t *dst = input_buffers[input];
+        uint count = 0;
+        if (dst) {
+            for (uint j = first; j < stream->config.block_samples; j += n) {
+                dst[count++] = block->samples[j];
+            }
+        }
+        if (counts) counts[input] = count;
+    }
+}
+
+void adc_stream_get_stats(adc_stream_t *stream, adc_stream_stats_t *stats) {
+    *stats = stream->stats;
+}
+
+void adc_stream_reset_stats(adc_stream_t *stream) {
+    memset(&stream->stats, 0, sizeof(stream->stats));
+}
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_ADC_STREAM_H
+#define _PICO_ADC_STREAM_H
+
+#include "pico.h"
+#include "pico/util/queue.h"
+
+/** \file pico/adc_stream.h
+ *  \defgroup pico_adc_stream pico_adc_stream
+ * Continuous gap-free ADC capture into a ring of buffer blocks
+ *
+ * An ADC stream samples one or more ADC inputs (in round robin order) continuously at a fixed rate, and delivers the
+ * samples in fixed size blocks. Two DMA channels paced by the ADC DREQ are chained to each other, so while one channel
+ * fills a block, the other is already armed with the next one; the DMA IRQ handler only has to re-arm the channel
+ * which just finished before the other one does, and no samples are lost while it does so.
+ *
+ * Completed blocks are either passed to a callback (from the DMA IRQ handler), or queued for the application to
+ * fetch with \ref adc_stream_get_block_blocking or \ref adc_stream_try_get_block and return with
+ * \ref adc_stream_release_block. If the application holds on to too many blocks, so that there is no free block for
+ * the DMA to fill next, the newest block is dropped (and counted as an overrun) rather than overwriting a block the
+ * application is still reading. Each block carries a sequence number, so gaps are also visible to the application.
+ *
+ * When several inputs are sampled, the samples in a block are interleaved; \ref adc_stream_demux copies them out into
+ * a buffer per input.
+ *
+ * The size of a block in bytes must be a power of two, and the buffer must be aligned to the block size (see
+ * \ref ADC_STREAM_BUFFER), as the DMA channels wrap within their block; should the IRQ handler be serviced so late
+ * that a channel is restarted before it was re-armed, it overwrites its own block rather than memory beyond it. In this
+ * case the stream is restarted and the event is counted in the statistics.
+ *
+ * On the host platform, the DMA and ADC are replaced by a synthetic source (see pico/adc_stream_synthetic.h), which
+ * fills blocks with generated samples on demand.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// PICO_CONFIG: PARAM_ASSERTIONS_ENABLED_ADC_STREAM, Enable/disable assertions in the ADC stream module, type=bool, default=0, group=pico_adc_stream
+#ifndef PARAM_ASSERTIONS_ENABLED_ADC_STREAM
+#define PARAM_ASSERTIONS_ENABLED_ADC_STREAM 0
+#endif
+
+/*! \brief Declare a suitably aligned static buffer for an ADC stream
+ *  \ingroup pico_adc_stream
+ *
+ * \param name the name of the buffer
+ * \param block_samples the number of samples in a block; this must be a power of two
+ * \param num_blocks the number of blocks
+ */
+#define ADC_STREAM_BUFFER(name, block_samples, num_blocks) \
+    static uint16_t __attribute__((aligned((block_samples) * 2))) name[(block_samples) * (num_blocks)]
+
+typedef struct adc_stream adc_stream_t;
+
+/*! \brief A completed block of samples
+ *  \ingroup pico_adc_stream
+ */
+typedef struct {
+    uint16_t *samples;      ///< the (interleaved) samples
+    uint32_t sequence;      ///< number of blocks completed before this one since the stream was started
+    uint32_t completed_us;  ///< the time (from time_us_32()) at which the block was completed
+    uint16_t index;         ///< the index of the block within the stream's buffer
+    uint8_t phase;          ///< the index (within the stream's inputs) of the input of the first sample
+} adc_stream_block_t;
+
+/*! \brief Callback for a completed block
+ *  \ingroup pico_adc_stream
+ *
+ * This is called from the DMA IRQ handler, so should return quickly; the block is returned to the stream when
+ * the callback returns.
+ */
+typedef void (*adc_stream_callback_t)(adc_stream_t *stream, const adc_stream_block_t *block);
+
+/*! \brief ADC stream configuration
+ *  \ingroup pico_adc_stream
+ */
+typedef struct {
+    uint input_mask;                ///< mask of ADC inputs to sample (bit n for input n); sampled round robin in order
+    uint sample_rate;               ///< the total sample rate (over all inputs) in samples per second
+    uint16_t *buffer;               ///< buffer of block_samples * num_blocks samples, aligned to the block size
+    uint block_samples;             ///< number of samples in each block; must be a power of two
+    uint num_blocks;                ///< number of blocks in the buffer; at least 3
+    adc_stream_callback_t callback; ///< callback for completed blocks, or NULL to queue them
+    void *user_data;                ///< user data for the callback
+} adc_stream_config_t;
+
+/*! \brief ADC stream statistics
+ *  \ingroup pico_adc_stream
+ */
+typedef struct {
+    uint32_t blocks;                ///< number of blocks completed (including dropped ones)
+    uint32_t overruns;              ///< number of blocks dropped because no free block was available
+    uint32_t restarts;              ///< number of times the stream was restarted after the IRQ handler ran too late
+    uint32_t delivered;             ///< number of blocks delivered to the callback or fetched from the queue
+    uint32_t total_latency_us;      ///< total time from completion of the delivered blocks to their delivery
+    uint32_t max_latency_us;        ///< longest time from completion of a block to its delivery
+    uint32_t max_irq_delay_samples; ///< most samples taken into the following block before a completed block was handled
+} adc_stream_stats_t;
+
+struct adc_stream {
+    adc_stream_config_t config;
+    uint8_t inputs[NUM_ADC_CHANNELS];
+    uint8_t num_inputs;
+    uint8_t phase;          // phase of the block currently being filled
+    uint16_t armed[2];      // the blocks being filled by each DMA channel
+    uint32_t sequence;
+    volatile bool running;
+    queue_t free_blocks;    // indices of blocks available for the DMA to fill
+    queue_t ready_blocks;   // completed blocks waiting for the application
+    adc_stream_stats_t stats;
+};
+
+/*! \brief Initialize an ADC stream
+ *  \ingroup pico_adc_stream
+ *
+ * The ADC itself must already have been initialized with adc_init(), and the GPIOs of the inputs set up with
+ * adc_gpio_init().
+ *
+ * \param stream the stream
+ * \param config the configuration, which is copied
+ */
+void adc_stream_init(adc_stream_t *stream, const adc_stream_config_t *config);
+
+/*! \brief Release the resources used by a stopped ADC stream
+ *  \ingroup pico_adc_stream
+ *
+ * \param stream the stream
+ */
+void adc_stream_deinit(adc_stream_t *stream);
+
+/*! \brief Start capturing samples
+ *  \ingroup pico_adc_stream
+ *
+ * Any blocks not yet fetched from a previous run are discarded. Only one stream may be running at a time.
+ *
+ * \param stream the stream
+ */
+void adc_stream_start(adc_stream_t *stream);
+
+/*! \brief Stop capturing samples
+ *  \ingroup pico_adc_stream
+ *
+ * Blocks which were already completed may still be fetched.
+ *
+ * \param stream the stream
+ */
+void adc_stream_stop(adc_stream_t *stream);
+
+/*! \brief Fetch the oldest completed block, waiting if there is none
+ *  \ingroup pico_adc_stream
+ *
+ * This may only be used when the stream has no callback. The block must be returned with
+ * \ref adc_stream_release_block once the samples have been used.
+ *
+ * \param stream the stream
+ * \param block filled in with the block
+ */
+void adc_stream_get_block_blocking(adc_stream_t *stream, adc_stream_block_t *block);
+
+/*! \brief Fetch the oldest completed block if there is one
+ *  \ingroup pico_adc_stream
+ *
+ * \param stream the stream
+ * \param block filled in with the block
+ * \return true if a block was fetched
+ */
+bool adc_stream_try_get_block(adc_stream_t *stream, adc_stream_block_t *block);
+
+/*! \brief Return a fetched block to the stream, to be filled again
+ *  \ingroup pico_adc_stream
+ *
+ * \param stream the stream
+ * \param block the block
+ */
+void adc_stream_release_block(adc_stream_t *stream, const adc_stream_block_t *block);
+
+/*! \brief Copy the samples of a block into a buffer per input
+ *  \ingroup pico_adc_stream
+ *
+ * \param stream the stream
+ * \param block the block
+ * \param input_buffers buffers indexed by ADC input number. Samples are only copied for inputs which are sampled by
+ *                      the stream and have a non NULL buffer; each buffer must have room for
+ *                      block_samples / number of inputs samples (rounded up)
+ * \param counts if not NULL, filled in with the number of samples copied for each input
+ */
+void adc_stream_demux(const adc_stream_t *stream, const adc_stream_block_t *block,
+                      uint16_t *const input_buffers[NUM_ADC_CHANNELS], uint counts[NUM_ADC_CHANNELS]);
+
+/*! \brief Get the statistics of an ADC stream
+ *  \ingroup pico_adc_stream
+ *
+ * \param stream the stream
+ * \param stats filled in with the statistics
+ */
+void adc_stream_get_stats(adc_stream_t *stream, adc_stream_stats_t *stats);
+
+/*! \brief Reset the statistics of an ADC stream
+ *  \ingroup pico_adc_stream
+ *
+ * \param stream the stream
+ */
+void adc_stream_reset_stats(adc_stream_t *stream);
+
+/*! \brief Get the user data of an ADC stream
+ *  \ingroup pico_adc_stream
+ *
+ * \param stream the stream
+ * \return the user_data from the configuration
+ */
+static inline void *adc_stream_get_user_data(adc_stream_t *stream) {
+    return stream->config.user_data;
+}
+
+// \cond internal
+// implemented by the platform backend (DMA or synthetic)
+void adc_stream_backend_start(adc_stream_t *stream);
+void adc_stream_backend_stop(adc_stream_t *stream);
+
+// called by the backend when DMA channel `which` has filled its block; returns the block to arm the channel with next.
+// irq_delay_samples is the number of samples already taken into the other channel's block
+uint adc_stream_block_done(adc_stream_t *stream, uint which, uint irq_delay_samples);
+
+// called by the backend when both channels completed before the first was re-armed; re-arms both channels from
+// scratch, dropping the completed blocks
+void adc_stream_restart_blocks(adc_stream_t *stream);
+// \endcond
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_CRC_H
+#define _PICO_CRC_H
+
+#include "pico.h"
+
+/** \file pico/crc.h
+ *  \defgroup pico_crc pico_crc
+ * CRC and checksum calculation, using the DMA sniffer where available
+ *
+ * The DMA sniffer on RP2040 calculates a CRC-32, CRC-16-CCITT or simple checksum of the data read by one DMA channel,
+ * at no cost to the processor. This library uses it to calculate the CRC of a buffer in RAM or flash by transferring
+ * the buffer to a single (non-incrementing) dummy destination, which runs at up to 4 bytes per system clock cycle. The
+ * DMA is only used for the whole words in the middle of the buffer; any bytes before or after them are handled by
+ * a table driven software implementation, as are buffers too short to be worth setting up a DMA transfer for
+ * (see \ref PICO_CRC_DMA_MIN_BYTES). The software implementation is also used when the DMA sniffer or a DMA channel is not
+ * available, and always on the host platform, so results are identical everywhere.
+ *
+ * On RP2040, pico/crc_sniff.h additionally allows calculating the CRC of data moved by another DMA transfer (e.g.
+ * a packet being received from a peripheral) as it happens.
+ *
+ * The CRC of a buffer may be calculated in pieces, by passing the result of one call as the starting value of the
+ * next:
+ *
+ * \code
+ * uint32_t crc = crc_initial_value(CRC_32);
+ * crc = crc_update(CRC_32, crc, header, sizeof(header));
+ * crc = crc_update(CRC_32, crc, payload, payload_len);
+ * \endcode
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// PICO_CONFIG: PARAM_ASSERTIONS_ENABLED_CRC, Enable/disable assertions in the CRC module, type=bool, default=0, group=pico_crc
+#ifndef PARAM_ASSERTIONS_ENABLED_CRC
+#define PARAM_ASSERTIONS_ENABLED_CRC 0
+#endif
+
+/*! \brief CRC and checksum algorithms
+ *  \ingroup pico_crc
+ *
+ * The names (and check values, being the result for the ASCII string "123456789") follow the usual CRC catalogues.
+ */
+typedef enum {
+    CRC_32,         ///< CRC-32 as used by Ethernet, zlib and PNG (reflected, init and xorout 0xffffffff; check 0xcbf43926)
+    CRC_32_MPEG2,   ///< CRC-32/MPEG-2 (same polynomial, not reflected, init 0xffffffff, no xorout; check 0x0376e6e7)
+    CRC_16_CCITT,   ///< CRC-16/CCITT-FALSE, aka CRC-16/IBM-3740 (polynomial 0x1021, init 0xffff; check 0x29b1)
+    CRC_16_XMODEM,  ///< CRC-16/XMODEM (polynomial 0x1021, init 0; check 0x31c3)
+    CRC_16_KERMIT,  ///< CRC-16/KERMIT (polynomial 0x1021, reflected, init 0; check 0x2189)
+    CRC_SUM32,      ///< 32 bit sum of the little endian 32 bit words of the data, which must be word aligned and sized
+    CRC_PARITY,     ///< 1 if the total number of set bits in the data is odd, 0 otherwise
+    CRC_TYPE_COUNT
+} crc_type_t;
+
+/*! \brief Get the value to start a calculation in pieces from
+ *  \ingroup pico_crc
+ *
+ * This is also the result for no data.
+ *
+ * \param type the algorithm
+ * \return the initial value
+ */
+uint32_t crc_initial_value(crc_type_t type);
+
+/*! \brief Continue a CRC or checksum calculation over more data
+ *  \ingroup pico_crc
+ *
+ * This uses the DMA sniffer where possible (see the module description), waiting for the transfer to complete.
+ *
+ * \param type the algorithm
+ * \param crc the result for the preceding data, or \ref crc_initial_value()
+ * \param data the data, which may be in RAM or flash
+ * \param len the length of the data in bytes
+ * \return the result for the preceding data followed by this data
+ */
+uint32_t crc_update(crc_type_t type, uint32_t crc, const void *data, size_t len);
+
+/*! \brief Calculate a CRC or checksum
+ *  \ingroup pico_crc
+ *
+ * \param type the algorithm
+ * \param data the data, which may be in RAM or flash
+ * \param len the length of the data in bytes
+ * \return the result
+ */
+static inline uint32_t crc_compute(crc_type_t type, const void *data, size_t len) {
+    return crc_update(type, crc_initial_value(type), data, len);
+}
+
+/*! \brief Continue a CRC or checksum calculation over more data, without using the DMA
+ *  \ingroup pico_crc
+ *
+ * \param type the algorithm
+ * \param crc the result for the preceding data, or \ref crc_initial_value()
+ * \param data the data
+ * \param len the length of the data in bytes
+ * \return the result for the preceding data followed by this data
+ */
+uint32_t crc_update_software(crc_type_t type, uint32_t crc, const void *data, size_t len);
+
+// \cond internal
+// the result is the state of the calculation (the CRC register value, reflected for reflected CRCs) with this applied
+static inline uint32_t crc_final_xor(crc_type_t type) {
+    return type == CRC_32 ? 0xffffffffu : 0;
+}
+
+// implemented by the platform backend; continues a calculation over whole words using hardware if possible, returning
+// false if the caller should use software instead
+bool crc_backend_update_words(crc_type_t type, uint32_t *state, const uint32_t *words, size_t count);
+// \endcond
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_JOB_H
+#define _PICO_JOB_H
+
+#include "pico.h"
+
+/** \file job.h
+ *  \defgroup pico_job pico_job
+ *
+ * Work-stealing job system for splitting work across both cores
+ *
+ * Each core has a deque (double-ended queue) of jobs protected by a spin lock. A core adds the jobs it submits to the
+ * bottom of its own deque, and takes jobs from the bottom when looking for work, so it tends to work on the most recently
+ * split (and hence smallest and most cache/bus friendly) pieces of work. When a core's own deque is empty, it steals the
+ * oldest job from the top of the other core's deque; for \ref parallel_for this is the largest remaining piece of the range.
+ *
+ * A core with no work to do sleeps (via `__wfe`) after marking itself as waiting on the other core's deque. The next
+ * job submitted to that deque rings a doorbell by writing to the inter-core FIFO, which wakes the core.
+ *
+ * \ref job_system_init() launches core 1 as a worker which does nothing but run jobs. Core 0 submits jobs, and runs
+ * jobs itself while waiting for them to complete (see \ref job_group_wait()), so both cores contribute to the work.
+ * Jobs may themselves submit and wait for jobs.
+ *
+ * \note the job system takes ownership of the inter-core FIFO, which should not be used for anything else (including
+ * \ref multicore_lockout) once \ref job_system_init() has been called.
+ *
+ * For example:
+ *
+ * \code
+ * static void scale(void *arg, uint32_t begin, uint32_t end) {
+ *     float *data = (float *)arg;
+ *     for (uint32_t i = begin; i < end; i++) data[i] *= 2.0f;
+ * }
+ *
+ * job_system_init();
+ * parallel_for(0, count_of(data), 64, scale, data);
+ * \endcode
+ */
+
+// PICO_CONFIG: PARAM_ASSERTIONS_ENABLED_JOB, Enable/disable assertions in the job module, type=bool, default=0, group=pico_job
+#ifndef PARAM_ASSERTIONS_ENABLED_JOB
+#define PARAM_ASSERTIONS_ENABLED_JOB 0
+#endif
+
+// PICO_CONFIG: PICO_JOB_DEQUE_SIZE, Maximum number of jobs queued on each core, must be a power of 2; jobs submitted when the deque is full are run immediately, min=2, default=32, group=pico_job
+#ifndef PICO_JOB_DEQUE_SIZE
+#define PICO_JOB_DEQUE_SIZE 32
+#endif
+
+// PICO_CONFIG: PICO_JOB_REDUCE_MAX_SIZE, Maximum size in bytes of the result type for parallel_reduce, min=4, default=16, group=pico_job
+#ifndef PICO_JOB_REDUCE_MAX_SIZE
+#define PICO_JOB_REDUCE_MAX_SIZE 16
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \brief Job function type
+ *  \ingroup pico_job
+ *
+ * \param arg the argument passed when the job was submitted
+ * \param begin the start of the range for the job (inclusive)
+ * \param end the end of the range for the job (exclusive)
+ */
+typedef void (*job_func_t)(void *arg, uint32_t begin, uint32_t end);
+
+/*! \brief Body function type for \ref parallel_reduce
+ *  \ingroup pico_job
+ *
+ * \param arg the argument passed to \ref parallel_reduce
+ * \param begin the start of the range (inclusive)
+ * \param end the end of the range (exclusive)
+ * \param acc accumulator, initially holding the identity value, into which the result for the range should be accumulated
+ */
+typedef void (*job_reduce_body_t)(void *arg, uint32_t begin, uint32_t end, void *acc);
+
+/*! \brief Combine function type for \ref parallel_reduce
+ *  \ingroup pico_job
+ *
+ * \param acc accumulator to update
+ * \param value the value to combine into acc
+ */
+typedef void (*job_reduce_combine_t)(void *acc, const void *value);
+
+/*! \brief A group of jobs which may be waited for together
+ *  \ingroup pico_job
+ */
+typedef struct job_group {
+    volatile uint32_t pending;
+} job_group_t;
+
+/*! \brief Job system statistics for one core
+ *  \ingroup pico_job
+ */
+typedef struct {
+    uint32_t jobs_run;          ///< jobs run by the core (including those it stole)
+    uint32_t jobs_stolen;       ///< jobs the core took from the other core's deque
+    uint32_t jobs_run_inline;   ///< jobs run immediately on submission because the deque was full
+    uint32_t doorbells;         ///< doorbells the core sent to wake the other core
+    uint64_t idle_time_us;      ///< time the core spent waiting for work
+} job_stats_t;
+
+/*! \brief Initialize the job system, launching core 1 as a worker
+ *  \ingroup pico_job
+ *
+ * This must be called from core 0 before any other job functions are used, and core 1 must not already be running.
+ */
+void job_system_init(void);
+
+/*! \brief Initialize a job group
+ *  \ingroup pico_job
+ *
+ * \param group the group
+ */
+static inline void job_group_init(job_group_t *group) {
+    group->pending = 0;
+}
+
+/*! \brief Submit a job to the calling core's deque
+ *  \ingroup pico_job
+ *
+ * The job may be run by either core. If the deque is full, the job is run immediately on the calling core.
+ *
+ * \param group the group the job belongs to
+ * \param func the job function
+ * \param arg argument for the job function
+ * \param begin value passed as begin to the job function
+ * \param end value passed as end to the job function
+ */
+void job_submit(job_group_t *group, job_func_t func, void *arg, uint32_t begin, uint32_t end);
+
+/*! \brief Wait for all the jobs in a group to complete
+ *  \ingroup pico_job
+ *
+ * The calling core runs jobs (from any group) while it waits.
+ *
+ * \param group the group
+ */
+void job_group_wait(job_group_t *group);
+
+/*! \brief Call a function over a range, split across both cores
+ *  \ingroup pico_job
+ *
+ * The range is recursively split in half, with one half submitted as a job, until pieces are no larger than the grain
+ * size; body is then called for each piece. This function returns once body has been called for the whole range.
+ *
+ * \param begin the start of the range (inclusive)
+ * \param end the end of the range (exclusive)
+ * \param grain the maximum size of the range passed to each call of body
+ * \param body the function to call for each piece of the range
+ * \param arg argument for body
+ */
+void parallel_for(uint32_t begin, uint32_t end, uint32_t grain, job_func_t body, void *arg);
+
+/*! \brief Compute a reduction over a range, split across both cores
+ *  \ingroup pico_job
+ *
+ * The range is split as for \ref parallel_for. body is called for each piece of the range, with an accumulator
+ * initialized to the identity value; the resulting values are then combined using combine. As the order in which values
+ * are combined is not defined, combine should be associative and commutative.
+ *
+ * \param begin the start of the range (inclusive)
+ * \param end the end of the range (exclusive)
+ * \param grain the maximum size of the range passed to each call of body
+ * \param body the function to call for each piece of the range
+ * \param combine the function used to combine accumulated values
+ * \param result on entry the identity value, on exit the result
+ * \param result_size the size of the result, which must be no larger than PICO_JOB_REDUCE_MAX_SIZE
+ * \param arg argument for body
+ */
+void parallel_reduce(uint32_t begin, uint32_t end, uint32_t grain, job_reduce_body_t body, job_reduce_combine_t combine,
+                     void *result, size_t result_size, void *arg);
+
+/*! \brief Get the job system statistics for a core
+ *  \ingroup pico_job
+ *
+ * \param core the core number
+ * \param stats the statistics are copied here
+ */
+void job_system_get_stats(uint core, job_stats_t *stats);
+
+/*! \brief Reset the job system statistics for both cores
+ *  \ingroup pico_job
+ */
+void job_system_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include "pico/job.h"
+#include "pico/multicore.h"
+#include "pico/time.h"
+#include "hardware/sync.h"
+
+static_assert(!(PICO_JOB_DEQUE_SIZE & (PICO_JOB_DEQUE_SIZE - 1)), "PICO_JOB_DEQUE_SIZE must be a power of 2");
+
+// value written to the inter-core FIFO to wake the other core; the value itself is ignored
+#define JOB_DOORBELL 0x4a4f4231u
+
+typedef struct {
+    job_func_t func;
+    void *arg;
+    uint32_t begin;
+    uint32_t end;
+    job_group_t *group;
+} job_t;
+
+typedef struct {
+    spin_lock_t *lock;
+    job_t jobs[PICO_JOB_DEQUE_SIZE];
+    uint32_t top;       // index of the oldest job, which is taken by the other core when stealing
+    uint32_t bottom;    // index after the newest job, which is taken by the owning core
+    // set (under lock) when the other core is sleeping until a job is added to this deque
+    volatile bool thief_waiting;
+    job_stats_t stats;  // statistics for the owning core
+} job_deque_t;
+
+static job_deque_t deques[NUM_CORES];
+static spin_lock_t *group_lock;
+
+static void complete_job(job_group_t *group) {
+    uint32_t save = spin_lock_blocking(group_lock);
+    bool done = !--group->pending;
+    spin_unlock(group_lock, save);
+    // wake a core waiting in job_group_wait
+    if (done) __sev();
+}
+
+static void run_job(job_deque_t *d, const job_t *job) {
+    job->func(job->arg, job->begin, job->end);
+    d->stats.jobs_run++;
+    complete_job(job->group);
+}
+
+void job_submit(job_group_t *group, job_func_t func, void *arg, uint32_t begin, uint32_t end) {
+    job_deque_t *d = &deques[get_core_num()];
+    invalid_params_if(JOB, !d->lock);
+    uint32_t save = spin_lock_blocking(group_lock);
+    group->pending++;
+    spin_unlock(group_lock, save);
+
+    job_t job = {.func = func, .arg = arg, .begin = begin, .end = end, .group = group};
+    save = spin_lock_blocking(d->lock);
+    if (d->bottom - d->top == PICO_JOB_DEQUE_SIZE) {
+        spin_unlock(d->lock, save);
+        d->stats.jobs_run_inline++;
+        run_job(d, &job);
+        return;
+    }
+    d->jobs[d->bottom++ & (PICO_JOB_DEQUE_SIZE - 1)] = job;
+    bool wake = d->thief_waiting;
+    d->thief_waiting = false;
+    spin_unlock(d->lock, save);
+    if (wake) {
+        // if the FIFO is full, the other core has doorbells pending already
+        multicore_fifo_push_timeout_us(JOB_DOORBELL, 0);
+        d->stats.doorbells++;
+    }
+}
+
+// take a job from the bottom of our own deque, or failing that the top of the other core's deque
+static bool take_job(uint core, job_t *job) {
+    job_deque_t *d = &deques[core];
+    uint32_t save = spin_lock_blocking(d->lock);
+    bool found = d->bottom != d->top;
+    if (found) *job = d->jobs[--d->bottom & (PICO_JOB_DEQUE_SIZE - 1)];
+    spin_unlock(d->lock, save);
+    if (found) return true;
+
+    job_deque_t *victim = &deques[core ^ 1];
+    save = spin_lock_blocking(victim->lock);
+    found = victim->bottom != victim->top;
+    if (found) *job = victim->jobs[victim->top++ & (PICO_JOB_DEQUE_SIZE - 1)];
+    spin_unlock(victim->lock, save);
+    if (found) d->stats.jobs_stolen++;
+    return found;
+}
+
+// sleep until the other core submits a job, or the (optional) group completes
+static void wait_for_work(uint core, const job_group_t *group) {
+    // our own deque is empty (only we add to it), so we only need to watch the other core's deque. thief_waiting is
+    // set under the same lock that job_submit holds when adding a job, so either we see the job, or it sees the flag
+    job_deque_t *victim = &deques[core ^ 1];
+    uint32_t save = spin_lock_blocking(victim->lock);
+    bool empty = victim->bottom == victim->top;
+    if (empty) victim->thief_waiting = true;
+    spin_unlock(victim->lock, save);
+    if (!empty) return;
+
+    uint64_t start = time_us_64();
+    while (victim->thief_waiting && !(group && !group->pending)) {
+        // both the doorbell (a FIFO write) and group completion send an event
+        __wfe();
+    }
+    multicore_fifo_drain();
+    if (victim->thief_waiting) {
+        save = spin_lock_blocking(victim->lock);
+        victim->thief_waiting = false;
+        spin_unlock(victim->lock, save);
+    }
+    deques[core].stats.idle_time_us += time_us_64() - start;
+}
+
+void job_group_wait(job_group_t *group) {
+    uint core = get_core_num();
+    invalid_params_if(JOB, !deques[core].lock);
+    job_t job;
+    while (group->pending) {
+        if (take_job(core, &job)) {
+            run_job(&deques[core], &job);
+        } else {
+            wait_for_work(core, group);
+        }
+    }
+}
+
+static void job_worker_core1_entry(void) {
+    job_t job;
+    while (true) {
+        if (take_job(1, &job)) {
+            run_job(&deques[1], &job);
+        } else {
+            wait_for_work(1, NULL);
+        }
+    }
+}
+
+void job_system_init(void) {
+    assert(get_core_num() == 0);
+    group_lock = spin_lock_init(next_striped_spin_lock_num());
+    for (uint core = 0; core < NUM_CORES; core++) {
+        memset(&deques[core], 0, sizeof(job_deque_t));
+        deques[core].lock = spin_lock_init(next_striped_spin_lock_num());
+    }
+    multicore_launch_core1(job_worker_core1_entry);
+}
+
+typedef struct {
+    job_func_t body;
+    void *arg;
+    uint32_t grain;
+    job_group_t group;
+} parallel_for_t;
+
+static void parallel_for_range(void *arg, uint32_t begin, uint32_t end) {
+    parallel_for_t *pf = (parallel_for_t *) arg;
+    // keep the lower half, and submit the upper half as a job, until the remaining range is small enough; the first
+    // (largest) upper half ends up at the top of the deque, so it is the first to be stolen
+    while (end - begin > pf->grain) {
+        uint32_t mid = begin + (end - begin) / 2;
+        job_submit(&pf->group, parallel_for_range, pf, mid, end);
+        end = mid;
+    }
+    pf->body(pf->arg, begin, end);
+}
+
+void parallel_for(uint32_t begin, uint32_t end, uint32_t grain, job_func_t body, void *arg) {
+    parallel_for_t pf = {.body = body, .arg = arg, .grain = grain ? grain : 1};
+    job_group_init(&pf.group);
+    if (begin < end) parallel_for_range(&pf, begin, end);
+    job_group_wait(&pf.group);
+}
+
+#define REDUCE_WORDS ((PICO_JOB_REDUCE_MAX_SIZE + sizeof(uint64_t) - 1) / sizeof(uint64_t))
+
+typedef struct {
+    job_reduce_body_t body;
+    job_reduce_combine_t combine;
+    void *arg;
+    size_t size;
+    uint64_t identity[REDUCE_WORDS];
+    // each core combines the values for the pieces it runs into its own partial result
+    uint64_t partial[NUM_CORES][REDUCE_WORDS];
+} parallel_reduce_t;
+
+static void parallel_reduce_range(void *arg, uint32_t begin, uint32_t end) {
+    parallel_reduce_t *pr = (parallel_reduce_t *) arg;
+    uint64_t acc[REDUCE_WORDS];
+    memcpy(acc, pr->identity, pr->size);
+    // body may itself wait for jobs (and so run other pieces on this core), so accumulate into a local first
+    pr->body(pr->arg, begin, end, acc);
+    pr->combine(pr->partial[get_core_num()], acc);
+}
+
+void parallel_reduce(uint32_t begin, uint32_t end, uint32_t grain, job_reduce_body_t body, job_reduce_combine_t combine,
+                     void *result, size_t result_size, void *arg) {
+    invalid_params_if(JOB, result_size > PICO_JOB_REDUCE_MAX_SIZE);
+    parallel_reduce_t pr = {.body = body, .combine = combine, .arg = arg, .size = result_size};
+    memcpy(pr.identity, result, result_size);
+    for (uint core = 0; core < NUM_CORES; core++) {
+        memcpy(pr.partial[core], result, result_size);
+    }
+    parallel_for(begin, end, grain, parallel_reduce_range, &pr);
+    memcpy(result, pr.partial[0], result_size);
+    for (uint core = 1; core < NUM_CORES; core++) {
+        combine(result, pr.partial[core]);
+    }
+}
+
+void job_system_get_stats(uint core, job_stats_t *stats) {
+    invalid_params_if(JOB, core >= NUM_CORES);
+    *stats = deques[core].stats;
+}
+
+void job_system_reset_stats(void) {
+    for (uint core = 0; core < NUM_CORES; core++) {
+        memset(&deques[core].stats, 0, sizeof(job_stats_t));
+    }
+}
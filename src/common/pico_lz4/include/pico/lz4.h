@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_LZ4_H
+#define _PICO_LZ4_H
+
+// NOTE: This file is also used by host tools (elf2uf2), so does not use SDK includes
+
+#include <stdint.h>
+
+/** \file pico/lz4.h
+ *  \defgroup pico_lz4 pico_lz4
+ * Compression and decompression of LZ4 blocks
+ *
+ * The data is in the LZ4 block format (without the LZ4 frame format around it), so each block is compressed
+ * independently, and blocks produced here may be decompressed by any LZ4 implementation and vice versa.
+ *
+ * Decompression is fast, needs no memory beyond the output buffer, and checks its input, so a corrupt or malicious
+ * block can't make it read or write outside the buffers it is given. Compression is a simple greedy match search,
+ * intended for host tools and occasional use; it is not as thorough (so does not compress as well) as the reference
+ * LZ4 compressor.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \brief The largest input \ref lz4_compress_block accepts
+ *  \ingroup pico_lz4
+ */
+#define LZ4_MAX_INPUT_SIZE 0xffffu
+
+/*! \brief The largest a block of a given size can become when compressed
+ *  \ingroup pico_lz4
+ */
+#define LZ4_COMPRESS_BOUND(size) ((size) + (size) / 255u + 16u)
+
+/*! \brief Compress a block
+ *  \ingroup pico_lz4
+ *
+ * This uses about 8K of stack.
+ *
+ * \param src the data to compress
+ * \param src_len the length of the data, at most \ref LZ4_MAX_INPUT_SIZE
+ * \param dst the buffer for the compressed block
+ * \param dst_capacity the size of the buffer; \ref LZ4_COMPRESS_BOUND (\p src_len) is always enough
+ * \return the length of the compressed block, or 0 if it would not fit in \p dst_capacity (or \p src_len is too large)
+ */
+uint32_t lz4_compress_block(const uint8_t *src, uint32_t src_len, uint8_t *dst, uint32_t dst_capacity);
+
+/*! \brief Decompress a block
+ *  \ingroup pico_lz4
+ *
+ * \param src the compressed block
+ * \param src_len the length of the compressed block
+ * \param dst the buffer for the decompressed data
+ * \param dst_capacity the size of the buffer
+ * \return the length of the decompressed data, or -1 if the block is malformed or would decompress to more than
+ * \p dst_capacity bytes
+ */
+int32_t lz4_decompress_block(const uint8_t *src, uint32_t src_len, uint8_t *dst, uint32_t dst_capacity);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "pico/lz4.h"
+
+// LZ4 block format: a sequence is a token (literal length in the high nibble, match length - 4 in the low nibble, 15
+// in either meaning more length bytes follow), the literals, a 2 byte little endian match offset and the extra match
+// length bytes. The last sequence has only literals. The format requires the last 5 bytes to be literals, and the
+// last match to start at least 12 bytes before the end.
+
+#define MIN_MATCH 4u
+#define LAST_LITERALS 5u
+#define MATCH_FIND_LIMIT 12u
+#define HASH_LOG 12u
+
+static inline uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint32_t hash32(uint32_t v) {
+    return (v * 2654435761u) >> (32 - HASH_LOG);
+}
+
+// the number of bytes needed for the extra length bytes of a length field
+static inline uint32_t extra_length_bytes(uint32_t len) {
+    return len < 15 ? 0 : (len - 15) / 255 + 1;
+}
+
+static uint8_t *write_extra_length(uint8_t *op, uint32_t len) {
+    len -= 15;
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+static uint8_t *write_sequence(uint8_t *op, const uint8_t *oend, const uint8_t *literals, uint32_t lit_len,
+                               uint32_t offset, uint32_t match_len) {
+    uint32_t needed = 1 + extra_length_bytes(lit_len) + lit_len;
+    if (match_len) needed += 2 + extra_length_bytes(match_len - MIN_MATCH);
+    if (needed > (uint32_t)(oend - op)) return NULL;
+    uint8_t *token = op++;
+    *token = (uint8_t)((lit_len < 15 ? lit_len : 15) << 4);
+    if (lit_len >= 15) op = write_extra_length(op, lit_len);
+    memcpy(op, literals, lit_len);
+    op += lit_len;
+    if (match_len) {
+        *op++ = (uint8_t)offset;
+        *op++ = (uint8_t)(offset >> 8);
+        uint32_t ml = match_len - MIN_MATCH;
+        *token |= (uint8_t)(ml < 15 ? ml : 15);
+        if (ml >= 15) op = write_extra_length(op, ml);
+    }
+    return op;
+}
+
+uint32_t lz4_compress_block(const uint8_t *src, uint32_t src_len, uint8_t *dst, uint32_t dst_capacity) {
+    if (src_len > LZ4_MAX_INPUT_SIZE) return 0;
+    uint8_t *op = dst;
+    const uint8_t *oend = dst + dst_capacity;
+    uint32_t anchor = 0;
+    if (src_len > MATCH_FIND_LIMIT) {
+        // positions fit in 16 bits, as does any offset, since the input is at most 64K
+        uint16_t table[1u << HASH_LOG];
+        memset(table, 0, sizeof(table));
+        uint32_t ip = 0;
+        uint32_t match_start_limit = src_len - MATCH_FIND_LIMIT;
+        while (ip < match_start_limit) {
+            uint32_t seq = read32(src + ip);
+            uint32_t h = hash32(seq);
+            uint32_t candidate = table[h];
+            table[h] = (uint16_t)ip;
+            if (candidate >= ip || read32(src + candidate) != seq) {
+                ip++;
+                continue;
+            }
+            uint32_t len = MIN_MATCH;
+            uint32_t max_len = src_len - LAST_LITERALS - ip;
+            while (len < max_len && src[candidate + len] == src[ip + len]) len++;
+            op = write_sequence(op, oend, src + anchor, ip - anchor, ip - candidate, len);
+            if (!op) return 0;
+            ip += len;
+            anchor = ip;
+            // index a position inside the match too, which helps with repetitive data
+            if (ip < match_start_limit) table[hash32(read32(src + ip - 2))] = (uint16_t)(ip - 2);
+        }
+    }
+    op = write_sequence(op, oend, src + anchor, src_len - anchor, 0, 0);
+    return op ? (uint32_t)(op - dst) : 0;
+}
+
+int32_t lz4_decompress_block(const uint8_t *src, uint32_t src_len, uint8_t *dst, uint32_t dst_capacity) {
+    const uint8_t *ip = src;
+    const uint8_t *iend = src + src_len;
+    uint8_t *op = dst;
+    uint8_t *oend = dst + dst_capacity;
+    while (true) {
+        if (ip >= iend) return -1;
+        uint32_t token = *ip++;
+        uint32_t lit_len = token >> 4;
+        if (lit_len == 15) {
+            uint32_t b;
+            do {
+                if (ip >= iend) return -1;
+                b = *ip++;
+                lit_len += b;
+            } while (b == 255 && lit_len <= src_len);
+        }
+        if (lit_len > (uint32_t)(iend - ip) || lit_len > (uint32_t)(oend - op)) return -1;
+        memcpy(op, ip, lit_len);
+        op += lit_len;
+        ip += lit_len;
+        // the last sequence has no match
+        if (ip == iend) break;
+        if (iend - ip < 2) return -1;
+        uint32_t offset = ip[0] | ((uint32_t)ip[1] << 8);
+        ip += 2;
+        if (!offset || offset > (uint32_t)(op - dst)) return -1;
+        uint32_t match_len = token & 15;
+        if (match_len == 15) {
+            uint32_t b;
+            do {
+                if (ip >= iend) return -1;
+                b = *ip++;
+                match_len += b;
+            } while (b == 255 && match_len <= dst_capacity);
+        }
+        match_len += MIN_MATCH;
+        if (match_len > (uint32_t)(oend - op)) return -1;
+        const uint8_t *match = op - offset;
+        if (offset >= match_len) {
+            memcpy(op, match, match_len);
+            op += match_len;
+        } else {
+            // overlapping, which repeats the last offset bytes
+            for (uint32_t i = 0; i < match_len; i++) *op++ = *match++;
+        }
+    }
+    return (int32_t)(op - dst);
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_PLL_SOLVER_H
+#define _PICO_PLL_SOLVER_H
+
+#include "pico.h"
+#if !PICO_NO_HARDWARE
+// for PICO_PLL_VCO_MIN_FREQ_MHZ and PICO_PLL_VCO_MAX_FREQ_MHZ
+#include "hardware/pll.h"
+#endif
+
+/** \file pico/pll_solver.h
+ *  \defgroup pico_pll_solver pico_pll_solver
+ * Calculation of PLL parameters for a requested output frequency
+ *
+ * A PLL (with a reference divider of 1) produces an output of
+ * <tt>ref * fbdiv / (postdiv1 * postdiv2)</tt>, where the VCO frequency <tt>ref * fbdiv</tt> must be between
+ * \ref PICO_PLL_VCO_MIN_FREQ_MHZ and \ref PICO_PLL_VCO_MAX_FREQ_MHZ, \c fbdiv between 16 and 320, and both post
+ * dividers between 1 and 7.
+ *
+ * Rather than trying every feedback divider, the solver works from the post dividers: for each of the 28 pairs
+ * (with \c postdiv2 no greater than \c postdiv1) only the two feedback dividers either side of the ideal one, clamped
+ * to the range the VCO limits allow, can give the closest output, so at most 56 candidates are compared. The result
+ * is the closest achievable frequency, whether or not it is exact; between equally close candidates, the one with the
+ * highest VCO frequency (which has the lowest jitter) wins, and then the one with the larger \c postdiv1. For an
+ * exactly achievable frequency this gives the same parameters as an exhaustive search from the highest feedback
+ * divider down.
+ *
+ * \ref pll_solve_khz_inline is an inline version, which is \c constexpr in C++14 and later so it can be evaluated at
+ * compile time for a fixed frequency (in C, the compiler will normally fold a call with constant arguments).
+ * \ref pll_solve_khz also keeps a small cache of recent results, for repeated changes between a few frequencies.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the defaults in hardware/pll.h, for platforms without it
+#ifndef PICO_PLL_VCO_MIN_FREQ_MHZ
+#define PICO_PLL_VCO_MIN_FREQ_MHZ 750
+#endif
+
+#ifndef PICO_PLL_VCO_MAX_FREQ_MHZ
+#define PICO_PLL_VCO_MAX_FREQ_MHZ 1600
+#endif
+
+// PICO_CONFIG: PICO_PLL_SOLVER_CACHE_SIZE, Number of recent results kept by pll_solve_khz, type=int, default=4, min=0, max=32, group=pico_pll_solver
+#ifndef PICO_PLL_SOLVER_CACHE_SIZE
+#define PICO_PLL_SOLVER_CACHE_SIZE 4
+#endif
+
+#define PICO_PLL_FBDIV_MIN 16
+#define PICO_PLL_FBDIV_MAX 320
+#define PICO_PLL_POSTDIV_MAX 7
+
+#if defined(__cplusplus) && __cplusplus >= 201402L
+#define __pll_solver_constexpr constexpr
+#else
+#define __pll_solver_constexpr
+#endif
+
+/*! \brief PLL parameters, and the frequency they give
+ *  \ingroup pico_pll_solver
+ */
+typedef struct pll_solution {
+    uint32_t vco_khz;   ///< the VCO frequency, or 0 if there is no solution
+    uint16_t fbdiv;     ///< the feedback divider
+    uint8_t postdiv1;   ///< the first post divider
+    uint8_t postdiv2;   ///< the second post divider, which is no greater than \c postdiv1
+    uint32_t out_hz;    ///< the output frequency, rounded to the nearest Hz
+    int32_t error_hz;   ///< the output frequency less the requested one, rounded to the nearest Hz
+    bool exact;         ///< the output frequency is exactly the requested one
+} pll_solution_t;
+
+/*! \brief Find the PLL parameters giving the closest output to a given frequency
+ *  \ingroup pico_pll_solver
+ *
+ * This is the inline (and, in C++, constexpr) version of \ref pll_solve_khz, which has no cache.
+ *
+ * \param ref_khz the PLL's reference frequency (after the reference divider)
+ * \param target_khz the requested output frequency
+ * \return the parameters; \c vco_khz is 0 if \p target_khz is 0, or no feedback divider puts the VCO in range
+ */
+static inline __pll_solver_constexpr pll_solution_t pll_solve_khz_inline(uint32_t ref_khz, uint32_t target_khz) {
+    pll_solution_t best = {0, 0, 0, 0, 0, 0, false};
+    if (!ref_khz || !target_khz) return best;
+    uint32_t fbdiv_min = (PICO_PLL_VCO_MIN_FREQ_MHZ * 1000u + ref_khz - 1) / ref_khz;
+    uint32_t fbdiv_max = PICO_PLL_VCO_MAX_FREQ_MHZ * 1000u / ref_khz;
+    if (fbdiv_min < PICO_PLL_FBDIV_MIN) fbdiv_min = PICO_PLL_FBDIV_MIN;
+    if (fbdiv_max > PICO_PLL_FBDIV_MAX) fbdiv_max = PICO_PLL_FBDIV_MAX;
+    if (fbdiv_min > fbdiv_max) return best;
+    // the output error of a candidate is err / postdiv, where err is the VCO's distance from target * postdiv; the
+    // errors are compared by cross multiplication so nothing is rounded
+    uint64_t best_err = 0;
+    uint32_t best_postdiv = 0;
+    for (uint32_t postdiv1 = PICO_PLL_POSTDIV_MAX; postdiv1 > 0; postdiv1--) {
+        for (uint32_t postdiv2 = postdiv1; postdiv2 > 0; postdiv2--) {
+            uint32_t postdiv = postdiv1 * postdiv2;
+            uint64_t ideal_vco = (uint64_t)target_khz * postdiv;
+            uint64_t below = ideal_vco / ref_khz;
+            // the higher candidate first, so it wins a tie
+            for (uint32_t i = 0; i < 2; i++) {
+                uint64_t fbdiv = below + 1 - i;
+                if (fbdiv < fbdiv_min) fbdiv = fbdiv_min;
+                if (fbdiv > fbdiv_max) fbdiv = fbdiv_max;
+                uint64_t vco = fbdiv * ref_khz;
+                uint64_t err = vco > ideal_vco ? vco - ideal_vco : ideal_vco - vco;
+                uint64_t lhs = err * (best_postdiv ? best_postdiv : 1);
+                uint64_t rhs = best_err * postdiv;
+                if (!best_postdiv || lhs < rhs || (lhs == rhs && vco > best.vco_khz)) {
+                    best.vco_khz = (uint32_t)vco;
+                    best.fbdiv = (uint16_t)fbdiv;
+                    best.postdiv1 = (uint8_t)postdiv1;
+                    best.postdiv2 = (uint8_t)postdiv2;
+                    best_err = err;
+                    best_postdiv = postdiv;
+                }
+            }
+        }
+    }
+    uint64_t vco_hz = (uint64_t)best.vco_khz * 1000;
+    best.out_hz = (uint32_t)((vco_hz + best_postdiv / 2) / best_postdiv);
+    best.error_hz = (int32_t)((int64_t)best.out_hz - (int64_t)target_khz * 1000);
+    best.exact = !best_err;
+    return best;
+}
+
+/*! \brief Find the PLL parameters giving the closest output to a given frequency
+ *  \ingroup pico_pll_solver
+ *
+ * See \ref pll_solve_khz_inline; this also looks in, and adds to, a cache of the last
+ * \ref PICO_PLL_SOLVER_CACHE_SIZE results. It may be called from either core.
+ *
+ * \param ref_khz the PLL's reference frequency (after the reference divider)
+ * \param target_khz the requested output frequency
+ * \param solution filled in with the parameters
+ * \return false if there is no solution (\p target_khz is 0, or no feedback divider puts the VCO in range)
+ */
+bool pll_solve_khz(uint32_t ref_khz, uint32_t target_khz, pll_solution_t *solution);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pico/pll_solver.h"
+#include "hardware/sync.h"
+
+#if PICO_PLL_SOLVER_CACHE_SIZE
+typedef struct {
+    uint32_t ref_khz;
+    uint32_t target_khz;    // 0 for an unused entry
+    pll_solution_t solution;
+} pll_cache_entry_t;
+
+static pll_cache_entry_t cache[PICO_PLL_SOLVER_CACHE_SIZE];
+static uint cache_next;     // the entry to replace next (the oldest)
+static spin_lock_t *cache_lock;
+
+static void __attribute__((constructor)) pll_solver_init(void) {
+    cache_lock = spin_lock_instance(next_striped_spin_lock_num());
+}
+#endif
+
+bool pll_solve_khz(uint32_t ref_khz, uint32_t target_khz, pll_solution_t *solution) {
+#if PICO_PLL_SOLVER_CACHE_SIZE
+    // (the cache is skipped if this is called before the constructor has run)
+    if (target_khz && cache_lock) {
+        uint32_t save = spin_lock_blocking(cache_lock);
+        for (uint i = 0; i < PICO_PLL_SOLVER_CACHE_SIZE; i++) {
+            if (cache[i].target_khz == target_khz && cache[i].ref_khz == ref_khz) {
+                *solution = cache[i].solution;
+                spin_unlock(cache_lock, save);
+                return true;
+            }
+        }
+        spin_unlock(cache_lock, save);
+    }
+#endif
+    *solution = pll_solve_khz_inline(ref_khz, target_khz);
+    if (!solution->vco_khz) return false;
+#if PICO_PLL_SOLVER_CACHE_SIZE
+    if (!cache_lock) return true;
+    uint32_t save = spin_lock_blocking(cache_lock);
+    pll_cache_entry_t *entry = &cache[cache_next];
+    cache_next = (cache_next + 1) % PICO_PLL_SOLVER_CACHE_SIZE;
+    entry->ref_khz = ref_khz;
+    entry->target_khz = target_khz;
+    entry->solution = *solution;
+    spin_unlock(cache_lock, save);
+#endif
+    return true;
+}
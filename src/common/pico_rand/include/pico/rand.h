@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_RAND_H
+#define _PICO_RAND_H
+
+#include "pico.h"
+
+/** \file pico/rand.h
+ *  \defgroup pico_rand pico_rand
+ * Fast random numbers, seeded from a background entropy pool
+ *
+ * Random numbers are produced by a ChaCha stream cipher based generator, with a separate generator for each core, so
+ * \ref get_rand_32 and friends are callable from either core, and from IRQ handlers, without taking a lock. Each call
+ * normally just takes the next word from a block of generator output, which costs a few tens of cycles; once per 16
+ * words a new block is generated (around 1000 cycles on an RP2040 with the default 8 rounds).
+ *
+ * The generators are seeded from an entropy pool, which conditions raw entropy by absorbing it into a sponge built on
+ * the ChaCha permutation. After every \ref PICO_RAND_REKEY_BLOCKS blocks, a generator replaces its key with output of
+ * its own (so earlier output can't be recovered from its state), and, if the pool has collected another
+ * \ref PICO_RAND_SEED_ENTROPY_BITS bits of entropy since it was last drawn on, mixes in a new seed from the pool.
+ *
+ * On the device, the pool is seeded from the jitter of the ring oscillator (ROSC) at startup, before main(), and more
+ * is then harvested in the background, a few bits at a time, from a repeating alarm on the default alarm pool. The
+ * alarm stops once the pool holds enough entropy to reseed a generator, and restarts when the pool is drawn on, so an
+ * application which rarely needs fresh seeds isn't woken to no purpose. The ROSC must be left running. On the host, the pool is seeded from the operating system's random number source.
+ *
+ * Further entropy (e.g. radio noise or packet arrival times) may be added with \ref pico_rand_add_entropy.
+ *
+ * \note the output is not suitable for cryptographic keys unless the entropy estimate for the ROSC
+ * (\ref PICO_RAND_ROSC_SAMPLES_PER_BIT) is appropriate for the board and clock configuration in use.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// PICO_CONFIG: PICO_RAND_CHACHA_ROUNDS, Number of ChaCha rounds used by the random number generator, type=int, default=8, min=8, max=20, group=pico_rand
+#ifndef PICO_RAND_CHACHA_ROUNDS
+#define PICO_RAND_CHACHA_ROUNDS 8
+#endif
+
+// PICO_CONFIG: PICO_RAND_REKEY_BLOCKS, Number of 64 byte blocks each core's generator produces before replacing its key (and reseeding if more entropy is available), type=int, default=16, min=1, max=255, group=pico_rand
+#ifndef PICO_RAND_REKEY_BLOCKS
+#define PICO_RAND_REKEY_BLOCKS 16
+#endif
+
+// PICO_CONFIG: PICO_RAND_SEED_ENTROPY_BITS, Bits of entropy the pool must collect before it seeds a generator, type=int, default=256, min=64, max=512, group=pico_rand
+#ifndef PICO_RAND_SEED_ENTROPY_BITS
+#define PICO_RAND_SEED_ENTROPY_BITS 256
+#endif
+
+// PICO_CONFIG: PICO_RAND_ROSC_SAMPLES_PER_BIT, Number of ROSC random bit samples credited as one bit of entropy, type=int, default=4, min=1, group=pico_rand
+#ifndef PICO_RAND_ROSC_SAMPLES_PER_BIT
+#define PICO_RAND_ROSC_SAMPLES_PER_BIT 4
+#endif
+
+/*! \brief A 128 bit random number
+ *  \ingroup pico_rand
+ */
+typedef struct {
+    uint64_t r[2];
+} rng_128_t;
+
+/*! \brief Get a 32 bit random number
+ *  \ingroup pico_rand
+ *
+ * \return the random number
+ */
+uint32_t get_rand_32(void);
+
+/*! \brief Get a 64 bit random number
+ *  \ingroup pico_rand
+ *
+ * \return the random number
+ */
+uint64_t get_rand_64(void);
+
+/*! \brief Get a 128 bit random number
+ *  \ingroup pico_rand
+ *
+ * \param rand128 filled in with the random number
+ */
+void get_rand_128(rng_128_t *rand128);
+
+/*! \brief Add entropy to the pool
+ *  \ingroup pico_rand
+ *
+ * The data is always mixed into the pool, but only counts towards reseeding the generators by the amount of
+ * entropy it is credited with.
+ *
+ * \param data the data
+ * \param len the length of the data in bytes
+ * \param entropy_bits a conservative estimate of the number of bits of entropy in the data
+ */
+void pico_rand_add_entropy(const void *data, uint len, uint entropy_bits);
+
+// \cond internal
+// implemented by the platform backend; called once, before any random numbers are generated, to seed the pool (with
+// pico_rand_add_entropy) and start any background harvesting
+void pico_rand_backend_init(void);
+
+// implemented by the platform backend; called (from whichever core drew on it, with interrupts disabled) after the
+// pool has seeded a generator, to restart any background harvesting
+void pico_rand_backend_entropy_drawn(void);
+
+// whether the pool has collected enough entropy to seed a generator, so needs no more for now
+bool pico_rand_pool_is_full(void);
+
+// the ChaCha block function: out is the input state after the given number of rounds, plus the input state; in and
+// out may be the same
+void pico_rand_chacha_block(const uint32_t in[16], uint32_t out[16], uint rounds);
+// \endcond
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+#include "pico/rand.h"
+#include "hardware/sync.h"
+
+// "expand 32-byte k"
+#define CHACHA_CONST0 0x61707865u
+#define CHACHA_CONST1 0x3320646eu
+#define CHACHA_CONST2 0x79622d32u
+#define CHACHA_CONST3 0x6b206574u
+
+// the pool is a sponge: entropy is absorbed into the first POOL_RATE words, and the whole state permuted when they
+// are full
+#define POOL_RATE 8
+
+typedef struct {
+    uint32_t key[8];
+    uint32_t block[16];     // output not yet used, taken from the end; used words are zeroed
+    uint32_t counter;
+    uint8_t remaining;      // number of words left in block
+    uint8_t blocks_left;    // number of blocks until the next rekey
+    bool seeded;
+} rand_generator_t;
+
+static rand_generator_t generators[NUM_CORES];
+
+static uint32_t pool[16];
+static uint pool_pos;
+static uint pool_entropy;   // bits credited since the pool last seeded a generator
+static bool pool_seeded;    // the pool has collected PICO_RAND_SEED_ENTROPY_BITS since startup
+static spin_lock_t *pool_lock;
+
+static inline uint32_t rotl(uint32_t v, uint n) {
+    return (v << n) | (v >> (32 - n));
+}
+
+#define QUARTER_ROUND(a, b, c, d) \
+    a += b; d = rotl(d ^ a, 16);  \
+    c += d; b = rotl(b ^ c, 12);  \
+    a += b; d = rotl(d ^ a, 8);   \
+    c += d; b = rotl(b ^ c, 7)
+
+void pico_rand_chacha_block(const uint32_t in[16], uint32_t out[16], uint rounds) {
+    uint32_t x[16];
+    memcpy(x, in, sizeof(x));
+    for (uint i = 0; i < rounds; i += 2) {
+        QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+        QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+        QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+        QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+        QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+        QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+        QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+        QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+    }
+    for (uint i = 0; i < 16; i++) {
+        out[i] = x[i] + in[i];
+    }
+}
+
+static void pool_permute(void) {
+    pico_rand_chacha_block(pool, pool, PICO_RAND_CHACHA_ROUNDS);
+    pool_pos = 0;
+}
+
+static inline void pool_absorb(uint32_t word) {
+    pool[pool_pos++] ^= word;
+    if (pool_pos == POOL_RATE) pool_permute();
+}
+
+static void rand_init(void) {
+    if (pool_lock) return;
+    pool_lock = spin_lock_instance(next_striped_spin_lock_num());
+    pico_rand_backend_init();
+}
+
+// run before main(), so the pool is seeded before either core can use it
+static void __attribute__((constructor)) rand_init_on_boot(void) {
+    rand_init();
+}
+
+void pico_rand_add_entropy(const void *data, uint len, uint entropy_bits) {
+    // in case this is called from another constructor
+    if (!pool_lock) rand_init();
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint32_t save = spin_lock_blocking(pool_lock);
+    while (len) {
+        uint n = MIN(len, 4u);
+        uint32_t word = 0;
+        memcpy(&word, bytes, n);
+        pool_absorb(word);
+        bytes += n;
+        len -= n;
+    }
+    pool_entropy = MIN(pool_entropy + entropy_bits, 2u * PICO_RAND_SEED_ENTROPY_BITS);
+    if (pool_entropy >= PICO_RAND_SEED_ENTROPY_BITS) pool_seeded = true;
+    spin_unlock(pool_lock, save);
+}
+
+bool pico_rand_pool_is_full(void) {
+    return pool_entropy >= PICO_RAND_SEED_ENTROPY_BITS;
+}
+
+static void pool_extract(uint32_t seed[8]) {
+    uint32_t save = spin_lock_blocking(pool_lock);
+    // a generator can't be seeded before the pool has been
+    hard_assert(pool_seeded);
+    pool_permute();
+    memcpy(seed, pool, 8 * sizeof(uint32_t));
+    // forget the output, so it can't be recovered from the pool's state
+    memset(pool, 0, POOL_RATE * sizeof(uint32_t));
+    pool_permute();
+    pool_entropy = 0;
+    spin_unlock(pool_lock, save);
+    pico_rand_backend_entropy_drawn();
+}
+
+static void generate_block(rand_generator_t *g, uint32_t out[16]) {
+    uint32_t in[16] = {
+            CHACHA_CONST0, CHACHA_CONST1, CHACHA_CONST2, CHACHA_CONST3,
+            g->key[0], g->key[1], g->key[2], g->key[3], g->key[4], g->key[5], g->key[6], g->key[7],
+            g->counter++, get_core_num(), 0, 0
+    };
+    pico_rand_chacha_block(in, out, PICO_RAND_CHACHA_ROUNDS);
+}
+
+static void rekey(rand_generator_t *g) {
+    uint32_t block[16];
+    generate_block(g, block);
+    // the new key is output which is never handed out
+    memcpy(g->key, block, sizeof(g->key));
+    if (!g->seeded || pool_entropy >= PICO_RAND_SEED_ENTROPY_BITS) {
+        if (!pool_lock) rand_init();
+        uint32_t seed[8];
+        pool_extract(seed);
+        for (uint i = 0; i < 8; i++) g->key[i] ^= seed[i];
+        g->seeded = true;
+    }
+    g->blocks_left = PICO_RAND_REKEY_BLOCKS;
+}
+
+// called with interrupts disabled, so an IRQ handler on the same core can't use the generator at the same time
+static void __noinline refill(rand_generator_t *g) {
+    if (!g->blocks_left) rekey(g);
+    generate_block(g, g->block);
+    g->blocks_left--;
+    g->remaining = 16;
+}
+
+static inline uint32_t next_word(rand_generator_t *g) {
+    if (!g->remaining) refill(g);
+    uint32_t value = g->block[--g->remaining];
+    g->block[g->remaining] = 0;
+    return value;
+}
+
+uint32_t get_rand_32(void) {
+    rand_generator_t *g = &generators[get_core_num()];
+    uint32_t save = save_and_disable_interrupts();
+    uint32_t value = next_word(g);
+    restore_interrupts(save);
+    return value;
+}
+
+uint64_t get_rand_64(void) {
+    rand_generator_t *g = &generators[get_core_num()];
+    uint32_t save = save_and_disable_interrupts();
+    uint64_t value = next_word(g);
+    value |= (uint64_t)next_word(g) << 32;
+    restore_interrupts(save);
+    return value;
+}
+
+void get_rand_128(rng_128_t *rand128) {
+    rand_generator_t *g = &generators[get_core_num()];
+    uint32_t save = save_and_disable_interrupts();
+    for (uint i = 0; i < 2; i++) {
+        uint64_t value = next_word(g);
+        rand128->r[i] = value | (uint64_t)next_word(g) << 32;
+    }
+    restore_interrupts(save);
+}
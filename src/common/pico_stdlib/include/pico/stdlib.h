@@ -117,7 +117,7 @@ bool check_sys_clock_khz(uint32_t freq_khz, uint *vco_freq_out, uint *post_div1_
  *
  * Note that not all clock frequencies are possible; it is preferred that you
  * use src/rp2_common/hardware_clocks/scripts/vcocalc.py to calculate the parameters
- * for use with set_sys_clock_pll
+ * for use with set_sys_clock_pll, or \ref pll_solve_khz to find the closest achievable frequency
  *
  * \param freq_khz Requested frequency
  * \param required if true then this function will assert if the frequency is not attainable.
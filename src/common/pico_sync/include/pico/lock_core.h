@@ -102,6 +102,56 @@ void lock_init(lock_core_t *core, uint lock_num);
 #define lock_is_owner_id_valid(id) ((id) != LOCK_INVALID_OWNER_ID)
 #endif
 
+#ifndef lock_priority_t
+/*! \brief  type to use to store the scheduling priority of a lock owner, for priority inheritance
+ *  \ingroup lock_core
+ * Larger values are more urgent. By default this is uint8_t, however it may be overridden if a larger type is required
+ */
+#define lock_priority_t uint8_t
+#endif
+
+#ifndef lock_get_caller_priority
+/*! \brief  return the scheduling priority of the caller
+ *  \ingroup lock_core
+ * By default all callers have the same priority (0), but this may be overridden (e.g. to return the current RTOS task's
+ * priority) to enable priority inheritance in \ref pi_mutex
+ */
+#define lock_get_caller_priority() ((lock_priority_t)0)
+#endif
+
+#ifndef lock_set_owner_priority
+/*! \brief  set the scheduling priority of a lock owner
+ *  \ingroup lock_core
+ *
+ * This is used by \ref pi_mutex to raise the priority of a mutex owner to that of a higher priority waiter, and
+ * to restore the owner's priority when it releases the mutex. It is called with the lock's spin lock held,
+ * so must not block.
+ *
+ * By default this does nothing, but it may be overridden (e.g. to change an RTOS task's priority)
+ *
+ * \param owner the lock_owner_id_t of the owner
+ * \param priority the new priority
+ */
+#define lock_set_owner_priority(owner, priority) ((void)0)
+#endif
+
+#if PICO_LOCK_STATS
+// \cond internal
+// wait_start_us is the time the caller first had to wait for the lock (with bit 0 set so it is non zero), or 0 if it hasn't waited
+static inline void lock_stats_note_wait(uint32_t *wait_start_us) {
+    if (!*wait_start_us) *wait_start_us = lock_stats_time_us() | 1;
+}
+#define lock_stats_acquired(stats, wait_start_us) lock_stats_record_acquire(stats, (wait_start_us) != 0, wait_start_us)
+#define lock_stats_released(stats) lock_stats_record_release(stats)
+#define lock_stats_clear(stats) (*(stats) = (lock_stats_t){0})
+// \endcond
+#else
+#define lock_stats_note_wait(wait_start_us) ((void)0)
+#define lock_stats_acquired(stats, wait_start_us) ((void)(wait_start_us))
+#define lock_stats_released(stats) ((void)0)
+#define lock_stats_clear(stats) ((void)0)
+#endif
+
 #ifndef lock_internal_spin_unlock_with_wait
 /*! \brief   Atomically unlock the lock's spin lock, and wait for a notification.
  *  \ingroup lock_core
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_LOCK_STATS_H
+#define _PICO_LOCK_STATS_H
+
+#include "pico/mutex.h"
+#include "pico/sem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file lock_stats.h
+ *  \defgroup lock_stats lock_stats
+ *  \ingroup pico_sync
+ * \brief Lock contention statistics
+ *
+ * When PICO_LOCK_STATS is 1, every hardware spin lock, \ref mutex_t, \ref recursive_mutex_t and \ref semaphore_t
+ * records how often it was acquired (in total and by each core), how often and for how long callers had to wait for
+ * it, and the longest time it was held. Spin locks additionally record the number of failed attempts to claim them.
+ *
+ * Mutexes and semaphores may be registered with a name, so that they can be identified when the statistics are
+ * printed by \ref lock_stats_dump. Spin locks are always included in the dump (if they have been used), and may also be
+ * given a name. The statistics of the registered locks can also be found by a debugger via the \ref lock_stats_table
+ * variable, whose address is recorded in the binary info.
+ *
+ * When PICO_LOCK_STATS is 0 (the default), no statistics are recorded, the lock structures are unchanged and these
+ * functions do nothing.
+ *
+ * \note The statistics of a lock are updated while its internal spin lock is held, so are consistent with each other,
+ * however they are read without locking by \ref lock_stats_dump.
+ */
+
+// PICO_CONFIG: PICO_LOCK_STATS_MAX_REGISTERED, Maximum number of locks which may be registered by name for lock statistics, type=int, default=16, group=pico_sync
+#ifndef PICO_LOCK_STATS_MAX_REGISTERED
+#define PICO_LOCK_STATS_MAX_REGISTERED 16
+#endif
+
+#if PICO_LOCK_STATS
+/*! \brief A lock registered by name
+ *  \ingroup lock_stats
+ */
+typedef struct {
+    const char *name;
+    lock_stats_t *stats;
+} lock_stats_registration_t;
+
+/*! \brief The table of lock statistics, for use by debuggers
+ *  \ingroup lock_stats
+ */
+typedef struct {
+    lock_stats_t *spin_lock_stats;  ///< statistics for each spin lock, indexed by spin lock number
+    uint32_t num_spin_locks;
+    uint32_t num_registered;
+    lock_stats_registration_t registered[PICO_LOCK_STATS_MAX_REGISTERED];
+} lock_stats_table_t;
+
+extern lock_stats_table_t lock_stats_table;
+
+/*! \brief Register lock statistics with a name
+ *  \ingroup lock_stats
+ *
+ * This is generally called via one of the type specific wrappers such as \ref mutex_stats_register. Registering
+ * the same statistics again just changes the name.
+ *
+ * \param stats the statistics
+ * \param name the name to use in \ref lock_stats_dump. This must remain valid
+ * \return true if the statistics were registered, false if PICO_LOCK_STATS_MAX_REGISTERED locks are already registered
+ */
+bool lock_stats_register(lock_stats_t *stats, const char *name);
+
+/*! \brief Print the statistics for all used spin locks and registered locks to stdout
+ *  \ingroup lock_stats
+ */
+void lock_stats_dump(void);
+
+/*! \brief Reset the statistics for all spin locks and registered locks
+ *  \ingroup lock_stats
+ *
+ * The current hold of any lock which is held at the time is still timed when it is released.
+ */
+void lock_stats_reset(void);
+
+static inline bool spin_lock_stats_register(uint lock_num, const char *name) {
+    return lock_stats_register(&spin_lock_stats[lock_num], name);
+}
+
+static inline bool mutex_stats_register(mutex_t *mtx, const char *name) {
+    return lock_stats_register(&mtx->stats, name);
+}
+
+static inline bool recursive_mutex_stats_register(recursive_mutex_t *mtx, const char *name) {
+    return lock_stats_register(&mtx->stats, name);
+}
+
+static inline bool sem_stats_register(semaphore_t *sem, const char *name) {
+    return lock_stats_register(&sem->stats, name);
+}
+#else
+static inline bool spin_lock_stats_register(__unused uint lock_num, __unused const char *name) {
+    return false;
+}
+
+static inline bool mutex_stats_register(__unused mutex_t *mtx, __unused const char *name) {
+    return false;
+}
+
+static inline bool recursive_mutex_stats_register(__unused recursive_mutex_t *mtx, __unused const char *name) {
+    return false;
+}
+
+static inline bool sem_stats_register(__unused semaphore_t *sem, __unused const char *name) {
+    return false;
+}
+
+static inline void lock_stats_dump(void) {}
+
+static inline void lock_stats_reset(void) {}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -46,6 +46,9 @@ extern "C" {
  */
 typedef struct __packed_aligned  {
     lock_core_t core;
+#if PICO_LOCK_STATS
+    lock_stats_t stats;         //! contention statistics
+#endif
     lock_owner_id_t owner;      //! owner id LOCK_INVALID_OWNER_ID for unowned
     uint8_t enter_count;        //! ownership count
 #if PICO_MUTEX_ENABLE_SDK120_COMPATIBILITY
@@ -59,6 +62,9 @@ typedef struct __packed_aligned  {
 #if !PICO_MUTEX_ENABLE_SDK120_COMPATIBILITY
 typedef struct __packed_aligned mutex {
     lock_core_t core;
+#if PICO_LOCK_STATS
+    lock_stats_t stats;         //! contention statistics
+#endif
     lock_owner_id_t owner;      //! owner id LOCK_INVALID_OWNER_ID for unowned
 } mutex_t;
 #else
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_PI_MUTEX_H
+#define _PICO_PI_MUTEX_H
+
+#include "pico/lock_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file pi_mutex.h
+ *  \defgroup pi_mutex pi_mutex
+ *  \ingroup pico_sync
+ * \brief Priority inheriting mutex API
+ *
+ * A priority inheriting mutex is a regular (non recursive) mutex which avoids priority inversion: while a caller is
+ * waiting for the mutex, the owner's priority is raised to that of the highest priority waiter, so that the owner
+ * is not prevented from releasing the mutex by medium priority work. When the owner releases the mutex, its
+ * priority is restored to what it was when it took ownership.
+ *
+ * Priorities and owners are supplied by the \ref lock_get_caller_priority, \ref lock_set_owner_priority and
+ * \ref lock_get_caller_owner_id macros, which an RTOS integration overrides to use its task priorities and task ids.
+ * With the plain SDK, all callers have the same priority, so a pi_mutex behaves like a \ref mutex_t.
+ *
+ * \note If an owner holds more than one pi_mutex at once, they should be released in the reverse order to which they were
+ * acquired, so that the priority is restored correctly.
+ *
+ * The mutex also counts how often callers had to wait for it, and how often the owner's priority was raised.
+ */
+
+/*! \brief priority inheriting mutex instance
+ * \ingroup pi_mutex
+ */
+typedef struct __packed_aligned pi_mutex {
+    lock_core_t core;
+    lock_owner_id_t owner;              //! owner id LOCK_INVALID_OWNER_ID for unowned
+    lock_priority_t owner_priority;     //! the owner's priority when it took ownership
+    lock_priority_t boosted_priority;   //! the priority the owner has been raised to (if higher than owner_priority)
+    uint32_t contentions;               //! number of times a caller had to wait for the mutex
+    uint32_t priority_boosts;           //! number of times the owner's priority was raised
+} pi_mutex_t;
+
+/*! \brief  Initialise a priority inheriting mutex structure
+ *  \ingroup pi_mutex
+ *
+ * \param mtx Pointer to mutex structure
+ */
+void pi_mutex_init(pi_mutex_t *mtx);
+
+/*! \brief  Take ownership of a priority inheriting mutex
+ *  \ingroup pi_mutex
+ *
+ * This function will block until the caller can be granted ownership of the mutex, raising the priority of the
+ * current owner to that of the caller while it waits, if the caller's is higher.
+ * On return the caller owns the mutex
+ *
+ * \param mtx Pointer to mutex structure
+ */
+void pi_mutex_enter_blocking(pi_mutex_t *mtx);
+
+/*! \brief Attempt to take ownership of a priority inheriting mutex
+ *  \ingroup pi_mutex
+ *
+ * If the mutex wasn't owned, this will claim the mutex for the caller and return true.
+ * Otherwise (if the mutex was already owned) this will return false and the
+ * caller will NOT own the mutex.
+ *
+ * \param mtx Pointer to mutex structure
+ * \param owner_out If mutex was already owned, and this pointer is non-zero, it will be filled in with the owner id of the current owner of the mutex
+ * \return true if mutex now owned, false otherwise
+ */
+bool pi_mutex_try_enter(pi_mutex_t *mtx, uint32_t *owner_out);
+
+/*! \brief Wait for a priority inheriting mutex until a specific time
+ *  \ingroup pi_mutex
+ *
+ * Wait until the specific time to take ownership of the mutex, raising the priority of the current owner while waiting
+ * as for \ref pi_mutex_enter_blocking. If the caller can be granted ownership of the mutex before the timeout expires,
+ * then true will be returned and the caller will own the mutex, otherwise false will be returned and the caller
+ * will NOT own the mutex.
+ *
+ * \param mtx Pointer to mutex structure
+ * \param until The time after which to return if the caller cannot be granted ownership of the mutex
+ * \return true if mutex now owned, false if timeout occurred before ownership could be granted
+ */
+bool pi_mutex_enter_block_until(pi_mutex_t *mtx, absolute_time_t until);
+
+/*! \brief Wait for a priority inheriting mutex with timeout
+ *  \ingroup pi_mutex
+ *
+ * \param mtx Pointer to mutex structure
+ * \param timeout_ms The timeout in milliseconds.
+ * \return true if mutex now owned, false if timeout occurred before ownership could be granted
+ */
+bool pi_mutex_enter_timeout_ms(pi_mutex_t *mtx, uint32_t timeout_ms);
+
+/*! \brief  Release ownership of a priority inheriting mutex
+ *  \ingroup pi_mutex
+ *
+ * If the caller's priority was raised while it owned the mutex, it is restored.
+ *
+ * \param mtx Pointer to mutex structure
+ */
+void pi_mutex_exit(pi_mutex_t *mtx);
+
+/*! \brief Test for priority inheriting mutex initialized state
+ *  \ingroup pi_mutex
+ *
+ * \param mtx Pointer to mutex structure
+ * \return true if the mutex is initialized, false otherwise
+ */
+static inline bool pi_mutex_is_initialized(pi_mutex_t *mtx) {
+    return mtx->core.spin_lock != 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
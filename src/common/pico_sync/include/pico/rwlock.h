@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_RWLOCK_H
+#define _PICO_RWLOCK_H
+
+#include "pico/lock_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file rwlock.h
+ *  \defgroup rwlock rwlock
+ *  \ingroup pico_sync
+ * \brief Reader-writer lock API for read-mostly data
+ *
+ * A reader-writer lock may be held either by any number of readers at once (shared), or by a single writer (exclusive).
+ * This suits data which is read often but rarely changed, such as configuration, as readers do not block each other.
+ *
+ * Writers are given preference: once a writer is waiting, new readers wait until it has acquired and released the lock,
+ * so a steady stream of readers cannot starve a writer. As a consequence a reader must not try to re-enter the lock
+ * shared while it already holds it, as that would deadlock if a writer started waiting in between.
+ *
+ * The lock owner (see \ref lock_get_caller_owner_id) is recorded for the writer only. The lock counts how often
+ * readers and writers had to wait.
+ *
+ * As with mutexes, it is generally a bad idea to call the blocking functions from within an IRQ handler.
+ */
+
+/*! \brief reader-writer lock instance
+ * \ingroup rwlock
+ */
+typedef struct __packed_aligned rwlock {
+    lock_core_t core;
+    lock_owner_id_t writer;         //! owner id of the writer, or LOCK_INVALID_OWNER_ID if not held exclusively
+    uint8_t writers_waiting;        //! number of writers waiting for the lock
+    uint16_t readers;               //! number of readers holding the lock
+    uint32_t read_contentions;      //! number of times a reader had to wait
+    uint32_t write_contentions;     //! number of times a writer had to wait
+} rwlock_t;
+
+/*! \brief  Initialise a reader-writer lock structure
+ *  \ingroup rwlock
+ *
+ * \param rwl Pointer to reader-writer lock structure
+ */
+void rwlock_init(rwlock_t *rwl);
+
+/*! \brief  Acquire a reader-writer lock shared (for reading)
+ *  \ingroup rwlock
+ *
+ * This function will block while the lock is held by a writer, or a writer is waiting for it.
+ *
+ * \param rwl Pointer to reader-writer lock structure
+ */
+void rwlock_read_enter_blocking(rwlock_t *rwl);
+
+/*! \brief  Attempt to acquire a reader-writer lock shared (for reading)
+ *  \ingroup rwlock
+ *
+ * \param rwl Pointer to reader-writer lock structure
+ * \return true if the lock is now held shared by the caller, false if it is held by a writer or a writer is waiting
+ */
+bool rwlock_read_try_enter(rwlock_t *rwl);
+
+/*! \brief  Acquire a reader-writer lock shared (for reading), waiting until a specific time
+ *  \ingroup rwlock
+ *
+ * \param rwl Pointer to reader-writer lock structure
+ * \param until The time after which to return if the lock cannot be acquired
+ * \return true if the lock is now held shared by the caller, false if the timeout occurred first
+ */
+bool rwlock_read_enter_block_until(rwlock_t *rwl, absolute_time_t until);
+
+/*! \brief  Release a reader-writer lock held shared
+ *  \ingroup rwlock
+ *
+ * \param rwl Pointer to reader-writer lock structure
+ */
+void rwlock_read_exit(rwlock_t *rwl);
+
+/*! \brief  Acquire a reader-writer lock exclusively (for writing)
+ *  \ingroup rwlock
+ *
+ * This function will block until there are no readers and no other writer holding the lock.
+ *
+ * \param rwl Pointer to reader-writer lock structure
+ */
+void rwlock_write_enter_blocking(rwlock_t *rwl);
+
+/*! \brief  Attempt to acquire a reader-writer lock exclusively (for writing)
+ *  \ingroup rwlock
+ *
+ * \param rwl Pointer to reader-writer lock structure
+ * \return true if the lock is now held exclusively by the caller, false if it is held by anyone else
+ */
+bool rwlock_write_try_enter(rwlock_t *rwl);
+
+/*! \brief  Acquire a reader-writer lock exclusively (for writing), waiting until a specific time
+ *  \ingroup rwlock
+ *
+ * \param rwl Pointer to reader-writer lock structure
+ * \param until The time after which to return if the lock cannot be acquired
+ * \return true if the lock is now held exclusively by the caller, false if the timeout occurred first
+ */
+bool rwlock_write_enter_block_until(rwlock_t *rwl, absolute_time_t until);
+
+/*! \brief  Release a reader-writer lock held exclusively
+ *  \ingroup rwlock
+ *
+ * \param rwl Pointer to reader-writer lock structure
+ */
+void rwlock_write_exit(rwlock_t *rwl);
+
+/*! \brief Test for reader-writer lock initialized state
+ *  \ingroup rwlock
+ *
+ * \param rwl Pointer to reader-writer lock structure
+ * \return true if the lock is initialized, false otherwise
+ */
+static inline bool rwlock_is_initialized(rwlock_t *rwl) {
+    return rwl->core.spin_lock != 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
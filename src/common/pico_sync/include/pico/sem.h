@@ -30,6 +30,9 @@ extern "C" {
 #endif
 typedef struct __packed_aligned semaphore {
     struct lock_core core;
+#if PICO_LOCK_STATS
+    lock_stats_t stats;
+#endif
     int16_t permits;
     int16_t max_permits;
 } semaphore_t;
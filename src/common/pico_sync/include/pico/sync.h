@@ -14,6 +14,9 @@
 
 #include "pico/sem.h"
 #include "pico/mutex.h"
+#include "pico/pi_mutex.h"
+#include "pico/rwlock.h"
 #include "pico/critical_section.h"
+#include "pico/lock_stats.h"
 
 #endif
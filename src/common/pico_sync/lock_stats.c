@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include "pico/lock_stats.h"
+
+#if PICO_LOCK_STATS
+#include "pico/binary_info.h"
+
+lock_stats_table_t lock_stats_table = {
+    .spin_lock_stats = spin_lock_stats,
+    .num_spin_locks = NUM_SPIN_LOCKS,
+};
+
+bi_decl(bi_int(BINARY_INFO_TAG_RASPBERRY_PI, BINARY_INFO_ID_RP_LOCK_STATS_TABLE, (int32_t)(uintptr_t)&lock_stats_table))
+
+bool lock_stats_register(lock_stats_t *stats, const char *name) {
+    uint32_t save = save_and_disable_interrupts();
+    uint i;
+    for (i = 0; i < lock_stats_table.num_registered; i++) {
+        if (lock_stats_table.registered[i].stats == stats) break;
+    }
+    bool ok = i < PICO_LOCK_STATS_MAX_REGISTERED;
+    if (ok) {
+        lock_stats_table.registered[i].name = name;
+        lock_stats_table.registered[i].stats = stats;
+        // publish the entry before it is counted
+        __mem_fence_release();
+        if (i == lock_stats_table.num_registered) lock_stats_table.num_registered++;
+    }
+    restore_interrupts(save);
+    return ok;
+}
+
+static const char *spin_lock_name(uint lock_num) {
+    for (uint i = 0; i < lock_stats_table.num_registered; i++) {
+        if (lock_stats_table.registered[i].stats == &spin_lock_stats[lock_num]) return lock_stats_table.registered[i].name;
+    }
+    return NULL;
+}
+
+static void dump_stats(const char *name, uint num, const lock_stats_t *stats) {
+    if (name) {
+        printf("%-20s", name);
+    } else {
+        printf("spin lock %-10u", num);
+    }
+    printf(" %10u %10u %10u %10u %10u", (uint) stats->acquires, (uint) stats->contentions, (uint) stats->spins,
+           (uint) stats->total_wait_us, (uint) stats->max_hold_us);
+    for (uint core = 0; core < NUM_CORES; core++) {
+        printf(" %10u", (uint) stats->core_acquires[core]);
+    }
+    printf("\n");
+}
+
+void lock_stats_dump(void) {
+    printf("lock                   acquires contention      spins    wait_us max_hold_us");
+    for (uint core = 0; core < NUM_CORES; core++) {
+        printf("      core%u", core);
+    }
+    printf("\n");
+    for (uint i = 0; i < NUM_SPIN_LOCKS; i++) {
+        if (spin_lock_stats[i].acquires) dump_stats(spin_lock_name(i), i, &spin_lock_stats[i]);
+    }
+    for (uint i = 0; i < lock_stats_table.num_registered; i++) {
+        const lock_stats_registration_t *r = &lock_stats_table.registered[i];
+        if (r->stats < spin_lock_stats || r->stats >= spin_lock_stats + NUM_SPIN_LOCKS) {
+            dump_stats(r->name, 0, r->stats);
+        }
+    }
+}
+
+static void reset_stats(lock_stats_t *stats) {
+    // keep track of whether the lock is held, so the hold time of the current owner is still recorded
+    uint32_t acquired_at_us = stats->acquired_at_us;
+    bool held = stats->held;
+    *stats = (lock_stats_t){0};
+    stats->acquired_at_us = acquired_at_us;
+    stats->held = held;
+}
+
+void lock_stats_reset(void) {
+    for (uint i = 0; i < NUM_SPIN_LOCKS; i++) {
+        reset_stats(&spin_lock_stats[i]);
+    }
+    for (uint i = 0; i < lock_stats_table.num_registered; i++) {
+        reset_stats(lock_stats_table.registered[i].stats);
+    }
+}
+#endif
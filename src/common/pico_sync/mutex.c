@@ -10,6 +10,7 @@
 void mutex_init(mutex_t *mtx) {
     lock_init(&mtx->core, next_striped_spin_lock_num());
     mtx->owner = LOCK_INVALID_OWNER_ID;
+    lock_stats_clear(&mtx->stats);
 #if PICO_MUTEX_ENABLE_SDK120_COMPATIBILITY
     mtx->recursive = false;
 #endif
@@ -20,6 +21,7 @@ void recursive_mutex_init(recursive_mutex_t *mtx) {
     lock_init(&mtx->core, next_striped_spin_lock_num());
     mtx->owner = LOCK_INVALID_OWNER_ID;
     mtx->enter_count = 0;
+    lock_stats_clear(&mtx->stats);
 #if PICO_MUTEX_ENABLE_SDK120_COMPATIBILITY
     mtx->recursive = true;
 #endif
@@ -34,28 +36,34 @@ void __time_critical_func(mutex_enter_blocking)(mutex_t *mtx) {
     }
 #endif
     lock_owner_id_t caller = lock_get_caller_owner_id();
+    uint32_t __unused wait_start_us = 0;
     do {
         uint32_t save = spin_lock_blocking(mtx->core.spin_lock);
         if (!lock_is_owner_id_valid(mtx->owner)) {
             mtx->owner = caller;
+            lock_stats_acquired(&mtx->stats, wait_start_us);
             spin_unlock(mtx->core.spin_lock, save);
             break;
         }
+        lock_stats_note_wait(&wait_start_us);
         lock_internal_spin_unlock_with_wait(&mtx->core, save);
     } while (true);
 }
 
 void __time_critical_func(recursive_mutex_enter_blocking)(recursive_mutex_t *mtx) {
     lock_owner_id_t caller = lock_get_caller_owner_id();
+    uint32_t __unused wait_start_us = 0;
     do {
         uint32_t save = spin_lock_blocking(mtx->core.spin_lock);
         if (mtx->owner == caller || !lock_is_owner_id_valid(mtx->owner)) {
             mtx->owner = caller;
             uint __unused total = ++mtx->enter_count;
+            if (total == 1) lock_stats_acquired(&mtx->stats, wait_start_us);
             spin_unlock(mtx->core.spin_lock, save);
             assert(total); // check for overflow
             return;
         } else {
+            lock_stats_note_wait(&wait_start_us);
             lock_internal_spin_unlock_with_wait(&mtx->core, save);
         }
     } while (true);
@@ -71,6 +79,7 @@ bool __time_critical_func(mutex_try_enter)(mutex_t *mtx, uint32_t *owner_out) {
     uint32_t save = spin_lock_blocking(mtx->core.spin_lock);
     if (!lock_is_owner_id_valid(mtx->owner)) {
         mtx->owner = lock_get_caller_owner_id();
+        lock_stats_acquired(&mtx->stats, 0);
         entered = true;
     } else {
         if (owner_out) *owner_out = (uint32_t) mtx->owner;
@@ -88,6 +97,7 @@ bool __time_critical_func(recursive_mutex_try_enter)(recursive_mutex_t *mtx, uin
         mtx->owner = caller;
         uint __unused total = ++mtx->enter_count;
         assert(total); // check for overflow
+        if (total == 1) lock_stats_acquired(&mtx->stats, 0);
         entered = true;
     } else {
         if (owner_out) *owner_out = (uint32_t) mtx->owner;
@@ -121,13 +131,16 @@ bool __time_critical_func(mutex_enter_block_until)(mutex_t *mtx, absolute_time_t
 #endif
     assert(mtx->core.spin_lock);
     lock_owner_id_t caller = lock_get_caller_owner_id();
+    uint32_t __unused wait_start_us = 0;
     do {
         uint32_t save = spin_lock_blocking(mtx->core.spin_lock);
         if (!lock_is_owner_id_valid(mtx->owner)) {
             mtx->owner = caller;
+            lock_stats_acquired(&mtx->stats, wait_start_us);
             spin_unlock(mtx->core.spin_lock, save);
             return true;
         } else {
+            lock_stats_note_wait(&wait_start_us);
             if (lock_internal_spin_unlock_with_best_effort_wait_or_timeout(&mtx->core, save, until)) {
                 // timed out
                 return false;
@@ -140,15 +153,18 @@ bool __time_critical_func(mutex_enter_block_until)(mutex_t *mtx, absolute_time_t
 bool __time_critical_func(recursive_mutex_enter_block_until)(recursive_mutex_t *mtx, absolute_time_t until) {
     assert(mtx->core.spin_lock);
     lock_owner_id_t caller = lock_get_caller_owner_id();
+    uint32_t __unused wait_start_us = 0;
     do {
         uint32_t save = spin_lock_blocking(mtx->core.spin_lock);
         if (!lock_is_owner_id_valid(mtx->owner) || mtx->owner == caller) {
             mtx->owner = caller;
             uint __unused total = ++mtx->enter_count;
+            if (total == 1) lock_stats_acquired(&mtx->stats, wait_start_us);
             spin_unlock(mtx->core.spin_lock, save);
             assert(total); // check for overflow
             return true;
         } else {
+            lock_stats_note_wait(&wait_start_us);
             if (lock_internal_spin_unlock_with_best_effort_wait_or_timeout(&mtx->core, save, until)) {
                 // timed out
                 return false;
@@ -168,6 +184,7 @@ void __time_critical_func(mutex_exit)(mutex_t *mtx) {
     uint32_t save = spin_lock_blocking(mtx->core.spin_lock);
     assert(lock_is_owner_id_valid(mtx->owner));
     mtx->owner = LOCK_INVALID_OWNER_ID;
+    lock_stats_released(&mtx->stats);
     lock_internal_spin_unlock_with_notify(&mtx->core, save);
 }
 
@@ -177,6 +194,7 @@ void __time_critical_func(recursive_mutex_exit)(recursive_mutex_t *mtx) {
     assert(mtx->enter_count);
     if (!--mtx->enter_count) {
         mtx->owner = LOCK_INVALID_OWNER_ID;
+        lock_stats_released(&mtx->stats);
         lock_internal_spin_unlock_with_notify(&mtx->core, save);
     } else {
         spin_unlock(mtx->core.spin_lock, save);
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pico/pi_mutex.h"
+#include "pico/time.h"
+
+void pi_mutex_init(pi_mutex_t *mtx) {
+    lock_init(&mtx->core, next_striped_spin_lock_num());
+    mtx->owner = LOCK_INVALID_OWNER_ID;
+    mtx->owner_priority = mtx->boosted_priority = 0;
+    mtx->contentions = 0;
+    mtx->priority_boosts = 0;
+    __mem_fence_release();
+}
+
+// called with the spin lock held; returns true if the caller now owns the mutex. Otherwise the owner's priority is
+// raised to the caller's if necessary
+static inline bool pi_mutex_try_claim(pi_mutex_t *mtx, lock_owner_id_t caller, lock_priority_t priority, bool *waited) {
+    if (!lock_is_owner_id_valid(mtx->owner)) {
+        mtx->owner = caller;
+        mtx->owner_priority = mtx->boosted_priority = priority;
+        return true;
+    }
+    if (!*waited) {
+        mtx->contentions++;
+        *waited = true;
+    }
+    if (priority > mtx->boosted_priority) {
+        mtx->boosted_priority = priority;
+        mtx->priority_boosts++;
+        lock_set_owner_priority(mtx->owner, priority);
+    }
+    return false;
+}
+
+void __time_critical_func(pi_mutex_enter_blocking)(pi_mutex_t *mtx) {
+    assert(mtx->core.spin_lock);
+    lock_owner_id_t caller = lock_get_caller_owner_id();
+    lock_priority_t priority = lock_get_caller_priority();
+    bool waited = false;
+    do {
+        uint32_t save = spin_lock_blocking(mtx->core.spin_lock);
+        if (pi_mutex_try_claim(mtx, caller, priority, &waited)) {
+            spin_unlock(mtx->core.spin_lock, save);
+            return;
+        }
+        lock_internal_spin_unlock_with_wait(&mtx->core, save);
+    } while (true);
+}
+
+bool __time_critical_func(pi_mutex_try_enter)(pi_mutex_t *mtx, uint32_t *owner_out) {
+    bool entered;
+    uint32_t save = spin_lock_blocking(mtx->core.spin_lock);
+    if (!lock_is_owner_id_valid(mtx->owner)) {
+        mtx->owner = lock_get_caller_owner_id();
+        mtx->owner_priority = mtx->boosted_priority = lock_get_caller_priority();
+        entered = true;
+    } else {
+        if (owner_out) *owner_out = (uint32_t) mtx->owner;
+        entered = false;
+    }
+    spin_unlock(mtx->core.spin_lock, save);
+    return entered;
+}
+
+bool __time_critical_func(pi_mutex_enter_block_until)(pi_mutex_t *mtx, absolute_time_t until) {
+    assert(mtx->core.spin_lock);
+    lock_owner_id_t caller = lock_get_caller_owner_id();
+    lock_priority_t priority = lock_get_caller_priority();
+    bool waited = false;
+    do {
+        uint32_t save = spin_lock_blocking(mtx->core.spin_lock);
+        if (pi_mutex_try_claim(mtx, caller, priority, &waited)) {
+            spin_unlock(mtx->core.spin_lock, save);
+            return true;
+        }
+        if (lock_internal_spin_unlock_with_best_effort_wait_or_timeout(&mtx->core, save, until)) {
+            // timed out; note the owner keeps any priority it inherited from us until it releases the mutex
+            return false;
+        }
+        // not timed out; spin lock already unlocked, so loop again
+    } while (true);
+}
+
+bool __time_critical_func(pi_mutex_enter_timeout_ms)(pi_mutex_t *mtx, uint32_t timeout_ms) {
+    return pi_mutex_enter_block_until(mtx, make_timeout_time_ms(timeout_ms));
+}
+
+void __time_critical_func(pi_mutex_exit)(pi_mutex_t *mtx) {
+    uint32_t save = spin_lock_blocking(mtx->core.spin_lock);
+    assert(lock_is_owner_id_valid(mtx->owner));
+    if (mtx->boosted_priority != mtx->owner_priority) {
+        lock_set_owner_priority(mtx->owner, mtx->owner_priority);
+    }
+    mtx->owner = LOCK_INVALID_OWNER_ID;
+    lock_internal_spin_unlock_with_notify(&mtx->core, save);
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pico/rwlock.h"
+#include "pico/time.h"
+
+void rwlock_init(rwlock_t *rwl) {
+    lock_init(&rwl->core, next_striped_spin_lock_num());
+    rwl->writer = LOCK_INVALID_OWNER_ID;
+    rwl->writers_waiting = 0;
+    rwl->readers = 0;
+    rwl->read_contentions = 0;
+    rwl->write_contentions = 0;
+    __mem_fence_release();
+}
+
+// readers wait for waiting writers too, so that writers are not starved
+static inline bool rwlock_can_read(rwlock_t *rwl) {
+    return !lock_is_owner_id_valid(rwl->writer) && !rwl->writers_waiting;
+}
+
+static inline bool rwlock_can_write(rwlock_t *rwl) {
+    return !lock_is_owner_id_valid(rwl->writer) && !rwl->readers;
+}
+
+void __time_critical_func(rwlock_read_enter_blocking)(rwlock_t *rwl) {
+    assert(rwl->core.spin_lock);
+    bool waited = false;
+    do {
+        uint32_t save = spin_lock_blocking(rwl->core.spin_lock);
+        if (rwlock_can_read(rwl)) {
+            uint __unused total = ++rwl->readers;
+            spin_unlock(rwl->core.spin_lock, save);
+            assert(total); // check for overflow
+            return;
+        }
+        if (!waited) {
+            rwl->read_contentions++;
+            waited = true;
+        }
+        lock_internal_spin_unlock_with_wait(&rwl->core, save);
+    } while (true);
+}
+
+bool __time_critical_func(rwlock_read_try_enter)(rwlock_t *rwl) {
+    uint32_t save = spin_lock_blocking(rwl->core.spin_lock);
+    bool entered = rwlock_can_read(rwl);
+    if (entered) rwl->readers++;
+    spin_unlock(rwl->core.spin_lock, save);
+    return entered;
+}
+
+bool __time_critical_func(rwlock_read_enter_block_until)(rwlock_t *rwl, absolute_time_t until) {
+    assert(rwl->core.spin_lock);
+    bool waited = false;
+    do {
+        uint32_t save = spin_lock_blocking(rwl->core.spin_lock);
+        if (rwlock_can_read(rwl)) {
+            rwl->readers++;
+            spin_unlock(rwl->core.spin_lock, save);
+            return true;
+        }
+        if (!waited) {
+            rwl->read_contentions++;
+            waited = true;
+        }
+        if (lock_internal_spin_unlock_with_best_effort_wait_or_timeout(&rwl->core, save, until)) {
+            // timed out
+            return false;
+        }
+        // not timed out; spin lock already unlocked, so loop again
+    } while (true);
+}
+
+void __time_critical_func(rwlock_read_exit)(rwlock_t *rwl) {
+    uint32_t save = spin_lock_blocking(rwl->core.spin_lock);
+    assert(rwl->readers);
+    if (!--rwl->readers) {
+        // a writer may be waiting
+        lock_internal_spin_unlock_with_notify(&rwl->core, save);
+    } else {
+        spin_unlock(rwl->core.spin_lock, save);
+    }
+}
+
+static bool __time_critical_func(rwlock_write_enter_internal)(rwlock_t *rwl, bool timeout, absolute_time_t until) {
+    assert(rwl->core.spin_lock);
+    lock_owner_id_t caller = lock_get_caller_owner_id();
+    bool waiting = false;
+    do {
+        uint32_t save = spin_lock_blocking(rwl->core.spin_lock);
+        if (rwlock_can_write(rwl)) {
+            rwl->writer = caller;
+            if (waiting) rwl->writers_waiting--;
+            spin_unlock(rwl->core.spin_lock, save);
+            return true;
+        }
+        if (!waiting) {
+            // from now on, new readers wait for us
+            rwl->write_contentions++;
+            rwl->writers_waiting++;
+            waiting = true;
+        }
+        if (!timeout) {
+            lock_internal_spin_unlock_with_wait(&rwl->core, save);
+        } else if (lock_internal_spin_unlock_with_best_effort_wait_or_timeout(&rwl->core, save, until)) {
+            // timed out; stop holding off readers
+            save = spin_lock_blocking(rwl->core.spin_lock);
+            rwl->writers_waiting--;
+            lock_internal_spin_unlock_with_notify(&rwl->core, save);
+            return false;
+        }
+    } while (true);
+}
+
+void __time_critical_func(rwlock_write_enter_blocking)(rwlock_t *rwl) {
+    rwlock_write_enter_internal(rwl, false, nil_time);
+}
+
+bool __time_critical_func(rwlock_write_try_enter)(rwlock_t *rwl) {
+    uint32_t save = spin_lock_blocking(rwl->core.spin_lock);
+    bool entered = rwlock_can_write(rwl);
+    if (entered) rwl->writer = lock_get_caller_owner_id();
+    spin_unlock(rwl->core.spin_lock, save);
+    return entered;
+}
+
+bool __time_critical_func(rwlock_write_enter_block_until)(rwlock_t *rwl, absolute_time_t until) {
+    return rwlock_write_enter_internal(rwl, true, until);
+}
+
+void __time_critical_func(rwlock_write_exit)(rwlock_t *rwl) {
+    uint32_t save = spin_lock_blocking(rwl->core.spin_lock);
+    assert(lock_is_owner_id_valid(rwl->writer));
+    rwl->writer = LOCK_INVALID_OWNER_ID;
+    lock_internal_spin_unlock_with_notify(&rwl->core, save);
+}
@@ -11,6 +11,7 @@ void sem_init(semaphore_t *sem, int16_t initial_permits, int16_t max_permits) {
     lock_init(&sem->core, next_striped_spin_lock_num());
     sem->permits = initial_permits;
     sem->max_permits = max_permits;
+    lock_stats_clear(&sem->stats);
     __mem_fence_release();
 }
 
@@ -19,13 +20,16 @@ int __time_critical_func(sem_available)(semaphore_t *sem) {
 }
 
 void __time_critical_func(sem_acquire_blocking)(semaphore_t *sem) {
+    uint32_t __unused wait_start_us = 0;
     do {
         uint32_t save = spin_lock_blocking(sem->core.spin_lock);
         if (sem->permits > 0) {
             sem->permits--;
+            lock_stats_acquired(&sem->stats, wait_start_us);
             spin_unlock(sem->core.spin_lock, save);
             break;
         }
+        lock_stats_note_wait(&wait_start_us);
         lock_internal_spin_unlock_with_wait(&sem->core, save);
     } while (true);
 }
@@ -39,13 +43,16 @@ bool __time_critical_func(sem_acquire_timeout_us)(semaphore_t *sem, uint32_t tim
 }
 
 bool __time_critical_func(sem_acquire_block_until)(semaphore_t *sem, absolute_time_t until) {
+    uint32_t __unused wait_start_us = 0;
     do {
         uint32_t save = spin_lock_blocking(sem->core.spin_lock);
         if (sem->permits > 0) {
             sem->permits--;
+            lock_stats_acquired(&sem->stats, wait_start_us);
             spin_unlock(sem->core.spin_lock, save);
             return true;
         }
+        lock_stats_note_wait(&wait_start_us);
         if (lock_internal_spin_unlock_with_best_effort_wait_or_timeout(&sem->core, save, until)) {
             return false;
         }
@@ -56,6 +63,7 @@ bool __time_critical_func(sem_try_acquire)(semaphore_t *sem) {
     uint32_t save = spin_lock_blocking(sem->core.spin_lock);
     if (sem->permits > 0) {
         sem->permits--;
+        lock_stats_acquired(&sem->stats, 0);
         spin_unlock(sem->core.spin_lock, save);
         return true;
     }
@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_TASK_H
+#define _PICO_TASK_H
+
+#include "pico.h"
+#include "pico/time.h"
+#include "pico/sem.h"
+#include "pico/util/queue.h"
+
+/** \file task.h
+ *  \defgroup pico_task pico_task
+ *
+ * Cooperative run-to-completion task scheduler
+ *
+ * Each core has its own scheduler with a ready queue of tasks. A task is a function which is called by the scheduler, runs
+ * until it has nothing more to do, and then returns, having optionally recorded something it wants to wait for. The
+ * scheduler does not resume the task until that condition is met. Tasks never block the core, so a single core can interleave
+ * many tasks which would otherwise be implemented as hand written state machines driven from timer callbacks.
+ *
+ * Tasks can wait for:
+ *  - A time to be reached (see \ref TASK_SLEEP_US and \ref TASK_SLEEP_UNTIL)
+ *  - An item to be removed from a \ref queue (see \ref TASK_QUEUE_REMOVE)
+ *  - A permit to be acquired from a \ref sem (see \ref TASK_SEM_ACQUIRE)
+ *  - A \ref task_event_t to be signalled, typically from an IRQ handler (e.g. DMA or PIO) (see \ref TASK_WAIT_EVENT)
+ *
+ * The scheduler performs the queue removal, semaphore acquisition or event consumption on behalf of the task before
+ * making it ready, so the task does not need to re-check the condition when it resumes.
+ *
+ * In C, tasks are written as stackless coroutines using the TASK_ macros, which store the position at which the task
+ * resumes in the task_t itself; local variables are therefore not preserved across a wait and should be kept
+ * in the task's user data. For example:
+ *
+ * \code
+ * void blink_task(task_t *task) {
+ *     TASK_BEGIN(task);
+ *     while (true) {
+ *         gpio_xor_mask(1u << PICO_DEFAULT_LED_PIN);
+ *         TASK_SLEEP_MS(task, 500);
+ *     }
+ *     TASK_END(task);
+ * }
+ * \endcode
+ *
+ * With C++20, pico/task_coroutine.h allows tasks to be written as C++ coroutines which `co_await` the same conditions.
+ *
+ * When no task is ready, \ref task_scheduler_run() waits for an event (`__wfe`), using an alarm from the scheduler's alarm
+ * pool to wake at the earliest time any task is waiting for. The SDK's queue, semaphore and task_event_t implementations
+ * all send an event (`__sev`) when updated, so waiting tasks are re-checked promptly.
+ *
+ * The scheduler records per task run counts, run time and scheduling latency (the time from the task's wait condition
+ * being detected as satisfied to the task running), and per core idle time.
+ */
+
+// PICO_CONFIG: PARAM_ASSERTIONS_ENABLED_TASK, Enable/disable assertions in the task module, type=bool, default=0, group=pico_task
+#ifndef PARAM_ASSERTIONS_ENABLED_TASK
+#define PARAM_ASSERTIONS_ENABLED_TASK 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct task task_t;
+
+/*! \brief Task function type
+ *  \ingroup pico_task
+ *
+ * The function is called each time the task is scheduled, and should return when it has either finished,
+ * or set up a wait via one of the TASK_ macros (or task_set_wait_ functions)
+ */
+typedef void (*task_func_t)(task_t *task);
+
+/*! \brief An event which may be signalled (e.g. from an IRQ handler) to wake a waiting task
+ *  \ingroup pico_task
+ *
+ * An event is either signalled or not; multiple signals before a task consumes the event are coalesced.
+ */
+typedef struct task_event {
+    lock_core_t core;
+    bool signalled;
+} task_event_t;
+
+enum task_wait_type {
+    TASK_WAIT_TYPE_NONE = 0,   ///< the task is ready (or has yielded)
+    TASK_WAIT_TYPE_TIME,       ///< waiting for wait_until to be reached
+    TASK_WAIT_TYPE_QUEUE,      ///< waiting to remove an item from wait_queue into wait_data
+    TASK_WAIT_TYPE_SEM,        ///< waiting to acquire a permit from wait_sem
+    TASK_WAIT_TYPE_EVENT,      ///< waiting for wait_event to be signalled
+    TASK_WAIT_TYPE_DONE,       ///< the task has completed
+};
+
+/*! \brief Task state; this should be treated as opaque apart from user_data and the statistics fields
+ *  \ingroup pico_task
+ */
+struct task {
+    struct task *next;
+    task_func_t func;
+    void *user_data;
+    const char *name;
+    uint32_t resume_point;
+    uint8_t wait_type;
+    uint8_t core;
+    absolute_time_t wait_until;
+    union {
+        queue_t *wait_queue;
+        semaphore_t *wait_sem;
+        task_event_t *wait_event;
+    };
+    void *wait_data;
+    absolute_time_t ready_time;
+    // statistics
+    uint32_t run_count;          ///< number of times the task has been run
+    uint32_t max_latency_us;     ///< maximum time between the task becoming ready and running
+    uint64_t total_latency_us;   ///< total time between the task becoming ready and running
+    uint64_t run_time_us;        ///< total time spent running the task
+};
+
+/*! \brief Initialize a task
+ *  \ingroup pico_task
+ *
+ * \param task the task
+ * \param name a name for the task (may be NULL)
+ * \param func the task function
+ * \param user_data user data available to the task function as task->user_data
+ */
+void task_init(task_t *task, const char *name, task_func_t func, void *user_data);
+
+/*! \brief Add a task to the ready queue of the specified core
+ *  \ingroup pico_task
+ *
+ * This may be called from either core, but not from an IRQ handler. The task must not already be running
+ *
+ * \param task the task
+ * \param core the core whose scheduler is to run the task
+ */
+void task_start_on_core(task_t *task, uint core);
+
+/*! \brief Add a task to the ready queue of the calling core
+ *  \ingroup pico_task
+ *
+ * \param task the task
+ */
+static inline void task_start(task_t *task) {
+    task_start_on_core(task, get_core_num());
+}
+
+/*! \brief Determine if a task has completed
+ *  \ingroup pico_task
+ *
+ * \param task the task
+ * \return true if the task function has finished (i.e. reached \ref TASK_END)
+ */
+static inline bool task_is_done(const task_t *task) {
+    return task->wait_type == TASK_WAIT_TYPE_DONE;
+}
+
+/*! \brief Return the task currently being run by the calling core's scheduler
+ *  \ingroup pico_task
+ *
+ * \return the current task, or NULL if called from outside a task
+ */
+task_t *task_get_current(void);
+
+/*! \brief Run tasks on the calling core forever
+ *  \ingroup pico_task
+ *
+ * The core sleeps (via `__wfe`) whenever no task is ready.
+ */
+void __noreturn task_scheduler_run(void);
+
+/*! \brief Run tasks on the calling core until no tasks remain
+ *  \ingroup pico_task
+ *
+ * This is the same as \ref task_scheduler_run(), but returns once all tasks on the core have completed.
+ */
+void task_scheduler_run_until_done(void);
+
+/*! \brief Run each ready task on the calling core once, without waiting
+ *  \ingroup pico_task
+ *
+ * This can be used to run tasks from an existing main loop.
+ *
+ * \return true if any tasks (ready or waiting) remain on this core
+ */
+bool task_scheduler_poll(void);
+
+/*! \brief Set the alarm pool used to wake the calling core's scheduler for timed waits
+ *  \ingroup pico_task
+ *
+ * By default the default alarm pool is used if it is available
+ *
+ * \param pool the alarm pool, or NULL to poll for timed waits instead
+ */
+void task_scheduler_set_alarm_pool(alarm_pool_t *pool);
+
+/*! \brief Return the total time the calling core's scheduler has spent waiting for tasks to become ready
+ *  \ingroup pico_task
+ *
+ * \return idle time in microseconds
+ */
+uint64_t task_scheduler_get_idle_time_us(void);
+
+/*! \brief Print the statistics for all tasks known to the calling core's scheduler via stdio
+ *  \ingroup pico_task
+ */
+void task_scheduler_dump(void);
+
+/*! \brief Make the task wait until the given time; used by \ref TASK_SLEEP_UNTIL
+ *  \ingroup pico_task
+ */
+void task_set_wait_until(task_t *task, absolute_time_t until);
+
+/*! \brief Make the task wait to remove an item from the queue into data; used by \ref TASK_QUEUE_REMOVE
+ *  \ingroup pico_task
+ */
+void task_set_wait_queue_remove(task_t *task, queue_t *q, void *data);
+
+/*! \brief Make the task wait to acquire a permit from the semaphore; used by \ref TASK_SEM_ACQUIRE
+ *  \ingroup pico_task
+ */
+void task_set_wait_sem_acquire(task_t *task, semaphore_t *sem);
+
+/*! \brief Make the task wait for the event to be signalled; used by \ref TASK_WAIT_EVENT
+ *  \ingroup pico_task
+ */
+void task_set_wait_event(task_t *task, task_event_t *event);
+
+/*! \brief Initialize a task event
+ *  \ingroup pico_task
+ *
+ * \param event the event
+ */
+void task_event_init(task_event_t *event);
+
+/*! \brief Signal a task event, waking any task waiting for it
+ *  \ingroup pico_task
+ *
+ * This may be called from any core, and from IRQ handlers
+ *
+ * \param event the event
+ */
+void task_event_signal(task_event_t *event);
+
+/*! \brief Consume a signal from a task event if there is one
+ *  \ingroup pico_task
+ *
+ * \param event the event
+ * \return true if the event was signalled (it is now no longer signalled)
+ */
+bool task_event_try_consume(task_event_t *event);
+
+// \cond internal
+#define __TASK_SUSPEND(task) (task)->resume_point = __LINE__; return; case __LINE__:
+// \endcond
+
+/*! \brief Start of a C task function body
+ *  \ingroup pico_task
+ *
+ * \note only one TASK_ macro may be used per source line, and a switch statement must not span a TASK_ wait macro
+ */
+#define TASK_BEGIN(task) switch ((task)->resume_point) { case 0:
+
+/*! \brief End of a C task function body; the task is complete if it reaches here
+ *  \ingroup pico_task
+ */
+#define TASK_END(task) } (task)->wait_type = TASK_WAIT_TYPE_DONE; return
+
+/*! \brief Let other ready tasks run before continuing
+ *  \ingroup pico_task
+ */
+#define TASK_YIELD(task) do { __TASK_SUSPEND(task); } while (0)
+
+/*! \brief Wait until the given time
+ *  \ingroup pico_task
+ */
+#define TASK_SLEEP_UNTIL(task, until) do { task_set_wait_until(task, until); __TASK_SUSPEND(task); } while (0)
+
+/*! \brief Wait for the given number of microseconds
+ *  \ingroup pico_task
+ */
+#define TASK_SLEEP_US(task, us) TASK_SLEEP_UNTIL(task, make_timeout_time_us(us))
+
+/*! \brief Wait for the given number of milliseconds
+ *  \ingroup pico_task
+ */
+#define TASK_SLEEP_MS(task, ms) TASK_SLEEP_UNTIL(task, make_timeout_time_ms(ms))
+
+/*! \brief Remove an item from a queue into data, waiting for the queue to become non-empty if necessary
+ *  \ingroup pico_task
+ */
+#define TASK_QUEUE_REMOVE(task, q, data) do { if (!queue_try_remove(q, data)) { task_set_wait_queue_remove(task, q, data); __TASK_SUSPEND(task); } } while (0)
+
+/*! \brief Acquire a permit from a semaphore, waiting for one to become available if necessary
+ *  \ingroup pico_task
+ */
+#define TASK_SEM_ACQUIRE(task, sem) do { if (!sem_try_acquire(sem)) { task_set_wait_sem_acquire(task, sem); __TASK_SUSPEND(task); } } while (0)
+
+/*! \brief Wait for an event to be signalled
+ *  \ingroup pico_task
+ */
+#define TASK_WAIT_EVENT(task, event) do { if (!task_event_try_consume(event)) { task_set_wait_event(task, event); __TASK_SUSPEND(task); } } while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_TASK_COROUTINE_H
+#define _PICO_TASK_COROUTINE_H
+
+#include "pico/task.h"
+
+/** \file task_coroutine.h
+ *  \ingroup pico_task
+ *
+ * \brief C++20 coroutine support for \ref pico_task
+ *
+ * A function returning pico::coroutine_task is a coroutine which runs under the \ref pico_task scheduler, and may
+ * `co_await` the same conditions as a C task:
+ *
+ * \code
+ * pico::coroutine_task consumer(queue_t *q) {
+ *     while (true) {
+ *         uint32_t value;
+ *         co_await pico::queue_remove(q, &value);
+ *         printf("got %d\n", value);
+ *         co_await pico::sleep_ms(10);
+ *     }
+ * }
+ *
+ * auto t = consumer(&q);  // t must outlive the coroutine
+ * t.start();
+ * task_scheduler_run();
+ * \endcode
+ *
+ * Unlike C tasks, local variables are preserved across waits, as they are stored in the coroutine frame, which is
+ * allocated by the compiler (using operator new) when the coroutine is called.
+ */
+
+#if defined(__cplusplus) && defined(__cpp_impl_coroutine)
+#include <coroutine>
+
+namespace pico {
+
+class coroutine_task {
+public:
+    struct promise_type {
+        task_t task;
+
+        coroutine_task get_return_object() {
+            auto handle = std::coroutine_handle<promise_type>::from_promise(*this);
+            task_init(&task, nullptr, resume, handle.address());
+            return coroutine_task(handle);
+        }
+        // the coroutine does not run until the scheduler first resumes it
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        // the frame is kept until the coroutine_task is destroyed
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { panic("unhandled exception in coroutine task"); }
+
+        static void resume(task_t *t) {
+            auto handle = std::coroutine_handle<promise_type>::from_address(t->user_data);
+            handle.resume();
+            if (handle.done()) t->wait_type = TASK_WAIT_TYPE_DONE;
+        }
+    };
+
+    coroutine_task(coroutine_task &&other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    coroutine_task(const coroutine_task &) = delete;
+    coroutine_task &operator=(const coroutine_task &) = delete;
+    ~coroutine_task() { if (handle) handle.destroy(); }
+
+    /*! \brief the underlying task; this may be used to access the statistics, or to set a name */
+    task_t *task() { return &handle.promise().task; }
+
+    /*! \brief add the coroutine to the calling core's ready queue */
+    void start() { task_start(task()); }
+
+    /*! \brief add the coroutine to the ready queue of the specified core */
+    void start_on_core(uint core) { task_start_on_core(task(), core); }
+
+    bool done() const { return handle.done(); }
+
+private:
+    explicit coroutine_task(std::coroutine_handle<promise_type> h) : handle(h) {}
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Awaitables; each records the wait in the current task and suspends the coroutine if the wait cannot be satisfied immediately
+
+struct sleep_until {
+    absolute_time_t until;
+    explicit sleep_until(absolute_time_t t) : until(t) {}
+    bool await_ready() const { return time_reached(until); }
+    void await_suspend(std::coroutine_handle<>) { task_set_wait_until(task_get_current(), until); }
+    void await_resume() {}
+};
+
+struct sleep_us : sleep_until {
+    explicit sleep_us(uint64_t us) : sleep_until(make_timeout_time_us(us)) {}
+};
+
+struct sleep_ms : sleep_until {
+    explicit sleep_ms(uint32_t ms) : sleep_until(make_timeout_time_ms(ms)) {}
+};
+
+struct yield {
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<>) {}
+    void await_resume() {}
+};
+
+struct queue_remove {
+    queue_t *q;
+    void *data;
+    queue_remove(queue_t *q, void *data) : q(q), data(data) {}
+    bool await_ready() { return queue_try_remove(q, data); }
+    void await_suspend(std::coroutine_handle<>) { task_set_wait_queue_remove(task_get_current(), q, data); }
+    void await_resume() {}
+};
+
+struct sem_acquire {
+    semaphore_t *sem;
+    explicit sem_acquire(semaphore_t *sem) : sem(sem) {}
+    bool await_ready() { return sem_try_acquire(sem); }
+    void await_suspend(std::coroutine_handle<>) { task_set_wait_sem_acquire(task_get_current(), sem); }
+    void await_resume() {}
+};
+
+struct wait_event {
+    task_event_t *event;
+    explicit wait_event(task_event_t *event) : event(event) {}
+    bool await_ready() { return task_event_try_consume(event); }
+    void await_suspend(std::coroutine_handle<>) { task_set_wait_event(task_get_current(), event); }
+    void await_resume() {}
+};
+
+}
+#endif
+
+#endif
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/task.h"
+
+typedef struct {
+    spin_lock_t *lock; // protects the ready list, which other cores may add to
+    task_t *ready_head;
+    task_t *ready_tail;
+    task_t *waiting; // only accessed by the owning core
+    task_t *current;
+    alarm_pool_t *alarm_pool;
+    bool alarm_pool_set;
+    uint64_t idle_time_us;
+} task_scheduler_t;
+
+static task_scheduler_t schedulers[NUM_CORES];
+
+static task_scheduler_t *get_scheduler(uint core) {
+    task_scheduler_t *s = &schedulers[core];
+    if (!s->lock) {
+        // each core's scheduler always uses the same striped lock, so no allocation is necessary
+        s->lock = spin_lock_instance(PICO_SPINLOCK_ID_STRIPED_FIRST + core);
+    }
+    return s;
+}
+
+static void make_ready(task_scheduler_t *s, task_t *task, absolute_time_t ready_time) {
+    task->wait_type = TASK_WAIT_TYPE_NONE;
+    task->ready_time = ready_time;
+    task->next = NULL;
+    uint32_t save = spin_lock_blocking(s->lock);
+    if (s->ready_tail) {
+        s->ready_tail->next = task;
+    } else {
+        s->ready_head = task;
+    }
+    s->ready_tail = task;
+    spin_unlock(s->lock, save);
+}
+
+void task_init(task_t *task, const char *name, task_func_t func, void *user_data) {
+    memset(task, 0, sizeof(task_t));
+    task->name = name;
+    task->func = func;
+    task->user_data = user_data;
+}
+
+void task_start_on_core(task_t *task, uint core) {
+    invalid_params_if(TASK, core >= NUM_CORES);
+    task->core = (uint8_t) core;
+    task->resume_point = 0;
+    make_ready(get_scheduler(core), task, get_absolute_time());
+    // wake the scheduler if it is idle
+    __sev();
+}
+
+task_t *task_get_current(void) {
+    return get_scheduler(get_core_num())->current;
+}
+
+void task_set_wait_until(task_t *task, absolute_time_t until) {
+    task->wait_type = TASK_WAIT_TYPE_TIME;
+    task->wait_until = until;
+}
+
+void task_set_wait_queue_remove(task_t *task, queue_t *q, void *data) {
+    task->wait_type = TASK_WAIT_TYPE_QUEUE;
+    task->wait_queue = q;
+    task->wait_data = data;
+}
+
+void task_set_wait_sem_acquire(task_t *task, semaphore_t *sem) {
+    task->wait_type = TASK_WAIT_TYPE_SEM;
+    task->wait_sem = sem;
+}
+
+void task_set_wait_event(task_t *task, task_event_t *event) {
+    task->wait_type = TASK_WAIT_TYPE_EVENT;
+    task->wait_event = event;
+}
+
+void task_event_init(task_event_t *event) {
+    lock_init(&event->core, next_striped_spin_lock_num());
+    event->signalled = false;
+}
+
+void task_event_signal(task_event_t *event) {
+    uint32_t save = spin_lock_blocking(event->core.spin_lock);
+    event->signalled = true;
+    lock_internal_spin_unlock_with_notify(&event->core, save);
+}
+
+bool task_event_try_consume(task_event_t *event) {
+    uint32_t save = spin_lock_blocking(event->core.spin_lock);
+    bool signalled = event->signalled;
+    event->signalled = false;
+    spin_unlock(event->core.spin_lock, save);
+    return signalled;
+}
+
+// returns true if the wait is satisfied; note that this performs the queue removal/semaphore acquisition on behalf of the task
+static bool check_wait(task_t *task) {
+    switch (task->wait_type) {
+        case TASK_WAIT_TYPE_TIME:
+            return time_reached(task->wait_until);
+        case TASK_WAIT_TYPE_QUEUE:
+            return queue_try_remove(task->wait_queue, task->wait_data);
+        case TASK_WAIT_TYPE_SEM:
+            return sem_try_acquire(task->wait_sem);
+        case TASK_WAIT_TYPE_EVENT:
+            return task_event_try_consume(task->wait_event);
+        default:
+            return true;
+    }
+}
+
+static void check_waiting(task_scheduler_t *s) {
+    task_t **prev = &s->waiting;
+    task_t *task;
+    while ((task = *prev)) {
+        if (check_wait(task)) {
+            *prev = task->next;
+            // for timed waits, the latency is measured from the requested time
+            make_ready(s, task, task->wait_type == TASK_WAIT_TYPE_TIME ? task->wait_until : get_absolute_time());
+        } else {
+            prev = &task->next;
+        }
+    }
+}
+
+static void run_task(task_scheduler_t *s, task_t *task) {
+    uint64_t start = time_us_64();
+    uint64_t ready_us = to_us_since_boot(task->ready_time);
+    uint32_t latency = start > ready_us ? (uint32_t) (start - ready_us) : 0;
+    if (latency > task->max_latency_us) task->max_latency_us = latency;
+    task->total_latency_us += latency;
+
+    s->current = task;
+    task->func(task);
+    s->current = NULL;
+
+    uint64_t end = time_us_64();
+    task->run_time_us += end - start;
+    task->run_count++;
+    if (task->wait_type == TASK_WAIT_TYPE_DONE) return;
+    if (task->wait_type == TASK_WAIT_TYPE_NONE) {
+        // the task yielded
+        absolute_time_t now;
+        update_us_since_boot(&now, end);
+        make_ready(s, task, now);
+    } else {
+        task->next = s->waiting;
+        s->waiting = task;
+    }
+}
+
+static bool run_ready_tasks(task_scheduler_t *s) {
+    check_waiting(s);
+    // detach the ready list, so that tasks which yield run again only after the others
+    uint32_t save = spin_lock_blocking(s->lock);
+    task_t *task = s->ready_head;
+    s->ready_head = s->ready_tail = NULL;
+    spin_unlock(s->lock, save);
+    while (task) {
+        task_t *next = task->next;
+        run_task(s, task);
+        task = next;
+    }
+    return s->ready_head || s->waiting;
+}
+
+bool task_scheduler_poll(void) {
+    return run_ready_tasks(get_scheduler(get_core_num()));
+}
+
+static int64_t wake_callback(__unused alarm_id_t id, __unused void *user_data) {
+    // the IRQ will wake the core if it is the one waiting, but the scheduler may be running on the other core
+    __sev();
+    return 0;
+}
+
+static alarm_pool_t *get_alarm_pool(task_scheduler_t *s) {
+    if (!s->alarm_pool_set) {
+#if !PICO_TIME_DEFAULT_ALARM_POOL_DISABLED
+        s->alarm_pool = alarm_pool_get_default();
+#endif
+        s->alarm_pool_set = true;
+    }
+    return s->alarm_pool;
+}
+
+static void wait_for_ready_task(task_scheduler_t *s) {
+    if (s->ready_head) return;
+    absolute_time_t earliest = at_the_end_of_time;
+    for (task_t *task = s->waiting; task; task = task->next) {
+        if (task->wait_type == TASK_WAIT_TYPE_TIME && absolute_time_diff_us(task->wait_until, earliest) > 0) {
+            earliest = task->wait_until;
+        }
+    }
+    uint64_t start = time_us_64();
+    if (is_at_the_end_of_time(earliest)) {
+        __wfe();
+    } else {
+        alarm_pool_t *pool = get_alarm_pool(s);
+        alarm_id_t id = pool ? alarm_pool_add_alarm_at(pool, earliest, wake_callback, NULL, false) : -1;
+        if (id > 0) {
+            __wfe();
+            alarm_pool_cancel_alarm(pool, id);
+        } else if (!pool) {
+            best_effort_wfe_or_timeout(earliest);
+        } // else the time has already passed
+    }
+    s->idle_time_us += time_us_64() - start;
+}
+
+void task_scheduler_run(void) {
+    task_scheduler_t *s = get_scheduler(get_core_num());
+    while (true) {
+        run_ready_tasks(s);
+        wait_for_ready_task(s);
+    }
+}
+
+void task_scheduler_run_until_done(void) {
+    task_scheduler_t *s = get_scheduler(get_core_num());
+    while (run_ready_tasks(s)) {
+        wait_for_ready_task(s);
+    }
+}
+
+void task_scheduler_set_alarm_pool(alarm_pool_t *pool) {
+    task_scheduler_t *s = get_scheduler(get_core_num());
+    s->alarm_pool = pool;
+    s->alarm_pool_set = true;
+}
+
+uint64_t task_scheduler_get_idle_time_us(void) {
+    return get_scheduler(get_core_num())->idle_time_us;
+}
+
+static void dump_task(const task_t *task, const char *state) {
+    printf("%-16s %-8s %10u %12llu %8u %8u\n", task->name ? task->name : "?", state, (uint) task->run_count,
+           (unsigned long long) task->run_time_us, task->run_count ? (uint) (task->total_latency_us / task->run_count) : 0,
+           (uint) task->max_latency_us);
+}
+
+void task_scheduler_dump(void) {
+    static const char *wait_names[] = {"ready", "time", "queue", "sem", "event", "done"};
+    task_scheduler_t *s = get_scheduler(get_core_num());
+    printf("task             state          runs   run_time_us  avg_lat  max_lat\n");
+    if (s->current) dump_task(s->current, "running");
+    // note we don't hold the lock while printing; the other core only ever appends to the ready list
+    for (task_t *task = s->ready_head; task; task = task->next) {
+        dump_task(task, wait_names[TASK_WAIT_TYPE_NONE]);
+    }
+    for (task_t *task = s->waiting; task; task = task->next) {
+        dump_task(task, wait_names[task->wait_type]);
+    }
+    printf("idle time %llu us\n", (unsigned long long) s->idle_time_us);
+}
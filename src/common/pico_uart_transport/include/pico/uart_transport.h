@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_UART_TRANSPORT_H
+#define _PICO_UART_TRANSPORT_H
+
+#include "pico.h"
+#include "hardware/uart.h"
+#include "hardware/sync.h"
+
+/** \file pico/uart_transport.h
+ *  \defgroup pico_uart_transport pico_uart_transport
+ * Framed binary packet transport over a UART, using DMA in both directions
+ *
+ * A UART transport sends and receives whole frames (packets), delimited on the wire with either COBS or SLIP framing.
+ * It is intended for binary protocols at high baud rates, where spinning per byte (or taking an interrupt per byte)
+ * loses data whenever another interrupt runs for too long.
+ *
+ * On the device:
+ * - received bytes are written by DMA into the RX ring buffer, in two halves chained to each other so reception never
+ *   stops. The RX DMA only runs during a burst of data: while the line is idle, the UART's RX FIFO level interrupt
+ *   starts it when a few bytes have arrived, and its receive timeout interrupt (after 32 idle bit periods) delivers a
+ *   frame too short to reach that level. While the DMA runs, the data is decoded by the DMA IRQ for each completed
+ *   half, and by an alarm every few character times (<tt>PICO_UART_TRANSPORT_RX_IDLE_CHARS</tt>), which stops the DMA
+ *   again once nothing more has arrived. So a frame is delivered soon after the line goes idle after it, without any
+ *   per byte interrupt.
+ * - frames are encoded straight into the TX ring buffer, and sent from it by DMA
+ *
+ * Received frames are decoded directly into a pool of frame buffers, and handed to the application in place: see
+ * \ref uart_transport_get_frame and \ref uart_transport_release_frame. Frames which can't be delivered (invalid
+ * encoding, too long, or no free frame buffer) are dropped and counted, as are UART overruns and line errors; see
+ * \ref uart_transport_stats_t. Decoding always resynchronizes at the next frame delimiter.
+ *
+ * On the host, the transport runs over the host hardware_uart, which can be attached to a pty (see
+ * uart_host_open_pty()) to loop it back to a test or another program; received data is processed by
+ * \ref uart_transport_poll.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// PICO_CONFIG: PARAM_ASSERTIONS_ENABLED_UART_TRANSPORT, Enable/disable assertions in the UART transport module, type=bool, default=0, group=pico_uart_transport
+#ifndef PARAM_ASSERTIONS_ENABLED_UART_TRANSPORT
+#define PARAM_ASSERTIONS_ENABLED_UART_TRANSPORT 0
+#endif
+
+// PICO_CONFIG: PICO_UART_TRANSPORT_MAX_FRAMES, Maximum number of received frame buffers per UART transport, type=int, default=8, min=1, max=256, group=pico_uart_transport
+#ifndef PICO_UART_TRANSPORT_MAX_FRAMES
+#define PICO_UART_TRANSPORT_MAX_FRAMES 8
+#endif
+
+/*! \brief Framing used on the wire
+ *  \ingroup pico_uart_transport
+ */
+typedef enum {
+    /// Consistent Overhead Byte Stuffing: frames are terminated by a zero byte, which doesn't otherwise appear; the
+    /// overhead is one byte per 254 bytes of data
+    UART_TRANSPORT_COBS,
+    /// RFC 1055 SLIP: frames are delimited by 0xc0 bytes (before and after), with 0xc0 and 0xdb in the data escaped as
+    /// two bytes
+    UART_TRANSPORT_SLIP,
+} uart_transport_framing_t;
+
+typedef struct uart_transport uart_transport_t;
+
+/*! \brief Callback for a received frame
+ *  \ingroup pico_uart_transport
+ *
+ * This is called (from the IRQ handler on the device, or \ref uart_transport_poll) after one or more frames have been
+ * added to the received frames; it may be used to wake the code which fetches them.
+ */
+typedef void (*uart_transport_frame_callback_t)(uart_transport_t *transport);
+
+/*! \brief UART transport configuration
+ *  \ingroup pico_uart_transport
+ */
+typedef struct {
+    uart_inst_t *uart;                  ///< the UART, already initialized with the baud rate and format set
+    uart_transport_framing_t framing;   ///< the framing
+    uint8_t *rx_ring;                   ///< RX ring buffer, for received bytes before they are decoded
+    uint rx_ring_size;                  ///< size of the RX ring buffer; a power of two of at least 16
+    uint8_t *tx_ring;                   ///< TX ring buffer, for encoded frames being sent
+    uint tx_ring_size;                  ///< size of the TX ring buffer; a power of two of at least 16
+    uint8_t *frame_buffer;              ///< buffer for frame_count received frames of max_frame_len bytes each
+    uint frame_count;                   ///< number of frame buffers, up to \ref PICO_UART_TRANSPORT_MAX_FRAMES
+    uint max_frame_len;                 ///< maximum length of a received frame (before encoding); at most 65535
+    uart_transport_frame_callback_t frame_received; ///< callback for each received frame, or NULL
+    void *user_data;                    ///< for the use of the caller
+} uart_transport_config_t;
+
+/*! \brief UART transport statistics
+ *  \ingroup pico_uart_transport
+ */
+typedef struct {
+    uint32_t frames_sent;       ///< number of frames queued for sending
+    uint32_t frames_received;   ///< number of frames received and delivered
+    uint32_t framing_errors;    ///< number of frames dropped because they were not validly encoded
+    uint32_t oversize_frames;   ///< number of frames dropped because they were longer than max_frame_len
+    uint32_t dropped_frames;    ///< number of frames dropped because all the frame buffers were in use
+    uint32_t rx_overruns;       ///< number of times the UART RX FIFO overflowed, losing data
+    uint32_t ring_overruns;     ///< number of times received data was overwritten in the RX ring before being decoded
+    uint32_t line_errors;       ///< number of bytes received with a break, parity or (UART) framing error
+} uart_transport_stats_t;
+
+struct uart_transport {
+    uart_transport_config_t config;
+    // \cond internal
+    spin_lock_t *lock;
+    // receive: decoding
+    uint32_t rx_pos;            // (free running) position in the RX ring up to which data has been decoded
+    uint16_t rx_len;            // decoded length of the frame being received
+    uint8_t rx_cobs_remaining;  // (COBS) data bytes left in the current block
+    bool rx_cobs_zero;          // (COBS) a zero follows the current block, unless it ends the frame
+    bool rx_slip_escape;        // (SLIP) the last byte was an escape
+    bool rx_started;            // some data of the frame has been received
+    uint8_t rx_discard;         // nonzero if the frame being received is being dropped (and why)
+    // receive: frames decoded and waiting for the application
+    volatile uint32_t frame_head;
+    volatile uint32_t frame_tail;
+    uint16_t frame_len[PICO_UART_TRANSPORT_MAX_FRAMES];
+    // transmit
+    uint32_t tx_head;           // (free running) end of the encoded data in the TX ring
+    volatile uint32_t tx_tail;  // end of the data sent (or being sent)
+    // backend
+    uint32_t rx_dma_pos;        // (device) RX ring position at the start of the active channel's half
+    uint32_t tx_dma_count;      // (device) number of bytes being sent by the TX DMA
+    uint32_t rx_idle_pos;       // (device) RX ring position the DMA had reached at the last idle check
+    uint32_t rx_idle_us;        // (device) time between idle checks while the RX DMA runs
+    int32_t rx_idle_alarm;      // (device) the alarm_id_t of the idle check, or 0 while the RX DMA is stopped
+    uint8_t rx_channel[2];
+    uint8_t rx_active;
+    uint8_t tx_channel;
+    bool tx_busy;
+    // \endcond
+    uart_transport_stats_t stats;
+};
+
+/*! \brief Initialize and start a UART transport
+ *  \ingroup pico_uart_transport
+ *
+ * On the device, three DMA channels are claimed, and the UART's IRQ handler is installed. The UART must already be
+ * initialized with its baud rate, which sets how often the line is checked for going idle; alarms (from the default
+ * alarm pool) are used for those checks.
+ *
+ * \param transport the transport
+ * \param config the configuration, which is copied
+ */
+void uart_transport_init(uart_transport_t *transport, const uart_transport_config_t *config);
+
+/*! \brief Stop a UART transport, releasing its resources
+ *  \ingroup pico_uart_transport
+ *
+ * Any data not yet sent, and any frames not yet fetched, are discarded.
+ *
+ * \param transport the transport
+ */
+void uart_transport_deinit(uart_transport_t *transport);
+
+/*! \brief Send a frame, without blocking
+ *  \ingroup pico_uart_transport
+ *
+ * The frame is encoded directly into the TX ring buffer, and sent by DMA. Frames may be sent from one core (or thread)
+ * at a time.
+ *
+ * \param transport the transport
+ * \param data the frame
+ * \param len the length of the frame, which must not be zero
+ * \return true if the frame was queued, or false if there was not enough space in the TX ring buffer for it
+ */
+bool uart_transport_send(uart_transport_t *transport, const void *data, uint len);
+
+/*! \brief Check whether everything sent has been handed to the UART
+ *  \ingroup pico_uart_transport
+ *
+ * \param transport the transport
+ * \return true if there is no data in the TX ring buffer waiting to go to the UART (some may still be in its TX FIFO)
+ */
+bool uart_transport_is_tx_idle(uart_transport_t *transport);
+
+/*! \brief Process data received so far
+ *  \ingroup pico_uart_transport
+ *
+ * On the device, this decodes data which the DMA has written but which has not yet been decoded (because neither half
+ * of the RX ring buffer has been completed since, nor the line gone idle). On the host, this reads and decodes all the
+ * data available from the UART.
+ *
+ * \param transport the transport
+ */
+void uart_transport_poll(uart_transport_t *transport);
+
+/*! \brief Get the oldest received frame
+ *  \ingroup pico_uart_transport
+ *
+ * The frame stays in its frame buffer, which remains valid until released with \ref uart_transport_release_frame.
+ *
+ * \param transport the transport
+ * \param len filled in with the length of the frame
+ * \return the frame, or NULL if there are no received frames
+ */
+const uint8_t *uart_transport_get_frame(uart_transport_t *transport, uint *len);
+
+/*! \brief Release the oldest received frame, once it has been used
+ *  \ingroup pico_uart_transport
+ *
+ * \param transport the transport
+ */
+void uart_transport_release_frame(uart_transport_t *transport);
+
+/*! \brief Get the statistics of a UART transport
+ *  \ingroup pico_uart_transport
+ *
+ * \param transport the transport
+ * \param stats filled in with the statistics
+ * \param reset if true the statistics are reset to zero
+ */
+void uart_transport_get_stats(uart_transport_t *transport, uart_transport_stats_t *stats, bool reset);
+
+/*! \brief Get the user data of a UART transport
+ *  \ingroup pico_uart_transport
+ *
+ * \param transport the transport
+ * \return the user_data from the transport's configuration
+ */
+static inline void *uart_transport_get_user_data(uart_transport_t *transport) {
+    return transport->config.user_data;
+}
+
+// \cond internal
+// implemented by the platform backend (DMA or host)
+void uart_transport_backend_init(uart_transport_t *transport);
+void uart_transport_backend_deinit(uart_transport_t *transport);
+// hand newly encoded data in the TX ring to the UART; called with the lock held
+void uart_transport_backend_start_tx(uart_transport_t *transport);
+void uart_transport_backend_poll(uart_transport_t *transport);
+
+// called by the backend, with the lock held, to decode the RX ring up to (free running) position end; returns the
+// number of frames delivered
+uint uart_transport_rx_ring(uart_transport_t *transport, uint32_t end);
+// called by the backend, with the lock held, to decode bytes received outside the RX ring, which follow the data
+// already decoded; returns the number of frames delivered
+uint uart_transport_rx_bytes(uart_transport_t *transport, const uint8_t *data, uint len);
+// called by the backend, with the lock held, when received data has been lost; the frame being received, and any
+// data up to the next delimiter, are dropped
+void uart_transport_rx_lost(uart_transport_t *transport);
+
+// called by the backend, without the lock held, after decoding
+static inline void uart_transport_notify(uart_transport_t *transport, uint frames) {
+    if (frames && transport->config.frame_received) transport->config.frame_received(transport);
+}
+// \endcond
+
+#ifdef __cplusplus
+}
+#endif
+#endif
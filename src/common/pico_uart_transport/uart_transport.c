@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+#include "pico/uart_transport.h"
+
+#define SLIP_END 0xc0
+#define SLIP_ESC 0xdb
+#define SLIP_ESC_END 0xdc
+#define SLIP_ESC_ESC 0xdd
+
+// why the frame being received is being dropped
+enum {
+    RX_KEEP = 0,
+    RX_FRAMING_ERROR,
+    RX_OVERSIZE,
+    RX_NO_BUFFER,
+    RX_LOST,            // data was lost; already counted
+};
+
+static inline uint8_t *frame_slot(uart_transport_t *transport, uint32_t index) {
+    return transport->config.frame_buffer + (index % transport->config.frame_count) * transport->config.max_frame_len;
+}
+
+static void rx_reset(uart_transport_t *transport) {
+    transport->rx_len = 0;
+    transport->rx_cobs_remaining = 0;
+    transport->rx_cobs_zero = false;
+    transport->rx_slip_escape = false;
+    transport->rx_started = false;
+    transport->rx_discard = RX_KEEP;
+}
+
+static inline void rx_drop(uart_transport_t *transport, uint reason) {
+    // the first reason is the one counted
+    if (!transport->rx_discard) transport->rx_discard = (uint8_t)reason;
+}
+
+// the first byte of a frame claims a frame buffer
+static inline void rx_start(uart_transport_t *transport) {
+    if (transport->rx_started) return;
+    transport->rx_started = true;
+    if (transport->frame_head - transport->frame_tail == transport->config.frame_count) rx_drop(transport, RX_NO_BUFFER);
+}
+
+static inline void rx_data(uart_transport_t *transport, uint8_t b) {
+    if (transport->rx_discard) return;
+    if (transport->rx_len == transport->config.max_frame_len) {
+        rx_drop(transport, RX_OVERSIZE);
+        return;
+    }
+    frame_slot(transport, transport->frame_head)[transport->rx_len++] = b;
+}
+
+// a delimiter; returns the number of frames delivered
+static uint rx_end(uart_transport_t *transport) {
+    uint delivered = 0;
+    // an empty frame (e.g. the opening delimiter of a SLIP frame) is ignored
+    if (transport->rx_started) {
+        if (transport->rx_cobs_remaining || transport->rx_slip_escape) rx_drop(transport, RX_FRAMING_ERROR);
+        switch (transport->rx_discard) {
+            case RX_KEEP:
+                transport->frame_len[transport->frame_head % transport->config.frame_count] = transport->rx_len;
+                // the frame must be complete before the application can see it
+                __mem_fence_release();
+                transport->frame_head++;
+                transport->stats.frames_received++;
+                delivered = 1;
+                break;
+            case RX_FRAMING_ERROR:
+                transport->stats.framing_errors++;
+                break;
+            case RX_OVERSIZE:
+                transport->stats.oversize_frames++;
+                break;
+            case RX_NO_BUFFER:
+                transport->stats.dropped_frames++;
+                break;
+            default:
+                break;
+        }
+    }
+    rx_reset(transport);
+    return delivered;
+}
+
+static uint rx_cobs(uart_transport_t *transport, const uint8_t *data, uint len) {
+    uint delivered = 0;
+    for (uint i = 0; i < len; i++) {
+        uint8_t b = data[i];
+        if (!b) {
+            delivered += rx_end(transport);
+            continue;
+        }
+        rx_start(transport);
+        if (transport->rx_cobs_remaining) {
+            rx_data(transport, b);
+            transport->rx_cobs_remaining--;
+        } else {
+            // a code byte: the length of the next block, plus one
+            if (transport->rx_cobs_zero) rx_data(transport, 0);
+            transport->rx_cobs_remaining = (uint8_t)(b - 1);
+            // a maximum length block isn't followed by a zero
+            transport->rx_cobs_zero = b != 0xff;
+        }
+    }
+    return delivered;
+}
+
+static uint rx_slip(uart_transport_t *transport, const uint8_t *data, uint len) {
+    uint delivered = 0;
+    for (uint i = 0; i < len; i++) {
+        uint8_t b = data[i];
+        if (b == SLIP_END) {
+            delivered += rx_end(transport);
+            continue;
+        }
+        rx_start(transport);
+        if (transport->rx_slip_escape) {
+            transport->rx_slip_escape = false;
+            if (b == SLIP_ESC_END) {
+                b = SLIP_END;
+            } else if (b == SLIP_ESC_ESC) {
+                b = SLIP_ESC;
+            } else {
+                rx_drop(transport, RX_FRAMING_ERROR);
+                continue;
+            }
+        } else if (b == SLIP_ESC) {
+            transport->rx_slip_escape = true;
+            continue;
+        }
+        rx_data(transport, b);
+    }
+    return delivered;
+}
+
+uint uart_transport_rx_bytes(uart_transport_t *transport, const uint8_t *data, uint len) {
+    if (transport->config.framing == UART_TRANSPORT_COBS) return rx_cobs(transport, data, len);
+    return rx_slip(transport, data, len);
+}
+
+void uart_transport_rx_lost(uart_transport_t *transport) {
+    rx_reset(transport);
+    // the bytes up to the next delimiter are the end of a frame whose start has been lost
+    transport->rx_started = true;
+    transport->rx_discard = RX_LOST;
+}
+
+uint uart_transport_rx_ring(uart_transport_t *transport, uint32_t end) {
+    uint32_t size = transport->config.rx_ring_size;
+    if (end - transport->rx_pos > size) {
+        // the data has been overwritten by newer data; start again from the newest
+        transport->stats.ring_overruns++;
+        uart_transport_rx_lost(transport);
+        transport->rx_pos = end;
+    }
+    uint delivered = 0;
+    while (transport->rx_pos != end) {
+        uint32_t index = transport->rx_pos & (size - 1);
+        uint len = MIN(end - transport->rx_pos, size - index);
+        delivered += uart_transport_rx_bytes(transport, transport->config.rx_ring + index, len);
+        transport->rx_pos += len;
+    }
+    return delivered;
+}
+
+void uart_transport_init(uart_transport_t *transport, const uart_transport_config_t *config) {
+    invalid_params_if(UART_TRANSPORT, !config->rx_ring || config->rx_ring_size < 16 ||
+                                      (config->rx_ring_size & (config->rx_ring_size - 1)));
+    invalid_params_if(UART_TRANSPORT, !config->tx_ring || config->tx_ring_size < 16 ||
+                                      (config->tx_ring_size & (config->tx_ring_size - 1)));
+    invalid_params_if(UART_TRANSPORT, !config->frame_buffer || !config->frame_count ||
+                                      config->frame_count > PICO_UART_TRANSPORT_MAX_FRAMES);
+    invalid_params_if(UART_TRANSPORT, !config->max_frame_len || config->max_frame_len > 0xffff);
+    memset(transport, 0, sizeof(uart_transport_t));
+    transport->config = *config;
+    transport->lock = spin_lock_instance(next_striped_spin_lock_num());
+    rx_reset(transport);
+    uart_transport_backend_init(transport);
+}
+
+void uart_transport_deinit(uart_transport_t *transport) {
+    uart_transport_backend_deinit(transport);
+}
+
+// encode into the TX ring from position pos, returning the new end position
+static uint32_t tx_cobs(uint8_t *ring, uint32_t mask, uint32_t pos, const uint8_t *src, uint len) {
+    // each block is preceded by a code byte, filled in once the block's length is known
+    uint32_t code_pos = pos++;
+    uint8_t code = 1;
+    for (uint i = 0; i < len; i++) {
+        uint8_t b = src[i];
+        if (b) {
+            ring[pos++ & mask] = b;
+            code++;
+        }
+        // a full block is only followed by another if there is more data
+        if (!b || (code == 0xff && i + 1 < len)) {
+            ring[code_pos & mask] = code;
+            code_pos = pos++;
+            code = 1;
+        }
+    }
+    ring[code_pos & mask] = code;
+    ring[pos++ & mask] = 0;
+    return pos;
+}
+
+static uint32_t tx_slip(uint8_t *ring, uint32_t mask, uint32_t pos, const uint8_t *src, uint len) {
+    // the opening delimiter ends any line noise received as a (dropped) frame
+    ring[pos++ & mask] = SLIP_END;
+    for (uint i = 0; i < len; i++) {
+        uint8_t b = src[i];
+        if (b == SLIP_END) {
+            ring[pos++ & mask] = SLIP_ESC;
+            b = SLIP_ESC_END;
+        } else if (b == SLIP_ESC) {
+            ring[pos++ & mask] = SLIP_ESC;
+            b = SLIP_ESC_ESC;
+        }
+        ring[pos++ & mask] = b;
+    }
+    ring[pos++ & mask] = SLIP_END;
+    return pos;
+}
+
+bool uart_transport_send(uart_transport_t *transport, const void *data, uint len) {
+    invalid_params_if(UART_TRANSPORT, !len);
+    uint32_t size = transport->config.tx_ring_size;
+    bool cobs = transport->config.framing == UART_TRANSPORT_COBS;
+    uint32_t max_len = cobs ? len + len / 254 + 2 : len * 2 + 2;
+    // only the sender moves tx_head, so the frame can be encoded into the free space without the lock
+    if (size - (transport->tx_head - transport->tx_tail) < max_len) return false;
+    uint32_t end;
+    if (cobs) {
+        end = tx_cobs(transport->config.tx_ring, size - 1, transport->tx_head, (const uint8_t *)data, len);
+    } else {
+        end = tx_slip(transport->config.tx_ring, size - 1, transport->tx_head, (const uint8_t *)data, len);
+    }
+    uint32_t save = spin_lock_blocking(transport->lock);
+    // make sure the data is written before the DMA reads it
+    __mem_fence_release();
+    transport->tx_head = end;
+    transport->stats.frames_sent++;
+    uart_transport_backend_start_tx(transport);
+    spin_unlock(transport->lock, save);
+    return true;
+}
+
+bool uart_transport_is_tx_idle(uart_transport_t *transport) {
+    return transport->tx_tail == transport->tx_head;
+}
+
+void uart_transport_poll(uart_transport_t *transport) {
+    uart_transport_backend_poll(transport);
+}
+
+const uint8_t *uart_transport_get_frame(uart_transport_t *transport, uint *len) {
+    uint32_t tail = transport->frame_tail;
+    if (transport->frame_head == tail) return NULL;
+    // make sure the frame isn't read before it was complete
+    __mem_fence_acquire();
+    *len = transport->frame_len[tail % transport->config.frame_count];
+    return frame_slot(transport, tail);
+}
+
+void uart_transport_release_frame(uart_transport_t *transport) {
+    uint32_t tail = transport->frame_tail;
+    assert(transport->frame_head != tail);
+    // finish with the frame before its buffer can be reused
+    __mem_fence_release();
+    transport->frame_tail = tail + 1;
+}
+
+void uart_transport_get_stats(uart_transport_t *transport, uart_transport_stats_t *stats, bool reset) {
+    uint32_t save = spin_lock_blocking(transport->lock);
+    *stats = transport->stats;
+    if (reset) memset(&transport->stats, 0, sizeof(uart_transport_stats_t));
+    spin_unlock(transport->lock, save);
+}
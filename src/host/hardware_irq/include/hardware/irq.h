@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _HARDWARE_IRQ_H
+#define _HARDWARE_IRQ_H
+
+#include "pico.h"
+
+#ifndef PICO_MAX_SHARED_IRQ_HANDLERS
+#define PICO_MAX_SHARED_IRQ_HANDLERS 4u
+#endif
+
+#ifndef PICO_IRQ_PROFILE
+#define PICO_IRQ_PROFILE 0
+#endif
+
+#ifndef PICO_IRQ_PROFILE_MAX_HANDLERS
+#define PICO_IRQ_PROFILE_MAX_HANDLERS 16
+#endif
+
+#ifndef PICO_DEFAULT_IRQ_PRIORITY
+#define PICO_DEFAULT_IRQ_PRIORITY 0x80
+#endif
+
+#define PICO_LOWEST_IRQ_PRIORITY 0xff
+#define PICO_HIGHEST_IRQ_PRIORITY 0x00
+
+#ifndef PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+#endif
+
+#define PICO_SHARED_IRQ_HANDLER_HIGHEST_ORDER_PRIORITY 0xff
+#define PICO_SHARED_IRQ_HANDLER_LOWEST_ORDER_PRIORITY 0x00
+
+#ifndef PARAM_ASSERTIONS_ENABLED_IRQ
+#define PARAM_ASSERTIONS_ENABLED_IRQ 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*irq_handler_t)(void);
+
+static inline void check_irq_param(__unused uint num) {
+    invalid_params_if(IRQ, num >= NUM_IRQS);
+}
+
+// This is a simulation of a single core's NVIC; an IRQ made pending while enabled has its handler(s)
+// called synchronously, unless a handler of the same or higher priority is already executing
+void irq_set_priority(uint num, uint8_t hardware_priority);
+uint irq_get_priority(uint num);
+void irq_set_enabled(uint num, bool enabled);
+bool irq_is_enabled(uint num);
+void irq_set_mask_enabled(uint32_t mask, bool enabled);
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+irq_handler_t irq_get_exclusive_handler(uint num);
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority);
+void irq_remove_handler(uint num, irq_handler_t handler);
+bool irq_has_shared_handler(uint num);
+irq_handler_t irq_get_vtable_handler(uint num);
+void irq_clear(uint int_num);
+void irq_set_pending(uint num);
+void irq_init_priorities(void);
+
+void user_irq_claim(uint irq_num);
+void user_irq_unclaim(uint irq_num);
+int user_irq_claim_unused(bool required);
+bool user_irq_is_claimed(uint irq_num);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
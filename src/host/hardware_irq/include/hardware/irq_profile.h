@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _HARDWARE_IRQ_PROFILE_H
+#define _HARDWARE_IRQ_PROFILE_H
+
+#include "hardware/irq.h"
+
+#ifndef PICO_IRQ_PROFILE_HISTOGRAM_BUCKETS
+#define PICO_IRQ_PROFILE_HISTOGRAM_BUCKETS 16
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Note on host the "cycle" counts are microseconds as measured by time_us_64()
+typedef struct {
+    uint32_t count;
+    uint32_t preemptions;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+    uint32_t histogram[PICO_IRQ_PROFILE_HISTOGRAM_BUCKETS];
+} irq_profile_stats_t;
+
+static inline uint32_t irq_profile_stats_avg_cycles(const irq_profile_stats_t *stats) {
+    return stats->count ? (uint32_t)(stats->total_cycles / stats->count) : 0;
+}
+
+#if PICO_IRQ_PROFILE
+bool irq_profile_get_handler_stats(uint num, irq_handler_t handler, irq_profile_stats_t *stats);
+bool irq_profile_get_irq_stats(uint num, irq_profile_stats_t *stats);
+void irq_profile_reset(void);
+void irq_profile_dump(void);
+#else
+static inline bool irq_profile_get_handler_stats(__unused uint num, __unused irq_handler_t handler, __unused irq_profile_stats_t *stats) {
+    return false;
+}
+
+static inline bool irq_profile_get_irq_stats(__unused uint num, __unused irq_profile_stats_t *stats) {
+    return false;
+}
+
+static inline void irq_profile_reset(void) {}
+
+static inline void irq_profile_dump(void) {}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hardware/irq.h"
+#include "hardware/irq_profile.h"
+#include "hardware/timer.h"
+
+// This is a dummy implementation that is single threaded, simulating the NVIC of the calling core
+
+#define FIRST_USER_IRQ 26u
+
+static struct irq_state {
+    // handlers in the order they are called; an exclusive handler is the only entry
+    irq_handler_t handlers[PICO_MAX_SHARED_IRQ_HANDLERS];
+    uint8_t order_priorities[PICO_MAX_SHARED_IRQ_HANDLERS];
+    uint8_t handler_count;
+    bool shared;
+    uint8_t priority;
+} irqs[NUM_IRQS];
+
+static uint32_t enabled_mask;
+static uint32_t pending_mask;
+static uint32_t active_mask;
+// priority of the currently executing handler, or 0x100 if none
+static uint active_priority = 0x100;
+static uint8_t user_irq_claimed;
+
+#if PICO_IRQ_PROFILE
+static struct irq_profile_slot {
+    irq_handler_t handler;
+    uint8_t num;
+    irq_profile_stats_t stats;
+} irq_profile_slots[PICO_IRQ_PROFILE_MAX_HANDLERS];
+
+static struct irq_profile_slot *current_slot;
+static uint64_t current_preempted_us;
+
+static struct irq_profile_slot *profile_slot(uint num, irq_handler_t handler) {
+    struct irq_profile_slot *free_slot = NULL;
+    for (uint i = 0; i < PICO_IRQ_PROFILE_MAX_HANDLERS; i++) {
+        struct irq_profile_slot *slot = &irq_profile_slots[i];
+        if (slot->handler == handler && slot->num == num) return slot;
+        if (!slot->handler && !free_slot) free_slot = slot;
+    }
+    if (free_slot) {
+        free_slot->handler = handler;
+        free_slot->num = (uint8_t) num;
+    }
+    return free_slot;
+}
+
+static void call_handler(uint num, irq_handler_t handler) {
+    struct irq_profile_slot *slot = profile_slot(num, handler);
+    if (!slot) {
+        handler();
+        return;
+    }
+    struct irq_profile_slot *outer_slot = current_slot;
+    uint64_t outer_preempted_us = current_preempted_us;
+    if (outer_slot) outer_slot->stats.preemptions++;
+    current_slot = slot;
+    current_preempted_us = 0;
+    uint64_t start = time_us_64();
+    handler();
+    uint64_t elapsed = time_us_64() - start;
+    uint32_t us = (uint32_t) (elapsed - current_preempted_us);
+    current_slot = outer_slot;
+    current_preempted_us = outer_preempted_us + elapsed;
+
+    irq_profile_stats_t *stats = &slot->stats;
+    if (!stats->count || us < stats->min_cycles) stats->min_cycles = us;
+    if (us > stats->max_cycles) stats->max_cycles = us;
+    stats->count++;
+    stats->total_cycles += us;
+    uint bucket = us ? 32u - (uint) __builtin_clz(us) : 0;
+    stats->histogram[MIN(bucket, PICO_IRQ_PROFILE_HISTOGRAM_BUCKETS - 1u)]++;
+}
+
+bool irq_profile_get_handler_stats(uint num, irq_handler_t handler, irq_profile_stats_t *stats) {
+    check_irq_param(num);
+    for (uint i = 0; i < PICO_IRQ_PROFILE_MAX_HANDLERS; i++) {
+        if (irq_profile_slots[i].handler == handler && irq_profile_slots[i].num == num) {
+            *stats = irq_profile_slots[i].stats;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool irq_profile_get_irq_stats(uint num, irq_profile_stats_t *stats) {
+    check_irq_param(num);
+    bool found = false;
+    memset(stats, 0, sizeof(*stats));
+    for (uint i = 0; i < PICO_IRQ_PROFILE_MAX_HANDLERS; i++) {
+        const struct irq_profile_slot *slot = &irq_profile_slots[i];
+        if (!slot->handler || slot->num != num) continue;
+        found = true;
+        const irq_profile_stats_t *s = &slot->stats;
+        if (!s->count) continue;
+        if (!stats->count || s->min_cycles < stats->min_cycles) stats->min_cycles = s->min_cycles;
+        if (s->max_cycles > stats->max_cycles) stats->max_cycles = s->max_cycles;
+        stats->count += s->count;
+        stats->preemptions += s->preemptions;
+        stats->total_cycles += s->total_cycles;
+        for (uint b = 0; b < PICO_IRQ_PROFILE_HISTOGRAM_BUCKETS; b++) {
+            stats->histogram[b] += s->histogram[b];
+        }
+    }
+    return found;
+}
+
+void irq_profile_reset(void) {
+    for (uint i = 0; i < PICO_IRQ_PROFILE_MAX_HANDLERS; i++) {
+        memset(&irq_profile_slots[i].stats, 0, sizeof(irq_profile_slots[i].stats));
+    }
+}
+
+void irq_profile_dump(void) {
+    printf("irq handler                 count      min      avg      max  preempt\n");
+    for (uint i = 0; i < PICO_IRQ_PROFILE_MAX_HANDLERS; i++) {
+        const struct irq_profile_slot *slot = &irq_profile_slots[i];
+        if (!slot->handler) continue;
+        printf("%3u %-18p %10u %8u %8u %8u %8u\n", slot->num, (void *) (uintptr_t) slot->handler,
+               (uint) slot->stats.count, (uint) slot->stats.min_cycles, (uint) irq_profile_stats_avg_cycles(&slot->stats),
+               (uint) slot->stats.max_cycles, (uint) slot->stats.preemptions);
+    }
+}
+#else
+static inline void call_handler(__unused uint num, irq_handler_t handler) {
+    handler();
+}
+#endif
+
+static void dispatch_pending(void) {
+    for (;;) {
+        // find the highest priority (lowest numbered on a tie) pending IRQ which may preempt what is running
+        uint best = NUM_IRQS;
+        uint32_t runnable = pending_mask & enabled_mask & ~active_mask;
+        for (uint num = 0; num < NUM_IRQS; num++) {
+            if ((runnable & (1u << num)) && irqs[num].priority < active_priority &&
+                (best == NUM_IRQS || irqs[num].priority < irqs[best].priority)) {
+                best = num;
+            }
+        }
+        if (best == NUM_IRQS) return;
+        struct irq_state *irq = &irqs[best];
+        if (!irq->handler_count) {
+            panic("Unhandled IRQ %d\n", best);
+        }
+        uint saved_priority = active_priority;
+        pending_mask &= ~(1u << best);
+        active_mask |= 1u << best;
+        active_priority = irq->priority;
+        for (uint i = 0; i < irq->handler_count; i++) {
+            call_handler(best, irq->handlers[i]);
+        }
+        active_priority = saved_priority;
+        active_mask &= ~(1u << best);
+    }
+}
+
+void irq_set_priority(uint num, uint8_t hardware_priority) {
+    check_irq_param(num);
+    irqs[num].priority = hardware_priority;
+}
+
+uint irq_get_priority(uint num) {
+    check_irq_param(num);
+    return irqs[num].priority;
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+    check_irq_param(num);
+    irq_set_mask_enabled(1u << num, enabled);
+}
+
+bool irq_is_enabled(uint num) {
+    check_irq_param(num);
+    return enabled_mask & (1u << num);
+}
+
+void irq_set_mask_enabled(uint32_t mask, bool enabled) {
+    if (enabled) {
+        pending_mask &= ~mask;
+        enabled_mask |= mask;
+    } else {
+        enabled_mask &= ~mask;
+    }
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+    check_irq_param(num);
+    struct irq_state *irq = &irqs[num];
+    hard_assert(!irq->handler_count || (!irq->shared && irq->handlers[0] == handler));
+    irq->handlers[0] = handler;
+    irq->handler_count = 1;
+    irq->shared = false;
+}
+
+irq_handler_t irq_get_exclusive_handler(uint num) {
+    check_irq_param(num);
+    return irqs[num].handler_count && !irqs[num].shared ? irqs[num].handlers[0] : NULL;
+}
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority) {
+    check_irq_param(num);
+    struct irq_state *irq = &irqs[num];
+    hard_assert(!irq->handler_count || irq->shared);
+    hard_assert(irq->handler_count < PICO_MAX_SHARED_IRQ_HANDLERS);
+    uint i = irq->handler_count++;
+    for (; i > 0 && irq->order_priorities[i - 1] < order_priority; i--) {
+        irq->handlers[i] = irq->handlers[i - 1];
+        irq->order_priorities[i] = irq->order_priorities[i - 1];
+    }
+    irq->handlers[i] = handler;
+    irq->order_priorities[i] = order_priority;
+    irq->shared = true;
+}
+
+void irq_remove_handler(uint num, irq_handler_t handler) {
+    check_irq_param(num);
+    struct irq_state *irq = &irqs[num];
+    for (uint i = 0; i < irq->handler_count; i++) {
+        if (irq->handlers[i] == handler) {
+            irq->handler_count--;
+            memmove(&irq->handlers[i], &irq->handlers[i + 1], (irq->handler_count - i) * sizeof(irq_handler_t));
+            memmove(&irq->order_priorities[i], &irq->order_priorities[i + 1], irq->handler_count - i);
+            return;
+        }
+    }
+    assert(false); // not found
+}
+
+bool irq_has_shared_handler(uint num) {
+    check_irq_param(num);
+    return irqs[num].handler_count && irqs[num].shared;
+}
+
+irq_handler_t irq_get_vtable_handler(uint num) {
+    check_irq_param(num);
+    // there is no vtable; return the first handler
+    return irqs[num].handler_count ? irqs[num].handlers[0] : NULL;
+}
+
+void irq_clear(uint int_num) {
+    pending_mask &= ~(1u << (int_num & 0x1fu));
+}
+
+void irq_set_pending(uint num) {
+    check_irq_param(num);
+    pending_mask |= 1u << num;
+    dispatch_pending();
+}
+
+void irq_init_priorities(void) {
+    for (uint num = 0; num < NUM_IRQS; num++) {
+        irqs[num].priority = PICO_DEFAULT_IRQ_PRIORITY;
+    }
+}
+
+static uint get_user_irq_claim_index(uint irq_num) {
+    invalid_params_if(IRQ, irq_num < FIRST_USER_IRQ || irq_num >= NUM_IRQS);
+    return NUM_IRQS - irq_num - 1u;
+}
+
+void user_irq_claim(uint irq_num) {
+    uint bit = get_user_irq_claim_index(irq_num);
+    hard_assert(!(user_irq_claimed & (1u << bit)));
+    user_irq_claimed |= (uint8_t) (1u << bit);
+}
+
+void user_irq_unclaim(uint irq_num) {
+    user_irq_claimed &= (uint8_t) ~(1u << get_user_irq_claim_index(irq_num));
+}
+
+int user_irq_claim_unused(bool required) {
+    for (uint bit = 0; bit < NUM_IRQS - FIRST_USER_IRQ; bit++) {
+        if (!(user_irq_claimed & (1u << bit))) {
+            user_irq_claimed |= (uint8_t) (1u << bit);
+            return (int) (NUM_IRQS - bit - 1);
+        }
+    }
+    if (required) panic("No user IRQs are available");
+    return -1;
+}
+
+bool user_irq_is_claimed(uint irq_num) {
+    return user_irq_claimed & (1u << get_user_irq_claim_index(irq_num));
+}
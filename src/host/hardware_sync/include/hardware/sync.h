@@ -38,8 +38,28 @@ static inline void atomic_thread_fence(uint x) {}
 #define PICO_SPINLOCK_ID_STRIPED_LAST 23
 #endif
 
+// PICO_CONFIG: PICO_LOCK_STATS, Enable/disable recording of contention statistics for hardware spin locks and pico_sync mutexes and semaphores, type=bool, default=0, group=hardware_sync
+#ifndef PICO_LOCK_STATS
+#define PICO_LOCK_STATS 0
+#endif
+
 typedef struct _spin_lock_t spin_lock_t;
 
+#if PICO_LOCK_STATS
+#include "hardware/platform_defs.h"
+
+typedef struct lock_stats {
+    uint32_t acquires;
+    uint32_t contentions;
+    uint32_t spins;
+    uint32_t total_wait_us;
+    uint32_t max_hold_us;
+    uint32_t core_acquires[NUM_CORES];
+    uint32_t acquired_at_us;
+    bool held;
+} lock_stats_t;
+#endif
+
 inline static void __mem_fence_acquire() {
 #ifndef __cplusplus
     atomic_thread_fence(memory_order_acquire);
@@ -98,6 +118,14 @@ void spin_lock_unclaim(uint lock_num);
 int spin_lock_claim_unused(bool required);
 uint spin_lock_num(spin_lock_t *lock);
 
+#if PICO_LOCK_STATS
+extern lock_stats_t spin_lock_stats[NUM_SPIN_LOCKS];
+
+uint32_t lock_stats_time_us(void);
+void lock_stats_record_acquire(lock_stats_t *stats, bool waited, uint32_t wait_start_us);
+void lock_stats_record_release(lock_stats_t *stats);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
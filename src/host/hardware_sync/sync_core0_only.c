@@ -6,6 +6,9 @@
 
 #include "hardware/sync.h"
 #include "hardware/platform_defs.h"
+#if PICO_LOCK_STATS
+#include <time.h>
+#endif
 
 // This is a dummy implementation that is single threaded
 
@@ -51,6 +54,9 @@ PICO_WEAK_FUNCTION_DEF(spin_lock_unsafe_blocking)
 
 void PICO_WEAK_FUNCTION_IMPL_NAME(spin_lock_unsafe_blocking)(spin_lock_t *lock) {
     lock->locked = true;
+#if PICO_LOCK_STATS
+    lock_stats_record_acquire(&spin_lock_stats[spin_lock_get_num(lock)], false, 0);
+#endif
 }
 
 PICO_WEAK_FUNCTION_DEF(spin_lock_blocking)
@@ -69,6 +75,9 @@ bool PICO_WEAK_FUNCTION_IMPL_NAME(is_spin_locked)(const spin_lock_t *lock) {
 PICO_WEAK_FUNCTION_DEF(spin_unlock_unsafe)
 
 void PICO_WEAK_FUNCTION_IMPL_NAME(spin_unlock_unsafe)(spin_lock_t *lock) {
+#if PICO_LOCK_STATS
+    lock_stats_record_release(&spin_lock_stats[spin_lock_get_num(lock)]);
+#endif
     lock->locked = false;
 }
 
@@ -137,4 +146,32 @@ int PICO_WEAK_FUNCTION_IMPL_NAME(spin_lock_claim_unused)(bool required) {
 PICO_WEAK_FUNCTION_DEF(spin_lock_num)
 uint PICO_WEAK_FUNCTION_IMPL_NAME(spin_lock_num)(spin_lock_t *lock) {
     return 0;
-}
\ No newline at end of file
+}
+#if PICO_LOCK_STATS
+lock_stats_t spin_lock_stats[NUM_SPIN_LOCKS];
+
+uint32_t lock_stats_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) (ts.tv_sec * 1000000ull + ts.tv_nsec / 1000);
+}
+
+void lock_stats_record_acquire(lock_stats_t *stats, bool waited, uint32_t wait_start_us) {
+    uint32_t now = lock_stats_time_us();
+    stats->acquires++;
+    stats->core_acquires[get_core_num()]++;
+    if (waited) {
+        stats->contentions++;
+        stats->total_wait_us += now - wait_start_us;
+    }
+    stats->acquired_at_us = now;
+    stats->held = true;
+}
+
+void lock_stats_record_release(lock_stats_t *stats) {
+    if (!stats->held) return;
+    stats->held = false;
+    uint32_t hold_us = lock_stats_time_us() - stats->acquired_at_us;
+    if (hold_us > stats->max_hold_us) stats->max_hold_us = hold_us;
+}
+#endif
@@ -43,8 +43,8 @@ uint64_t PICO_WEAK_FUNCTION_IMPL_NAME(time_us_64)() {
 #endif
 }
 
-PICO_WEAK_FUNCTION_DEF(timer_us_32)
-uint32_t PICO_WEAK_FUNCTION_IMPL_NAME(timer_us_32)() {
+PICO_WEAK_FUNCTION_DEF(time_us_32)
+uint32_t PICO_WEAK_FUNCTION_IMPL_NAME(time_us_32)() {
     return (uint32_t) time_us_64();
 }
 
@@ -84,6 +84,18 @@ void uart_set_break(uart_inst_t *uart, bool en);
 
 void uart_default_tx_wait_blocking();
 
+// ----------------------------------------------------------------------------
+// Host only
+
+// Attach the UART to a new pseudo terminal (in raw mode), instead of stdin/stdout,
+// so that another program (or the test itself) can open the returned slave device
+// and act as the other end of the line. Returns NULL if a pty can't be created.
+// If the UART is already attached, the existing slave device is returned.
+const char *uart_host_open_pty(uart_inst_t *uart);
+
+// Detach the UART from its pseudo terminal, returning it to stdin/stdout.
+void uart_host_close_pty(uart_inst_t *uart);
+
 #ifdef __cplusplus
 }
 #endif
@@ -5,6 +5,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include "hardware/uart.h"
 
 #if defined(__unix) || defined(__APPLE__)
@@ -15,6 +16,12 @@
 #include <termios.h>
 #include <fcntl.h>
 #include <stdlib.h>
+#include <poll.h>
+#ifdef __APPLE__
+#include <util.h>
+#else
+#include <pty.h>
+#endif
 
 #ifndef FNONBLOCK
 #define FNONBLOCK O_NONBLOCK
@@ -60,8 +67,97 @@ typedef struct {
     bool dummy;
 } uart_hw_t;
 
-uart_inst_t *const uart0;
-uart_inst_t *const uart1;
+// a UART uses stdin/stdout, unless it has been attached to a pty
+typedef struct {
+    int fd;         // the pty master, or -1
+    int slave_fd;   // held open so the master doesn't see a hang up while nothing else has the slave open
+    char name[64];
+} uart_host_t;
+
+static uart_host_t uarts[2] = {{.fd = -1, .slave_fd = -1}, {.fd = -1, .slave_fd = -1}};
+
+uart_inst_t *const uart0 = (uart_inst_t *)&uarts[0];
+uart_inst_t *const uart1 = (uart_inst_t *)&uarts[1];
+
+static inline int pty_fd(uart_inst_t *uart) {
+    return ((uart_host_t *)uart)->fd;
+}
+
+#if defined(__unix) || defined(__APPLE__)
+const char *uart_host_open_pty(uart_inst_t *uart) {
+    uart_host_t *u = (uart_host_t *)uart;
+    if (u->fd >= 0) return u->name;
+    int fd, slave_fd;
+    if (openpty(&fd, &slave_fd, NULL, NULL, NULL)) return NULL;
+    // pass binary data straight through, in both directions
+    struct termios tty;
+    const char *name = ttyname(slave_fd);
+    if (!name || tcgetattr(slave_fd, &tty)) {
+        close(slave_fd);
+        close(fd);
+        return NULL;
+    }
+    cfmakeraw(&tty);
+    tcsetattr(slave_fd, TCSANOW, &tty);
+    snprintf(u->name, sizeof(u->name), "%s", name);
+    u->fd = fd;
+    u->slave_fd = slave_fd;
+    return u->name;
+}
+
+void uart_host_close_pty(uart_inst_t *uart) {
+    uart_host_t *u = (uart_host_t *)uart;
+    if (u->fd < 0) return;
+    close(u->slave_fd);
+    close(u->fd);
+    u->fd = u->slave_fd = -1;
+}
+
+static bool pty_readable(int fd) {
+    struct pollfd p = {.fd = fd, .events = POLLIN};
+    return poll(&p, 1, 0) == 1 && (p.revents & POLLIN);
+}
+
+static uint8_t pty_getc(int fd) {
+    uint8_t c;
+    while (read(fd, &c, 1) != 1) {
+        struct pollfd p = {.fd = fd, .events = POLLIN};
+        poll(&p, 1, -1);
+    }
+    return c;
+}
+
+static void pty_write(int fd, const uint8_t *src, size_t len) {
+    while (len) {
+        ssize_t n = write(fd, src, len);
+        if (n <= 0) {
+            struct pollfd p = {.fd = fd, .events = POLLOUT};
+            poll(&p, 1, -1);
+            continue;
+        }
+        src += n;
+        len -= (size_t)n;
+    }
+}
+#else
+const char *uart_host_open_pty(uart_inst_t *uart) {
+    return NULL;
+}
+
+void uart_host_close_pty(uart_inst_t *uart) {
+}
+
+static bool pty_readable(int fd) {
+    return false;
+}
+
+static uint8_t pty_getc(int fd) {
+    return 0;
+}
+
+static void pty_write(int fd, const uint8_t *src, size_t len) {
+}
+#endif
 
 static int _nextchar = EOF;
 
@@ -84,11 +180,16 @@ size_t uart_is_writable(uart_inst_t *uart) {
 // If returns 0, no data is available to be read from UART.
 // If returns nonzero, at least that many bytes can be written without blocking.
 size_t uart_is_readable(uart_inst_t *uart) {
+    if (pty_fd(uart) >= 0) return pty_readable(pty_fd(uart)) ? 1 : 0;
     return _peekchar() ? 1 : 0;
 }
 
 // Write len bytes directly from src to the UART
 void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len) {
+    if (pty_fd(uart) >= 0) {
+        pty_write(pty_fd(uart), src, len);
+        return;
+    }
     for (size_t i = 0; i < len; i++) {
         uart_putc(uart, src[i]);
     }
@@ -105,14 +206,23 @@ void uart_read_blocking(uart_inst_t *uart, uint8_t *dst, size_t len) {
 // UART-specific operations and aliases
 
 void uart_putc(uart_inst_t *uart, char c) {
+    if (pty_fd(uart) >= 0) {
+        pty_write(pty_fd(uart), (const uint8_t *)&c, 1);
+        return;
+    }
     putchar(c);
 }
 
 void uart_puts(uart_inst_t *uart, const char *s) {
+    if (pty_fd(uart) >= 0) {
+        pty_write(pty_fd(uart), (const uint8_t *)s, strlen(s));
+        return;
+    }
     puts(s);
 }
 
 char uart_getc(uart_inst_t *uart) {
+    if (pty_fd(uart) >= 0) return (char)pty_getc(pty_fd(uart));
     while (!_peekchar()) {
         tight_loop_contents();
     }
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pico/adc_stream_synthetic.h"
+
+static uint16_t default_source(uint input, uint32_t sample_num) {
+    return (uint16_t)((input << 9) | (sample_num & 0x1ff));
+}
+
+static adc_stream_synthetic_source_t source = default_source;
+static adc_stream_t *active_stream;
+static uint next_done;
+static uint32_t sample_num;
+static uint round_robin;
+
+void adc_stream_synthetic_set_source(adc_stream_synthetic_source_t new_source) {
+    source = new_source ? new_source : default_source;
+}
+
+static void fill(adc_stream_t *stream, uint which) {
+    uint16_t *dst = stream->config.buffer + stream->armed[which] * stream->config.block_samples;
+    for (uint i = 0; i < stream->config.block_samples; i++) {
+        dst[i] = source(stream->inputs[round_robin], sample_num++);
+        if (++round_robin == stream->num_inputs) round_robin = 0;
+    }
+}
+
+bool adc_stream_synthetic_fill_blocks(uint num_blocks) {
+    adc_stream_t *stream = active_stream;
+    if (!stream) return false;
+    while (num_blocks--) {
+        fill(stream, next_done);
+        adc_stream_block_done(stream, next_done, 0);
+        next_done ^= 1;
+    }
+    return true;
+}
+
+bool adc_stream_synthetic_miss_irq(void) {
+    adc_stream_t *stream = active_stream;
+    if (!stream) return false;
+    fill(stream, next_done);
+    fill(stream, next_done ^ 1);
+    adc_stream_restart_blocks(stream);
+    // as on the device, the restart begins again with the first input in the first channel
+    next_done = 0;
+    round_robin = 0;
+    return true;
+}
+
+void adc_stream_backend_start(adc_stream_t *stream) {
+    assert(!active_stream);
+    active_stream = stream;
+    next_done = 0;
+    sample_num = 0;
+    round_robin = 0;
+}
+
+void adc_stream_backend_stop(adc_stream_t *stream) {
+    assert(active_stream == stream);
+    active_stream = NULL;
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_ADC_STREAM_SYNTHETIC_H
+#define _PICO_ADC_STREAM_SYNTHETIC_H
+
+#include "pico/adc_stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// On host the running ADC stream is filled on demand from a synthetic source. sample_num counts the samples taken
+// (over all inputs) since the stream was started. The default source returns (input << 9) | (sample_num & 0x1ff)
+typedef uint16_t (*adc_stream_synthetic_source_t)(uint input, uint32_t sample_num);
+
+void adc_stream_synthetic_set_source(adc_stream_synthetic_source_t source);
+
+// fill blocks as the DMA would, handling the completion of each as the DMA IRQ handler would. Returns false if no
+// stream is running
+bool adc_stream_synthetic_fill_blocks(uint num_blocks);
+
+// fill both blocks being filled without handling their completion, as if the DMA IRQ handler was too late, so the
+// stream is restarted
+bool adc_stream_synthetic_miss_irq(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -22,7 +22,7 @@ bool multicore_fifo_rvalid(void);
 bool multicore_fifo_wready(void);
 void multicore_fifo_push_blocking(uint32_t data);
 bool multicore_fifo_push_timeout_us(uint32_t data, uint64_t timeout_us);
-uint32_t multicore_fifo_pop_blocking();
+uint32_t multicore_fifo_pop_blocking(void);
 bool multicore_fifo_pop_timeout_us(uint64_t timeout_us, uint32_t *out);
 void multicore_fifo_drain(void);
 void multicore_fifo_clear_irq(void);
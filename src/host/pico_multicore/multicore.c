@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <pthread.h>
+#include <time.h>
+
+#include "pico/multicore.h"
+#include "pico/time.h"
+#include "hardware/sync.h"
+
+// Core 1 is simulated by a thread. As code may then run on two threads at once, this replaces the (weak) single threaded
+// spin lock, event and core number implementations from hardware_sync with ones which work between threads
+
+#define FIFO_DEPTH 8
+
+static __thread uint this_core_num;
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static bool event_pending[NUM_CORES];
+
+// fifos[n] is the FIFO read by core n
+typedef struct {
+    uint32_t data[FIFO_DEPTH];
+    uint head;
+    uint count;
+} fifo_t;
+
+static fifo_t fifos[NUM_CORES];
+
+static struct _spin_lock_t {
+    volatile bool locked;
+} spin_locks[NUM_SPIN_LOCKS];
+
+uint get_core_num(void) {
+    return this_core_num;
+}
+
+spin_lock_t *spin_lock_instance(uint lock_num) {
+    assert(lock_num < NUM_SPIN_LOCKS);
+    return &spin_locks[lock_num];
+}
+
+uint spin_lock_get_num(spin_lock_t *lock) {
+    return (uint) (lock - spin_locks);
+}
+
+void spin_lock_unsafe_blocking(spin_lock_t *lock) {
+#if PICO_LOCK_STATS
+    if (!__atomic_test_and_set(&lock->locked, __ATOMIC_ACQUIRE)) {
+        lock_stats_record_acquire(&spin_lock_stats[spin_lock_get_num(lock)], false, 0);
+        return;
+    }
+    uint32_t wait_start_us = lock_stats_time_us();
+    uint32_t spins = 1;
+    while (__atomic_test_and_set(&lock->locked, __ATOMIC_ACQUIRE)) {
+        spins++;
+        tight_loop_contents();
+    }
+    lock_stats_t *stats = &spin_lock_stats[spin_lock_get_num(lock)];
+    stats->spins += spins;
+    lock_stats_record_acquire(stats, true, wait_start_us);
+#else
+    while (__atomic_test_and_set(&lock->locked, __ATOMIC_ACQUIRE)) {
+        tight_loop_contents();
+    }
+#endif
+}
+
+bool is_spin_locked(const spin_lock_t *lock) {
+    return __atomic_load_n(&lock->locked, __ATOMIC_RELAXED);
+}
+
+void spin_unlock_unsafe(spin_lock_t *lock) {
+#if PICO_LOCK_STATS
+    lock_stats_record_release(&spin_lock_stats[spin_lock_get_num(lock)]);
+#endif
+    __atomic_clear(&lock->locked, __ATOMIC_RELEASE);
+}
+
+static void notify_locked(void) {
+    for (uint i = 0; i < NUM_CORES; i++) {
+        event_pending[i] = true;
+    }
+    pthread_cond_broadcast(&cond);
+}
+
+void __sev(void) {
+    pthread_mutex_lock(&mutex);
+    notify_locked();
+    pthread_mutex_unlock(&mutex);
+}
+
+static void wait_locked(uint64_t timeout_us) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t ns = (uint64_t) ts.tv_nsec + timeout_us * 1000u;
+    ts.tv_sec += (time_t) (ns / 1000000000u);
+    ts.tv_nsec = (long) (ns % 1000000000u);
+    pthread_cond_timedwait(&cond, &mutex, &ts);
+}
+
+void __wfe(void) {
+    pthread_mutex_lock(&mutex);
+    // as on the device, WFE may return without an event; the timeout means code which is waiting for time to pass
+    // (rather than for an event) still makes progress
+    if (!event_pending[this_core_num]) {
+        wait_locked(1000);
+    }
+    event_pending[this_core_num] = false;
+    pthread_mutex_unlock(&mutex);
+}
+
+bool multicore_fifo_rvalid(void) {
+    pthread_mutex_lock(&mutex);
+    bool rc = fifos[this_core_num].count != 0;
+    pthread_mutex_unlock(&mutex);
+    return rc;
+}
+
+bool multicore_fifo_wready(void) {
+    pthread_mutex_lock(&mutex);
+    bool rc = fifos[this_core_num ^ 1].count != FIFO_DEPTH;
+    pthread_mutex_unlock(&mutex);
+    return rc;
+}
+
+bool multicore_fifo_push_timeout_us(uint32_t data, uint64_t timeout_us) {
+    absolute_time_t end_time = make_timeout_time_us(timeout_us);
+    pthread_mutex_lock(&mutex);
+    fifo_t *fifo = &fifos[this_core_num ^ 1];
+    while (fifo->count == FIFO_DEPTH) {
+        if (time_reached(end_time)) {
+            pthread_mutex_unlock(&mutex);
+            return false;
+        }
+        wait_locked(MIN(1000, (uint64_t) absolute_time_diff_us(get_absolute_time(), end_time)));
+    }
+    fifo->data[(fifo->head + fifo->count++) % FIFO_DEPTH] = data;
+    notify_locked();
+    pthread_mutex_unlock(&mutex);
+    return true;
+}
+
+void multicore_fifo_push_blocking(uint32_t data) {
+    multicore_fifo_push_timeout_us(data, UINT64_MAX);
+}
+
+bool multicore_fifo_pop_timeout_us(uint64_t timeout_us, uint32_t *out) {
+    absolute_time_t end_time = make_timeout_time_us(timeout_us);
+    pthread_mutex_lock(&mutex);
+    fifo_t *fifo = &fifos[this_core_num];
+    while (!fifo->count) {
+        if (time_reached(end_time)) {
+            pthread_mutex_unlock(&mutex);
+            return false;
+        }
+        wait_locked(MIN(1000, (uint64_t) absolute_time_diff_us(get_absolute_time(), end_time)));
+    }
+    *out = fifo->data[fifo->head];
+    fifo->head = (fifo->head + 1) % FIFO_DEPTH;
+    fifo->count--;
+    // wake a writer waiting for space
+    notify_locked();
+    pthread_mutex_unlock(&mutex);
+    return true;
+}
+
+uint32_t multicore_fifo_pop_blocking(void) {
+    uint32_t data;
+    multicore_fifo_pop_timeout_us(UINT64_MAX, &data);
+    return data;
+}
+
+void multicore_fifo_drain(void) {
+    pthread_mutex_lock(&mutex);
+    fifos[this_core_num].count = 0;
+    notify_locked();
+    pthread_mutex_unlock(&mutex);
+}
+
+void multicore_fifo_clear_irq(void) {
+}
+
+uint32_t multicore_fifo_get_status(void) {
+    // bit layout matches SIO FIFO_ST
+    return (multicore_fifo_rvalid() ? 1u : 0u) | (multicore_fifo_wready() ? 2u : 0u);
+}
+
+static void *core1_thread(void *entry) {
+    this_core_num = 1;
+    ((void (*)(void)) entry)();
+    return NULL;
+}
+
+void multicore_launch_core1(void (*entry)(void)) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, core1_thread, (void *) entry)) {
+        panic("Failed to create core 1 thread");
+    }
+    pthread_detach(thread);
+}
+
+void multicore_launch_core1_with_stack(void (*entry)(void), __unused uint32_t *stack_bottom, __unused size_t stack_size_bytes) {
+    // the thread has its own stack
+    multicore_launch_core1(entry);
+}
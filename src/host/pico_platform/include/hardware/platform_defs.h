@@ -11,6 +11,8 @@
 
 #define NUM_DMA_CHANNELS 12u
 
+#define NUM_ADC_CHANNELS 5u
+
 #define NUM_TIMERS 4u
 
 #define NUM_IRQS 32u
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "pico/rand.h"
+
+#define SEED_BYTES (PICO_RAND_SEED_ENTROPY_BITS / 8)
+
+// there is no ROSC on the host; the operating system's random number source is used instead
+void pico_rand_backend_init(void) {
+    uint8_t seed[SEED_BYTES];
+    uint credited = 0;
+    FILE *f = fopen("/dev/urandom", "rb");
+    if (f) {
+        if (fread(seed, 1, sizeof(seed), f) == sizeof(seed)) credited = PICO_RAND_SEED_ENTROPY_BITS;
+        fclose(f);
+    }
+    if (!credited) {
+        // fall back on timing jitter, credited at one bit per sample
+        for (uint i = 0; i < sizeof(seed); i++) {
+            uint8_t sample = 0;
+            for (uint bit = 0; bit < 8; bit++) {
+                struct timespec ts;
+                clock_gettime(CLOCK_MONOTONIC, &ts);
+                sample = (uint8_t)((sample << 1) | (ts.tv_nsec & 1));
+            }
+            seed[i] = sample;
+        }
+        credited = PICO_RAND_SEED_ENTROPY_BITS;
+    }
+    pico_rand_add_entropy(seed, sizeof(seed), credited);
+}
+
+void pico_rand_backend_entropy_drawn(void) {
+}
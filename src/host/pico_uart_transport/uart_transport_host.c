@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pico/uart_transport.h"
+
+// The host has no DMA, so data is sent as soon as it is encoded, and received data is read when polled. Attaching
+// the UART to a pty with uart_host_open_pty() makes this a loopback which a test (or another program) can drive from
+// the other end.
+
+void uart_transport_backend_init(uart_transport_t *transport) {
+}
+
+void uart_transport_backend_deinit(uart_transport_t *transport) {
+}
+
+void uart_transport_backend_start_tx(uart_transport_t *transport) {
+    uint32_t size = transport->config.tx_ring_size;
+    while (transport->tx_tail != transport->tx_head) {
+        uint32_t index = transport->tx_tail & (size - 1);
+        uint len = MIN(transport->tx_head - transport->tx_tail, size - index);
+        uart_write_blocking(transport->config.uart, transport->config.tx_ring + index, len);
+        transport->tx_tail += len;
+    }
+}
+
+void uart_transport_backend_poll(uart_transport_t *transport) {
+    uint32_t size = transport->config.rx_ring_size;
+    uint delivered = 0;
+    while (uart_is_readable(transport->config.uart)) {
+        uint32_t save = spin_lock_blocking(transport->lock);
+        // stage the data in the RX ring, as the DMA does on the device
+        uint32_t end = transport->rx_pos;
+        while (end - transport->rx_pos < size && uart_is_readable(transport->config.uart)) {
+            transport->config.rx_ring[end++ & (size - 1)] = (uint8_t)uart_getc(transport->config.uart);
+        }
+        delivered += uart_transport_rx_ring(transport, end);
+        spin_unlock(transport->lock, save);
+    }
+    uart_transport_notify(transport, delivered);
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include "cyw43_spi_sg.h"
+
+#if CYW43_SPI_PIO && CYW43_LWIP
+// only updated by the driver, which runs in one context at a time
+static cyw43_pbuf_stats_t pbuf_stats;
+
+struct pbuf *cyw43_read_pbuf(cyw43_int_t *self, uint32_t fn, uint32_t addr, size_t len) {
+    // the bus transfers whole words, so the chain has room for the rounding
+    size_t aligned_len = (len + 3) & ~3u;
+    assert(aligned_len <= sizeof(self->spid_buf));
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, (u16_t)aligned_len, PBUF_POOL);
+    if (!p) {
+        pbuf_stats.rx_no_pbuf++;
+        return NULL;
+    }
+    cyw43_spi_segment_t segments[CYW43_SPI_MAX_SEGMENTS];
+    uint count = 0;
+    bool direct = cyw43_spi_sg_available(self);
+    for (struct pbuf *q = p; q && direct; q = q->next) {
+        if (count == CYW43_SPI_MAX_SEGMENTS) {
+            direct = false;
+        } else {
+            segments[count].data = q->payload;
+            segments[count++].len = q->len;
+        }
+    }
+    int ret;
+    if (direct) {
+        ret = cyw43_read_bytes_sg(self, fn, addr, len, segments, count);
+        if (!ret) {
+            pbuf_stats.rx_frames_direct++;
+            pbuf_stats.bytes_not_copied += len;
+        }
+    } else {
+        ret = cyw43_read_bytes(self, fn, addr, len, self->spid_buf);
+        if (!ret) {
+            pbuf_take(p, self->spid_buf, (u16_t)len);
+            pbuf_stats.rx_frames_copied++;
+        }
+    }
+    if (ret) {
+        pbuf_free(p);
+        return NULL;
+    }
+    pbuf_realloc(p, (u16_t)len);
+    return p;
+}
+
+int cyw43_write_pbuf(cyw43_int_t *self, uint32_t fn, uint32_t addr, const void *header, size_t header_len,
+                     const struct pbuf *p) {
+    size_t len = header_len + p->tot_len;
+    assert(len <= sizeof(self->spid_buf));
+    cyw43_spi_segment_t segments[CYW43_SPI_MAX_SEGMENTS];
+    uint count = 0;
+    bool direct = cyw43_spi_sg_available(self);
+    if (header_len) {
+        segments[count].data = (void *)header;
+        segments[count++].len = header_len;
+    }
+    for (const struct pbuf *q = p; q && direct; q = q->next) {
+        if (!q->len) continue;
+        if (count == CYW43_SPI_MAX_SEGMENTS) {
+            direct = false;
+        } else {
+            segments[count].data = q->payload;
+            segments[count++].len = q->len;
+        }
+    }
+    int ret;
+    if (direct) {
+        ret = cyw43_write_bytes_sg(self, fn, addr, segments, count);
+        if (!ret) {
+            pbuf_stats.tx_frames_direct++;
+            pbuf_stats.bytes_not_copied += p->tot_len;
+        }
+    } else {
+        // linearize the chain into the bus buffer
+        memcpy(self->spid_buf, header, header_len);
+        pbuf_copy_partial(p, self->spid_buf + header_len, p->tot_len, 0);
+        ret = cyw43_write_bytes(self, fn, addr, len, self->spid_buf);
+        if (!ret) pbuf_stats.tx_frames_copied++;
+    }
+    return ret;
+}
+
+void cyw43_pbuf_get_stats(cyw43_pbuf_stats_t *stats, bool reset) {
+    *stats = pbuf_stats;
+    if (reset) memset(&pbuf_stats, 0, sizeof(pbuf_stats));
+}
+#endif
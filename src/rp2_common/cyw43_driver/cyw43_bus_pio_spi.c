@@ -15,10 +15,13 @@
 #include "hardware/structs/iobank0.h"
 #include "hardware/sync.h"
 #include "hardware/dma.h"
+#include "hardware/dma_desc.h"
 #include "cyw43_bus_pio_spi.pio.h"
 #include "cyw43.h"
 #include "cyw43_internal.h"
 #include "cyw43_spi.h"
+#include "cyw43_spi_sg.h"
+#include "cyw43_spi_calibrate.h"
 #include "cyw43_debug_pins.h"
 
 #if CYW43_SPI_PIO
@@ -31,14 +34,32 @@
 #define CS_PIN 25u
 #define IRQ_SAMPLE_DELAY_NS 100
 
-#define SPI_PROGRAM_NAME spi_gap01_sample0
-#define SPI_PROGRAM_FUNC __CONCAT(SPI_PROGRAM_NAME, _program)
-#define SPI_PROGRAM_GET_DEFAULT_CONFIG_FUNC __CONCAT(SPI_PROGRAM_NAME, _program_get_default_config)
-#define SPI_OFFSET_END __CONCAT(SPI_PROGRAM_NAME, _offset_end)
-#define SPI_OFFSET_LP1_END __CONCAT(SPI_PROGRAM_NAME, _offset_lp1_end)
-
-#define CLOCK_DIV 2
-#define CLOCK_DIV_MINOR 0
+// the programs differ in when the first bit of a response is sampled after the data pin is turned around, so each
+// suits a different range of delays (board and chip) between a clock edge and the data arriving
+typedef struct {
+    const pio_program_t *program;
+    pio_sm_config (*get_default_config)(uint offset);
+    uint8_t offset_lp1_end;
+    uint8_t offset_end;
+    const char *name;
+} spi_program_t;
+
+#define SPI_PROGRAM(NAME) { &NAME ## _program, NAME ## _program_get_default_config, NAME ## _offset_lp1_end, \
+                            NAME ## _offset_end, #NAME }
+
+// in the order they are tried by calibration: the default samples a whole clock after the turnaround, in the middle of
+// the range; the others half a clock earlier and later
+static const spi_program_t spi_programs[] = {
+        SPI_PROGRAM(spi_gap01_sample0),
+        SPI_PROGRAM(spi_gap0_sample1),
+        SPI_PROGRAM(spi_gap010_sample1),
+};
+
+#define SPI_PROGRAM_DEFAULT (&spi_programs[0])
+
+// clock dividers (as 8.8 fixed point) for the state machine, which takes two cycles per bit
+#define CLOCK_DIV_DEFAULT 0x200
+static const uint16_t spi_clock_divs[] = {0x100, 0x180, 0x200, 0x300, 0x400};
 #define PADS_DRIVE_STRENGTH PADS_BANK0_GPIO0_DRIVE_VALUE_12MA
 
 #if !CYW43_USE_SPI
@@ -82,10 +103,32 @@ typedef struct {
     int8_t pio_sm;
     int8_t dma_out;
     int8_t dma_in;
+    // control channels for scatter-gather transfers, or -1 if there weren't any free
+    int8_t dma_out_control;
+    int8_t dma_in_control;
+    const spi_program_t *program;
+    uint16_t clock_div; // 8.8 fixed point
+    // the command, the segments and padding to a whole word, plus the end of each list
+    dma_desc_t out_descs[CYW43_SPI_MAX_SEGMENTS + 3];
+    dma_desc_t in_descs[CYW43_SPI_MAX_SEGMENTS + 1];
 } bus_data_t;
 
 static bus_data_t bus_data_instance;
 
+// configure the state machine for the loaded program and clock divider
+static void spi_pio_configure(bus_data_t *bus_data) {
+    pio_sm_config config = bus_data->program->get_default_config(bus_data->pio_offset);
+    sm_config_set_clkdiv_int_frac(&config, bus_data->clock_div >> 8, bus_data->clock_div & 0xff);
+    sm_config_set_out_pins(&config, DATA_OUT_PIN, 1);
+    sm_config_set_in_pins(&config, DATA_IN_PIN);
+    sm_config_set_set_pins(&config, DATA_OUT_PIN, 1);
+    sm_config_set_sideset(&config, 1, false, false);
+    sm_config_set_sideset_pins(&config, CLOCK_PIN);
+    sm_config_set_in_shift(&config, false, true, 32);
+    sm_config_set_out_shift(&config, false, true, 32);
+    pio_sm_set_config(bus_data->pio, bus_data->pio_sm, &config);
+}
+
 int cyw43_spi_init(cyw43_int_t *self) {
     // Only does something if CYW43_LOGIC_DEBUG=1
     logic_debug_init();
@@ -95,9 +138,9 @@ int cyw43_spi_init(cyw43_int_t *self) {
     pio_hw_t *pios[2] = {pio0, pio1};
     uint pio_index = CYW43_SPI_PIO_PREFERRED_PIO;
     // Check we can add the program
-    if (!pio_can_add_program(pios[pio_index], &SPI_PROGRAM_FUNC)) {
+    if (!pio_can_add_program(pios[pio_index], SPI_PROGRAM_DEFAULT->program)) {
         pio_index ^= 1;
-        if (!pio_can_add_program(pios[pio_index], &SPI_PROGRAM_FUNC)) {
+        if (!pio_can_add_program(pios[pio_index], SPI_PROGRAM_DEFAULT->program)) {
             return CYW43_FAIL_FAST_CHECK(-CYW43_EIO);
         }
     }
@@ -107,6 +150,10 @@ int cyw43_spi_init(cyw43_int_t *self) {
     bus_data->pio = pios[pio_index];
     bus_data->dma_in = -1;
     bus_data->dma_out = -1;
+    bus_data->dma_in_control = -1;
+    bus_data->dma_out_control = -1;
+    bus_data->program = SPI_PROGRAM_DEFAULT;
+    bus_data->clock_div = CLOCK_DIV_DEFAULT;
 
     static_assert(GPIO_FUNC_PIO1 == GPIO_FUNC_PIO0 + 1, "");
     bus_data->pio_func_sel = GPIO_FUNC_PIO0 + pio_index;
@@ -116,10 +163,9 @@ int cyw43_spi_init(cyw43_int_t *self) {
         return CYW43_FAIL_FAST_CHECK(-CYW43_EIO);
     }
 
-    bus_data->pio_offset = pio_add_program(bus_data->pio, &SPI_PROGRAM_FUNC);
-    pio_sm_config config = SPI_PROGRAM_GET_DEFAULT_CONFIG_FUNC(bus_data->pio_offset);
+    bus_data->pio_offset = (int8_t)pio_add_program(bus_data->pio, bus_data->program->program);
+    spi_pio_configure(bus_data);
 
-    sm_config_set_clkdiv_int_frac(&config, CLOCK_DIV, CLOCK_DIV_MINOR);
     hw_write_masked(&padsbank0_hw->io[CLOCK_PIN],
                     (uint)PADS_DRIVE_STRENGTH << PADS_BANK0_GPIO0_DRIVE_LSB,
                     PADS_BANK0_GPIO0_DRIVE_BITS
@@ -129,15 +175,7 @@ int cyw43_spi_init(cyw43_int_t *self) {
                     PADS_BANK0_GPIO0_SLEWFAST_BITS
     );
 
-    sm_config_set_out_pins(&config, DATA_OUT_PIN, 1);
-    sm_config_set_in_pins(&config, DATA_IN_PIN);
-    sm_config_set_set_pins(&config, DATA_OUT_PIN, 1);
-    sm_config_set_sideset(&config, 1, false, false);
-    sm_config_set_sideset_pins(&config, CLOCK_PIN);
-    sm_config_set_in_shift(&config, false, true, 32);
-    sm_config_set_out_shift(&config, false, true, 32);
     hw_set_bits(&bus_data->pio->input_sync_bypass, 1u << DATA_IN_PIN);
-    pio_sm_set_config(bus_data->pio, bus_data->pio_sm, &config);
     pio_sm_set_consecutive_pindirs(bus_data->pio, bus_data->pio_sm, CLOCK_PIN, 1, true);
     gpio_set_function(DATA_OUT_PIN, bus_data->pio_func_sel);
     gpio_set_function(CLOCK_PIN, bus_data->pio_func_sel);
@@ -154,6 +192,7 @@ int cyw43_spi_init(cyw43_int_t *self) {
         cyw43_spi_deinit(self);
         return CYW43_FAIL_FAST_CHECK(-CYW43_EIO);
     }
+    // the control channels for scatter-gather transfers are only claimed when first needed
     return 0;
 }
 
@@ -162,7 +201,7 @@ void cyw43_spi_deinit(cyw43_int_t *self) {
         bus_data_t *bus_data = (bus_data_t *)self->bus_data;
         if (bus_data->pio_sm >= 0) {
             if (bus_data->pio_offset != -1)
-                pio_remove_program(bus_data->pio, &SPI_PROGRAM_FUNC, bus_data->pio_offset);
+                pio_remove_program(bus_data->pio, bus_data->program->program, (uint)bus_data->pio_offset);
             pio_sm_unclaim(bus_data->pio, bus_data->pio_sm);
         }
         if (bus_data->dma_out >= 0) {
@@ -173,6 +212,12 @@ void cyw43_spi_deinit(cyw43_int_t *self) {
             dma_channel_unclaim(bus_data->dma_in);
             bus_data->dma_in = -1;
         }
+        if (bus_data->dma_out_control >= 0) {
+            dma_channel_unclaim(bus_data->dma_out_control);
+            dma_channel_unclaim(bus_data->dma_in_control);
+            bus_data->dma_out_control = -1;
+            bus_data->dma_in_control = -1;
+        }
         self->bus_data = NULL;
     }
 }
@@ -219,6 +264,34 @@ static void dump_bytes(const uint8_t *bptr, uint32_t len) {
 }
 #endif
 
+// restart the state machine, ready to send tx_length bytes then, if rx_length is nonzero, receive rx_length bytes
+static void spi_pio_prepare(bus_data_t *bus_data, size_t tx_length, size_t rx_length) {
+    pio_sm_set_enabled(bus_data->pio, bus_data->pio_sm, false);
+    uint end = rx_length ? bus_data->program->offset_end : bus_data->program->offset_lp1_end;
+    pio_sm_set_wrap(bus_data->pio, bus_data->pio_sm, bus_data->pio_offset, bus_data->pio_offset + end - 1);
+    pio_sm_clear_fifos(bus_data->pio, bus_data->pio_sm);
+    pio_sm_set_pindirs_with_mask(bus_data->pio, bus_data->pio_sm, 1u << DATA_OUT_PIN, 1u << DATA_OUT_PIN);
+    pio_sm_restart(bus_data->pio, bus_data->pio_sm);
+    pio_sm_clkdiv_restart(bus_data->pio, bus_data->pio_sm);
+    pio_sm_put(bus_data->pio, bus_data->pio_sm, tx_length * 8 - 1);
+    pio_sm_exec(bus_data->pio, bus_data->pio_sm, pio_encode_out(pio_x, 32));
+    pio_sm_put(bus_data->pio, bus_data->pio_sm, rx_length ? rx_length * 8 - 1 : 0);
+    pio_sm_exec(bus_data->pio, bus_data->pio_sm, pio_encode_out(pio_y, 32));
+    pio_sm_exec(bus_data->pio, bus_data->pio_sm, pio_encode_jmp(bus_data->pio_offset));
+}
+
+// wait for a transmit only transfer to finish, and turn the data pin around
+static void spi_pio_wait_tx_stall(bus_data_t *bus_data) {
+    bus_data->pio->fdebug = 1u << PIO_FDEBUG_TXSTALL_LSB;
+    pio_sm_set_enabled(bus_data->pio, 0, true);
+    while (!(bus_data->pio->fdebug & (1u << PIO_FDEBUG_TXSTALL_LSB))) {
+        tight_loop_contents(); // todo timeout
+    }
+    __compiler_memory_barrier();
+    pio_sm_set_enabled(bus_data->pio, bus_data->pio_sm, false);
+    pio_sm_set_consecutive_pindirs(bus_data->pio, bus_data->pio_sm, DATA_IN_PIN, 1, false);
+}
+
 int cyw43_spi_transfer(cyw43_int_t *self, const uint8_t *tx, size_t tx_length, uint8_t *rx,
                        size_t rx_length) {
 
@@ -242,17 +315,7 @@ int cyw43_spi_transfer(cyw43_int_t *self, const uint8_t *tx, size_t tx_length, u
         assert(!(((uintptr_t)rx) & 3));
         assert(!(rx_length & 3));
 
-        pio_sm_set_enabled(bus_data->pio, bus_data->pio_sm, false);
-        pio_sm_set_wrap(bus_data->pio, bus_data->pio_sm, bus_data->pio_offset, bus_data->pio_offset + SPI_OFFSET_END - 1);
-        pio_sm_clear_fifos(bus_data->pio, bus_data->pio_sm);
-        pio_sm_set_pindirs_with_mask(bus_data->pio, bus_data->pio_sm, 1u << DATA_OUT_PIN, 1u << DATA_OUT_PIN);
-        pio_sm_restart(bus_data->pio, bus_data->pio_sm);
-        pio_sm_clkdiv_restart(bus_data->pio, bus_data->pio_sm);
-        pio_sm_put(bus_data->pio, bus_data->pio_sm, tx_length * 8 - 1);
-        pio_sm_exec(bus_data->pio, bus_data->pio_sm, pio_encode_out(pio_x, 32));
-        pio_sm_put(bus_data->pio, bus_data->pio_sm, (rx_length - tx_length) * 8 - 1);
-        pio_sm_exec(bus_data->pio, bus_data->pio_sm, pio_encode_out(pio_y, 32));
-        pio_sm_exec(bus_data->pio, bus_data->pio_sm, pio_encode_jmp(bus_data->pio_offset));
+        spi_pio_prepare(bus_data, tx_length, rx_length - tx_length);
         dma_channel_abort(bus_data->dma_out);
         dma_channel_abort(bus_data->dma_in);
 
@@ -284,17 +347,7 @@ int cyw43_spi_transfer(cyw43_int_t *self, const uint8_t *tx, size_t tx_length, u
         )
         assert(!(((uintptr_t)tx) & 3));
         assert(!(tx_length & 3));
-        pio_sm_set_enabled(bus_data->pio, bus_data->pio_sm, false);
-        pio_sm_set_wrap(bus_data->pio, bus_data->pio_sm, bus_data->pio_offset, bus_data->pio_offset + SPI_OFFSET_LP1_END - 1);
-        pio_sm_clear_fifos(bus_data->pio, bus_data->pio_sm);
-        pio_sm_set_pindirs_with_mask(bus_data->pio, bus_data->pio_sm, 1u << DATA_OUT_PIN, 1u << DATA_OUT_PIN);
-        pio_sm_restart(bus_data->pio, bus_data->pio_sm);
-        pio_sm_clkdiv_restart(bus_data->pio, bus_data->pio_sm);
-        pio_sm_put(bus_data->pio, bus_data->pio_sm, tx_length * 8 - 1);
-        pio_sm_exec(bus_data->pio, bus_data->pio_sm, pio_encode_out(pio_x, 32));
-        pio_sm_put(bus_data->pio, bus_data->pio_sm, 0);
-        pio_sm_exec(bus_data->pio, bus_data->pio_sm, pio_encode_out(pio_y, 32));
-        pio_sm_exec(bus_data->pio, bus_data->pio_sm, pio_encode_jmp(bus_data->pio_offset));
+        spi_pio_prepare(bus_data, tx_length, 0);
         dma_channel_abort(bus_data->dma_out);
 
         dma_channel_config out_config = dma_channel_get_default_config(bus_data->dma_out);
@@ -303,14 +356,7 @@ int cyw43_spi_transfer(cyw43_int_t *self, const uint8_t *tx, size_t tx_length, u
 
         dma_channel_configure(bus_data->dma_out, &out_config, &bus_data->pio->txf[0], tx, tx_length / 4, true);
 
-        bus_data->pio->fdebug = 1u << PIO_FDEBUG_TXSTALL_LSB;
-        pio_sm_set_enabled(bus_data->pio, 0, true);
-        while (!(bus_data->pio->fdebug & (1u << PIO_FDEBUG_TXSTALL_LSB))) {
-            tight_loop_contents(); // todo timeout
-        }
-        __compiler_memory_barrier();
-        pio_sm_set_enabled(bus_data->pio, bus_data->pio_sm, false);
-        pio_sm_set_consecutive_pindirs(bus_data->pio, bus_data->pio_sm, DATA_IN_PIN, 1, false);
+        spi_pio_wait_tx_stall(bus_data);
     } else if (rx != NULL) { /* currently do one at a time */
         DUMP_SPI_TRANSACTIONS(
                 printf("[%lu] bus TX %u bytes:", counter++, rx_length);
@@ -330,6 +376,128 @@ int cyw43_spi_transfer(cyw43_int_t *self, const uint8_t *tx, size_t tx_length, u
     return 0;
 }
 
+static bool segments_are_words(const cyw43_spi_segment_t *segments, uint count) {
+    for (uint i = 0; i < count; i++) {
+        if (((uintptr_t)segments[i].data | segments[i].len) & 3) return false;
+    }
+    return true;
+}
+
+static size_t segments_length(const cyw43_spi_segment_t *segments, uint count) {
+    size_t len = 0;
+    for (uint i = 0; i < count; i++) len += segments[i].len;
+    return len;
+}
+
+// set the state machine's autopull and autopush thresholds, in bits
+static void spi_pio_set_thresholds(bus_data_t *bus_data, uint pull_bits, uint push_bits) {
+    hw_write_masked(&bus_data->pio->sm[bus_data->pio_sm].shiftctrl,
+                    ((pull_bits & 0x1fu) << PIO_SM0_SHIFTCTRL_PULL_THRESH_LSB) |
+                    ((push_bits & 0x1fu) << PIO_SM0_SHIFTCTRL_PUSH_THRESH_LSB),
+                    PIO_SM0_SHIFTCTRL_PULL_THRESH_BITS | PIO_SM0_SHIFTCTRL_PUSH_THRESH_BITS);
+}
+
+// a descriptor list moving each segment to or from a PIO FIFO, in words (byte swapped, as for cyw43_spi_transfer) or in
+// bytes. A byte written to the TX FIFO is replicated across the word, of which the state machine shifts out the top
+// 8 bits; a byte read from the RX FIFO is the low 8 bits of the word pushed by the state machine
+static void spi_sg_list_init(bus_data_t *bus_data, dma_desc_list_t *list, bool is_tx, bool words,
+                             const cyw43_spi_segment_t *segments, uint count) {
+    if (is_tx) {
+        dma_desc_list_init(list, bus_data->out_descs, count_of(bus_data->out_descs), (uint)bus_data->dma_out,
+                           (uint)bus_data->dma_out_control);
+    } else {
+        dma_desc_list_init(list, bus_data->in_descs, count_of(bus_data->in_descs), (uint)bus_data->dma_in,
+                           (uint)bus_data->dma_in_control);
+    }
+    dma_channel_config c = dma_desc_list_get_default_config(list);
+    channel_config_set_transfer_data_size(&c, words ? DMA_SIZE_32 : DMA_SIZE_8);
+    channel_config_set_bswap(&c, words);
+    channel_config_set_dreq(&c, pio_get_dreq(bus_data->pio, (uint)bus_data->pio_sm, is_tx));
+    channel_config_set_read_increment(&c, is_tx);
+    channel_config_set_write_increment(&c, !is_tx);
+    for (uint i = 0; i < count; i++) {
+        if (!segments[i].len) continue;
+        uint transfers = words ? segments[i].len / 4 : segments[i].len;
+        if (is_tx) {
+            dma_desc_list_add(list, &c, &bus_data->pio->txf[bus_data->pio_sm], segments[i].data, transfers, false);
+        } else {
+            dma_desc_list_add(list, &c, segments[i].data, &bus_data->pio->rxf[bus_data->pio_sm], transfers, false);
+        }
+    }
+}
+
+bool cyw43_spi_sg_available(cyw43_int_t *self) {
+    bus_data_t *bus_data = (bus_data_t *)self->bus_data;
+    if (!bus_data) return false;
+    if (bus_data->dma_out_control < 0) {
+        // scatter-gather transfers are optional, so carry on without them if there are no more channels (and try
+        // again next time)
+        int out_control = dma_claim_unused_channel(false);
+        int in_control = dma_claim_unused_channel(false);
+        if (out_control >= 0 && in_control >= 0) {
+            bus_data->dma_out_control = (int8_t)out_control;
+            bus_data->dma_in_control = (int8_t)in_control;
+        } else {
+            if (out_control >= 0) dma_channel_unclaim((uint)out_control);
+            if (in_control >= 0) dma_channel_unclaim((uint)in_control);
+        }
+    }
+    return bus_data->dma_out_control >= 0;
+}
+
+int cyw43_spi_transfer_sg(cyw43_int_t *self, const cyw43_spi_segment_t *tx, uint tx_count,
+                          const cyw43_spi_segment_t *rx, uint rx_count) {
+    if (!cyw43_spi_sg_available(self)) {
+        return CYW43_FAIL_FAST_CHECK(-CYW43_EPERM);
+    }
+    size_t tx_length = segments_length(tx, tx_count);
+    size_t rx_length = segments_length(rx, rx_count);
+    // the bus always transfers whole words
+    if (!tx_length || tx_count > CYW43_SPI_MAX_SEGMENTS + 2 || rx_count > CYW43_SPI_MAX_SEGMENTS ||
+        ((tx_length | rx_length) & 3)) {
+        return CYW43_FAIL_FAST_CHECK(-CYW43_EINVAL);
+    }
+    bus_data_t *bus_data = (bus_data_t *)self->bus_data;
+    bool tx_words = segments_are_words(tx, tx_count);
+    bool rx_words = segments_are_words(rx, rx_count);
+    DUMP_SPI_TRANSACTIONS(
+            printf("[%lu] bus SG TX %u bytes (%u segments) RX %u bytes (%u segments)\n", counter++, tx_length,
+                   tx_count, rx_length, rx_count);
+    )
+    start_spi_comms(self);
+    spi_pio_prepare(bus_data, tx_length, rx_length);
+    spi_pio_set_thresholds(bus_data, tx_words ? 32 : 8, rx_words ? 32 : 8);
+    dma_channel_abort(bus_data->dma_out);
+    dma_channel_abort(bus_data->dma_in);
+
+    dma_desc_list_t out_list, in_list;
+    spi_sg_list_init(bus_data, &out_list, true, tx_words, tx, tx_count);
+    if (rx_length) {
+        spi_sg_list_init(bus_data, &in_list, false, rx_words, rx, rx_count);
+        dma_desc_list_start(&in_list, false);
+    }
+    dma_desc_list_start(&out_list, false);
+    if (rx_length) {
+        pio_sm_set_enabled(bus_data->pio, bus_data->pio_sm, true);
+        __compiler_memory_barrier();
+        dma_desc_list_wait_for_finish_blocking(&out_list);
+        dma_desc_list_wait_for_finish_blocking(&in_list);
+        __compiler_memory_barrier();
+    } else {
+        // the end of the transfer is detected by the state machine stalling, so make sure it can't stall before the
+        // first descriptor has been loaded
+        while (!pio_sm_is_tx_fifo_full(bus_data->pio, (uint)bus_data->pio_sm) && dma_desc_list_is_busy(&out_list)) {
+            tight_loop_contents();
+        }
+        spi_pio_wait_tx_stall(bus_data);
+    }
+    spi_pio_set_thresholds(bus_data, 32, 32);
+    pio_sm_exec(bus_data->pio, bus_data->pio_sm, pio_encode_mov(pio_pins, pio_null)); // for next time we turn output on
+
+    stop_spi_comms();
+    return 0;
+}
+
 // Initialise our gpios
 void cyw43_spi_gpio_setup(void) {
     // Setup WL_REG_ON (23)
@@ -504,6 +672,22 @@ int cyw43_read_bytes(cyw43_int_t *self, uint32_t fn, uint32_t addr, size_t len,
     return 0;
 }
 
+// Wait for FIFO to be ready to accept data
+static int wait_f2_ready(cyw43_int_t *self) {
+    int f2_ready_attempts = 1000;
+    while (f2_ready_attempts-- > 0) {
+        uint32_t bus_status = cyw43_read_reg_u32(self, BUS_FUNCTION, SPI_STATUS_REGISTER);
+        if (bus_status & STATUS_F2_RX_READY) {
+            logic_debug_set(pin_F2_RX_READY_WAIT, 0);
+            return 0;
+        } else {
+            logic_debug_set(pin_F2_RX_READY_WAIT, 1);
+        }
+    }
+    printf("F2 not ready\n");
+    return CYW43_FAIL_FAST_CHECK(-CYW43_EIO);
+}
+
 // See whd_bus_spi_transfer_bytes
 // Note, uses spid_buf if src isn't using it already
 // Apart from firmware download this appears to only be used for wlan functions?
@@ -512,20 +696,9 @@ int cyw43_write_bytes(cyw43_int_t *self, uint32_t fn, uint32_t addr, size_t len,
     size_t aligned_len = (len + 3) & ~3u;
     assert(aligned_len > 0 && aligned_len <= 0x7f8);
     if (fn == WLAN_FUNCTION) {
-        // Wait for FIFO to be ready to accept data
-        int f2_ready_attempts = 1000;
-        while (f2_ready_attempts-- > 0) {
-            uint32_t bus_status = cyw43_read_reg_u32(self, BUS_FUNCTION, SPI_STATUS_REGISTER);
-            if (bus_status & STATUS_F2_RX_READY) {
-                logic_debug_set(pin_F2_RX_READY_WAIT, 0);
-                break;
-            } else {
-                logic_debug_set(pin_F2_RX_READY_WAIT, 1);
-            }
-        }
-        if (f2_ready_attempts <= 0) {
-            printf("F2 not ready\n");
-            return CYW43_FAIL_FAST_CHECK(-CYW43_EIO);
+        int ret = wait_f2_ready(self);
+        if (ret != 0) {
+            return ret;
         }
     }
     if (src == self->spid_buf) { // avoid a copy in the usual case just to add the header
@@ -542,4 +715,162 @@ int cyw43_write_bytes(cyw43_int_t *self, uint32_t fn, uint32_t addr, size_t len,
         return cyw43_spi_transfer(self, (uint8_t *)&self->spi_header[1], aligned_len + 4, NULL, 0);
     }
 }
+
+int cyw43_read_bytes_sg(cyw43_int_t *self, uint32_t fn, uint32_t addr, size_t len,
+                        const cyw43_spi_segment_t *segments, uint count) {
+    // the response to a backplane read is preceded by padding, which isn't supported here
+    assert(fn != BACKPLANE_FUNCTION);
+    size_t aligned_len = (len + 3) & ~3u;
+    assert(aligned_len > 0 && aligned_len <= 0x7f8);
+    if (segments_length(segments, count) != aligned_len) {
+        return CYW43_FAIL_FAST_CHECK(-CYW43_EINVAL);
+    }
+    uint32_t cmd = make_cmd(false, true, fn, addr, len);
+    cyw43_spi_segment_t tx = {&cmd, 4};
+    if (fn == WLAN_FUNCTION) {
+        logic_debug_set(pin_WIFI_RX, 1);
+    }
+    int ret = cyw43_spi_transfer_sg(self, &tx, 1, segments, count);
+    if (fn == WLAN_FUNCTION) {
+        logic_debug_set(pin_WIFI_RX, 0);
+    }
+    return ret;
+}
+
+int cyw43_write_bytes_sg(cyw43_int_t *self, uint32_t fn, uint32_t addr, const cyw43_spi_segment_t *segments,
+                         uint count) {
+    assert(fn != BACKPLANE_FUNCTION);
+    static uint32_t zero_padding;
+    size_t len = segments_length(segments, count);
+    size_t aligned_len = (len + 3) & ~3u;
+    assert(aligned_len > 0 && aligned_len <= 0x7f8);
+    if (count > CYW43_SPI_MAX_SEGMENTS) {
+        return CYW43_FAIL_FAST_CHECK(-CYW43_EINVAL);
+    }
+    if (fn == WLAN_FUNCTION) {
+        int ret = wait_f2_ready(self);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    // the command, then the data, then padding to a whole word
+    uint32_t cmd = make_cmd(true, true, fn, addr, len);
+    cyw43_spi_segment_t tx[CYW43_SPI_MAX_SEGMENTS + 2];
+    tx[0].data = &cmd;
+    tx[0].len = 4;
+    memcpy(&tx[1], segments, count * sizeof(cyw43_spi_segment_t));
+    uint tx_count = count + 1;
+    if (aligned_len != len) {
+        tx[tx_count].data = &zero_padding;
+        tx[tx_count++].len = aligned_len - len;
+    }
+    logic_debug_set(pin_WIFI_TX, 1);
+    int ret = cyw43_spi_transfer_sg(self, tx, tx_count, NULL, 0);
+    logic_debug_set(pin_WIFI_TX, 0);
+    return ret;
+}
+
+#ifndef SPI_READ_TEST_REGISTER
+#define SPI_READ_TEST_REGISTER 0x14
+#endif
+#ifndef SPI_TEST_RW_REGISTER
+#define SPI_TEST_RW_REGISTER 0x18
+#endif
+#define TEST_PATTERN 0xfeedbead
+
+// switch to another program and/or clock divider, between transfers
+static bool spi_pio_select(bus_data_t *bus_data, const spi_program_t *program, uint16_t clock_div) {
+    if (program != bus_data->program) {
+        pio_remove_program(bus_data->pio, bus_data->program->program, (uint)bus_data->pio_offset);
+        if (!pio_can_add_program(bus_data->pio, program->program)) {
+            // put back the one we had, which fitted before
+            bus_data->pio_offset = (int8_t)pio_add_program(bus_data->pio, bus_data->program->program);
+            return false;
+        }
+        bus_data->pio_offset = (int8_t)pio_add_program(bus_data->pio, program->program);
+        bus_data->program = program;
+    }
+    bus_data->clock_div = clock_div;
+    spi_pio_configure(bus_data);
+    return true;
+}
+
+static bool spi_link_test(cyw43_int_t *self) {
+    // reads first, so nothing is written with a setting which can't even read
+    for (uint i = 0; i < CYW43_SPI_CALIBRATION_ITERATIONS; i++) {
+        if (cyw43_read_reg_u32(self, BUS_FUNCTION, SPI_READ_TEST_REGISTER) != TEST_PATTERN) {
+            return false;
+        }
+    }
+    static const uint32_t fixed_patterns[] = {0, 0xffffffff, 0xaaaaaaaa, 0x55555555};
+    uint32_t lcg = 1;
+    for (uint i = 0; i < CYW43_SPI_CALIBRATION_ITERATIONS; i++) {
+        uint32_t value;
+        if (i < count_of(fixed_patterns)) {
+            value = fixed_patterns[i];
+        } else if (i < count_of(fixed_patterns) + 32) {
+            value = 1u << (i - count_of(fixed_patterns));
+        } else {
+            lcg = lcg * 1664525u + 1013904223u;
+            value = lcg;
+        }
+        cyw43_write_reg_u32(self, BUS_FUNCTION, SPI_TEST_RW_REGISTER, value);
+        if (cyw43_read_reg_u32(self, BUS_FUNCTION, SPI_TEST_RW_REGISTER) != value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline uint32_t spi_clock_hz(uint16_t clock_div) {
+    // two state machine cycles per bit
+    return (uint32_t)((uint64_t)clock_get_hz(clk_sys) * 128 / clock_div);
+}
+
+static uint32_t spi_measure_bytes_per_sec(cyw43_int_t *self) {
+    const uint reads = 64;
+    absolute_time_t start = get_absolute_time();
+    for (uint i = 0; i < reads; i++) {
+        cyw43_read_reg_u32(self, BUS_FUNCTION, SPI_READ_TEST_REGISTER);
+    }
+    int64_t us = absolute_time_diff_us(start, get_absolute_time());
+    // each read is a 4 byte command and a 4 byte response
+    return (uint32_t)((uint64_t)reads * 8 * 1000000 / (uint64_t)MAX(us, 1));
+}
+
+int cyw43_spi_calibrate(cyw43_int_t *self, cyw43_spi_calibration_t *result) {
+    bus_data_t *bus_data = (bus_data_t *)self->bus_data;
+    memset(result, 0, sizeof(cyw43_spi_calibration_t));
+    // this also checks the chip is up
+    if (cyw43_read_reg_u32(self, BUS_FUNCTION, SPI_READ_TEST_REGISTER) != TEST_PATTERN) {
+        return CYW43_FAIL_FAST_CHECK(-CYW43_EIO);
+    }
+    const spi_program_t *program = bus_data->program;
+    uint16_t clock_div = bus_data->clock_div;
+    bool passed = false;
+    for (uint d = 0; d < count_of(spi_clock_divs) && !passed; d++) {
+        if (spi_clock_hz(spi_clock_divs[d]) > CYW43_SPI_MAX_CLOCK_HZ) continue;
+        for (uint p = 0; p < count_of(spi_programs); p++) {
+            if (!spi_pio_select(bus_data, &spi_programs[p], spi_clock_divs[d])) continue;
+            result->settings_tried++;
+            if (spi_link_test(self)) {
+                program = &spi_programs[p];
+                clock_div = spi_clock_divs[d];
+                passed = true;
+                break;
+            }
+        }
+    }
+    // if nothing passed, go back to where we started
+    spi_pio_select(bus_data, program, clock_div);
+    CYW43_DEBUG("cyw43 bus: %s clock divider %d.%02d\n", program->name, clock_div >> 8, (clock_div & 0xff) * 100 / 256);
+
+    result->program_name = program->name;
+    result->clock_div_int = clock_div >> 8;
+    result->clock_div_frac = clock_div & 0xff;
+    result->clock_hz = spi_clock_hz(clock_div);
+    result->peak_bytes_per_sec = result->clock_hz / 8;
+    result->bytes_per_sec = spi_measure_bytes_per_sec(self);
+    return passed ? 0 : CYW43_FAIL_FAST_CHECK(-CYW43_EIO);
+}
 #endif
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _CYW43_SPI_CALIBRATE_H
+#define _CYW43_SPI_CALIBRATE_H
+
+#include "pico.h"
+#include "cyw43.h"
+#include "cyw43_internal.h"
+
+/** \file cyw43_spi_calibrate.h
+ *
+ * Calibration of the CYW43 PIO SPI bus clock and sampling point
+ *
+ * By default the bus runs the PIO state machine at half the system clock, which gives an SPI clock of a quarter of
+ * the system clock, with a PIO program that samples the first bit of a response one whole clock after the data pin is
+ * turned around. How fast the bus can actually run depends on the delay between a clock edge and the CYW43's data
+ * arriving, which depends on the board.
+ *
+ * cyw43_spi_calibrate() tries faster clock dividers, each with the PIO programs which sample earlier or later than
+ * the default, fastest first, and checks each setting with a self-test of the link: repeated reads of the chip's
+ * read-only test register, then writes and reads back of its read/write test register with fixed (all zeros, all
+ * ones, alternating bits), walking ones and pseudo-random patterns. The fastest setting which passes is kept.
+ * Settings with an SPI clock above \ref CYW43_SPI_MAX_CLOCK_HZ are not tried.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// PICO_CONFIG: CYW43_SPI_MAX_CLOCK_HZ, Maximum CYW43 SPI bus clock tried by cyw43_spi_calibrate(), type=int, default=50000000, group=pico_cyw43_arch
+#ifndef CYW43_SPI_MAX_CLOCK_HZ
+#define CYW43_SPI_MAX_CLOCK_HZ 50000000
+#endif
+
+// PICO_CONFIG: CYW43_SPI_CALIBRATION_ITERATIONS, Number of test register reads and write/read pairs each CYW43 bus setting must pass during calibration, type=int, default=64, min=36, group=pico_cyw43_arch
+#ifndef CYW43_SPI_CALIBRATION_ITERATIONS
+#define CYW43_SPI_CALIBRATION_ITERATIONS 64
+#endif
+
+/*! \brief The result of a CYW43 bus calibration
+ */
+typedef struct cyw43_spi_calibration {
+    const char *program_name;   ///< name of the PIO program in use
+    uint16_t clock_div_int;     ///< integer part of the state machine clock divider in use
+    uint8_t clock_div_frac;     ///< fractional part (in 1/256ths) of the state machine clock divider in use
+    uint8_t settings_tried;     ///< number of settings tested
+    uint32_t clock_hz;          ///< the resulting SPI clock
+    uint32_t peak_bytes_per_sec;    ///< the rate at which data is clocked over the bus during a transfer
+    uint32_t bytes_per_sec;     ///< the rate measured for back to back register reads (command and response bytes)
+} cyw43_spi_calibration_t;
+
+/*! \brief Find the fastest reliable clock and sampling point for the CYW43 bus
+ *
+ * This must be called with the chip powered up (i.e. after the driver has initialized the bus), and with no other
+ * bus activity; see cyw43_arch_calibrate_bus(). Only the bus test registers are written.
+ *
+ * \param self the driver state
+ * \param result filled in with the setting in use afterwards, and the bus speed it achieves
+ * \return 0 on success, or -CYW43_EIO if the bus doesn't work at the current setting or no setting passed (in which
+ * case the current setting is kept)
+ */
+int cyw43_spi_calibrate(cyw43_int_t *self, cyw43_spi_calibration_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _CYW43_SPI_SG_H
+#define _CYW43_SPI_SG_H
+
+#include "pico.h"
+#include "cyw43.h"
+#include "cyw43_internal.h"
+
+#if CYW43_LWIP
+#include "lwip/pbuf.h"
+#endif
+
+/** \file cyw43_spi_sg.h
+ *
+ * Scatter-gather transfers on the CYW43 PIO SPI bus, and zero copy transfer of lwIP pbufs
+ *
+ * cyw43_spi_transfer() sends and receives contiguous buffers, so a packet is normally copied between an lwIP pbuf
+ * chain and the driver's bus buffer. The scatter-gather functions here instead run the bus DMA channels from
+ * \ref dma_desc lists, one descriptor per segment, so a packet can be sent straight from a pbuf chain, or received
+ * straight into one. Segments which are all word aligned (in address and length) are moved a word at a time, as for
+ * cyw43_spi_transfer(); otherwise the DMA and the state machine move a byte at a time, which gives the same data on
+ * the bus.
+ *
+ * Scatter-gather needs two more DMA channels, which are claimed (if available) by the first call to
+ * cyw43_spi_sg_available(), so an application which never uses the pbuf functions doesn't lose them; they are released
+ * by cyw43_spi_deinit(). Without them the pbuf functions fall back to copying through the bus buffer.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// PICO_CONFIG: CYW43_SPI_MAX_SEGMENTS, Maximum number of data segments in a scatter-gather CYW43 bus transfer, type=int, default=8, min=1, group=pico_cyw43_arch
+#ifndef CYW43_SPI_MAX_SEGMENTS
+#define CYW43_SPI_MAX_SEGMENTS 8
+#endif
+
+/*! \brief A segment of a scatter-gather transfer
+ */
+typedef struct {
+    void *data;
+    size_t len;
+} cyw43_spi_segment_t;
+
+/*! \brief Check whether scatter-gather transfers are available
+ *
+ * The first call claims the DMA channels needed, if they are free; while they aren't, each call tries again.
+ *
+ * \param self the driver state
+ * \return true if the DMA channels needed have been claimed
+ */
+bool cyw43_spi_sg_available(cyw43_int_t *self);
+
+/*! \brief Perform a scatter-gather bus transfer
+ *
+ * The tx segments are sent, then, if there are any rx segments, data is received into them. The total length in each
+ * direction must be a multiple of 4 bytes.
+ *
+ * \param self the driver state
+ * \param tx the segments to send, at most CYW43_SPI_MAX_SEGMENTS + 2 (to allow for a command and padding)
+ * \param tx_count the number of segments to send
+ * \param rx the segments to receive into, at most CYW43_SPI_MAX_SEGMENTS
+ * \param rx_count the number of segments to receive into, which may be 0
+ * \return 0 on success, or a negative error code
+ */
+int cyw43_spi_transfer_sg(cyw43_int_t *self, const cyw43_spi_segment_t *tx, uint tx_count,
+                          const cyw43_spi_segment_t *rx, uint rx_count);
+
+/*! \brief Read from a (bus or WLAN) function into segments
+ *
+ * As cyw43_read_bytes(), but without going through the bus buffer
+ *
+ * \param self the driver state
+ * \param fn the function
+ * \param addr the address
+ * \param len the number of bytes to read
+ * \param segments the segments, whose total length must be len rounded up to a multiple of 4
+ * \param count the number of segments, at most CYW43_SPI_MAX_SEGMENTS
+ * \return 0 on success, or a negative error code
+ */
+int cyw43_read_bytes_sg(cyw43_int_t *self, uint32_t fn, uint32_t addr, size_t len,
+                        const cyw43_spi_segment_t *segments, uint count);
+
+/*! \brief Write the concatenation of segments to a (bus or WLAN) function
+ *
+ * As cyw43_write_bytes(), but without going through the bus buffer
+ *
+ * \param self the driver state
+ * \param fn the function
+ * \param addr the address
+ * \param segments the segments
+ * \param count the number of segments, at most CYW43_SPI_MAX_SEGMENTS
+ * \return 0 on success, or a negative error code
+ */
+int cyw43_write_bytes_sg(cyw43_int_t *self, uint32_t fn, uint32_t addr, const cyw43_spi_segment_t *segments,
+                         uint count);
+
+#if CYW43_LWIP
+/*! \brief Counters for pbuf transfers
+ */
+typedef struct {
+    uint32_t rx_frames_direct;  ///< frames received straight into a pbuf chain
+    uint32_t rx_frames_copied;  ///< frames received into the bus buffer and copied into a pbuf chain
+    uint32_t rx_no_pbuf;        ///< frames not read because no pbuf could be allocated
+    uint32_t tx_frames_direct;  ///< frames sent straight from a pbuf chain
+    uint32_t tx_frames_copied;  ///< frames copied from a pbuf chain into the bus buffer to be sent
+    uint32_t bytes_not_copied;  ///< bytes moved by the frames sent or received directly, which would have been copied
+} cyw43_pbuf_stats_t;
+
+/*! \brief Read a frame from a function into a new PBUF_POOL pbuf chain
+ *
+ * The frame, including the bus protocol headers preceding the packet, is received by DMA directly into the pbufs;
+ * the headers can then be dropped with pbuf_remove_header() before handing the packet to lwIP.
+ *
+ * \param self the driver state
+ * \param fn the function (normally WLAN_FUNCTION)
+ * \param addr the address
+ * \param len the length of the frame
+ * \return the pbuf chain, or NULL if there were no pbufs available or the read failed
+ */
+struct pbuf *cyw43_read_pbuf(cyw43_int_t *self, uint32_t fn, uint32_t addr, size_t len);
+
+/*! \brief Write a frame made up of a header and a pbuf chain to a function
+ *
+ * \param self the driver state
+ * \param fn the function (normally WLAN_FUNCTION)
+ * \param addr the address
+ * \param header the bus protocol headers preceding the packet
+ * \param header_len the length of the headers
+ * \param p the packet
+ * \return 0 on success, or a negative error code
+ */
+int cyw43_write_pbuf(cyw43_int_t *self, uint32_t fn, uint32_t addr, const void *header, size_t header_len,
+                     const struct pbuf *p);
+
+/*! \brief Get the counters for pbuf transfers
+ *
+ * \param stats filled in with the counters
+ * \param reset if true the counters are reset to zero
+ */
+void cyw43_pbuf_get_stats(cyw43_pbuf_stats_t *stats, bool reset);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif
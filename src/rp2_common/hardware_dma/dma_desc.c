@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "hardware/dma_desc.h"
+
+// the control channel writes each descriptor into the data channel's alias 1 registers
+static_assert(sizeof(dma_desc_t) == 16, "");
+static_assert(DMA_CH0_AL1_TRANS_COUNT_TRIG_OFFSET - DMA_CH0_AL1_CTRL_OFFSET == 12, "");
+static_assert(!(DMA_CH0_AL1_CTRL_OFFSET & 0xf), "");
+
+void dma_desc_list_init(dma_desc_list_t *list, dma_desc_t *descs, uint capacity, uint data_channel, uint control_channel) {
+    check_dma_channel_param(data_channel);
+    check_dma_channel_param(control_channel);
+    invalid_params_if(DMA, data_channel == control_channel);
+    invalid_params_if(DMA, capacity < 2 || capacity > 0xffff);
+    list->descs = descs;
+    list->capacity = (uint16_t)capacity;
+    list->count = 0;
+    list->data_channel = (uint8_t)data_channel;
+    list->control_channel = (uint8_t)control_channel;
+    list->first = descs;
+}
+
+// every descriptor chains back to the control channel, and only raises an IRQ if asked
+static uint32_t desc_ctrl(const dma_desc_list_t *list, const dma_channel_config *config, bool irq) {
+    dma_channel_config c = *config;
+    channel_config_set_chain_to(&c, list->control_channel);
+    channel_config_set_irq_quiet(&c, !irq);
+    channel_config_set_enable(&c, true);
+    return channel_config_get_ctrl_value(&c);
+}
+
+void dma_desc_list_add(dma_desc_list_t *list, const dma_channel_config *config, volatile void *write_addr,
+                       const volatile void *read_addr, uint transfer_count, bool irq) {
+    // one entry is kept for the end of the list
+    invalid_params_if(DMA, list->count + 1u >= list->capacity);
+    // a zero count would be a null trigger, ending the list
+    invalid_params_if(DMA, !transfer_count);
+    dma_desc_t *desc = &list->descs[list->count++];
+    desc->ctrl = desc_ctrl(list, config, irq);
+    desc->read_addr = read_addr;
+    desc->write_addr = write_addr;
+    desc->transfer_count = transfer_count;
+}
+
+void dma_desc_list_start(dma_desc_list_t *list, bool loop) {
+    invalid_params_if(DMA, !list->count);
+    dma_desc_t *end = &list->descs[list->count];
+    dma_channel_config c = dma_channel_get_default_config(list->data_channel);
+    if (loop) {
+        // copy the address of the first descriptor into the control channel's read address, then chain to it to load
+        // the first descriptor again
+        channel_config_set_read_increment(&c, false);
+        end->ctrl = desc_ctrl(list, &c, false);
+        end->read_addr = &list->first;
+        end->write_addr = &dma_hw->ch[list->control_channel].read_addr;
+        end->transfer_count = 1;
+    } else {
+        // writing zero to the trigger register is a null trigger, which doesn't start the data channel, but does
+        // raise its IRQ as it is quiet
+        channel_config_set_chain_to(&c, list->data_channel);
+        channel_config_set_irq_quiet(&c, true);
+        end->ctrl = channel_config_get_ctrl_value(&c);
+        end->read_addr = NULL;
+        end->write_addr = NULL;
+        end->transfer_count = 0;
+    }
+    list->first = list->descs;
+
+    c = dma_channel_get_default_config(list->control_channel);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, true);
+    // wrap the write address back to the data channel's AL1_CTRL after each descriptor
+    channel_config_set_ring(&c, true, 4);
+    // make sure the descriptors have been written before the DMA reads them
+    __compiler_memory_barrier();
+    dma_channel_configure(list->control_channel, &c, &dma_hw->ch[list->data_channel].al1_ctrl, list->descs,
+                          sizeof(dma_desc_t) / sizeof(uint32_t), true);
+}
+
+bool dma_desc_list_is_busy(const dma_desc_list_t *list) {
+    // both channels may be briefly idle between descriptors, so the list has only finished once the control channel
+    // has loaded the (terminating) end of the list. A looping list never finishes, as the data channel is busy
+    // reloading the control channel's read address whenever that is past the end of the list
+    const dma_desc_t *end = &list->descs[list->count];
+    return dma_channel_is_busy(list->control_channel) || dma_channel_is_busy(list->data_channel) ||
+           dma_channel_hw_addr(list->control_channel)->read_addr != (uintptr_t)(end + 1);
+}
+
+void dma_desc_list_abort(dma_desc_list_t *list) {
+    dma_hw->abort = (1u << list->data_channel) | (1u << list->control_channel);
+    // the control channel may trigger the data channel (or vice versa) as it is aborted, so wait for both
+    while (dma_channel_is_busy(list->data_channel) || dma_channel_is_busy(list->control_channel)) {
+        dma_hw->abort = (1u << list->data_channel) | (1u << list->control_channel);
+    }
+    // mark the list as finished for dma_desc_list_is_busy()
+    dma_channel_hw_addr(list->control_channel)->read_addr = (uintptr_t)(&list->descs[list->count] + 1);
+}
@@ -197,6 +197,23 @@ static inline void channel_config_set_chain_to(dma_channel_config *c, uint chain
     c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS) | (chain_to << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB);
 }
 
+/*! \brief Change the channel a DMA channel triggers when it completes
+ *  \ingroup hardware_dma
+ *
+ * Unlike \ref channel_config_set_chain_to this updates the channel itself, without triggering it or changing the rest
+ * of its configuration, so it can be used while the channel is running. Chaining a channel to itself disables chaining,
+ * which stops a pair of channels triggering each other (for example, while they are being aborted).
+ *
+ * \param channel DMA channel
+ * \param chain_to Channel to trigger when this channel completes.
+ */
+static inline void dma_channel_set_chain_to(uint channel, uint chain_to) {
+    check_dma_channel_param(channel);
+    assert(chain_to <= NUM_DMA_CHANNELS);
+    dma_channel_hw_t *hw = dma_channel_hw_addr(channel);
+    hw->al1_ctrl = (hw->al1_ctrl & ~DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS) | (chain_to << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB);
+}
+
 /*! \brief Set the size of each DMA bus transfer in a channel configuration object
  *  \ingroup channel_config
  *
@@ -761,6 +778,57 @@ inline static void dma_sniffer_set_byte_swap_enabled(bool swap) {
         hw_clear_bits(&dma_hw->sniff_ctrl, DMA_SNIFF_CTRL_BSWAP_BITS);
 }
 
+/*! \brief Enable the Sniffer output invert function
+ *  \ingroup hardware_dma
+ *
+ * If enabled, the sniff data result appears bit-inverted when read.
+ * This does not affect the way the checksum is calculated.
+ *
+ * \param invert Set true to enable output bit inversion
+ */
+inline static void dma_sniffer_set_output_invert_enabled(bool invert) {
+    if (invert)
+        hw_set_bits(&dma_hw->sniff_ctrl, DMA_SNIFF_CTRL_OUT_INV_BITS);
+    else
+        hw_clear_bits(&dma_hw->sniff_ctrl, DMA_SNIFF_CTRL_OUT_INV_BITS);
+}
+
+/*! \brief Enable the Sniffer output bit reversal function
+ *  \ingroup hardware_dma
+ *
+ * If enabled, the sniff result appears bit-reversed when read.
+ * This does not affect the way the checksum is calculated.
+ *
+ * \param reverse Set true to enable output bit reversal
+ */
+inline static void dma_sniffer_set_output_reverse_enabled(bool reverse) {
+    if (reverse)
+        hw_set_bits(&dma_hw->sniff_ctrl, DMA_SNIFF_CTRL_OUT_REV_BITS);
+    else
+        hw_clear_bits(&dma_hw->sniff_ctrl, DMA_SNIFF_CTRL_OUT_REV_BITS);
+}
+
+/*! \brief Set the sniffer's data accumulator with initial value
+ *  \ingroup hardware_dma
+ *
+ * Generally, CRC algorithms are used with the data accumulator initially
+ * seeded with 0xFFFF or 0xFFFFFFFF (for crc16 and crc32 algorithms)
+ *
+ * \param seed_value value to set data accumulator
+ */
+inline static void dma_sniffer_set_data_accumulator(uint32_t seed_value) {
+    dma_hw->sniff_data = seed_value;
+}
+
+/*! \brief Get the sniffer's data accumulator value
+ *  \ingroup hardware_dma
+ *
+ * Read value calculated by the hardware from sniffing the DMA stream
+ */
+inline static uint32_t dma_sniffer_get_data_accumulator(void) {
+    return dma_hw->sniff_data;
+}
+
 /*! \brief Disable the DMA sniffer
  *  \ingroup hardware_dma
  *
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _HARDWARE_DMA_DESC_H
+#define _HARDWARE_DMA_DESC_H
+
+#include "hardware/dma.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file hardware/dma_desc.h
+ *  \defgroup dma_desc dma_desc
+ *  \ingroup hardware_dma
+ *
+ * \brief DMA descriptor lists (control blocks) for scatter-gather transfers
+ *
+ * A descriptor list is a list in RAM of transfers (from a buffer to a buffer, or to/from a peripheral) which are
+ * performed one after another by a data DMA channel without any involvement from the processor. A second, control DMA
+ * channel copies each descriptor in turn into the data channel's registers, using the layout of the data channel's
+ * alias 1 registers (CTRL, READ_ADDR, WRITE_ADDR, TRANS_COUNT_TRIG), so that the final write of each descriptor
+ * starts the transfer. Each descriptor's control value chains the data channel back to the control channel, so that
+ * the next descriptor is loaded as soon as the transfer completes.
+ *
+ * This makes it cheap to gather many small buffers (e.g. packet fragments) into one destination, or scatter one
+ * source into many (e.g. display tiles). Each descriptor has its own DREQ, transfer size and address increment
+ * settings, taken from a \ref dma_channel_config.
+ *
+ * The list either terminates, or loops back to the first descriptor forever (until aborted). The descriptors are all
+ * "quiet", so the data channel raises its interrupt only on completion of descriptors added with an IRQ, and
+ * (in terminate mode) when the end of the list is reached, so a single IRQ handler can be notified of the whole list
+ * completing.
+ */
+
+/*! \brief A single descriptor
+ *  \ingroup dma_desc
+ *
+ * The layout matches the data channel's alias 1 registers
+ */
+typedef struct {
+    uint32_t ctrl;
+    const volatile void *read_addr;
+    volatile void *write_addr;
+    uint32_t transfer_count;
+} dma_desc_t;
+
+/*! \brief A descriptor list, and the pair of DMA channels which run it
+ *  \ingroup dma_desc
+ */
+typedef struct {
+    dma_desc_t *descs;
+    uint16_t capacity;
+    uint16_t count;
+    uint8_t data_channel;
+    uint8_t control_channel;
+    // the address of the first descriptor, read by the descriptor which loops back to it
+    const dma_desc_t *first;
+} dma_desc_list_t;
+
+/*! \brief Initialize an empty descriptor list
+ *  \ingroup dma_desc
+ *
+ * \param list the list
+ * \param descs storage for the descriptors; one entry is used for the end of the list, so this should have room for
+ *              one more than the number of transfers
+ * \param capacity the number of entries in descs
+ * \param data_channel the (claimed) DMA channel which performs the transfers
+ * \param control_channel the (claimed) DMA channel which loads the descriptors into the data channel
+ */
+void dma_desc_list_init(dma_desc_list_t *list, dma_desc_t *descs, uint capacity, uint data_channel, uint control_channel);
+
+/*! \brief Remove all descriptors from a list
+ *  \ingroup dma_desc
+ *
+ * \param list the list, which must not be running
+ */
+static inline void dma_desc_list_clear(dma_desc_list_t *list) {
+    list->count = 0;
+}
+
+/*! \brief Get the default channel configuration for a descriptor in a list
+ *  \ingroup dma_desc
+ *
+ * This is the same as \ref dma_channel_get_default_config for the list's data channel; the chaining and IRQ settings
+ * of descriptor configurations are overridden by \ref dma_desc_list_add.
+ *
+ * \param list the list
+ * \return the default configuration
+ */
+static inline dma_channel_config dma_desc_list_get_default_config(const dma_desc_list_t *list) {
+    return dma_channel_get_default_config(list->data_channel);
+}
+
+/*! \brief Append a transfer to a descriptor list
+ *  \ingroup dma_desc
+ *
+ * \param list the list, which must not be running
+ * \param config the configuration (DREQ, data size, increments etc.) for the transfer
+ * \param write_addr the initial write address
+ * \param read_addr the initial read address
+ * \param transfer_count the number of transfers
+ * \param irq true if the data channel should raise its interrupt when this transfer completes
+ */
+void dma_desc_list_add(dma_desc_list_t *list, const dma_channel_config *config, volatile void *write_addr,
+                       const volatile void *read_addr, uint transfer_count, bool irq);
+
+/*! \brief Start running a descriptor list
+ *  \ingroup dma_desc
+ *
+ * \param list the list, which must have at least one descriptor
+ * \param loop true to loop back to the first descriptor after the last, false to stop after the last. When the list
+ *             stops, the data channel raises its interrupt
+ */
+void dma_desc_list_start(dma_desc_list_t *list, bool loop);
+
+/*! \brief Check whether a descriptor list is still running
+ *  \ingroup dma_desc
+ *
+ * \param list the list, which must have been started
+ * \return true if the list has not yet reached its end or been aborted (always true for a looping list
+ *         until it is aborted)
+ */
+bool dma_desc_list_is_busy(const dma_desc_list_t *list);
+
+/*! \brief Wait for a (non looping) descriptor list to reach its end
+ *  \ingroup dma_desc
+ *
+ * \param list the list
+ */
+static inline void dma_desc_list_wait_for_finish_blocking(const dma_desc_list_t *list) {
+    while (dma_desc_list_is_busy(list)) tight_loop_contents();
+}
+
+/*! \brief Stop a running descriptor list
+ *  \ingroup dma_desc
+ *
+ * As for \ref dma_channel_abort, this may cause a spurious interrupt from the data channel, which should be
+ * acknowledged.
+ *
+ * \param list the list
+ */
+void dma_desc_list_abort(dma_desc_list_t *list);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -7,7 +7,7 @@
 #ifndef _HARDWARE_IRQ_H_
 #define _HARDWARE_IRQ_H_
 
-// These two config items are also used by assembler, so keeping separate
+// These config items are also used by assembler, so keeping separate
 // PICO_CONFIG: PICO_MAX_SHARED_IRQ_HANDLERS, Maximum number of shared IRQ handlers, default=4, advanced=true, group=hardware_irq
 #ifndef PICO_MAX_SHARED_IRQ_HANDLERS
 #define PICO_MAX_SHARED_IRQ_HANDLERS 4u
@@ -18,6 +18,16 @@
 #define PICO_DISABLE_SHARED_IRQ_HANDLERS 0
 #endif
 
+// PICO_CONFIG: PICO_IRQ_PROFILE, Enable timing instrumentation of IRQ handlers added via irq_set_exclusive_handler() or irq_add_shared_handler(), type=bool, default=0, group=hardware_irq
+#ifndef PICO_IRQ_PROFILE
+#define PICO_IRQ_PROFILE 0
+#endif
+
+// PICO_CONFIG: PICO_IRQ_PROFILE_MAX_HANDLERS, Maximum number of handlers (across both cores) that can be instrumented when PICO_IRQ_PROFILE is enabled, min=1, max=255, default=16, advanced=true, group=hardware_irq
+#ifndef PICO_IRQ_PROFILE_MAX_HANDLERS
+#define PICO_IRQ_PROFILE_MAX_HANDLERS 16
+#endif
+
 #ifndef __ASSEMBLER__
 
 #include "pico.h"
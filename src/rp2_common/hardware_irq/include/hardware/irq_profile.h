@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _HARDWARE_IRQ_PROFILE_H
+#define _HARDWARE_IRQ_PROFILE_H
+
+#include "hardware/irq.h"
+
+/** \file hardware/irq_profile.h
+ *  \defgroup irq_profile irq_profile
+ *  \ingroup hardware_irq
+ *
+ * \brief IRQ handler execution time profiling
+ *
+ * When PICO_IRQ_PROFILE is set to 1, every handler installed via irq_set_exclusive_handler() or irq_add_shared_handler()
+ * is called via a small thunk which timestamps entry and exit of the handler using the SysTick counter of the executing core.
+ * The SysTick counter is started (free running at the processor clock, with no interrupt) the first time a handler is installed on a core,
+ * so it should not be otherwise reconfigured by the application while profiling.
+ *
+ * Statistics are kept per handler in a fixed size table (see PICO_IRQ_PROFILE_MAX_HANDLERS), and the cycle counts recorded
+ * exclude any time spent in other (higher priority) handlers which preempted the handler being measured. Handlers which
+ * take longer than 2^24 cycles (the width of the SysTick counter) will be mis-measured.
+ *
+ * When PICO_IRQ_PROFILE is 0 (the default), no instrumentation is compiled in, and the functions below are empty inline stubs.
+ *
+ * \note Statistics are recorded separately for each core, and the query functions, like other IRQ APIs, refer to the executing core.
+ */
+
+// PICO_CONFIG: PICO_IRQ_PROFILE_HISTOGRAM_BUCKETS, Number of power of two cycle count histogram buckets kept per profiled IRQ handler, min=2, max=25, default=16, advanced=true, group=hardware_irq
+#ifndef PICO_IRQ_PROFILE_HISTOGRAM_BUCKETS
+#define PICO_IRQ_PROFILE_HISTOGRAM_BUCKETS 16
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \brief Execution statistics for an IRQ handler (or for all handlers of an IRQ)
+ *  \ingroup irq_profile
+ *
+ * histogram[0] counts calls that took 0 cycles, and histogram[n] counts calls which took between 2^(n-1) and 2^n - 1 cycles,
+ * with the last bucket also counting all longer calls.
+ */
+typedef struct {
+    uint32_t count;         ///< number of times the handler was called
+    uint32_t preemptions;   ///< number of times the handler was interrupted by another profiled handler
+    uint32_t min_cycles;    ///< shortest handler execution time
+    uint32_t max_cycles;    ///< longest handler execution time
+    uint64_t total_cycles;  ///< total handler execution time
+    uint32_t histogram[PICO_IRQ_PROFILE_HISTOGRAM_BUCKETS];
+} irq_profile_stats_t;
+
+/*! \brief Return the average execution time from a set of IRQ statistics
+ *  \ingroup irq_profile
+ *
+ * \param stats the statistics
+ * \return the average number of cycles per call, or 0 if there have been no calls
+ */
+static inline uint32_t irq_profile_stats_avg_cycles(const irq_profile_stats_t *stats) {
+    return stats->count ? (uint32_t)(stats->total_cycles / stats->count) : 0;
+}
+
+#if PICO_IRQ_PROFILE
+/*! \brief Get the statistics for a specific IRQ handler on the executing core
+ *  \ingroup irq_profile
+ *
+ * Statistics are retained after a handler is removed, until the profiling slot is reused for another handler.
+ *
+ * \param num Interrupt number \ref interrupt_nums
+ * \param handler the handler as passed to irq_set_exclusive_handler() or irq_add_shared_handler()
+ * \param stats filled in with the statistics
+ * \return true if the handler has been profiled on this core, false otherwise
+ */
+bool irq_profile_get_handler_stats(uint num, irq_handler_t handler, irq_profile_stats_t *stats);
+
+/*! \brief Get the combined statistics for all handlers of an IRQ on the executing core
+ *  \ingroup irq_profile
+ *
+ * For an IRQ with shared handlers, the count is the total number of handler calls, and the minimum/maximum
+ * figures are those of the individual handlers.
+ *
+ * \param num Interrupt number \ref interrupt_nums
+ * \param stats filled in with the statistics
+ * \return true if any handler for the IRQ has been profiled on this core, false otherwise
+ */
+bool irq_profile_get_irq_stats(uint num, irq_profile_stats_t *stats);
+
+/*! \brief Reset the statistics for all profiled handlers on the executing core
+ *  \ingroup irq_profile
+ */
+void irq_profile_reset(void);
+
+/*! \brief Print the statistics for all profiled handlers on both cores via stdio
+ *  \ingroup irq_profile
+ */
+void irq_profile_dump(void);
+
+#else
+static inline bool irq_profile_get_handler_stats(__unused uint num, __unused irq_handler_t handler, __unused irq_profile_stats_t *stats) {
+    return false;
+}
+
+static inline bool irq_profile_get_irq_stats(__unused uint num, __unused irq_profile_stats_t *stats) {
+    return false;
+}
+
+static inline void irq_profile_reset(void) {}
+
+static inline void irq_profile_dump(void) {}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -15,6 +15,14 @@
 
 extern void __unhandled_user_irq(void);
 
+#if PICO_IRQ_PROFILE
+// implemented in irq_profile.c; these must be called with the PICO_SPINLOCK_ID_IRQ spin lock held
+extern irq_handler_t irq_profile_wrap_handler(uint num, irq_handler_t handler);
+extern irq_handler_t irq_profile_wrapped_handler(uint num, irq_handler_t handler);
+extern irq_handler_t irq_profile_unwrap_handler(irq_handler_t handler);
+extern void irq_profile_handler_removed(irq_handler_t handler);
+#endif
+
 static uint8_t user_irq_claimed[NUM_CORES];
 
 static inline irq_handler_t *get_vtable(void) {
@@ -120,6 +128,9 @@ void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
 #if !PICO_NO_RAM_VECTOR_TABLE
     spin_lock_t *lock = spin_lock_instance(PICO_SPINLOCK_ID_IRQ);
     uint32_t save = spin_lock_blocking(lock);
+#if PICO_IRQ_PROFILE
+    handler = irq_profile_wrap_handler(num, handler);
+#endif
     __unused irq_handler_t current = irq_get_vtable_handler(num);
     hard_assert(current == __unhandled_user_irq || current == handler);
     set_raw_irq_handler_and_unlock(num, handler, save);
@@ -138,6 +149,9 @@ irq_handler_t irq_get_exclusive_handler(uint num) {
     if (current == __unhandled_user_irq || is_shared_irq_raw_handler(current)) {
         return NULL;
     }
+#if PICO_IRQ_PROFILE
+    current = irq_profile_unwrap_handler(current);
+#endif
     return current;
 #else
     panic_unsupported();
@@ -202,6 +216,9 @@ void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_prior
 #else
     spin_lock_t *lock = spin_lock_instance(PICO_SPINLOCK_ID_IRQ);
     uint32_t save = spin_lock_blocking(lock);
+#if PICO_IRQ_PROFILE
+    handler = irq_profile_wrap_handler(num, handler);
+#endif
     hard_assert(irq_hander_chain_free_slot_head >= 0); // we must have a slot
     struct irq_handler_chain_slot *slot = &irq_handler_chain_slots[irq_hander_chain_free_slot_head];
     int8_t slot_index = irq_hander_chain_free_slot_head;
@@ -271,6 +288,10 @@ void irq_remove_handler(uint num, irq_handler_t handler) {
 #if !PICO_NO_RAM_VECTOR_TABLE
     spin_lock_t *lock = spin_lock_instance(PICO_SPINLOCK_ID_IRQ);
     uint32_t save = spin_lock_blocking(lock);
+#if PICO_IRQ_PROFILE
+    handler = irq_profile_wrapped_handler(num, handler);
+    irq_profile_handler_removed(handler);
+#endif
     irq_handler_t vtable_handler = get_vtable()[16 + num];
     if (vtable_handler != __unhandled_user_irq && vtable_handler != handler) {
 #if !PICO_DISABLE_SHARED_IRQ_HANDLERS
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "hardware/irq_profile.h"
+
+#if PICO_IRQ_PROFILE
+#include <stdio.h>
+#include <string.h>
+
+#include "hardware/sync.h"
+#include "hardware/structs/systick.h"
+
+static_assert(PICO_IRQ_PROFILE_MAX_HANDLERS >= 1 && PICO_IRQ_PROFILE_MAX_HANDLERS <= 0xff, "");
+static_assert(PICO_IRQ_PROFILE_HISTOGRAM_BUCKETS >= 2 && PICO_IRQ_PROFILE_HISTOGRAM_BUCKETS <= 25, "");
+
+// note these are not real functions, they are 4 byte code fragments (one per slot) which call irq_profile_dispatch
+extern uint16_t irq_profile_thunks[];
+
+static struct irq_profile_slot {
+    irq_handler_t handler; // NULL if the slot has never been used
+    uint8_t num;
+    uint8_t core;
+    bool installed;
+    irq_profile_stats_t stats;
+} irq_profile_slots[PICO_IRQ_PROFILE_MAX_HANDLERS];
+
+// the profiled handler currently executing on each core (if any), and the number of cycles it has spent preempted
+static struct irq_profile_slot *current_slot[NUM_CORES];
+static uint32_t current_preempted_cycles[NUM_CORES];
+
+static inline irq_handler_t thunk_for_slot(uint slot_index) {
+    return (irq_handler_t) (((uintptr_t) &irq_profile_thunks[slot_index * 2]) | 1u);
+}
+
+static inline int slot_for_thunk(irq_handler_t thunk) {
+    uintptr_t offset = ((uintptr_t) thunk) - (((uintptr_t) irq_profile_thunks) | 1u);
+    if (offset >= PICO_IRQ_PROFILE_MAX_HANDLERS * 4 || (offset & 3u)) return -1;
+    return (int) (offset / 4);
+}
+
+static void systick_start(void) {
+    if (!(systick_hw->csr & M0PLUS_SYST_CSR_ENABLE_BITS)) {
+        systick_hw->rvr = M0PLUS_SYST_RVR_BITS;
+        systick_hw->cvr = 0;
+        systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+    }
+}
+
+static void record_cycles(irq_profile_stats_t *stats, uint32_t cycles) {
+    if (!stats->count || cycles < stats->min_cycles) stats->min_cycles = cycles;
+    if (cycles > stats->max_cycles) stats->max_cycles = cycles;
+    stats->count++;
+    stats->total_cycles += cycles;
+    uint bucket = cycles ? 32u - (uint) __builtin_clz(cycles) : 0;
+    stats->histogram[MIN(bucket, PICO_IRQ_PROFILE_HISTOGRAM_BUCKETS - 1u)]++;
+}
+
+// called (tail-called from the thunk, so the return address is the EXC_RETURN or the shared handler chain) with the slot index
+void __time_critical_func(irq_profile_dispatch)(uint slot_index) {
+    struct irq_profile_slot *slot = &irq_profile_slots[slot_index];
+    uint core = get_core_num();
+
+    uint32_t save = save_and_disable_interrupts();
+    struct irq_profile_slot *outer_slot = current_slot[core];
+    uint32_t outer_preempted_cycles = current_preempted_cycles[core];
+    if (outer_slot) outer_slot->stats.preemptions++;
+    current_slot[core] = slot;
+    current_preempted_cycles[core] = 0;
+    uint32_t start = systick_hw->cvr;
+    restore_interrupts(save);
+
+    slot->handler();
+
+    save = save_and_disable_interrupts();
+    // SysTick counts down
+    uint32_t elapsed = (start - systick_hw->cvr) & M0PLUS_SYST_CVR_BITS;
+    record_cycles(&slot->stats, elapsed - current_preempted_cycles[core]);
+    current_slot[core] = outer_slot;
+    current_preempted_cycles[core] = outer_preempted_cycles + elapsed;
+    restore_interrupts(save);
+}
+
+// The following are called by irq.c with the PICO_SPINLOCK_ID_IRQ spin lock held
+
+irq_handler_t irq_profile_wrap_handler(uint num, irq_handler_t handler) {
+    uint core = get_core_num();
+    int free_slot = -1;
+    int evictable_slot = -1;
+    for (uint i = 0; i < PICO_IRQ_PROFILE_MAX_HANDLERS; i++) {
+        struct irq_profile_slot *slot = &irq_profile_slots[i];
+        if (slot->handler == handler && slot->num == num && slot->core == core) {
+            slot->installed = true;
+            return thunk_for_slot(i);
+        }
+        if (!slot->handler) {
+            if (free_slot < 0) free_slot = (int) i;
+        } else if (!slot->installed && evictable_slot < 0) {
+            evictable_slot = (int) i;
+        }
+    }
+    if (free_slot < 0) free_slot = evictable_slot;
+    // if we have run out of slots, the handler is simply not profiled
+    if (free_slot < 0) return handler;
+    systick_start();
+    struct irq_profile_slot *slot = &irq_profile_slots[free_slot];
+    memset(&slot->stats, 0, sizeof(slot->stats));
+    slot->handler = handler;
+    slot->num = (uint8_t) num;
+    slot->core = (uint8_t) core;
+    slot->installed = true;
+    return thunk_for_slot((uint) free_slot);
+}
+
+irq_handler_t irq_profile_wrapped_handler(uint num, irq_handler_t handler) {
+    uint core = get_core_num();
+    for (uint i = 0; i < PICO_IRQ_PROFILE_MAX_HANDLERS; i++) {
+        struct irq_profile_slot *slot = &irq_profile_slots[i];
+        if (slot->installed && slot->handler == handler && slot->num == num && slot->core == core) {
+            return thunk_for_slot(i);
+        }
+    }
+    return handler;
+}
+
+irq_handler_t irq_profile_unwrap_handler(irq_handler_t handler) {
+    int slot_index = slot_for_thunk(handler);
+    return slot_index < 0 ? handler : irq_profile_slots[slot_index].handler;
+}
+
+void irq_profile_handler_removed(irq_handler_t handler) {
+    int slot_index = slot_for_thunk(handler);
+    if (slot_index >= 0) irq_profile_slots[slot_index].installed = false;
+}
+
+static struct irq_profile_slot *find_slot(uint core, uint num, irq_handler_t handler) {
+    for (uint i = 0; i < PICO_IRQ_PROFILE_MAX_HANDLERS; i++) {
+        struct irq_profile_slot *slot = &irq_profile_slots[i];
+        if (slot->handler == handler && slot->num == num && slot->core == core) return slot;
+    }
+    return NULL;
+}
+
+bool irq_profile_get_handler_stats(uint num, irq_handler_t handler, irq_profile_stats_t *stats) {
+    check_irq_param(num);
+    struct irq_profile_slot *slot = find_slot(get_core_num(), num, handler);
+    if (!slot) return false;
+    uint32_t save = save_and_disable_interrupts();
+    *stats = slot->stats;
+    restore_interrupts(save);
+    return true;
+}
+
+static bool get_irq_stats(uint core, uint num, irq_profile_stats_t *stats) {
+    bool found = false;
+    memset(stats, 0, sizeof(*stats));
+    uint32_t save = save_and_disable_interrupts();
+    for (uint i = 0; i < PICO_IRQ_PROFILE_MAX_HANDLERS; i++) {
+        struct irq_profile_slot *slot = &irq_profile_slots[i];
+        if (!slot->handler || slot->num != num || slot->core != core) continue;
+        found = true;
+        const irq_profile_stats_t *s = &slot->stats;
+        if (!s->count) continue;
+        if (!stats->count || s->min_cycles < stats->min_cycles) stats->min_cycles = s->min_cycles;
+        if (s->max_cycles > stats->max_cycles) stats->max_cycles = s->max_cycles;
+        stats->count += s->count;
+        stats->preemptions += s->preemptions;
+        stats->total_cycles += s->total_cycles;
+        for (uint b = 0; b < PICO_IRQ_PROFILE_HISTOGRAM_BUCKETS; b++) {
+            stats->histogram[b] += s->histogram[b];
+        }
+    }
+    restore_interrupts(save);
+    return found;
+}
+
+bool irq_profile_get_irq_stats(uint num, irq_profile_stats_t *stats) {
+    check_irq_param(num);
+    return get_irq_stats(get_core_num(), num, stats);
+}
+
+void irq_profile_reset(void) {
+    uint core = get_core_num();
+    uint32_t save = save_and_disable_interrupts();
+    for (uint i = 0; i < PICO_IRQ_PROFILE_MAX_HANDLERS; i++) {
+        struct irq_profile_slot *slot = &irq_profile_slots[i];
+        if (slot->core == core) memset(&slot->stats, 0, sizeof(slot->stats));
+    }
+    restore_interrupts(save);
+}
+
+static void print_stats(const irq_profile_stats_t *stats) {
+    printf("%10u %8u %8u %8u %8u\n", (uint) stats->count, (uint) stats->min_cycles,
+           (uint) irq_profile_stats_avg_cycles(stats), (uint) stats->max_cycles, (uint) stats->preemptions);
+}
+
+void irq_profile_dump(void) {
+    // note the other core's figures may be being updated while we print them
+    printf("core irq handler       count      min      avg      max  preempt\n");
+    for (uint core = 0; core < NUM_CORES; core++) {
+        for (uint num = 0; num < NUM_IRQS; num++) {
+            irq_profile_stats_t stats;
+            if (!get_irq_stats(core, num, &stats)) continue;
+            printf("%4u %3u %-8s ", core, num, "(all)");
+            print_stats(&stats);
+            for (uint i = 0; i < PICO_IRQ_PROFILE_MAX_HANDLERS; i++) {
+                struct irq_profile_slot *slot = &irq_profile_slots[i];
+                if (!slot->handler || slot->num != num || slot->core != core) continue;
+                stats = slot->stats;
+                printf("         %08x%c", (uint) (uintptr_t) slot->handler, slot->installed ? ' ' : '*');
+                print_stats(&stats);
+            }
+        }
+    }
+}
+#endif
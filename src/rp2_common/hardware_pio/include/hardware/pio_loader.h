@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _HARDWARE_PIO_LOADER_H
+#define _HARDWARE_PIO_LOADER_H
+
+#include "hardware/pio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file hardware/pio_loader.h
+ *  \defgroup pio_loader pio_loader
+ *  \ingroup hardware_pio
+ *
+ * \brief Shared, relocatable loading of PIO programs across both PIO instances
+ *
+ * The program loader keeps a registry of the programs it has loaded, so that independent users of the same program
+ * (e.g. two UART drivers) share a single copy of it in instruction memory; each load just takes another reference,
+ * and the program is removed when the last reference is dropped. Programs are identified by their contents, so copies
+ * of the same program compiled into different parts of an application are also shared.
+ *
+ * New programs are placed in the smallest gap of free instruction memory (on either PIO instance, unless a particular
+ * one is asked for) which they fit in, to keep larger gaps available for larger programs. Loading and unloading
+ * programs can still leave the free space fragmented, in which case \ref pio_loader_compact may be called to move
+ * loaded programs together. A program is only moved if no enabled state machine is running it; the JMP targets within
+ * the program are rewritten, and the wrap settings and program counter of the state machines attached to the program
+ * with \ref pio_loader_attach_sm are updated to match. Programs with a fixed origin are never moved.
+ *
+ * Since programs may move, users should always obtain the current offset of a program with
+ * \ref pio_loader_get_offset before (re)configuring a state machine to run it.
+ *
+ * Programs loaded with \ref pio_add_program etc. occupy instruction memory as usual, but are not known to the loader,
+ * so are neither shared nor moved.
+ */
+
+// PICO_CONFIG: PICO_PIO_LOADER_MAX_PROGRAMS, Maximum number of distinct programs loaded by the PIO program loader at once, type=int, default=16, min=1, max=64, group=hardware_pio
+#ifndef PICO_PIO_LOADER_MAX_PROGRAMS
+#define PICO_PIO_LOADER_MAX_PROGRAMS 16
+#endif
+
+/*! \brief Load a program onto whichever PIO instance has the best fitting space, or share an existing copy
+ *  \ingroup pio_loader
+ *
+ * \param program the program definition, which must remain valid until the program is removed
+ * \param required if true the function will panic if the program cannot be loaded
+ * \return a handle for the loaded program, or -1 if required was false and the program cannot be loaded
+ */
+int pio_loader_add_program(const pio_program_t *program, bool required);
+
+/*! \brief Load a program onto a particular PIO instance, or share an existing copy on that instance
+ *  \ingroup pio_loader
+ *
+ * \param pio The PIO instance; either \ref pio0 or \ref pio1
+ * \param program the program definition, which must remain valid until the program is removed
+ * \param required if true the function will panic if the program cannot be loaded
+ * \return a handle for the loaded program, or -1 if required was false and the program cannot be loaded
+ */
+int pio_loader_add_program_to_pio(PIO pio, const pio_program_t *program, bool required);
+
+/*! \brief Drop a reference to a loaded program, removing it from instruction memory if it was the last
+ *  \ingroup pio_loader
+ *
+ * \param handle the handle returned when the program was added
+ */
+void pio_loader_remove_program(int handle);
+
+/*! \brief Get the PIO instance a program is loaded on
+ *  \ingroup pio_loader
+ *
+ * \param handle the handle returned when the program was added
+ * \return the PIO instance
+ */
+PIO pio_loader_get_pio(int handle);
+
+/*! \brief Get the current instruction memory offset of a program
+ *  \ingroup pio_loader
+ *
+ * \param handle the handle returned when the program was added
+ * \return the offset, which may change when \ref pio_loader_compact is called
+ */
+uint pio_loader_get_offset(int handle);
+
+/*! \brief Attach a state machine to a loaded program, so that it is updated if the program is moved
+ *  \ingroup pio_loader
+ *
+ * \param handle the handle returned when the program was added
+ * \param sm State machine index (0..3) on the program's PIO instance
+ */
+void pio_loader_attach_sm(int handle, uint sm);
+
+/*! \brief Detach a state machine from a loaded program
+ *  \ingroup pio_loader
+ *
+ * \param handle the handle returned when the program was added
+ * \param sm State machine index (0..3) on the program's PIO instance
+ */
+void pio_loader_detach_sm(int handle, uint sm);
+
+/*! \brief Move loaded programs together to combine the free instruction memory into as few gaps as possible
+ *  \ingroup pio_loader
+ *
+ * Programs are moved towards the top of instruction memory, leaving free space at the bottom. Programs which are
+ * being run by an enabled state machine, or have a fixed origin, or were not loaded by the loader, stay where they are.
+ *
+ * \return the number of programs moved
+ */
+uint pio_loader_compact(void);
+
+/*! \brief Get the size of the largest gap in a PIO instance's instruction memory
+ *  \ingroup pio_loader
+ *
+ * \param pio The PIO instance; either \ref pio0 or \ref pio1
+ * \return the length of the longest program that could currently be loaded (without a fixed origin)
+ */
+uint pio_loader_get_largest_free_gap(PIO pio);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
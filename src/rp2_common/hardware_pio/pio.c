@@ -58,11 +58,12 @@ bool pio_sm_is_claimed(PIO pio, uint sm) {
 }
 
 static_assert(PIO_INSTRUCTION_COUNT <= 32, "");
-static uint32_t _used_instruction_space[2];
+// these are also used by the program loader (pio_loader.c)
+uint32_t _pio_used_instruction_space[2];
 
 static int _pio_find_offset_for_program(PIO pio, const pio_program_t *program) {
     assert(program->length <= PIO_INSTRUCTION_COUNT);
-    uint32_t used_mask = _used_instruction_space[pio_get_index(pio)];
+    uint32_t used_mask = _pio_used_instruction_space[pio_get_index(pio)];
     uint32_t program_mask = (1u << program->length) - 1;
     if (program->origin >= 0) {
         if (program->origin > 32 - program->length) return -1;
@@ -89,7 +90,7 @@ static bool _pio_can_add_program_at_offset(PIO pio, const pio_program_t *program
     valid_params_if(PIO, offset < PIO_INSTRUCTION_COUNT);
     valid_params_if(PIO, offset + program->length <= PIO_INSTRUCTION_COUNT);
     if (program->origin >= 0 && (uint)program->origin != offset) return false;
-    uint32_t used_mask = _used_instruction_space[pio_get_index(pio)];
+    uint32_t used_mask = _pio_used_instruction_space[pio_get_index(pio)];
     uint32_t program_mask = (1u << program->length) - 1;
     return !(used_mask & (program_mask << offset));
 }
@@ -101,7 +102,7 @@ bool pio_can_add_program_at_offset(PIO pio, const pio_program_t *program, uint o
     return rc;
 }
 
-static void _pio_add_program_at_offset(PIO pio, const pio_program_t *program, uint offset) {
+void _pio_add_program_at_offset(PIO pio, const pio_program_t *program, uint offset) {
     if (!_pio_can_add_program_at_offset(pio, program, offset)) {
         panic("No program space");
     }
@@ -110,7 +111,7 @@ static void _pio_add_program_at_offset(PIO pio, const pio_program_t *program, ui
         pio->instr_mem[offset + i] = pio_instr_bits_jmp != _pio_major_instr_bits(instr) ? instr : instr + offset;
     }
     uint32_t program_mask = (1u << program->length) - 1;
-    _used_instruction_space[pio_get_index(pio)] |= program_mask << offset;
+    _pio_used_instruction_space[pio_get_index(pio)] |= program_mask << offset;
 }
 
 // these assert if unable
@@ -135,14 +136,14 @@ void pio_remove_program(PIO pio, const pio_program_t *program, uint loaded_offse
     uint32_t program_mask = (1u << program->length) - 1;
     program_mask <<= loaded_offset;
     uint32_t save = hw_claim_lock();
-    assert(program_mask == (_used_instruction_space[pio_get_index(pio)] & program_mask));
-    _used_instruction_space[pio_get_index(pio)] &= ~program_mask;
+    assert(program_mask == (_pio_used_instruction_space[pio_get_index(pio)] & program_mask));
+    _pio_used_instruction_space[pio_get_index(pio)] &= ~program_mask;
     hw_claim_unlock(save);
 }
 
 void pio_clear_instruction_memory(PIO pio) {
     uint32_t save = hw_claim_lock();
-    _used_instruction_space[pio_get_index(pio)] = 0;
+    _pio_used_instruction_space[pio_get_index(pio)] = 0;
     for(uint i=0;i<PIO_INSTRUCTION_COUNT;i++) {
         pio->instr_mem[i] = pio_encode_jmp(i);
     }
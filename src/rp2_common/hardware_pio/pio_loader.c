@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+#include "hardware/claim.h"
+#include "hardware/pio_loader.h"
+#include "hardware/pio_instructions.h"
+
+// shared with pio.c
+extern uint32_t _pio_used_instruction_space[2];
+void _pio_add_program_at_offset(PIO pio, const pio_program_t *program, uint offset);
+
+typedef struct {
+    const pio_program_t *program; // NULL if the entry is unused
+    uint16_t refcount;
+    uint8_t pio_index;
+    uint8_t offset;
+    uint8_t sm_mask;              // attached state machines
+} loaded_program_t;
+
+static loaded_program_t loaded_programs[PICO_PIO_LOADER_MAX_PROGRAMS];
+
+static inline PIO pio_from_index(uint pio_index) {
+    return pio_index ? pio1 : pio0;
+}
+
+static inline uint32_t range_mask(uint length, uint offset) {
+    return (length < 32 ? (1u << length) - 1 : 0xffffffffu) << offset;
+}
+
+static loaded_program_t *loaded_program(int handle) {
+    invalid_params_if(PIO, handle < 0 || handle >= PICO_PIO_LOADER_MAX_PROGRAMS);
+    loaded_program_t *lp = &loaded_programs[handle];
+    invalid_params_if(PIO, !lp->program);
+    return lp;
+}
+
+static bool same_program(const pio_program_t *a, const pio_program_t *b) {
+    return a == b || (a->length == b->length && a->origin == b->origin &&
+                      !memcmp(a->instructions, b->instructions, a->length * sizeof(uint16_t)));
+}
+
+// returns the offset which places a program of the given length at the top of the smallest free gap it fits in (or -1)
+static int find_best_fit(uint32_t used_mask, uint length, uint *gap_length_out) {
+    int best_offset = -1;
+    uint best_length = PIO_INSTRUCTION_COUNT + 1;
+    int top = PIO_INSTRUCTION_COUNT - 1;
+    while (top >= 0) {
+        if (used_mask & (1u << top)) {
+            top--;
+            continue;
+        }
+        int bottom = top;
+        while (bottom > 0 && !(used_mask & (1u << (bottom - 1)))) bottom--;
+        uint gap_length = (uint)(top - bottom + 1);
+        if (gap_length >= length && gap_length < best_length) {
+            best_length = gap_length;
+            best_offset = top + 1 - (int)length;
+        }
+        top = bottom - 1;
+    }
+    *gap_length_out = best_length;
+    return best_offset;
+}
+
+static int find_highest_fit(uint32_t used_mask, uint length) {
+    for (int offset = PIO_INSTRUCTION_COUNT - (int)length; offset >= 0; offset--) {
+        if (!(used_mask & range_mask(length, (uint)offset))) return offset;
+    }
+    return -1;
+}
+
+static int add_program(uint pio_mask, const pio_program_t *program, bool required) {
+    invalid_params_if(PIO, !program->length || program->length > PIO_INSTRUCTION_COUNT);
+    int handle = -1;
+    uint32_t save = hw_claim_lock();
+    for (int i = 0; i < PICO_PIO_LOADER_MAX_PROGRAMS; i++) {
+        loaded_program_t *lp = &loaded_programs[i];
+        if (lp->program && (pio_mask & (1u << lp->pio_index)) && same_program(lp->program, program)) {
+            lp->refcount++;
+            handle = i;
+            break;
+        }
+    }
+    if (handle < 0) {
+        int entry = -1;
+        for (int i = 0; i < PICO_PIO_LOADER_MAX_PROGRAMS && entry < 0; i++) {
+            if (!loaded_programs[i].program) entry = i;
+        }
+        int best_offset = -1;
+        uint best_pio_index = 0;
+        uint best_gap_length = ~0u;
+        for (uint pio_index = 0; pio_index < NUM_PIOS && entry >= 0; pio_index++) {
+            if (!(pio_mask & (1u << pio_index))) continue;
+            uint32_t used_mask = _pio_used_instruction_space[pio_index];
+            int offset;
+            uint gap_length;
+            if (program->origin >= 0) {
+                // a fixed origin fits or it doesn't; prefer the first instance it fits on
+                bool fits = (uint)program->origin + program->length <= PIO_INSTRUCTION_COUNT &&
+                            !(used_mask & range_mask(program->length, (uint)program->origin));
+                offset = fits ? program->origin : -1;
+                gap_length = 0;
+            } else {
+                offset = find_best_fit(used_mask, program->length, &gap_length);
+            }
+            if (offset >= 0 && gap_length < best_gap_length) {
+                best_offset = offset;
+                best_pio_index = pio_index;
+                best_gap_length = gap_length;
+            }
+        }
+        if (best_offset >= 0) {
+            _pio_add_program_at_offset(pio_from_index(best_pio_index), program, (uint)best_offset);
+            loaded_programs[entry] = (loaded_program_t) {
+                    .program = program,
+                    .refcount = 1,
+                    .pio_index = (uint8_t)best_pio_index,
+                    .offset = (uint8_t)best_offset,
+            };
+            handle = entry;
+        }
+    }
+    hw_claim_unlock(save);
+    if (handle < 0 && required) {
+        panic("No program space");
+    }
+    return handle;
+}
+
+int pio_loader_add_program(const pio_program_t *program, bool required) {
+    return add_program((1u << NUM_PIOS) - 1, program, required);
+}
+
+int pio_loader_add_program_to_pio(PIO pio, const pio_program_t *program, bool required) {
+    check_pio_param(pio);
+    return add_program(1u << pio_get_index(pio), program, required);
+}
+
+void pio_loader_remove_program(int handle) {
+    loaded_program_t *lp = loaded_program(handle);
+    uint32_t save = hw_claim_lock();
+    assert(lp->refcount);
+    if (!--lp->refcount) {
+        _pio_used_instruction_space[lp->pio_index] &= ~range_mask(lp->program->length, lp->offset);
+        lp->program = NULL;
+        lp->sm_mask = 0;
+    }
+    hw_claim_unlock(save);
+}
+
+PIO pio_loader_get_pio(int handle) {
+    return pio_from_index(loaded_program(handle)->pio_index);
+}
+
+uint pio_loader_get_offset(int handle) {
+    return loaded_program(handle)->offset;
+}
+
+void pio_loader_attach_sm(int handle, uint sm) {
+    check_sm_param(sm);
+    loaded_program_t *lp = loaded_program(handle);
+    uint32_t save = hw_claim_lock();
+    lp->sm_mask |= (uint8_t)(1u << sm);
+    hw_claim_unlock(save);
+}
+
+void pio_loader_detach_sm(int handle, uint sm) {
+    check_sm_param(sm);
+    loaded_program_t *lp = loaded_program(handle);
+    uint32_t save = hw_claim_lock();
+    lp->sm_mask &= (uint8_t)~(1u << sm);
+    hw_claim_unlock(save);
+}
+
+static inline bool in_program(const loaded_program_t *lp, uint addr) {
+    return addr >= lp->offset && addr < lp->offset + lp->program->length;
+}
+
+// a program can't be moved while an enabled state machine may be running it, whether attached or not
+static bool is_program_busy(PIO pio, const loaded_program_t *lp) {
+    uint enabled_mask = (pio->ctrl & PIO_CTRL_SM_ENABLE_BITS) >> PIO_CTRL_SM_ENABLE_LSB;
+    if (enabled_mask & lp->sm_mask) return true;
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+        if (!(enabled_mask & (1u << sm))) continue;
+        uint wrap_top = (pio->sm[sm].execctrl & PIO_SM0_EXECCTRL_WRAP_TOP_BITS) >> PIO_SM0_EXECCTRL_WRAP_TOP_LSB;
+        if (in_program(lp, pio_sm_get_pc(pio, sm)) || in_program(lp, wrap_top)) return true;
+    }
+    return false;
+}
+
+static void relocate_attached_sms(PIO pio, const loaded_program_t *lp, uint new_offset) {
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+        if (!(lp->sm_mask & (1u << sm))) continue;
+        uint32_t execctrl = pio->sm[sm].execctrl;
+        uint wrap_top = (execctrl & PIO_SM0_EXECCTRL_WRAP_TOP_BITS) >> PIO_SM0_EXECCTRL_WRAP_TOP_LSB;
+        uint wrap_bottom = (execctrl & PIO_SM0_EXECCTRL_WRAP_BOTTOM_BITS) >> PIO_SM0_EXECCTRL_WRAP_BOTTOM_LSB;
+        if (in_program(lp, wrap_top)) wrap_top = wrap_top - lp->offset + new_offset;
+        if (in_program(lp, wrap_bottom)) wrap_bottom = wrap_bottom - lp->offset + new_offset;
+        pio_sm_set_wrap(pio, sm, wrap_bottom, wrap_top);
+        uint pc = pio_sm_get_pc(pio, sm);
+        if (in_program(lp, pc)) {
+            // the state machine is disabled, but still executes this immediately
+            pio_sm_exec(pio, sm, pio_encode_jmp(pc - lp->offset + new_offset));
+        }
+    }
+}
+
+uint pio_loader_compact(void) {
+    uint moved = 0;
+    uint32_t save = hw_claim_lock();
+    for (uint pio_index = 0; pio_index < NUM_PIOS; pio_index++) {
+        PIO pio = pio_from_index(pio_index);
+        loaded_program_t *movable[PICO_PIO_LOADER_MAX_PROGRAMS];
+        uint count = 0;
+        for (uint i = 0; i < PICO_PIO_LOADER_MAX_PROGRAMS; i++) {
+            loaded_program_t *lp = &loaded_programs[i];
+            if (!lp->program || lp->pio_index != pio_index || lp->program->origin >= 0 || is_program_busy(pio, lp)) {
+                continue;
+            }
+            // insert in order of descending offset
+            uint j = count++;
+            for (; j && movable[j - 1]->offset < lp->offset; j--) movable[j] = movable[j - 1];
+            movable[j] = lp;
+            _pio_used_instruction_space[pio_index] &= ~range_mask(lp->program->length, lp->offset);
+        }
+        // moving each program (from the top down) as high as it will go never moves it down, so never onto
+        // instructions of a program not yet moved which is still being relied on
+        for (uint i = 0; i < count; i++) {
+            loaded_program_t *lp = movable[i];
+            uint new_offset = (uint)find_highest_fit(_pio_used_instruction_space[pio_index], lp->program->length);
+            assert(new_offset >= lp->offset);
+            if (new_offset != lp->offset) {
+                _pio_add_program_at_offset(pio, lp->program, new_offset);
+                relocate_attached_sms(pio, lp, new_offset);
+                lp->offset = (uint8_t)new_offset;
+                moved++;
+            } else {
+                _pio_used_instruction_space[pio_index] |= range_mask(lp->program->length, lp->offset);
+            }
+        }
+    }
+    hw_claim_unlock(save);
+    return moved;
+}
+
+uint pio_loader_get_largest_free_gap(PIO pio) {
+    check_pio_param(pio);
+    uint32_t used_mask = _pio_used_instruction_space[pio_get_index(pio)];
+    uint largest = 0, length = 0;
+    for (uint i = 0; i < PIO_INSTRUCTION_COUNT; i++) {
+        length = used_mask & (1u << i) ? 0 : length + 1;
+        if (length > largest) largest = length;
+    }
+    return largest;
+}
@@ -31,10 +31,12 @@ typedef pll_hw_t *PLL;
 #define pll_sys pll_sys_hw
 #define pll_usb pll_usb_hw
 
+// PICO_CONFIG: PICO_PLL_VCO_MIN_FREQ_MHZ, Minimum PLL VCO frequency in MHz, type=int, default=750, group=hardware_pll
 #ifndef PICO_PLL_VCO_MIN_FREQ_MHZ
 #define PICO_PLL_VCO_MIN_FREQ_MHZ 750
 #endif
 
+// PICO_CONFIG: PICO_PLL_VCO_MAX_FREQ_MHZ, Maximum PLL VCO frequency in MHz, type=int, default=1600, group=hardware_pll
 #ifndef PICO_PLL_VCO_MAX_FREQ_MHZ
 #define PICO_PLL_VCO_MAX_FREQ_MHZ 1600
 #endif
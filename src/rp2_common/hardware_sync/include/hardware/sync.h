@@ -50,6 +50,11 @@ extern "C" {
 #define PARAM_ASSERTIONS_ENABLED_SYNC 0
 #endif
 
+// PICO_CONFIG: PICO_LOCK_STATS, Enable/disable recording of contention statistics for hardware spin locks and pico_sync mutexes and semaphores, type=bool, default=0, group=hardware_sync
+#ifndef PICO_LOCK_STATS
+#define PICO_LOCK_STATS 0
+#endif
+
 /** \brief A spin lock identifier
  * \ingroup hardware_sync
  */
@@ -240,16 +245,52 @@ __force_inline static uint spin_lock_get_num(spin_lock_t *lock) {
     return (uint) (lock - (spin_lock_t *) (SIO_BASE + SIO_SPINLOCK0_OFFSET));
 }
 
+#if PICO_LOCK_STATS
+/*! \brief Contention statistics for a lock
+ *  \ingroup hardware_sync
+ *
+ * When PICO_LOCK_STATS is 1, these are recorded for each hardware spin lock (see \ref spin_lock_stats), and
+ * for each pico_sync mutex and semaphore. Times are measured with the 1us resolution timer, so will be 0 for
+ * locks held very briefly.
+ */
+typedef struct lock_stats {
+    uint32_t acquires;                  ///< number of times the lock was acquired
+    uint32_t contentions;               ///< number of acquisitions which had to wait for another owner
+    uint32_t spins;                     ///< (spin locks only) number of failed attempts to claim the lock
+    uint32_t total_wait_us;             ///< total time spent waiting to acquire the lock
+    uint32_t max_hold_us;               ///< longest time the lock was held (not recorded for semaphores)
+    uint32_t core_acquires[NUM_CORES];  ///< number of times each core acquired the lock
+    uint32_t acquired_at_us;            ///< time of the current acquisition
+    bool held;
+} lock_stats_t;
+
+/*! \brief Statistics for each hardware spin lock, indexed by spin lock number
+ *  \ingroup hardware_sync
+ */
+extern lock_stats_t spin_lock_stats[NUM_SPIN_LOCKS];
+
+// \cond internal
+uint32_t lock_stats_time_us(void);
+void lock_stats_record_acquire(lock_stats_t *stats, bool waited, uint32_t wait_start_us);
+void lock_stats_record_release(lock_stats_t *stats);
+void spin_lock_unsafe_blocking_with_stats(spin_lock_t *lock);
+// \endcond
+#endif
+
 /*! \brief Acquire a spin lock without disabling interrupts (hence unsafe)
  *  \ingroup hardware_sync
  *
  * \param lock Spinlock instance
  */
 __force_inline static void spin_lock_unsafe_blocking(spin_lock_t *lock) {
+#if PICO_LOCK_STATS
+    spin_lock_unsafe_blocking_with_stats(lock);
+#else
     // Note we don't do a wfe or anything, because by convention these spin_locks are VERY SHORT LIVED and NEVER BLOCK and run
     // with INTERRUPTS disabled (to ensure that)... therefore nothing on our core could be blocking us, so we just need to wait on another core
     // anyway which should be finished soon
     while (__builtin_expect(!*lock, 0));
+#endif
     __mem_fence_acquire();
 }
 
@@ -259,6 +300,9 @@ __force_inline static void spin_lock_unsafe_blocking(spin_lock_t *lock) {
  * \param lock Spinlock instance
  */
 __force_inline static void spin_unlock_unsafe(spin_lock_t *lock) {
+#if PICO_LOCK_STATS
+    lock_stats_record_release(&spin_lock_stats[spin_lock_get_num(lock)]);
+#endif
     __mem_fence_release();
     *lock = 0;
 }
@@ -62,3 +62,47 @@ bool spin_lock_is_claimed(uint lock_num) {
     return hw_is_claimed((uint8_t *) &claimed, lock_num);
 }
 
+
+#if PICO_LOCK_STATS
+#include "hardware/structs/timer.h"
+
+lock_stats_t spin_lock_stats[NUM_SPIN_LOCKS];
+
+uint32_t __time_critical_func(lock_stats_time_us)(void) {
+    return timer_hw->timerawl;
+}
+
+void __time_critical_func(lock_stats_record_acquire)(lock_stats_t *stats, bool waited, uint32_t wait_start_us) {
+    uint32_t now = timer_hw->timerawl;
+    stats->acquires++;
+    stats->core_acquires[get_core_num()]++;
+    if (waited) {
+        stats->contentions++;
+        stats->total_wait_us += now - wait_start_us;
+    }
+    stats->acquired_at_us = now;
+    stats->held = true;
+}
+
+void __time_critical_func(lock_stats_record_release)(lock_stats_t *stats) {
+    // spin locks are also unlocked when they are initialized or unclaimed
+    if (!stats->held) return;
+    stats->held = false;
+    uint32_t hold_us = timer_hw->timerawl - stats->acquired_at_us;
+    if (hold_us > stats->max_hold_us) stats->max_hold_us = hold_us;
+}
+
+void __time_critical_func(spin_lock_unsafe_blocking_with_stats)(spin_lock_t *lock) {
+    // note reading the spin lock register claims the lock if it is free, so the statistics are only updated once we own it
+    lock_stats_t *stats = &spin_lock_stats[spin_lock_get_num(lock)];
+    if (__builtin_expect(*lock != 0, 1)) {
+        lock_stats_record_acquire(stats, false, 0);
+        return;
+    }
+    uint32_t wait_start_us = timer_hw->timerawl;
+    uint32_t spins = 1;
+    while (!*lock) spins++;
+    stats->spins += spins;
+    lock_stats_record_acquire(stats, true, wait_start_us);
+}
+#endif
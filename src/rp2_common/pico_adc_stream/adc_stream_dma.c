@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pico/adc_stream.h"
+#include "hardware/adc.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+// PICO_CONFIG: PICO_ADC_STREAM_DMA_IRQ_INDEX, The DMA IRQ (0 for DMA_IRQ_0 or 1 for DMA_IRQ_1) used by pico_adc_stream, type=int, default=1, min=0, max=1, group=pico_adc_stream
+#ifndef PICO_ADC_STREAM_DMA_IRQ_INDEX
+#define PICO_ADC_STREAM_DMA_IRQ_INDEX 1
+#endif
+
+// only one stream can use the ADC at a time
+static adc_stream_t *active_stream;
+static uint dma_chan[2];
+// the channel which will complete next
+static uint next_done;
+
+static inline uint16_t *block_addr(adc_stream_t *stream, uint index) {
+    return stream->config.buffer + index * stream->config.block_samples;
+}
+
+static void stop_channels(void) {
+    // stop the channels triggering each other while they are aborted
+    for (uint which = 0; which < 2; which++) {
+        dma_channel_config c = dma_get_channel_config(dma_chan[which]);
+        channel_config_set_chain_to(&c, dma_chan[which]);
+        dma_channel_set_config(dma_chan[which], &c, false);
+    }
+    dma_channel_abort(dma_chan[0]);
+    dma_channel_abort(dma_chan[1]);
+    for (uint which = 0; which < 2; which++) {
+        dma_irqn_acknowledge_channel(PICO_ADC_STREAM_DMA_IRQ_INDEX, dma_chan[which]);
+    }
+}
+
+static void start_channels(adc_stream_t *stream) {
+    uint ring_bits = (uint)__builtin_ctz(stream->config.block_samples * 2);
+    for (uint which = 0; which < 2; which++) {
+        dma_channel_config c = dma_channel_get_default_config(dma_chan[which]);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+        channel_config_set_read_increment(&c, false);
+        channel_config_set_write_increment(&c, true);
+        // if a channel is restarted before being re-armed, it wraps around within its own block
+        channel_config_set_ring(&c, true, ring_bits);
+        channel_config_set_dreq(&c, DREQ_ADC);
+        channel_config_set_chain_to(&c, dma_chan[which ^ 1]);
+        dma_channel_configure(dma_chan[which], &c, block_addr(stream, stream->armed[which]), &adc_hw->fifo,
+                              stream->config.block_samples, false);
+    }
+    next_done = 0;
+    adc_fifo_drain();
+    adc_select_input(stream->inputs[0]);
+    dma_channel_start(dma_chan[0]);
+    adc_run(true);
+}
+
+static void __isr __not_in_flash_func(adc_stream_dma_irq_handler)(void) {
+    adc_stream_t *stream = active_stream;
+    if (!stream) return;
+    while (dma_irqn_get_channel_status(PICO_ADC_STREAM_DMA_IRQ_INDEX, dma_chan[next_done])) {
+        uint done = dma_chan[next_done];
+        uint other = dma_chan[next_done ^ 1];
+        dma_irqn_acknowledge_channel(PICO_ADC_STREAM_DMA_IRQ_INDEX, done);
+        if (dma_channel_is_busy(done) || dma_irqn_get_channel_status(PICO_ADC_STREAM_DMA_IRQ_INDEX, other)) {
+            // the other channel has also finished, and has restarted this one before it was re-armed
+            adc_run(false);
+            stop_channels();
+            adc_stream_restart_blocks(stream);
+            start_channels(stream);
+            return;
+        }
+        uint irq_delay_samples = stream->config.block_samples - dma_channel_hw_addr(other)->transfer_count;
+        uint next = adc_stream_block_done(stream, next_done, irq_delay_samples);
+        dma_channel_set_write_addr(done, block_addr(stream, next), false);
+        next_done ^= 1;
+    }
+}
+
+void adc_stream_backend_start(adc_stream_t *stream) {
+    assert(!active_stream);
+    active_stream = stream;
+    dma_chan[0] = (uint)dma_claim_unused_channel(true);
+    dma_chan[1] = (uint)dma_claim_unused_channel(true);
+
+    adc_run(false);
+    adc_fifo_setup(true, true, 1, false, false);
+    adc_set_round_robin(stream->num_inputs > 1 ? stream->config.input_mask : 0);
+    // a conversion takes 96 cycles, so the maximum rate is 500ksps with the usual 48MHz ADC clock
+    float div = (float)clock_get_hz(clk_adc) / (float)stream->config.sample_rate - 1;
+    adc_set_clkdiv(div > 0 ? div : 0);
+
+    dma_irqn_set_channel_mask_enabled(PICO_ADC_STREAM_DMA_IRQ_INDEX, (1u << dma_chan[0]) | (1u << dma_chan[1]), true);
+    irq_add_shared_handler(DMA_IRQ_0 + PICO_ADC_STREAM_DMA_IRQ_INDEX, adc_stream_dma_irq_handler,
+                           PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0 + PICO_ADC_STREAM_DMA_IRQ_INDEX, true);
+    start_channels(stream);
+}
+
+void adc_stream_backend_stop(adc_stream_t *stream) {
+    assert(active_stream == stream);
+    adc_run(false);
+    dma_irqn_set_channel_mask_enabled(PICO_ADC_STREAM_DMA_IRQ_INDEX, (1u << dma_chan[0]) | (1u << dma_chan[1]), false);
+    stop_channels();
+    irq_remove_handler(DMA_IRQ_0 + PICO_ADC_STREAM_DMA_IRQ_INDEX, adc_stream_dma_irq_handler);
+    adc_fifo_setup(false, false, 0, false, false);
+    adc_fifo_drain();
+    adc_set_round_robin(0);
+    dma_channel_unclaim(dma_chan[0]);
+    dma_channel_unclaim(dma_chan[1]);
+    active_stream = NULL;
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pico/crc_sniff.h"
+#include "hardware/claim.h"
+#include "hardware/dma.h"
+
+// PICO_CONFIG: PICO_CRC_DMA_MIN_BYTES, Minimum number of bytes for which crc_update uses the DMA sniffer rather than software, type=int, default=64, group=pico_crc
+#ifndef PICO_CRC_DMA_MIN_BYTES
+#define PICO_CRC_DMA_MIN_BYTES 64
+#endif
+
+static volatile bool sniffer_in_use;
+static int crc_dma_channel = -1;
+static crc_type_t sniff_type;
+// the sniffed channel reads the data, which is all written here
+static uint32_t dma_sink;
+
+static bool try_claim_sniffer(void) {
+    uint32_t save = hw_claim_lock();
+    bool claimed = !sniffer_in_use;
+    sniffer_in_use = true;
+    hw_claim_unlock(save);
+    return claimed;
+}
+
+static void release_sniffer(void) {
+    dma_sniffer_disable();
+    sniffer_in_use = false;
+}
+
+static inline uint32_t bit_reverse(uint32_t x) {
+    // Cortex-M0+ has no RBIT
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    return __builtin_bswap32(x);
+}
+
+static inline bool is_reflected(crc_type_t type) {
+    return type == CRC_32 || type == CRC_16_KERMIT;
+}
+
+static inline uint crc_width(crc_type_t type) {
+    return type == CRC_16_CCITT || type == CRC_16_XMODEM || type == CRC_16_KERMIT ? 16 : 32;
+}
+
+static uint sniff_mode(crc_type_t type) {
+    switch (type) {
+        case CRC_32: return DMA_SNIFF_CTRL_CALC_VALUE_CRC32R;
+        case CRC_32_MPEG2: return DMA_SNIFF_CTRL_CALC_VALUE_CRC32;
+        case CRC_16_KERMIT: return DMA_SNIFF_CTRL_CALC_VALUE_CRC16R;
+        case CRC_SUM32: return DMA_SNIFF_CTRL_CALC_VALUE_SUM;
+        case CRC_PARITY: return DMA_SNIFF_CTRL_CALC_VALUE_EVEN;
+        default: return DMA_SNIFF_CTRL_CALC_VALUE_CRC16;
+    }
+}
+
+// The sniffer always calculates CRCs most significant bit first, so for reflected CRCs it is fed bit reversed data
+// and its state is the bit reverse of ours (in the top bits, for CRC-16, once reversed as a 32 bit value)
+static void start_sniffer(uint channel, crc_type_t type, uint32_t state, enum dma_channel_transfer_size size) {
+    dma_sniffer_enable(channel, sniff_mode(type), true);
+    if (is_reflected(type)) {
+        dma_sniffer_set_output_reverse_enabled(true);
+        state = bit_reverse(state) >> (32 - crc_width(type));
+    } else if (type != CRC_SUM32 && type != CRC_PARITY && size != DMA_SIZE_8) {
+        // the data is fed most significant bit first, so the first byte in memory must be the most significant
+        dma_sniffer_set_byte_swap_enabled(true);
+    }
+    dma_sniffer_set_data_accumulator(state);
+}
+
+static uint32_t sniffer_state(crc_type_t type) {
+    uint32_t state = dma_sniffer_get_data_accumulator();
+    if (is_reflected(type)) return state >> (32 - crc_width(type));
+    if (type == CRC_PARITY) return state & 1;
+    return crc_width(type) == 16 ? state & 0xffff : state;
+}
+
+bool crc_backend_update_words(crc_type_t type, uint32_t *state, const uint32_t *words, size_t count) {
+    if (count * 4 < PICO_CRC_DMA_MIN_BYTES || !try_claim_sniffer()) return false;
+    if (crc_dma_channel < 0) {
+        // the channel is kept once claimed
+        crc_dma_channel = dma_claim_unused_channel(false);
+        if (crc_dma_channel < 0) {
+            release_sniffer();
+            return false;
+        }
+    }
+    uint channel = (uint)crc_dma_channel;
+    dma_channel_config c = dma_channel_get_default_config(channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_sniff_enable(&c, true);
+    dma_channel_configure(channel, &c, &dma_sink, words, count, false);
+    start_sniffer(channel, type, *state, DMA_SIZE_32);
+    dma_channel_start(channel);
+    dma_channel_wait_for_finish_blocking(channel);
+    *state = sniffer_state(type);
+    release_sniffer();
+    return true;
+}
+
+void crc_sniff_start(uint channel, crc_type_t type, uint32_t crc) {
+    invalid_params_if(CRC, type >= CRC_TYPE_COUNT);
+    enum dma_channel_transfer_size size = (enum dma_channel_transfer_size)
+            ((dma_channel_hw_addr(channel)->al1_ctrl & DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS) >> DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);
+    invalid_params_if(CRC, (type == CRC_SUM32 || type == CRC_PARITY) && size != DMA_SIZE_32);
+    while (!try_claim_sniffer()) tight_loop_contents();
+    sniff_type = type;
+    start_sniffer(channel, type, crc ^ crc_final_xor(type), size);
+}
+
+uint32_t crc_sniff_finish(void) {
+    assert(sniffer_in_use);
+    uint32_t state = sniffer_state(sniff_type);
+    release_sniffer();
+    return state ^ crc_final_xor(sniff_type);
+}
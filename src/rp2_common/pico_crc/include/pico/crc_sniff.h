@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_CRC_SNIFF_H
+#define _PICO_CRC_SNIFF_H
+
+#include "pico/crc.h"
+
+/** \file pico/crc_sniff.h
+ *  \ingroup pico_crc
+ *
+ * \brief Calculate the CRC of data moved by another DMA transfer, as it happens
+ *
+ * The DMA sniffer is a single shared resource, so only one channel can be sniffed at a time; whilst it is in use,
+ * \ref crc_update falls back to its software implementation.
+ *
+ * \code
+ * dma_channel_configure(chan, &c, buffer, &uart_get_hw(uart0)->dr, len, false);
+ * crc_sniff_start(chan, CRC_32, crc_initial_value(CRC_32));
+ * dma_channel_start(chan);
+ * dma_channel_wait_for_finish_blocking(chan);
+ * uint32_t crc = crc_sniff_finish();
+ * \endcode
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \brief Start calculating the CRC of the data read by a DMA channel
+ *  \ingroup pico_crc
+ *
+ * The channel must already be configured, but not yet started. Sniffing is enabled in its configuration, and the data
+ * is interpreted according to its transfer size (\ref CRC_SUM32 and \ref CRC_PARITY require 32 bit transfers);
+ * any byte swapping configured for the channel is not taken into account. If the sniffer is in use by a call to
+ * \ref crc_update on the other core, this waits for it to become free.
+ *
+ * \param channel the DMA channel
+ * \param type the algorithm
+ * \param crc the result for any preceding data, or \ref crc_initial_value()
+ */
+void crc_sniff_start(uint channel, crc_type_t type, uint32_t crc);
+
+/*! \brief Get the result of sniffing, and release the sniffer
+ *  \ingroup pico_crc
+ *
+ * The sniffed transfer must be complete.
+ *
+ * \return the result for the preceding data followed by the sniffed data
+ */
+uint32_t crc_sniff_finish(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -13,6 +13,7 @@
 #include "pico/cyw43_arch.h"
 #include "cyw43_ll.h"
 #include "cyw43_stats.h"
+#include "cyw43_spi_calibrate.h"
 
 #if CYW43_ARCH_DEBUG_ENABLED
 #define CYW43_ARCH_DEBUG(...) printf(__VA_ARGS__)
@@ -143,3 +144,11 @@ bool cyw43_arch_gpio_get(uint wl_gpio) {
     cyw43_gpio_get(&cyw43_state, (int)wl_gpio, &value);
     return value;
 }
+
+int cyw43_arch_calibrate_bus(cyw43_spi_calibration_t *result) {
+    assert(cyw43_is_initialized(&cyw43_state));
+    CYW43_THREAD_ENTER;
+    int ret = cyw43_spi_calibrate((cyw43_int_t *)&cyw43_state.cyw43_ll, result);
+    CYW43_THREAD_EXIT;
+    return ret;
+}
@@ -5,10 +5,12 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "pico/cyw43_arch.h"
 #include "pico/mutex.h"
 #include "pico/sem.h"
+#include "hardware/sync.h"
 
 #include "hardware/gpio.h"
 #include "hardware/irq.h"
@@ -32,9 +34,13 @@
 // todo right now we are now always doing a cyw43_dispatch along with a lwip one when hopping cores in low_prio_irq_schedule_dispatch
 
 #ifndef CYW43_SLEEP_CHECK_MS
-#define CYW43_SLEEP_CHECK_MS 50 // How often to run lwip callback
+#define CYW43_SLEEP_CHECK_MS 50 // How often to run lwip callback (unless PICO_CYW43_ARCH_EVENT_DRIVEN)
+#endif
+static alarm_id_t background_alarm = -1;
+#if PICO_CYW43_ARCH_EVENT_DRIVEN
+static absolute_time_t background_alarm_time;
+static absolute_time_t sleep_time; // when the driver's countdown to putting the bus to sleep ends
 #endif
-static alarm_id_t periodic_alarm = -1;
 
 static inline uint recursive_mutex_enter_count(recursive_mutex_t *mutex) {
     return mutex->enter_count;
@@ -65,11 +71,16 @@ static bool in_low_priority_irq;
 static uint8_t low_priority_irq_num;
 static bool low_priority_irq_missed;
 static low_prio_irq_dispatch_t low_priority_irq_dispatch_slots[CYW43_DISPATCH_SLOT_COUNT];
+static_assert(CYW43_DISPATCH_SLOT_COUNT <= 32, "");
+// slots with a dispatch requested; the low priority IRQ only needs triggering when this becomes non zero
+static volatile uint32_t low_priority_irq_dispatch_pending;
+static spin_lock_t *dispatch_lock;
+static cyw43_arch_background_stats_t background_stats;
 static recursive_mutex_t cyw43_mutex;
 semaphore_t cyw43_irq_sem;
 
 // Called in low priority pendsv interrupt only to do lwip processing and check cyw43 sleep
-static void periodic_worker(void)
+static void background_worker(void)
 {
 #if CYW43_USE_STATS
     static uint32_t counter;
@@ -79,26 +90,77 @@ static void periodic_worker(void)
 #endif
 
     CYW43_STAT_INC(LWIP_RUN_COUNT);
+    background_stats.wakeups++;
 #if CYW43_LWIP
     sys_check_timeouts();
 #endif
     if (cyw43_poll) {
+#if PICO_CYW43_ARCH_EVENT_DRIVEN
+        // the countdown is kept as a deadline; see background_alarm_update
+        if (cyw43_sleep == 1 && time_reached(sleep_time)) {
+            cyw43_sleep = 0;
+            low_prio_irq_schedule_dispatch(CYW43_DISPATCH_SLOT_CYW43, cyw43_poll);
+        }
+#else
         if (cyw43_sleep > 0) {
             if (--cyw43_sleep == 0) {
                 low_prio_irq_schedule_dispatch(CYW43_DISPATCH_SLOT_CYW43, cyw43_poll);
             }
         }
+#endif
     }
 }
 
-// Regular callback to get lwip to check for timeouts
-static int64_t periodic_alarm_handler(__unused alarm_id_t id, __unused void *user_data)
+static int64_t background_alarm_handler(__unused alarm_id_t id, __unused void *user_data)
 {
     // Do lwip processing in low priority pendsv interrupt
-    low_prio_irq_schedule_dispatch(CYW43_DISPATCH_SLOT_ADAPTER, periodic_worker);
+    low_prio_irq_schedule_dispatch(CYW43_DISPATCH_SLOT_ADAPTER, background_worker);
+#if PICO_CYW43_ARCH_EVENT_DRIVEN
+    // the alarm is set again for the next deadline once the worker has run
+    return 0;
+#else
     return CYW43_SLEEP_CHECK_MS * 1000;
+#endif
 }
 
+#if PICO_CYW43_ARCH_EVENT_DRIVEN
+// Set the alarm for the next lwIP timeout, or the end of the countdown to putting the bus to sleep, whichever is
+// sooner. This is called with cyw43_mutex held, after anything which may have added a timeout or restarted the
+// countdown: background processing, and the outermost cyw43_thread_exit
+static void background_alarm_update(void) {
+    absolute_time_t deadline = at_the_end_of_time;
+    if (cyw43_poll && cyw43_sleep > 0) {
+        if (cyw43_sleep > 1) {
+            // the driver (re)started the countdown, in CYW43_SLEEP_CHECK_MS ticks; count the rest down in one go
+            sleep_time = make_timeout_time_ms((uint32_t)(cyw43_sleep - 1) * CYW43_SLEEP_CHECK_MS);
+            cyw43_sleep = 1;
+        }
+        deadline = sleep_time;
+    }
+#if CYW43_LWIP
+    u32_t sleep_ms = sys_timeouts_sleeptime();
+    if (sleep_ms != SYS_TIMEOUTS_SLEEPTIME_INFINITE) {
+        absolute_time_t timeout_time = make_timeout_time_ms(sleep_ms);
+        if (absolute_time_diff_us(timeout_time, deadline) > 0) deadline = timeout_time;
+    }
+#endif
+    // an alarm due no later does the job, as the worker sets the alarm again when it runs
+    if (background_alarm > 0 && !time_reached(background_alarm_time) &&
+        absolute_time_diff_us(background_alarm_time, deadline) >= 0) {
+        return;
+    }
+    if (background_alarm > 0) {
+        cancel_alarm(background_alarm);
+    }
+    background_alarm = -1;
+    if (!is_at_the_end_of_time(deadline)) {
+        background_alarm_time = deadline;
+        // if the deadline has already passed, the worker is dispatched straight away (and 0 returned)
+        background_alarm = add_alarm_at(deadline, background_alarm_handler, NULL, true);
+    }
+}
+#endif
+
 void cyw43_await_background_or_timeout_us(uint32_t timeout_us) {
     // if we are called from within an IRQ, then don't wait (we are only ever called in a polling loop)
     if (!__get_current_exception()) {
@@ -133,16 +195,28 @@ static void low_priority_irq_handler(void) {
             CYW43_STAT_INC(PENDSV_DISABLED_COUNT);
         } else {
             CYW43_STAT_INC(PENDSV_RUN_COUNT);
+            background_stats.dispatches++;
 #ifndef NDEBUG
             in_low_priority_irq = true;
 #endif
+            // take all the requests made so far; any made while running them trigger another run
+            low_prio_irq_dispatch_t funcs[CYW43_DISPATCH_SLOT_COUNT];
+            uint32_t save = spin_lock_blocking(dispatch_lock);
+            uint32_t pending = low_priority_irq_dispatch_pending;
+            low_priority_irq_dispatch_pending = 0;
             for (size_t i = 0; i < count_of(low_priority_irq_dispatch_slots); i++) {
-                if (low_priority_irq_dispatch_slots[i] != NULL) {
-                    low_prio_irq_dispatch_t f = low_priority_irq_dispatch_slots[i];
-                    low_priority_irq_dispatch_slots[i] = NULL;
-                    f();
+                funcs[i] = low_priority_irq_dispatch_slots[i];
+                low_priority_irq_dispatch_slots[i] = NULL;
+            }
+            spin_unlock(dispatch_lock, save);
+            for (size_t i = 0; i < count_of(low_priority_irq_dispatch_slots); i++) {
+                if ((pending & (1u << i)) && funcs[i] != NULL) {
+                    funcs[i]();
                 }
             }
+#if PICO_CYW43_ARCH_EVENT_DRIVEN
+            background_alarm_update();
+#endif
 #ifndef NDEBUG
             in_low_priority_irq = false;
 #endif
@@ -178,14 +252,17 @@ static void low_prio_irq_deinit(void) {
 int cyw43_arch_init(void) {
     cyw43_core_num = get_core_num();
     recursive_mutex_init(&cyw43_mutex);
+    if (!dispatch_lock) dispatch_lock = spin_lock_instance(next_striped_spin_lock_num());
     cyw43_init(&cyw43_state);
     sem_init(&cyw43_irq_sem, 0, 1);
 
+#if !PICO_CYW43_ARCH_EVENT_DRIVEN
     // Start regular lwip callback to handle timeouts
-    periodic_alarm = add_alarm_in_us(CYW43_SLEEP_CHECK_MS * 1000, periodic_alarm_handler, NULL, true);
-    if (periodic_alarm < 0) {
+    background_alarm = add_alarm_in_us(CYW43_SLEEP_CHECK_MS * 1000, background_alarm_handler, NULL, true);
+    if (background_alarm < 0) {
         return PICO_ERROR_GENERIC;
     }
+#endif
 
     gpio_add_raw_irq_handler_with_order_priority(IO_IRQ_BANK0, gpio_irq_handler, CYW43_GPIO_IRQ_HANDLER_PRIORITY);
     gpio_set_irq_enabled(CYW43_PIN_WL_HOST_WAKE, GPIO_IRQ_LEVEL_HIGH, true);
@@ -200,13 +277,18 @@ int cyw43_arch_init(void) {
         cyw43_arch_deinit();
         return PICO_ERROR_GENERIC;
     }
+#if PICO_CYW43_ARCH_EVENT_DRIVEN
+    // set the alarm for the timeouts lwip_init() added
+    cyw43_thread_enter();
+    cyw43_thread_exit();
+#endif
     return PICO_OK;
 }
 
 void cyw43_arch_deinit(void) {
-    if (periodic_alarm >= 0) {
-        cancel_alarm(periodic_alarm);
-        periodic_alarm = -1;
+    if (background_alarm > 0) {
+        cancel_alarm(background_alarm);
+        background_alarm = -1;
     }
     gpio_set_irq_enabled(CYW43_PIN_WL_HOST_WAKE, GPIO_IRQ_LEVEL_HIGH, false);
     gpio_remove_raw_irq_handler(IO_IRQ_BANK0, gpio_irq_handler);
@@ -217,10 +299,7 @@ void cyw43_post_poll_hook(void) {
     gpio_set_irq_enabled(CYW43_PIN_WL_HOST_WAKE, GPIO_IRQ_LEVEL_HIGH, true);
 }
 
-// This is called in the gpio and low_prio_irq interrupts and on either core
-static void low_prio_irq_schedule_dispatch(size_t slot, low_prio_irq_dispatch_t f) {
-    assert(slot < count_of(low_priority_irq_dispatch_slots));
-    low_priority_irq_dispatch_slots[slot] = f;
+static void low_prio_irq_trigger(void) {
     if (cyw43_core_num == get_core_num()) {
         //on same core, can dispatch directly
         irq_set_pending(low_priority_irq_num);
@@ -235,6 +314,23 @@ static void low_prio_irq_schedule_dispatch(size_t slot, low_prio_irq_dispatch_t
     }
 }
 
+// This is called in the gpio and low_prio_irq interrupts and on either core
+static void low_prio_irq_schedule_dispatch(size_t slot, low_prio_irq_dispatch_t f) {
+    assert(slot < count_of(low_priority_irq_dispatch_slots));
+    uint32_t save = spin_lock_blocking(dispatch_lock);
+    low_priority_irq_dispatch_slots[slot] = f;
+    bool already_pending = low_priority_irq_dispatch_pending != 0;
+    low_priority_irq_dispatch_pending |= 1u << slot;
+    background_stats.dispatch_requests++;
+    spin_unlock(dispatch_lock, save);
+    // Requests are coalesced: one already pending will run this one too, as will the outermost cyw43_thread_exit if
+    // the lock is held. Pending the IRQ on its own core is cheap, and is needed when called from gpio_irq_handler
+    // on behalf of the other core
+    if (!already_pending || cyw43_core_num == get_core_num()) {
+        low_prio_irq_trigger();
+    }
+}
+
 void cyw43_schedule_internal_poll_dispatch(void (*func)(void)) {
     low_prio_irq_schedule_dispatch(CYW43_DISPATCH_SLOT_CYW43, func);
 }
@@ -258,18 +354,27 @@ void cyw43_thread_lock_check(void) {
 
 // Re-enable background processing
 void cyw43_thread_exit(void) {
-    // Run low_prio_irq if needed
-    if (1 == recursive_mutex_enter_count(&cyw43_mutex)) {
+    bool outermost = 1 == recursive_mutex_enter_count(&cyw43_mutex);
+    if (outermost) {
         // note the outer release of the mutex is not via cyw43_exit in the low_priority_irq case (it is a direct mutex exit)
         assert(!in_low_priority_irq);
-//        if (low_priority_irq_missed) {
-//            low_priority_irq_missed = false;
-            if (low_priority_irq_dispatch_slots[CYW43_DISPATCH_SLOT_CYW43]) {
-                low_prio_irq_schedule_dispatch(CYW43_DISPATCH_SLOT_CYW43, cyw43_poll);
-            }
-//        }
+#if PICO_CYW43_ARCH_EVENT_DRIVEN
+        background_alarm_update();
+#endif
     }
     recursive_mutex_exit(&cyw43_mutex);
+    // Run low_prio_irq if it was missed while we held the lock; this must be after the lock is released, or it would
+    // just miss it again
+    if (outermost && low_priority_irq_dispatch_pending) {
+        low_prio_irq_trigger();
+    }
+}
+
+void cyw43_arch_get_background_stats(cyw43_arch_background_stats_t *stats, bool reset) {
+    uint32_t save = spin_lock_blocking(dispatch_lock);
+    *stats = background_stats;
+    if (reset) memset(&background_stats, 0, sizeof(background_stats));
+    spin_unlock(dispatch_lock, save);
 }
 
 
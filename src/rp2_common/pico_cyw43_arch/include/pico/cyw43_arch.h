@@ -39,7 +39,9 @@ extern "C" {
  * \c pico_cyw43_arch attempts to abstract these complications into several behavioral groups:
  *
  * * \em 'poll' - This not multi-core/IRQ safe, and requires the user to call \ref cyw43_arch_poll periodically from their main loop
- * * \em 'thread_safe_background' - This is multi-core/thread/task safe, and maintenance of the driver and TCP/IP stack is handled automatically in the background
+ * * \em 'thread_safe_background' - This is multi-core/thread/task safe, and maintenance of the driver and TCP/IP stack is handled automatically in the background.
+ *   The background processing runs when the wireless chip interrupts, and from a single alarm set for the next lwIP timeout (or the point at which the
+ *   chip's bus is put to sleep), so an idle device is only woken when there is something to do; see \ref PICO_CYW43_ARCH_EVENT_DRIVEN
  *
  * As of right now, lwIP is the only supported TCP/IP stack, however the use of \c pico_cyw43_arch is intended to be independent of
  * the particular TCP/IP stack used (and possibly Bluetooth stack used) in the future. For this reason, the integration of lwIP
@@ -248,6 +250,21 @@ void cyw43_arch_gpio_put(uint wl_gpio, bool value);
  */
 bool cyw43_arch_gpio_get(uint wl_gpio);
 
+struct cyw43_spi_calibration;
+
+/*!
+ * \brief Find the fastest reliable clock for the bus to the wireless chip
+ * \ingroup pico_cyw43_arch
+ *
+ * Tries faster bus clocks, and earlier and later sampling of data from the chip, checking each with a self-test of
+ * the link, and keeps the fastest setting which passes; see cyw43_spi_calibrate.h. The chip must have been powered
+ * up, e.g. by \ref cyw43_arch_enable_sta_mode.
+ *
+ * \param result filled in with the setting chosen and the bus speed it achieves (a \c cyw43_spi_calibration_t)
+ * \return 0 on success, or a negative error code if the bus isn't working, in which case the setting is unchanged
+ */
+int cyw43_arch_calibrate_bus(struct cyw43_spi_calibration *result);
+
 /*!
  * \brief Perform any processing required by the \c cyw43_driver or the TCP/IP stack
  * \ingroup pico_cyw43_arch
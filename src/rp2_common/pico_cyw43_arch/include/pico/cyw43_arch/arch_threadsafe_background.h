@@ -13,6 +13,30 @@
 extern "C" {
 #endif
 
+// PICO_CONFIG: PICO_CYW43_ARCH_EVENT_DRIVEN, Run lwIP timeouts and the CYW43 sleep countdown from a one-shot alarm set for the next deadline, rather than checking them from a periodic alarm every CYW43_SLEEP_CHECK_MS, type=bool, default=1, group=pico_cyw43_arch
+#ifndef PICO_CYW43_ARCH_EVENT_DRIVEN
+#define PICO_CYW43_ARCH_EVENT_DRIVEN 1
+#endif
+
+/*! \brief Counters for the background processing of \c pico_cyw43_arch_threadsafe_background
+ *  \ingroup pico_cyw43_arch
+ */
+typedef struct {
+    uint32_t wakeups;           ///< runs of the lwIP timeouts and CYW43 sleep countdown
+    uint32_t dispatch_requests; ///< requests for background processing (timeouts, CYW43 interrupts and so on)
+    uint32_t dispatches;        ///< runs of background processing; fewer than the requests when they are coalesced
+} cyw43_arch_background_stats_t;
+
+/*! \brief Get the counters for background processing
+ *  \ingroup pico_cyw43_arch
+ *
+ * This may be called after \ref cyw43_arch_init, e.g. to measure how often an idle device wakes up.
+ *
+ * \param stats filled in with the counters
+ * \param reset if true the counters are reset to zero
+ */
+void cyw43_arch_get_background_stats(cyw43_arch_background_stats_t *stats, bool reset);
+
 void cyw43_thread_enter(void);
 
 void cyw43_thread_exit(void);
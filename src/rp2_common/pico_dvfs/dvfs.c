@@ -0,0 +1,406 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pico/dvfs.h"
+#include "pico/pll_solver.h"
+#include "hardware/clocks.h"
+#include "hardware/pll.h"
+#include "hardware/sync.h"
+#include "hardware/structs/vreg_and_chip_reset.h"
+#if PICO_DVFS_ADJUST_PERIPHERALS
+#include "hardware/uart.h"
+#include "hardware/spi.h"
+#include "hardware/pwm.h"
+#endif
+
+static const dvfs_level_t default_levels[] = {
+        {48000, VREG_VOLTAGE_0_95},
+        {125000, VREG_VOLTAGE_1_10},
+        {200000, VREG_VOLTAGE_1_15},
+        {250000, VREG_VOLTAGE_1_20},
+};
+
+static dvfs_level_t levels[PICO_DVFS_MAX_LEVELS];
+static pll_solution_t solutions[PICO_DVFS_MAX_LEVELS];
+static uint level_count;
+static int current_level = -1;
+
+static spin_lock_t *lock;
+static volatile bool in_transition;
+
+typedef struct {
+    dvfs_notifier_t notifier;
+    void *user_data;
+} notifier_entry_t;
+
+static notifier_entry_t notifiers[PICO_DVFS_MAX_NOTIFIERS];
+static dvfs_stats_t stats;
+
+#if PICO_DVFS_ADJUST_PERIPHERALS
+// The rate a peripheral was set to, and the register value it was left with by the last transition: as long as the
+// register still holds that value, the rate is taken from here rather than read back from the (rounded) register, so
+// rounding errors don't accumulate over repeated transitions. A register holding anything else has been changed since.
+typedef struct {
+    uint32_t rate;
+    uint32_t reg;
+} peripheral_rate_t;
+
+static peripheral_rate_t uart_rates[NUM_UARTS];
+static peripheral_rate_t spi_rates[NUM_SPIS];
+static peripheral_rate_t pwm_rates[NUM_PWM_SLICES];   // for PWM, the rate is in units of 1/16 Hz
+#endif
+
+typedef struct {
+    uint64_t idle_start_us;     // 0 when not idle
+    uint64_t idle_us;           // idle time since the governor last looked
+    bool reported;
+} idle_state_t;
+
+static idle_state_t idle_state[NUM_CORES];
+
+static struct {
+    repeating_timer_t timer;
+    dvfs_governor_config_t config;
+    uint64_t last_us;
+    bool running;
+} governor;
+
+void dvfs_init(const dvfs_level_t *new_levels, uint count) {
+    if (!new_levels) {
+        new_levels = default_levels;
+        count = count_of(default_levels);
+    }
+    invalid_params_if(DVFS, !count || count > PICO_DVFS_MAX_LEVELS);
+    if (!lock) lock = spin_lock_instance(next_striped_spin_lock_num());
+    uint32_t sys_hz = clock_get_hz(clk_sys);
+    current_level = -1;
+    for (uint i = 0; i < count; i++) {
+        invalid_params_if(DVFS, i && new_levels[i].sys_khz <= new_levels[i - 1].sys_khz);
+        levels[i] = new_levels[i];
+        if (!pll_solve_khz(XOSC_MHZ * 1000, levels[i].sys_khz, &solutions[i])) {
+            panic("System clock of %d kHz cannot be achieved", (int)levels[i].sys_khz);
+        }
+        if (solutions[i].out_hz == sys_hz) current_level = (int)i;
+    }
+    level_count = count;
+}
+
+uint dvfs_get_level_count(void) {
+    return level_count;
+}
+
+const dvfs_level_t *dvfs_get_level_info(uint level) {
+    invalid_params_if(DVFS, level >= level_count);
+    return &levels[level];
+}
+
+int dvfs_get_level(void) {
+    return current_level;
+}
+
+bool dvfs_add_notifier(dvfs_notifier_t notifier, void *user_data) {
+    bool added = false;
+    uint32_t save = spin_lock_blocking(lock);
+    for (uint i = 0; i < PICO_DVFS_MAX_NOTIFIERS; i++) {
+        if (!notifiers[i].notifier) {
+            notifiers[i].notifier = notifier;
+            notifiers[i].user_data = user_data;
+            added = true;
+            break;
+        }
+    }
+    spin_unlock(lock, save);
+    return added;
+}
+
+void dvfs_remove_notifier(dvfs_notifier_t notifier, void *user_data) {
+    uint32_t save = spin_lock_blocking(lock);
+    for (uint i = 0; i < PICO_DVFS_MAX_NOTIFIERS; i++) {
+        if (notifiers[i].notifier == notifier && notifiers[i].user_data == user_data) {
+            notifiers[i].notifier = NULL;
+            break;
+        }
+    }
+    spin_unlock(lock, save);
+}
+
+void dvfs_get_stats(dvfs_stats_t *out, bool reset) {
+    uint32_t save = spin_lock_blocking(lock);
+    *out = stats;
+    if (reset) {
+        stats.transitions = 0;
+        stats.max_us = 0;
+        stats.total_us = 0;
+    }
+    spin_unlock(lock, save);
+}
+
+#if PICO_DVFS_ADJUST_PERIPHERALS
+static uint32_t remembered_rate(peripheral_rate_t *r, uint32_t reg, uint32_t current_rate) {
+    if (r->rate && r->reg == reg) return r->rate;
+    r->rate = current_rate;
+    return current_rate;
+}
+
+static void peripherals_pre_change(const dvfs_transition_t *t, uint32_t *uart_baud, uint32_t *spi_baud) {
+    for (uint i = 0; i < NUM_UARTS; i++) {
+        uart_inst_t *uart = uart_get_instance(i);
+        uart_baud[i] = 0;
+        if (!uart_is_enabled(uart) || t->new_peri_hz == t->old_peri_hz) continue;
+        // don't garble a character on the way out
+        uart_tx_wait_blocking(uart);
+        uart_hw_t *hw = uart_get_hw(uart);
+        uint32_t reg = (hw->ibrd << 6) | hw->fbrd;
+        uart_baud[i] = remembered_rate(&uart_rates[i], reg, (4 * t->old_peri_hz) / ((hw->ibrd << 6) + hw->fbrd));
+    }
+    for (uint i = 0; i < NUM_SPIS; i++) {
+        spi_inst_t *spi = i ? spi1 : spi0;
+        spi_hw_t *hw = spi_get_hw(spi);
+        spi_baud[i] = 0;
+        if (!(hw->cr1 & SPI_SSPCR1_SSE_BITS) || t->new_peri_hz == t->old_peri_hz) continue;
+        while (spi_is_busy(spi)) tight_loop_contents();
+        uint32_t reg = (hw->cpsr << 16) | (hw->cr0 & SPI_SSPCR0_SCR_BITS);
+        spi_baud[i] = remembered_rate(&spi_rates[i], reg, spi_get_baudrate(spi));
+    }
+}
+
+static void peripherals_post_change(const dvfs_transition_t *t, const uint32_t *uart_baud, const uint32_t *spi_baud) {
+    for (uint i = 0; i < NUM_UARTS; i++) {
+        if (!uart_baud[i]) continue;
+        uart_inst_t *uart = uart_get_instance(i);
+        uart_set_baudrate(uart, uart_baud[i]);
+        uart_rates[i].reg = (uart_get_hw(uart)->ibrd << 6) | uart_get_hw(uart)->fbrd;
+    }
+    for (uint i = 0; i < NUM_SPIS; i++) {
+        if (!spi_baud[i]) continue;
+        spi_inst_t *spi = i ? spi1 : spi0;
+        spi_set_baudrate(spi, spi_baud[i]);
+        spi_rates[i].reg = (spi_get_hw(spi)->cpsr << 16) | (spi_get_hw(spi)->cr0 & SPI_SSPCR0_SCR_BITS);
+    }
+    for (uint slice = 0; slice < NUM_PWM_SLICES; slice++) {
+        if (!(pwm_hw->slice[slice].csr & PWM_CH0_CSR_EN_BITS)) continue;
+        uint32_t div = pwm_hw->slice[slice].div & PWM_CH0_DIV_BITS;
+        // the counting rate, in 1/16 Hz, is 16 * 16 * clk_sys / div
+        uint32_t rate = remembered_rate(&pwm_rates[slice], div,
+                                        (uint32_t)(((uint64_t)t->old_sys_hz << 8) / (div ? div : 1)));
+        uint32_t new_div = (uint32_t)((((uint64_t)t->new_sys_hz << 8) + rate / 2) / rate);
+        if (new_div < 0x10) new_div = 0x10;
+        if (new_div > PWM_CH0_DIV_BITS) new_div = PWM_CH0_DIV_BITS;
+        pwm_hw->slice[slice].div = new_div;
+        pwm_rates[slice].reg = new_div;
+    }
+}
+#endif
+
+static void notify(enum dvfs_phase phase, const dvfs_transition_t *t) {
+    notifier_entry_t local[PICO_DVFS_MAX_NOTIFIERS];
+    uint32_t save = spin_lock_blocking(lock);
+    uint n = 0;
+    for (uint i = 0; i < PICO_DVFS_MAX_NOTIFIERS; i++) {
+        if (notifiers[i].notifier) local[n++] = notifiers[i];
+    }
+    spin_unlock(lock, save);
+    for (uint i = 0; i < n; i++) {
+        notifier_entry_t *e = &local[phase == DVFS_PRE_CHANGE ? i : n - 1 - i];
+        e->notifier(phase, t, e->user_data);
+    }
+}
+
+static void switch_sys_clock(const pll_solution_t *s, bool peri_follows_sys) {
+    uint32_t ref_hz = clock_get_hz(clk_ref);
+    // run from clk_ref while the PLL changes
+    clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLK_REF, CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS,
+                    ref_hz, ref_hz);
+    if ((pll_sys_hw->cs & PLL_CS_LOCK_BITS) && (pll_sys_hw->fbdiv_int & PLL_FBDIV_INT_BITS) == s->fbdiv) {
+        // the VCO is already at the right frequency, so there's no need to wait for it to lock again
+        pll_sys_hw->prim = ((uint32_t)s->postdiv1 << PLL_PRIM_POSTDIV1_LSB) |
+                           ((uint32_t)s->postdiv2 << PLL_PRIM_POSTDIV2_LSB);
+    } else {
+        pll_init(pll_sys, 1, s->vco_khz * 1000, s->postdiv1, s->postdiv2);
+    }
+    clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX,
+                    CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS, s->out_hz, s->out_hz);
+    if (peri_follows_sys) {
+        clock_configure(clk_peri, 0, CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS, s->out_hz, s->out_hz);
+    }
+}
+
+static enum vreg_voltage get_voltage(void) {
+    return (enum vreg_voltage)((vreg_and_chip_reset_hw->vreg & VREG_AND_CHIP_RESET_VREG_VSEL_BITS) >>
+                               VREG_AND_CHIP_RESET_VREG_VSEL_LSB);
+}
+
+static void transition(uint level) {
+    uint64_t start_us = time_us_64();
+    const pll_solution_t *s = &solutions[level];
+    bool peri_follows_sys = ((clocks_hw->clk[clk_peri].ctrl & CLOCKS_CLK_PERI_CTRL_AUXSRC_BITS) >>
+                             CLOCKS_CLK_PERI_CTRL_AUXSRC_LSB) == CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS;
+    dvfs_transition_t t = {
+            .from_level = (uint)current_level,
+            .to_level = level,
+            .old_sys_hz = clock_get_hz(clk_sys),
+            .new_sys_hz = s->out_hz,
+            .old_peri_hz = clock_get_hz(clk_peri),
+            .new_peri_hz = peri_follows_sys ? s->out_hz : clock_get_hz(clk_peri),
+    };
+#if PICO_DVFS_ADJUST_PERIPHERALS
+    uint32_t uart_baud[NUM_UARTS];
+    uint32_t spi_baud[NUM_SPIS];
+#endif
+
+    notify(DVFS_PRE_CHANGE, &t);
+#if PICO_DVFS_ADJUST_PERIPHERALS
+    peripherals_pre_change(&t, uart_baud, spi_baud);
+#endif
+    uint64_t pre_us = time_us_64();
+
+    enum vreg_voltage voltage = levels[level].voltage;
+    bool raise = voltage > get_voltage();
+    if (raise) {
+        vreg_set_voltage(voltage);
+        busy_wait_us_32(PICO_DVFS_VREG_SETTLE_US);
+    }
+    uint64_t vreg_us = time_us_64();
+
+    uint32_t save = save_and_disable_interrupts();
+    switch_sys_clock(s, peri_follows_sys);
+    restore_interrupts(save);
+    uint64_t switch_us = time_us_64();
+
+    // lowering the voltage doesn't need to be waited for
+    if (!raise && voltage != get_voltage()) vreg_set_voltage(voltage);
+    current_level = (int)level;
+
+#if PICO_DVFS_ADJUST_PERIPHERALS
+    peripherals_post_change(&t, uart_baud, spi_baud);
+#endif
+    notify(DVFS_POST_CHANGE, &t);
+    uint64_t end_us = time_us_64();
+
+    save = spin_lock_blocking(lock);
+    stats.transitions++;
+    stats.last_us = (uint32_t)(end_us - start_us);
+    stats.max_us = MAX(stats.max_us, stats.last_us);
+    stats.total_us += stats.last_us;
+    stats.last_notify_us = (uint32_t)((pre_us - start_us) + (end_us - switch_us));
+    stats.last_vreg_us = (uint32_t)(vreg_us - pre_us);
+    stats.last_switch_us = (uint32_t)(switch_us - vreg_us);
+    spin_unlock(lock, save);
+}
+
+// Claim the right to make a transition, which fails if one is already in progress (on either core)
+static bool claim_transition(void) {
+    uint32_t save = spin_lock_blocking(lock);
+    bool claimed = !in_transition;
+    in_transition = true;
+    spin_unlock(lock, save);
+    return claimed;
+}
+
+static bool try_set_level(uint level) {
+    if (!claim_transition()) return false;
+    if ((int)level != current_level) transition(level);
+    in_transition = false;
+    return true;
+}
+
+void dvfs_set_level(uint level) {
+    invalid_params_if(DVFS, level >= level_count);
+    // a transition in progress can only be on the other core, or in the governor, which doesn't wait for this one
+    while (!try_set_level(level)) tight_loop_contents();
+}
+
+void dvfs_idle_begin(void) {
+    if (!lock) return;
+    idle_state_t *state = &idle_state[get_core_num()];
+    uint32_t save = spin_lock_blocking(lock);
+    state->idle_start_us = time_us_64();
+    state->reported = true;
+    spin_unlock(lock, save);
+}
+
+void dvfs_idle_end(void) {
+    if (!lock) return;
+    idle_state_t *state = &idle_state[get_core_num()];
+    uint32_t save = spin_lock_blocking(lock);
+    if (state->idle_start_us) {
+        state->idle_us += time_us_64() - state->idle_start_us;
+        state->idle_start_us = 0;
+    }
+    spin_unlock(lock, save);
+}
+
+// The idle time, as a percentage of the time since it was last called, of the core which was idle least, or -1 if
+// neither core has reported any idle time
+static int sample_busiest_idle_percent(void) {
+    uint32_t save = spin_lock_blocking(lock);
+    uint64_t now = time_us_64();
+    uint64_t elapsed = now - governor.last_us;
+    governor.last_us = now;
+    int percent = -1;
+    for (uint core = 0; core < NUM_CORES; core++) {
+        idle_state_t *state = &idle_state[core];
+        if (!state->reported) continue;
+        uint64_t idle = state->idle_us;
+        if (state->idle_start_us) {
+            idle += now - state->idle_start_us;
+            state->idle_start_us = now;
+        }
+        state->idle_us = 0;
+        int core_percent = elapsed ? (int)MIN(idle * 100 / elapsed, 100) : 100;
+        if (percent < 0 || core_percent < percent) percent = core_percent;
+    }
+    spin_unlock(lock, save);
+    return percent;
+}
+
+static bool governor_callback(__unused repeating_timer_t *rt) {
+    int idle = sample_busiest_idle_percent();
+    int level = current_level;
+    int top = (int)level_count - 1;
+    int next = level;
+    if (idle < 0) {
+        next = top;
+    } else if (level < 0) {
+        // not at any level yet; start in the middle
+        next = top / 2;
+    } else if (idle < governor.config.up_idle_percent) {
+        next = MIN(level + 1, top);
+    } else if (idle > governor.config.down_idle_percent) {
+        next = MAX(level - 1, 0);
+    }
+    // if a transition is already in progress, try again next time
+    if (next != level) try_set_level((uint)next);
+    return true;
+}
+
+dvfs_governor_config_t dvfs_governor_get_default_config(void) {
+    dvfs_governor_config_t config = {
+            .period_ms = 100,
+            .up_idle_percent = 20,
+            .down_idle_percent = 70,
+    };
+    return config;
+}
+
+bool dvfs_governor_start(const dvfs_governor_config_t *config) {
+    invalid_params_if(DVFS, !level_count);
+    dvfs_governor_stop();
+    governor.config = config ? *config : dvfs_governor_get_default_config();
+    invalid_params_if(DVFS, !governor.config.period_ms ||
+                            governor.config.up_idle_percent > governor.config.down_idle_percent);
+    (void)sample_busiest_idle_percent();
+    governor.running = add_repeating_timer_ms((int32_t)governor.config.period_ms, governor_callback, NULL,
+                                              &governor.timer);
+    return governor.running;
+}
+
+void dvfs_governor_stop(void) {
+    if (governor.running) {
+        cancel_repeating_timer(&governor.timer);
+        governor.running = false;
+    }
+}
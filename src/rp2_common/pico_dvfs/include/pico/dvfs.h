@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_DVFS_H
+#define _PICO_DVFS_H
+
+#include "pico.h"
+#include "pico/time.h"
+#include "hardware/vreg.h"
+
+/** \file pico/dvfs.h
+ *  \defgroup pico_dvfs pico_dvfs
+ * Dynamic voltage and frequency scaling: switching the system clock between performance levels
+ *
+ * Each performance level is a system clock frequency and a core voltage. \ref dvfs_set_level moves between them with
+ * the sequence the hardware needs:
+ * - registered notifiers are told the change is about to happen (see \ref dvfs_add_notifier)
+ * - when the voltage is going up, it is raised first, and given \ref PICO_DVFS_VREG_SETTLE_US to settle
+ * - \c clk_sys is switched to \c clk_ref while the system PLL is reprogrammed (only the post dividers are rewritten if
+ *   the VCO frequency is unchanged, which avoids waiting for the PLL to lock again), and then back to the PLL.
+ *   If \c clk_peri runs from \c clk_sys, it is reconfigured to follow it
+ * - when the voltage is going down, it is lowered last
+ * - enabled UARTs and SPIs have their baud rates set again for the new \c clk_peri, and enabled PWM slices have their
+ *   dividers scaled so they keep counting at the same rate (unless \ref PICO_DVFS_ADJUST_PERIPHERALS is 0)
+ * - the notifiers are told the change has happened
+ *
+ * The rates kept for the peripherals are those they were set to (the rate originally asked for may have been rounded
+ * differently); they are not compounded by repeated transitions. A PWM slice whose divider would go out of range is
+ * left as close as possible. The timer, and so alarm pools and everything in \c pico_time, counts a tick derived from
+ * \c clk_ref, which is not changed, so needs no adjustment.
+ *
+ * The governor (\ref dvfs_governor_start) picks a level automatically from how busy the cores are: work which waits
+ * for something should do so with \ref dvfs_sleep_until, or between \ref dvfs_idle_begin and \ref dvfs_idle_end,
+ * so the governor can see the idle time. When the busiest core is idle less than a threshold fraction of the time, the
+ * governor moves up a level, and when idle more than another threshold, it moves down one.
+ *
+ * \note Levels above 133 MHz overclock the RP2040, and need a raised core voltage.
+ * \note Transitions may be made from either core, but are not synchronized with the other core's use of the
+ * peripherals, which should be quiet at the time. Interrupts on the calling core are disabled while \c clk_sys is
+ * switched.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// PICO_CONFIG: PICO_DVFS_MAX_LEVELS, Maximum number of performance levels, type=int, default=8, min=1, max=32, group=pico_dvfs
+#ifndef PICO_DVFS_MAX_LEVELS
+#define PICO_DVFS_MAX_LEVELS 8
+#endif
+
+// PICO_CONFIG: PICO_DVFS_MAX_NOTIFIERS, Maximum number of functions notified of performance level transitions, type=int, default=8, min=1, group=pico_dvfs
+#ifndef PICO_DVFS_MAX_NOTIFIERS
+#define PICO_DVFS_MAX_NOTIFIERS 8
+#endif
+
+// PICO_CONFIG: PICO_DVFS_VREG_SETTLE_US, Time allowed for the core voltage to rise before the system clock is raised, type=int, default=1000, group=pico_dvfs
+#ifndef PICO_DVFS_VREG_SETTLE_US
+#define PICO_DVFS_VREG_SETTLE_US 1000
+#endif
+
+// PICO_CONFIG: PICO_DVFS_ADJUST_PERIPHERALS, Keep the baud rates of enabled UARTs and SPIs and the counting rate of enabled PWM slices across performance level transitions, type=bool, default=1, group=pico_dvfs
+#ifndef PICO_DVFS_ADJUST_PERIPHERALS
+#define PICO_DVFS_ADJUST_PERIPHERALS 1
+#endif
+
+// PICO_CONFIG: PARAM_ASSERTIONS_ENABLED_DVFS, Enable/disable assertions in the pico_dvfs module, type=bool, default=0, group=pico_dvfs
+#ifndef PARAM_ASSERTIONS_ENABLED_DVFS
+#define PARAM_ASSERTIONS_ENABLED_DVFS 0
+#endif
+
+/*! \brief A performance level
+ *  \ingroup pico_dvfs
+ */
+typedef struct dvfs_level {
+    uint32_t sys_khz;               ///< the system clock frequency; the closest the PLL can produce is used
+    enum vreg_voltage voltage;      ///< the core voltage
+} dvfs_level_t;
+
+/*! \brief Information about a performance level transition, passed to notifiers
+ *  \ingroup pico_dvfs
+ */
+typedef struct dvfs_transition {
+    uint from_level;        ///< the level being left, or -1u if there was none
+    uint to_level;          ///< the level being entered
+    uint32_t old_sys_hz;    ///< \c clk_sys before the transition
+    uint32_t new_sys_hz;    ///< \c clk_sys after the transition
+    uint32_t old_peri_hz;   ///< \c clk_peri before the transition
+    uint32_t new_peri_hz;   ///< \c clk_peri after the transition (which only changes if it runs from \c clk_sys)
+} dvfs_transition_t;
+
+/*! \brief Transition timings, from \ref dvfs_get_stats
+ *  \ingroup pico_dvfs
+ *
+ * All times are in microseconds.
+ */
+typedef struct dvfs_stats {
+    uint32_t transitions;       ///< number of transitions made
+    uint32_t last_us;           ///< duration of the last transition, from start to finish
+    uint32_t max_us;            ///< longest transition
+    uint64_t total_us;          ///< time spent in all transitions
+    uint32_t last_notify_us;    ///< time the last transition spent in notifiers and adjusting peripherals
+    uint32_t last_vreg_us;      ///< time the last transition spent waiting for the voltage to settle
+    uint32_t last_switch_us;    ///< time the last transition ran from \c clk_ref (reprogramming the PLL)
+} dvfs_stats_t;
+
+/*! \brief Which side of a transition a notifier is being called
+ *  \ingroup pico_dvfs
+ */
+enum dvfs_phase {
+    DVFS_PRE_CHANGE,    ///< the clocks are about to change; finish or pause anything timing dependent
+    DVFS_POST_CHANGE,   ///< the clocks have changed
+};
+
+/*! \brief A function notified of performance level transitions
+ *  \ingroup pico_dvfs
+ *
+ * Notifiers are called on the core making the transition, in the order they were added before the change and in the
+ * reverse order after it, and must not themselves change the level.
+ */
+typedef void (*dvfs_notifier_t)(enum dvfs_phase phase, const dvfs_transition_t *transition, void *user_data);
+
+/*! \brief Initialize the performance levels
+ *  \ingroup pico_dvfs
+ *
+ * The current level is taken to be the one whose frequency the system clock is running at, if any. If none matches,
+ * there is no current level until the first \ref dvfs_set_level.
+ *
+ * \param levels the levels, in increasing order of frequency, or NULL for the default levels: 48 MHz at 0.95 V,
+ * 125 MHz at 1.10 V, 200 MHz at 1.15 V and 250 MHz at 1.20 V
+ * \param count the number of levels, at most \ref PICO_DVFS_MAX_LEVELS
+ */
+void dvfs_init(const dvfs_level_t *levels, uint count);
+
+/*! \brief Get the number of performance levels
+ *  \ingroup pico_dvfs
+ */
+uint dvfs_get_level_count(void);
+
+/*! \brief Get a performance level
+ *  \ingroup pico_dvfs
+ *
+ * \param level the index of the level
+ * \return the level, with \c sys_khz the frequency asked for
+ */
+const dvfs_level_t *dvfs_get_level_info(uint level);
+
+/*! \brief Get the current performance level
+ *  \ingroup pico_dvfs
+ *
+ * \return the index of the current level, or -1 if the system clock was not set by \c pico_dvfs
+ */
+int dvfs_get_level(void);
+
+/*! \brief Change performance level
+ *  \ingroup pico_dvfs
+ *
+ * This does nothing if the level is already current. It must not be called from a notifier or an IRQ handler; if a
+ * transition is already in progress on the other core, this waits for it to finish first.
+ *
+ * \param level the index of the level
+ */
+void dvfs_set_level(uint level);
+
+/*! \brief Add a function to be notified of performance level transitions
+ *  \ingroup pico_dvfs
+ *
+ * \param notifier the function
+ * \param user_data passed to the function
+ * \return false if \ref PICO_DVFS_MAX_NOTIFIERS are already registered
+ */
+bool dvfs_add_notifier(dvfs_notifier_t notifier, void *user_data);
+
+/*! \brief Remove a function added with \ref dvfs_add_notifier
+ *  \ingroup pico_dvfs
+ *
+ * \param notifier the function
+ * \param user_data the user data it was added with
+ */
+void dvfs_remove_notifier(dvfs_notifier_t notifier, void *user_data);
+
+/*! \brief Get the transition timings
+ *  \ingroup pico_dvfs
+ *
+ * \param stats filled in with the timings
+ * \param reset whether to reset the counts and maxima afterwards
+ */
+void dvfs_get_stats(dvfs_stats_t *stats, bool reset);
+
+/*! \brief Configuration of the automatic governor
+ *  \ingroup pico_dvfs
+ */
+typedef struct dvfs_governor_config {
+    uint32_t period_ms;         ///< how often the governor looks at the idle time
+    uint8_t up_idle_percent;    ///< move up a level if the busiest core was idle less than this fraction of the time
+    uint8_t down_idle_percent;  ///< move down a level if the busiest core was idle more than this fraction of the time
+} dvfs_governor_config_t;
+
+/*! \brief Get the default governor configuration
+ *  \ingroup pico_dvfs
+ *
+ * This is a 100 ms period, moving up when idle less than 20% of the time, and down when idle more than 70%.
+ */
+dvfs_governor_config_t dvfs_governor_get_default_config(void);
+
+/*! \brief Start picking the performance level automatically
+ *  \ingroup pico_dvfs
+ *
+ * The governor runs from a repeating timer on the default alarm pool, so transitions it makes happen in that alarm
+ * pool's IRQ handler. Only cores which have used \ref dvfs_idle_begin (or \ref dvfs_sleep_until) count; if neither has,
+ * the governor moves to the highest level.
+ *
+ * \param config the configuration, or NULL for the default
+ * \return false if the timer could not be added
+ */
+bool dvfs_governor_start(const dvfs_governor_config_t *config);
+
+/*! \brief Stop picking the performance level automatically
+ *  \ingroup pico_dvfs
+ *
+ * The current level is kept.
+ */
+void dvfs_governor_stop(void);
+
+/*! \brief Mark the start of idle time on the calling core, for the governor
+ *  \ingroup pico_dvfs
+ */
+void dvfs_idle_begin(void);
+
+/*! \brief Mark the end of idle time on the calling core, for the governor
+ *  \ingroup pico_dvfs
+ */
+void dvfs_idle_end(void);
+
+/*! \brief Sleep until a given time, counting it as idle for the governor
+ *  \ingroup pico_dvfs
+ *
+ * \param t the time to wake up
+ */
+static inline void dvfs_sleep_until(absolute_time_t t) {
+    dvfs_idle_begin();
+    sleep_until(t);
+    dvfs_idle_end();
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
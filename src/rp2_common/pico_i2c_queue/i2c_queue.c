@@ -0,0 +1,361 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pico/i2c_queue.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/timer.h"
+
+// PICO_CONFIG: PICO_I2C_QUEUE_DMA_IRQ_INDEX, The DMA IRQ (0 for DMA_IRQ_0 or 1 for DMA_IRQ_1) used by pico_i2c_queue, type=int, default=0, min=0, max=1, group=pico_i2c_queue
+#ifndef PICO_I2C_QUEUE_DMA_IRQ_INDEX
+#define PICO_I2C_QUEUE_DMA_IRQ_INDEX 0
+#endif
+
+#define I2C_FIFO_DEPTH 16
+// the TX FIFO is topped up when it falls to this level, which leaves time to respond before it empties
+#define TX_REFILL_LEVEL 8
+// received data is read once this many bytes (or all those outstanding, if fewer) are in the RX FIFO
+#define RX_BATCH 8
+
+static i2c_queue_t *queues[NUM_I2CS];
+static uint dma_queue_count;
+
+static inline uint32_t command(const i2c_transaction_t *t, uint op, uint pos) {
+    const i2c_op_t *o = &t->ops[op];
+    bool last = op == t->op_count - 1u && pos == o->len - 1u;
+    return bool_to_bit(op && !pos) << I2C_IC_DATA_CMD_RESTART_LSB |
+           bool_to_bit(last) << I2C_IC_DATA_CMD_STOP_LSB |
+           (o->type == I2C_OP_READ ? I2C_IC_DATA_CMD_CMD_BITS : o->buf[pos]);
+}
+
+// read any received data, and issue as many commands as there is room for
+static void irq_mode_service(i2c_queue_t *q) {
+    i2c_hw_t *hw = i2c_get_hw(q->i2c);
+    const i2c_transaction_t *t = q->head;
+    for (uint n = hw->rxflr; n; n--) {
+        while (t->ops[q->rx_op].type != I2C_OP_READ) q->rx_op++;
+        t->ops[q->rx_op].buf[q->rx_pos] = (uint8_t)hw->data_cmd;
+        if (++q->rx_pos == t->ops[q->rx_op].len) {
+            q->rx_op++;
+            q->rx_pos = 0;
+        }
+        q->reads_outstanding--;
+    }
+    uint space = I2C_FIFO_DEPTH - hw->txflr;
+    bool rx_limited = false;
+    while (space && q->cmd_op < t->op_count) {
+        const i2c_op_t *o = &t->ops[q->cmd_op];
+        if (o->type == I2C_OP_READ) {
+            // don't ask for more data than the RX FIFO can hold
+            if (q->reads_outstanding == I2C_FIFO_DEPTH) {
+                rx_limited = true;
+                break;
+            }
+            q->reads_outstanding++;
+        }
+        hw->data_cmd = command(t, q->cmd_op, q->cmd_pos);
+        space--;
+        if (++q->cmd_pos == o->len) {
+            q->cmd_op++;
+            q->cmd_pos = 0;
+        }
+    }
+    uint32_t mask = I2C_IC_INTR_MASK_M_TX_ABRT_BITS | I2C_IC_INTR_MASK_M_STOP_DET_BITS;
+    // when waiting for the RX FIFO to drain, the TX FIFO refill interrupt would fire continuously
+    if (q->cmd_op < t->op_count && !rx_limited) mask |= I2C_IC_INTR_MASK_M_TX_EMPTY_BITS;
+    if (q->reads_outstanding) {
+        hw->rx_tl = MIN(q->reads_outstanding, RX_BATCH) - 1u;
+        mask |= I2C_IC_INTR_MASK_M_RX_FULL_BITS;
+    }
+    hw->intr_mask = mask;
+}
+
+// point the RX DMA channel at each read operation in turn, as it finishes the previous one
+static void dma_rx_advance(i2c_queue_t *q) {
+    const i2c_transaction_t *t = q->head;
+    while (q->rx_op < t->op_count) {
+        if (q->rx_armed) {
+            if (dma_channel_is_busy((uint)q->rx_channel)) return;
+            q->rx_armed = false;
+            q->rx_op++;
+        } else if (t->ops[q->rx_op].type == I2C_OP_READ) {
+            dma_channel_config c = dma_channel_get_default_config((uint)q->rx_channel);
+            channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+            channel_config_set_read_increment(&c, false);
+            channel_config_set_write_increment(&c, true);
+            channel_config_set_dreq(&c, i2c_get_dreq(q->i2c, false));
+            dma_channel_configure((uint)q->rx_channel, &c, t->ops[q->rx_op].buf, &i2c_get_hw(q->i2c)->data_cmd,
+                                  t->ops[q->rx_op].len, true);
+            q->rx_armed = true;
+        } else {
+            q->rx_op++;
+        }
+    }
+}
+
+static void start_transaction(i2c_queue_t *q) {
+    i2c_transaction_t *t = q->head;
+    i2c_hw_t *hw = i2c_get_hw(q->i2c);
+    hw->enable = 0;
+    hw->tar = t->addr;
+    hw->enable = 1;
+    hw->clr_intr;
+    q->cmd_op = q->rx_op = 0;
+    q->cmd_pos = q->rx_pos = 0;
+    q->reads_outstanding = 0;
+    q->aborted = false;
+    q->rx_armed = false;
+    t->abort_source = 0;
+    q->start_us = time_us_32();
+
+    uint count = 0;
+    for (uint op = 0; op < t->op_count; op++) count += t->ops[op].len;
+    q->using_dma = q->cmd_buffer && count <= q->cmd_buffer_len;
+    if (q->using_dma) {
+        uint n = 0;
+        for (uint op = 0; op < t->op_count; op++) {
+            for (uint pos = 0; pos < t->ops[op].len; pos++) q->cmd_buffer[n++] = (uint16_t)command(t, op, pos);
+        }
+        q->cmd_op = t->op_count;
+        hw->intr_mask = I2C_IC_INTR_MASK_M_TX_ABRT_BITS | I2C_IC_INTR_MASK_M_STOP_DET_BITS;
+        // the RX channel must be ready before the first read command is issued
+        dma_rx_advance(q);
+        dma_channel_config c = dma_channel_get_default_config((uint)q->tx_channel);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+        channel_config_set_read_increment(&c, true);
+        channel_config_set_write_increment(&c, false);
+        channel_config_set_dreq(&c, i2c_get_dreq(q->i2c, true));
+        dma_channel_configure((uint)q->tx_channel, &c, &hw->data_cmd, q->cmd_buffer, count, true);
+    } else {
+        irq_mode_service(q);
+    }
+}
+
+static void record_completion(i2c_queue_t *q, i2c_transaction_t *t) {
+    i2c_queue_stats_t *stats = &q->stats;
+    uint32_t us = time_us_32() - q->start_us;
+    stats->transactions++;
+    stats->bus_time_us += us;
+    if (q->using_dma) stats->dma_transactions++;
+    if (q->aborted) {
+        uint32_t source = t->abort_source;
+        t->result = PICO_ERROR_GENERIC;
+        stats->aborts++;
+        if (source & I2C_IC_TX_ABRT_SOURCE_ABRT_7B_ADDR_NOACK_BITS) stats->address_nacks++;
+        if (source & I2C_IC_TX_ABRT_SOURCE_ABRT_TXDATA_NOACK_BITS) stats->data_nacks++;
+        if (source & I2C_IC_TX_ABRT_SOURCE_ARB_LOST_BITS) stats->arbitration_lost++;
+        if (source & I2C_IC_TX_ABRT_SOURCE_ABRT_USER_ABRT_BITS) stats->user_aborts++;
+        return;
+    }
+    // start and stop, then for each operation a (repeated) start and address byte, and 9 bits per data byte
+    uint bits = 2;
+    uint written = 0, read = 0;
+    for (uint op = 0; op < t->op_count; op++) {
+        bits += 10 + 9u * t->ops[op].len;
+        if (t->ops[op].type == I2C_OP_READ) {
+            read += t->ops[op].len;
+        } else {
+            written += t->ops[op].len;
+        }
+    }
+    t->result = (int)(written + read);
+    stats->bytes_written += written;
+    stats->bytes_read += read;
+    uint32_t expected_us = (uint32_t)((bits * (uint64_t)q->bit_time_ns) / 1000);
+    if (us > expected_us) {
+        uint32_t stretch = us - expected_us;
+        stats->stretch_time_us += stretch;
+        if (stretch > stats->max_stretch_us) stats->max_stretch_us = stretch;
+    }
+}
+
+static void __not_in_flash_func(i2c_queue_irq_handler)(i2c_queue_t *q) {
+    i2c_hw_t *hw = i2c_get_hw(q->i2c);
+    uint32_t save = spin_lock_blocking(q->lock);
+    uint32_t status = hw->intr_stat;
+    i2c_transaction_t *t = q->head;
+    if (!t) {
+        hw->intr_mask = 0;
+        spin_unlock(q->lock, save);
+        return;
+    }
+    if (status & I2C_IC_INTR_STAT_R_TX_ABRT_BITS) {
+        if (q->using_dma) {
+            dma_channel_abort((uint)q->tx_channel);
+            dma_channel_abort((uint)q->rx_channel);
+        }
+        // the hardware flushes both FIFOs and sends a stop; reading the source clears it, as does clearing the abort
+        t->abort_source = hw->tx_abrt_source;
+        hw->clr_tx_abrt;
+        q->aborted = true;
+        hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS;
+    } else if (!q->aborted) {
+        if (!q->using_dma) irq_mode_service(q);
+    }
+    if (!(status & I2C_IC_INTR_STAT_R_STOP_DET_BITS)) {
+        spin_unlock(q->lock, save);
+        return;
+    }
+    hw->clr_stop_det;
+    if (!q->aborted) {
+        if (q->using_dma) {
+            // the last bytes received may still be on their way to memory
+            while (q->rx_op < t->op_count) dma_rx_advance(q);
+        } else {
+            irq_mode_service(q);
+        }
+    }
+    record_completion(q, t);
+    q->head = t->next;
+    if (q->head) {
+        start_transaction(q);
+    } else {
+        q->tail = NULL;
+        hw->intr_mask = 0;
+    }
+    // the callback may submit more transactions
+    spin_unlock(q->lock, save);
+    // the transaction is only done once its callback has returned, unless the callback submitted it again (which
+    // sets next); a self link marks it as completing meanwhile
+    t->next = t;
+    __compiler_memory_barrier();
+    if (t->callback) t->callback(t);
+    __compiler_memory_barrier();
+    if (t->next == t) {
+        t->next = NULL;
+        t->done = true;
+    }
+}
+
+static void __isr __not_in_flash_func(i2c0_queue_irq_handler)(void) {
+    i2c_queue_irq_handler(queues[0]);
+}
+
+static void __isr __not_in_flash_func(i2c1_queue_irq_handler)(void) {
+    i2c_queue_irq_handler(queues[1]);
+}
+
+static void __isr __not_in_flash_func(i2c_queue_dma_irq_handler)(void) {
+    for (uint i = 0; i < NUM_I2CS; i++) {
+        i2c_queue_t *q = queues[i];
+        if (!q || q->rx_channel < 0 ||
+            !dma_irqn_get_channel_status(PICO_I2C_QUEUE_DMA_IRQ_INDEX, (uint)q->rx_channel)) {
+            continue;
+        }
+        dma_irqn_acknowledge_channel(PICO_I2C_QUEUE_DMA_IRQ_INDEX, (uint)q->rx_channel);
+        uint32_t save = spin_lock_blocking(q->lock);
+        if (q->head && q->using_dma && !q->aborted) dma_rx_advance(q);
+        spin_unlock(q->lock, save);
+    }
+}
+
+void i2c_queue_init(i2c_queue_t *queue, i2c_inst_t *i2c) {
+    uint index = i2c_hw_index(i2c);
+    assert(!queues[index]);
+    i2c_hw_t *hw = i2c_get_hw(i2c);
+    queue->i2c = i2c;
+    queue->lock = spin_lock_instance(next_striped_spin_lock_num());
+    queue->head = queue->tail = NULL;
+    queue->tx_channel = queue->rx_channel = -1;
+    queue->cmd_buffer = NULL;
+    queue->cmd_buffer_len = 0;
+    // the hardware stretches the high period by the spike suppression length plus 7 cycles, and the low by 1
+    uint period = hw->fs_scl_hcnt + hw->fs_scl_lcnt + hw->fs_spklen + 8;
+    queue->bit_time_ns = (uint32_t)((period * 1000000000ull) / clock_get_hz(clk_sys));
+    queue->stats = (i2c_queue_stats_t) {0};
+
+    hw->enable = 0;
+    // hold the bus rather than lose data if the RX FIFO fills
+    hw_set_bits(&hw->con, I2C_IC_CON_RX_FIFO_FULL_HLD_CTRL_BITS);
+    hw->tx_tl = TX_REFILL_LEVEL;
+    hw->dma_tdlr = TX_REFILL_LEVEL;
+    hw->intr_mask = 0;
+    hw->enable = 1;
+
+    queues[index] = queue;
+    irq_set_exclusive_handler(I2C0_IRQ + index, index ? i2c1_queue_irq_handler : i2c0_queue_irq_handler);
+    irq_set_enabled(I2C0_IRQ + index, true);
+}
+
+void i2c_queue_deinit(i2c_queue_t *queue) {
+    assert(i2c_queue_is_idle(queue));
+    uint index = i2c_hw_index(queue->i2c);
+    i2c_hw_t *hw = i2c_get_hw(queue->i2c);
+    i2c_queue_set_dma_buffer(queue, NULL, 0);
+    irq_set_enabled(I2C0_IRQ + index, false);
+    irq_remove_handler(I2C0_IRQ + index, index ? i2c1_queue_irq_handler : i2c0_queue_irq_handler);
+    queues[index] = NULL;
+
+    // restore the settings the blocking functions expect
+    hw->enable = 0;
+    hw_clear_bits(&hw->con, I2C_IC_CON_RX_FIFO_FULL_HLD_CTRL_BITS);
+    hw->tx_tl = 0;
+    hw->rx_tl = 0;
+    hw->dma_tdlr = 0;
+    hw->intr_mask = 0;
+    hw->enable = 1;
+}
+
+void i2c_queue_set_dma_buffer(i2c_queue_t *queue, uint16_t *buffer, uint len) {
+    assert(i2c_queue_is_idle(queue));
+    invalid_params_if(I2C_QUEUE, buffer && !len);
+    if (buffer && queue->tx_channel < 0) {
+        queue->tx_channel = (int8_t)dma_claim_unused_channel(true);
+        queue->rx_channel = (int8_t)dma_claim_unused_channel(true);
+        dma_irqn_set_channel_enabled(PICO_I2C_QUEUE_DMA_IRQ_INDEX, (uint)queue->rx_channel, true);
+        if (!dma_queue_count++) {
+            irq_add_shared_handler(DMA_IRQ_0 + PICO_I2C_QUEUE_DMA_IRQ_INDEX, i2c_queue_dma_irq_handler,
+                                   PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+            irq_set_enabled(DMA_IRQ_0 + PICO_I2C_QUEUE_DMA_IRQ_INDEX, true);
+        }
+    } else if (!buffer && queue->tx_channel >= 0) {
+        dma_irqn_set_channel_enabled(PICO_I2C_QUEUE_DMA_IRQ_INDEX, (uint)queue->rx_channel, false);
+        if (!--dma_queue_count) {
+            irq_remove_handler(DMA_IRQ_0 + PICO_I2C_QUEUE_DMA_IRQ_INDEX, i2c_queue_dma_irq_handler);
+        }
+        dma_channel_unclaim((uint)queue->tx_channel);
+        dma_channel_unclaim((uint)queue->rx_channel);
+        queue->tx_channel = queue->rx_channel = -1;
+    }
+    queue->cmd_buffer = buffer;
+    queue->cmd_buffer_len = buffer ? len : 0;
+}
+
+void i2c_queue_submit(i2c_queue_t *queue, i2c_transaction_t *t) {
+    invalid_params_if(I2C_QUEUE, t->addr >= 0x80 || (t->addr & 0x78) == 0 || (t->addr & 0x78) == 0x78);
+    invalid_params_if(I2C_QUEUE, !t->op_count);
+    for (uint op = 0; op < t->op_count; op++) {
+        invalid_params_if(I2C_QUEUE, !t->ops[op].len);
+    }
+    t->next = NULL;
+    t->done = false;
+
+    uint32_t save = spin_lock_blocking(queue->lock);
+    if (queue->tail) {
+        queue->tail->next = t;
+        queue->tail = t;
+    } else {
+        queue->head = queue->tail = t;
+        start_transaction(queue);
+    }
+    spin_unlock(queue->lock, save);
+}
+
+void i2c_queue_abort(i2c_queue_t *queue) {
+    uint32_t save = spin_lock_blocking(queue->lock);
+    if (queue->head && !queue->aborted) {
+        hw_set_bits(&i2c_get_hw(queue->i2c)->enable, I2C_IC_ENABLE_ABORT_BITS);
+    }
+    spin_unlock(queue->lock, save);
+}
+
+void i2c_queue_get_stats(i2c_queue_t *queue, i2c_queue_stats_t *stats, bool reset) {
+    uint32_t save = spin_lock_blocking(queue->lock);
+    *stats = queue->stats;
+    if (reset) queue->stats = (i2c_queue_stats_t) {0};
+    spin_unlock(queue->lock, save);
+}
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_I2C_QUEUE_H
+#define _PICO_I2C_QUEUE_H
+
+#include "pico.h"
+#include "hardware/i2c.h"
+#include "hardware/sync.h"
+
+/** \file pico/i2c_queue.h
+ *  \defgroup pico_i2c_queue pico_i2c_queue
+ * Asynchronous interrupt and DMA driven I2C master with a transaction queue
+ *
+ * Each transaction is a list of operations (writes and reads) on one device, e.g. writing a register address
+ * followed by a read of N bytes. The operations are run back to back, with a repeated start before each operation
+ * after the first, and a stop at the end. Transactions, which may be for different devices, are queued per I2C
+ * instance and run one after another, so several drivers can share a bus without blocking each other.
+ *
+ * Transactions are run from the I2C IRQ handler, which keeps the TX FIFO topped up with commands and empties the
+ * RX FIFO, a FIFO's worth at a time. If a DMA command buffer is given (see \ref i2c_queue_set_dma_buffer), transactions
+ * which fit in it are instead run by DMA: the whole command stream is built in the buffer and written to the
+ * data_cmd register by one DMA channel, while received data is read into the read buffers by another, leaving the
+ * CPU to handle just the end of the transaction (and the start of each read operation after the first).
+ *
+ * Bus errors (transactions aborted by the hardware, e.g. because the device did not acknowledge) are counted by
+ * type, along with the time spent on the bus and an estimate of the time lost to clock stretching (see
+ * \ref i2c_queue_get_stats).
+ *
+ * The I2C instance must already have been initialized with i2c_init() and its pins set up, and must not be used by
+ * anything else (e.g. the blocking functions) while transactions are queued.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// PICO_CONFIG: PARAM_ASSERTIONS_ENABLED_I2C_QUEUE, Enable/disable assertions in the I2C queue module, type=bool, default=0, group=pico_i2c_queue
+#ifndef PARAM_ASSERTIONS_ENABLED_I2C_QUEUE
+#define PARAM_ASSERTIONS_ENABLED_I2C_QUEUE 0
+#endif
+
+/*! \brief I2C operation type
+ *  \ingroup pico_i2c_queue
+ */
+typedef enum {
+    I2C_OP_WRITE,
+    I2C_OP_READ,
+} i2c_op_type_t;
+
+/*! \brief One operation (write or read) of an I2C transaction
+ *  \ingroup pico_i2c_queue
+ */
+typedef struct {
+    uint8_t *buf;               ///< data to write (which is not modified) or buffer to read into
+    uint16_t len;               ///< number of bytes, which must not be 0
+    uint8_t type;               ///< an \ref i2c_op_type_t
+} i2c_op_t;
+
+/*! \brief Initializer for a write \ref i2c_op_t
+ *  \ingroup pico_i2c_queue
+ */
+#define I2C_OP_WRITE_BUF(data, length) { .buf = (uint8_t *)(data), .len = (length), .type = I2C_OP_WRITE }
+
+/*! \brief Initializer for a read \ref i2c_op_t
+ *  \ingroup pico_i2c_queue
+ */
+#define I2C_OP_READ_BUF(buffer, length) { .buf = (buffer), .len = (length), .type = I2C_OP_READ }
+
+typedef struct i2c_transaction i2c_transaction_t;
+
+/*! \brief Callback for completion of a transaction
+ *  \ingroup pico_i2c_queue
+ *
+ * This is called from the I2C IRQ handler, and may submit further transactions, including this one again (in which case it is
+ * not marked done). The transaction is only marked done once the callback has returned.
+ */
+typedef void (*i2c_transaction_callback_t)(i2c_transaction_t *transaction);
+
+/*! \brief An I2C transaction
+ *  \ingroup pico_i2c_queue
+ *
+ * e.g. to read 6 bytes starting at register 0x3b:
+ * \code
+ * static const uint8_t reg = 0x3b;
+ * static uint8_t data[6];
+ * static const i2c_op_t ops[] = { I2C_OP_WRITE_BUF(&reg, 1), I2C_OP_READ_BUF(data, 6) };
+ * static i2c_transaction_t t = { .addr = 0x68, .ops = ops, .op_count = 2, .callback = data_ready };
+ * \endcode
+ */
+struct i2c_transaction {
+    uint8_t addr;               ///< 7-bit address of the device
+    uint8_t op_count;           ///< number of operations
+    const i2c_op_t *ops;        ///< the operations
+    i2c_transaction_callback_t callback; ///< called on completion, or NULL
+    void *user_data;            ///< for the use of the caller
+    int result;                 ///< on completion, the number of bytes transferred, or PICO_ERROR_GENERIC if aborted
+    uint32_t abort_source;      ///< on completion, the IC_TX_ABRT_SOURCE register value if aborted, otherwise 0
+
+    // \cond internal
+    i2c_transaction_t *next;
+    volatile bool done;
+    // \endcond
+};
+
+/*! \brief I2C queue statistics
+ *  \ingroup pico_i2c_queue
+ */
+typedef struct {
+    uint32_t transactions;      ///< number of transactions completed (including those aborted)
+    uint32_t dma_transactions;  ///< number of those which were run by DMA
+    uint32_t bytes_written;     ///< number of bytes written by successful transactions
+    uint32_t bytes_read;        ///< number of bytes read by successful transactions
+    uint32_t aborts;            ///< number of transactions aborted
+    uint32_t address_nacks;     ///< aborts because the address was not acknowledged
+    uint32_t data_nacks;        ///< aborts because written data was not acknowledged
+    uint32_t arbitration_lost;  ///< aborts because another master won arbitration
+    uint32_t user_aborts;       ///< aborts requested by \ref i2c_queue_abort
+    uint64_t bus_time_us;       ///< total time from the start to the end of each transaction
+    /// total time by which successful transactions exceeded their expected duration at the configured baud rate; this
+    /// is mostly clock stretching by devices, but also includes any delay in servicing the FIFOs
+    uint64_t stretch_time_us;
+    uint32_t max_stretch_us;    ///< the most by which a single transaction exceeded its expected duration
+} i2c_queue_stats_t;
+
+/*! \brief An I2C transaction queue, for one I2C instance
+ *  \ingroup pico_i2c_queue
+ */
+typedef struct {
+    i2c_inst_t *i2c;
+    spin_lock_t *lock;
+    i2c_transaction_t *head;    // the transaction in progress
+    i2c_transaction_t *tail;
+    // progress of the transaction in progress
+    uint8_t cmd_op;             // operation of the next command to issue
+    uint8_t rx_op;              // operation of the next byte to receive
+    uint16_t cmd_pos;
+    uint16_t rx_pos;
+    uint16_t reads_outstanding; // read commands issued, whose data has not been received
+    bool aborted;
+    bool using_dma;
+    bool rx_armed;              // (DMA) the RX channel has been started for operation rx_op
+    uint32_t start_us;
+    // DMA
+    int8_t tx_channel;
+    int8_t rx_channel;
+    uint16_t *cmd_buffer;
+    uint cmd_buffer_len;
+    uint32_t bit_time_ns;       // SCL period at the configured baud rate
+    i2c_queue_stats_t stats;
+} i2c_queue_t;
+
+/*! \brief Initialize an I2C transaction queue
+ *  \ingroup pico_i2c_queue
+ *
+ * Only one queue may be used per I2C instance. If the baud rate of the I2C instance is changed, the queue should be
+ * deinitialized and initialized again (while idle) for the clock stretching estimate to remain accurate.
+ *
+ * \param queue the queue
+ * \param i2c the (initialized) I2C instance
+ */
+void i2c_queue_init(i2c_queue_t *queue, i2c_inst_t *i2c);
+
+/*! \brief Release the resources used by an idle I2C transaction queue
+ *  \ingroup pico_i2c_queue
+ *
+ * \param queue the queue
+ */
+void i2c_queue_deinit(i2c_queue_t *queue);
+
+/*! \brief Enable or disable running transactions by DMA
+ *  \ingroup pico_i2c_queue
+ *
+ * Two DMA channels are claimed when a buffer is first set, and released when it is cleared. Each command (byte to
+ * write or read) takes one entry in the buffer, and transactions with more commands than this are run from the IRQ
+ * handler instead. This must only be called while the queue is idle.
+ *
+ * \param queue the queue
+ * \param buffer the command buffer, which must remain valid while set, or NULL to disable DMA
+ * \param len the number of entries in the buffer
+ */
+void i2c_queue_set_dma_buffer(i2c_queue_t *queue, uint16_t *buffer, uint len);
+
+/*! \brief Add a transaction to the end of the queue, starting it if the queue is idle
+ *  \ingroup pico_i2c_queue
+ *
+ * \param queue the queue
+ * \param transaction the transaction, which (along with its operations and buffers) must remain valid and unmodified
+ *                    until it is done
+ */
+void i2c_queue_submit(i2c_queue_t *queue, i2c_transaction_t *transaction);
+
+/*! \brief Abort the transaction in progress
+ *  \ingroup pico_i2c_queue
+ *
+ * The hardware finishes the current byte and sends a stop, and the transaction then completes with an error, and a
+ * user abort in its abort_source. This can be used (e.g. from an alarm) to implement a timeout. Nothing happens if the
+ * queue is idle.
+ *
+ * \param queue the queue
+ */
+void i2c_queue_abort(i2c_queue_t *queue);
+
+/*! \brief Get the statistics of an I2C transaction queue
+ *  \ingroup pico_i2c_queue
+ *
+ * \param queue the queue
+ * \param stats filled in with the statistics
+ * \param reset if true the statistics are reset to zero
+ */
+void i2c_queue_get_stats(i2c_queue_t *queue, i2c_queue_stats_t *stats, bool reset);
+
+/*! \brief Check whether a transaction has completed
+ *  \ingroup pico_i2c_queue
+ *
+ * \param transaction the (submitted) transaction
+ * \return true if the transaction has completed (and its callback returned)
+ */
+static inline bool i2c_transaction_is_done(const i2c_transaction_t *transaction) {
+    return transaction->done;
+}
+
+/*! \brief Wait for a transaction to complete
+ *  \ingroup pico_i2c_queue
+ *
+ * \param transaction the (submitted) transaction
+ * \return the result of the transaction
+ */
+static inline int i2c_transaction_wait_blocking(const i2c_transaction_t *transaction) {
+    while (!transaction->done) tight_loop_contents();
+    // stop the compiler hoisting a non volatile buffer access above the completion
+    __compiler_memory_barrier();
+    return transaction->result;
+}
+
+/*! \brief Check whether an I2C transaction queue has finished all its transactions
+ *  \ingroup pico_i2c_queue
+ *
+ * \param queue the queue
+ * \return true if there are no transactions queued or in progress
+ */
+static inline bool i2c_queue_is_idle(const i2c_queue_t *queue) {
+    return !*(i2c_transaction_t *const volatile *)&queue->head;
+}
+
+/*! \brief Wait for an I2C transaction queue to finish all its transactions
+ *  \ingroup pico_i2c_queue
+ *
+ * \param queue the queue
+ */
+static inline void i2c_queue_wait_for_idle_blocking(const i2c_queue_t *queue) {
+    while (!i2c_queue_is_idle(queue)) tight_loop_contents();
+    __compiler_memory_barrier();
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pico/i2c_slave.h"
+#include "hardware/irq.h"
+
+#define I2C_FIFO_DEPTH 16
+// received data is read once this many bytes are in the RX FIFO (or at the end of the transfer)
+#define RX_BATCH 8
+// the TX FIFO is topped up when it falls to this level during a read
+#define TX_REFILL_LEVEL 8
+
+typedef struct {
+    const i2c_slave_handler_t *handler;
+    bool in_transfer;
+    bool is_read;
+    // write: the current receive buffer (NULL to discard)
+    uint8_t *rx_buf;
+    uint rx_len;
+    uint rx_pos;
+    // read: the current data, and the number of data and padding bytes put in the TX FIFO
+    const uint8_t *tx_buf;
+    uint tx_len;
+    uint tx_pos;
+    uint tx_padding;
+    uint tx_flushed;
+    uint count;                 // bytes received, or data bytes put in the TX FIFO
+} i2c_slave_state_t;
+
+static i2c_slave_state_t slaves[NUM_I2CS];
+static i2c_slave_handler_t regs_handlers[NUM_I2CS];
+
+static void finish_transfer(i2c_slave_state_t *s) {
+    uint count = s->count;
+    if (s->is_read) {
+        // discarded bytes are the last ones put in the FIFO, padding first
+        uint unsent = s->tx_flushed > s->tx_padding ? s->tx_flushed - s->tx_padding : 0;
+        count = unsent < count ? count - unsent : 0;
+    }
+    s->in_transfer = false;
+    s->handler->finish(s->handler->context, s->is_read, count);
+}
+
+static void start_transfer(i2c_slave_state_t *s, bool is_read) {
+    if (s->in_transfer) finish_transfer(s);
+    s->in_transfer = true;
+    s->is_read = is_read;
+    s->count = 0;
+    s->rx_buf = NULL;
+    s->rx_len = s->rx_pos = 0;
+    s->tx_buf = NULL;
+    s->tx_len = s->tx_pos = 0;
+    s->tx_padding = s->tx_flushed = 0;
+}
+
+// returns true if a new transfer was started
+static bool receive(i2c_slave_state_t *s, i2c_hw_t *hw) {
+    bool started = false;
+    for (uint n = hw->rxflr; n; n--) {
+        uint32_t value = hw->data_cmd;
+        if ((value & I2C_IC_DATA_CMD_FIRST_DATA_BYTE_BITS) || !s->in_transfer || s->is_read) {
+            start_transfer(s, false);
+            started = true;
+        }
+        if (s->rx_pos == s->rx_len) {
+            s->rx_pos = 0;
+            s->rx_buf = s->handler->rx_buffer(s->handler->context, s->count, &s->rx_len);
+            if (!s->rx_buf) s->rx_len = ~0u;
+            assert(s->rx_len);
+        }
+        if (s->rx_buf) s->rx_buf[s->rx_pos] = (uint8_t)value;
+        s->rx_pos++;
+        s->count++;
+    }
+    return started;
+}
+
+static void transmit(i2c_slave_state_t *s, i2c_hw_t *hw) {
+    for (uint n = I2C_FIFO_DEPTH - hw->txflr; n; n--) {
+        if (s->tx_pos == s->tx_len && !s->tx_padding) {
+            s->tx_pos = 0;
+            s->tx_buf = s->handler->tx_data(s->handler->context, s->count, &s->tx_len);
+            assert(!s->tx_buf || s->tx_len);
+        }
+        if (s->tx_buf && s->tx_pos < s->tx_len) {
+            hw->data_cmd = s->tx_buf[s->tx_pos++];
+            s->count++;
+        } else {
+            // the master has read everything the application has; padding continues to the end of the transfer
+            hw->data_cmd = PICO_I2C_SLAVE_TX_PAD_BYTE;
+            s->tx_padding++;
+        }
+    }
+}
+
+static void __not_in_flash_func(i2c_slave_irq_handler)(i2c_inst_t *i2c, i2c_slave_state_t *s) {
+    i2c_hw_t *hw = i2c_get_hw(i2c);
+    uint32_t status = hw->intr_stat;
+    if (status & I2C_IC_INTR_STAT_R_TX_ABRT_BITS) {
+        // at the end of a read, bytes left in the TX FIFO are flushed; reading the source clears it
+        uint32_t source = hw->tx_abrt_source;
+        hw->clr_tx_abrt;
+        s->tx_flushed += source >> I2C_IC_TX_ABRT_SOURCE_TX_FLUSH_CNT_LSB;
+    }
+    bool end = status & (I2C_IC_INTR_STAT_R_STOP_DET_BITS | I2C_IC_INTR_STAT_R_RESTART_DET_BITS);
+    if (end) {
+        hw->clr_stop_det;
+        hw->clr_restart_det;
+        // a read can only be ended by a stop or restart, and any data received belongs to a later transfer
+        if (s->in_transfer && s->is_read) {
+            finish_transfer(s);
+            end = false;
+        }
+    }
+    bool started = receive(s, hw);
+    if (end && s->in_transfer) {
+        // if a new write was started above, and is still going, the stop or restart was for the previous transfer,
+        // which has already been finished
+        if (!started || !(hw->status & I2C_IC_STATUS_SLV_ACTIVITY_BITS)) finish_transfer(s);
+    }
+    if (status & I2C_IC_INTR_STAT_R_RD_REQ_BITS) {
+        hw->clr_rd_req;
+        if (!s->in_transfer || !s->is_read) start_transfer(s, true);
+        transmit(s, hw);
+    } else if ((status & I2C_IC_INTR_STAT_R_TX_EMPTY_BITS) && s->in_transfer && s->is_read && !s->tx_flushed) {
+        transmit(s, hw);
+    }
+    // top up the TX FIFO before it empties, only while the master is reading
+    if (s->in_transfer && s->is_read && !s->tx_flushed) {
+        hw_set_bits(&hw->intr_mask, I2C_IC_INTR_MASK_M_TX_EMPTY_BITS);
+    } else {
+        hw_clear_bits(&hw->intr_mask, I2C_IC_INTR_MASK_M_TX_EMPTY_BITS);
+    }
+}
+
+static void __isr __not_in_flash_func(i2c0_slave_irq_handler)(void) {
+    i2c_slave_irq_handler(i2c0, &slaves[0]);
+}
+
+static void __isr __not_in_flash_func(i2c1_slave_irq_handler)(void) {
+    i2c_slave_irq_handler(i2c1, &slaves[1]);
+}
+
+void i2c_slave_init(i2c_inst_t *i2c, uint8_t address, const i2c_slave_handler_t *handler) {
+    uint index = i2c_hw_index(i2c);
+    i2c_slave_state_t *s = &slaves[index];
+    assert(!s->handler);
+    s->handler = handler;
+    s->in_transfer = false;
+
+    i2c_set_slave_mode(i2c, true, address);
+    i2c_hw_t *hw = i2c_get_hw(i2c);
+    hw->enable = 0;
+    // only report stops ending transfers to this slave
+    hw_set_bits(&hw->con, I2C_IC_CON_STOP_DET_IFADDRESSED_BITS);
+    hw->rx_tl = RX_BATCH - 1;
+    hw->tx_tl = TX_REFILL_LEVEL;
+    hw->intr_mask = I2C_IC_INTR_MASK_M_RX_FULL_BITS | I2C_IC_INTR_MASK_M_RD_REQ_BITS |
+                    I2C_IC_INTR_MASK_M_TX_ABRT_BITS | I2C_IC_INTR_MASK_M_STOP_DET_BITS |
+                    I2C_IC_INTR_MASK_M_RESTART_DET_BITS;
+    hw->enable = 1;
+
+    irq_set_exclusive_handler(I2C0_IRQ + index, index ? i2c1_slave_irq_handler : i2c0_slave_irq_handler);
+    irq_set_enabled(I2C0_IRQ + index, true);
+}
+
+void i2c_slave_deinit(i2c_inst_t *i2c) {
+    uint index = i2c_hw_index(i2c);
+    i2c_slave_state_t *s = &slaves[index];
+    assert(s->handler);
+    irq_set_enabled(I2C0_IRQ + index, false);
+    irq_remove_handler(I2C0_IRQ + index, index ? i2c1_slave_irq_handler : i2c0_slave_irq_handler);
+    s->handler = NULL;
+
+    // back to master mode, as set up by i2c_init
+    i2c_hw_t *hw = i2c_get_hw(i2c);
+    hw->enable = 0;
+    hw_write_masked(&hw->con, I2C_IC_CON_MASTER_MODE_BITS | I2C_IC_CON_IC_SLAVE_DISABLE_BITS,
+                    I2C_IC_CON_MASTER_MODE_BITS | I2C_IC_CON_IC_SLAVE_DISABLE_BITS |
+                    I2C_IC_CON_RX_FIFO_FULL_HLD_CTRL_BITS | I2C_IC_CON_STOP_DET_IFADDRESSED_BITS);
+    hw->rx_tl = 0;
+    hw->tx_tl = 0;
+    hw->intr_mask = 0;
+    hw->enable = 1;
+}
+
+// register file
+
+// the register reached by moving count registers on from addr, within addr's block
+static uint regs_advance(const i2c_slave_regs_t *regs, uint addr, uint count) {
+    uint block = regs->increment_block ? regs->increment_block : regs->size;
+    uint base = addr - addr % block;
+    return base + (addr - base + count) % block;
+}
+
+// the number of registers from addr to the end of its block
+static uint regs_contiguous(const i2c_slave_regs_t *regs, uint addr) {
+    uint block = regs->increment_block ? regs->increment_block : regs->size;
+    return block - addr % block;
+}
+
+static uint regs_received_addr(const i2c_slave_regs_t *regs) {
+    uint addr = regs->addr_buf[0];
+    if (regs->addr_bytes == 2) addr = addr << 8 | regs->addr_buf[1];
+    return addr % regs->size;
+}
+
+static uint8_t *regs_rx_buffer(void *context, uint offset, uint *len) {
+    i2c_slave_regs_t *regs = (i2c_slave_regs_t *)context;
+    if (offset < regs->addr_bytes) {
+        *len = regs->addr_bytes - offset;
+        return regs->addr_buf + offset;
+    }
+    uint addr = regs_advance(regs, regs_received_addr(regs), offset - regs->addr_bytes);
+    *len = regs_contiguous(regs, addr);
+    return regs->mem + addr;
+}
+
+static const uint8_t *regs_tx_data(void *context, uint offset, uint *len) {
+    i2c_slave_regs_t *regs = (i2c_slave_regs_t *)context;
+    uint addr = regs_advance(regs, regs->addr, offset);
+    *len = regs_contiguous(regs, addr);
+    return regs->mem + addr;
+}
+
+static void regs_finish(void *context, bool is_read, uint count) {
+    i2c_slave_regs_t *regs = (i2c_slave_regs_t *)context;
+    if (is_read) {
+        regs->addr = (uint16_t)regs_advance(regs, regs->addr, count);
+    } else if (count >= regs->addr_bytes) {
+        // a write of just the address sets it for a following read
+        uint first = regs_received_addr(regs);
+        count -= regs->addr_bytes;
+        regs->addr = (uint16_t)regs_advance(regs, first, count);
+        if (count && regs->written) regs->written(regs, first, count);
+    }
+}
+
+void i2c_slave_regs_init(i2c_inst_t *i2c, uint8_t address, i2c_slave_regs_t *regs) {
+    invalid_params_if(I2C_SLAVE, !regs->size);
+    invalid_params_if(I2C_SLAVE, regs->addr_bytes != 1 && regs->addr_bytes != 2);
+    invalid_params_if(I2C_SLAVE, regs->increment_block && regs->size % regs->increment_block);
+    regs->addr = 0;
+    i2c_slave_handler_t *handler = &regs_handlers[i2c_hw_index(i2c)];
+    handler->rx_buffer = regs_rx_buffer;
+    handler->tx_data = regs_tx_data;
+    handler->finish = regs_finish;
+    handler->context = regs;
+    i2c_slave_init(i2c, address, handler);
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_I2C_SLAVE_H
+#define _PICO_I2C_SLAVE_H
+
+#include "pico.h"
+#include "hardware/i2c.h"
+
+/** \file pico/i2c_slave.h
+ *  \defgroup pico_i2c_slave pico_i2c_slave
+ * Interrupt driven I2C slave, with zero copy streaming and a register file
+ *
+ * The I2C IRQ handler follows each transfer addressed to the slave, and moves data directly between the FIFOs and
+ * buffers supplied by the application:
+ * - when the master writes, received bytes are stored into buffers returned by the \ref i2c_slave_handler_t
+ *   rx_buffer callback, a FIFO's worth at a time
+ * - when the master reads, the TX FIFO is filled from data returned by the tx_data callback, so the master is not
+ *   held waiting for each byte. Bytes which end up not being read (because the master stops reading first) are
+ *   discarded by the hardware, and are not counted as sent.
+ * - at the end of the transfer (a stop or repeated start) the finish callback is called with the number of bytes
+ *   actually transferred
+ *
+ * The slave holds the clock low (rather than losing data) when the RX FIFO is full or the TX FIFO is empty, so a
+ * slow response delays the master rather than corrupting the transfer; at 1 MHz (Fast-mode Plus) the FIFOs give around
+ * 70us to respond before the master is held.
+ *
+ * \ref i2c_slave_regs_init provides a typical register file device on top of this: the first byte (or two) written in
+ * each transfer sets the register address, after which data written is stored at, and data read is taken from,
+ * consecutive registers.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// PICO_CONFIG: PARAM_ASSERTIONS_ENABLED_I2C_SLAVE, Enable/disable assertions in the I2C slave module, type=bool, default=0, group=pico_i2c_slave
+#ifndef PARAM_ASSERTIONS_ENABLED_I2C_SLAVE
+#define PARAM_ASSERTIONS_ENABLED_I2C_SLAVE 0
+#endif
+
+// PICO_CONFIG: PICO_I2C_SLAVE_TX_PAD_BYTE, The byte sent when the master reads more data than the application provides, type=int, default=0xff, group=pico_i2c_slave
+#ifndef PICO_I2C_SLAVE_TX_PAD_BYTE
+#define PICO_I2C_SLAVE_TX_PAD_BYTE 0xff
+#endif
+
+/*! \brief Callbacks for an I2C slave, which are all called from the I2C IRQ handler
+ *  \ingroup pico_i2c_slave
+ */
+typedef struct {
+    /*! \brief Get a buffer for data written by the master
+     *
+     * \param context the handler's context
+     * \param offset the number of bytes of the transfer received so far
+     * \param len filled in with the size of the buffer, which must be at least 1 unless NULL is returned
+     * \return the buffer, or NULL to discard the data
+     */
+    uint8_t *(*rx_buffer)(void *context, uint offset, uint *len);
+
+    /*! \brief Get data to be read by the master
+     *
+     * The data must remain valid and unmodified until the end of the transfer.
+     *
+     * \param context the handler's context
+     * \param offset the number of bytes of the transfer provided so far (which may be more than the master has read)
+     * \param len filled in with the number of bytes of data, which must be at least 1 unless NULL is returned
+     * \return the data, or NULL to pad the rest of the transfer with \ref PICO_I2C_SLAVE_TX_PAD_BYTE
+     */
+    const uint8_t *(*tx_data)(void *context, uint offset, uint *len);
+
+    /*! \brief Called at the end of each transfer
+     *
+     * \param context the handler's context
+     * \param is_read true if the master was reading
+     * \param count the number of bytes received, or the number of bytes of data (not padding) sent
+     */
+    void (*finish)(void *context, bool is_read, uint count);
+
+    void *context;              ///< passed to the callbacks
+} i2c_slave_handler_t;
+
+/*! \brief Register file for an I2C slave
+ *  \ingroup pico_i2c_slave
+ */
+typedef struct i2c_slave_regs i2c_slave_regs_t;
+
+struct i2c_slave_regs {
+    uint8_t *mem;               ///< the registers
+    uint16_t size;              ///< number of registers; register addresses from the master are taken modulo this
+    /// the address auto-increments within aligned blocks of this many registers, wrapping to the start of the block;
+    /// 0 to increment through (and wrap at the end of) the whole register file, or 1 for no auto-increment. The size
+    /// must be a multiple of this.
+    uint16_t increment_block;
+    uint8_t addr_bytes;         ///< number of bytes (1 or 2, most significant first) of register address
+    /// called (from the IRQ handler) after the master writes count (non zero) registers, from register first; the
+    /// registers written may wrap around within their block
+    void (*written)(i2c_slave_regs_t *regs, uint first, uint count);
+    void *user_data;            ///< for the use of the caller
+
+    // \cond internal
+    uint16_t addr;
+    uint8_t addr_buf[2];
+    // \endcond
+};
+
+/*! \brief Configure an I2C instance as a slave, handling transfers with the given callbacks
+ *  \ingroup pico_i2c_slave
+ *
+ * The I2C instance must have been initialized with i2c_init() and its pins set up.
+ *
+ * \param i2c the I2C instance
+ * \param address the 7-bit slave address
+ * \param handler the callbacks, which must remain valid until \ref i2c_slave_deinit
+ */
+void i2c_slave_init(i2c_inst_t *i2c, uint8_t address, const i2c_slave_handler_t *handler);
+
+/*! \brief Configure an I2C instance as a slave serving a register file
+ *  \ingroup pico_i2c_slave
+ *
+ * The registers may be accessed by the application at any time, but a multi-byte value being read or written by the
+ * master at the same time may be seen half updated.
+ *
+ * \param i2c the I2C instance
+ * \param address the 7-bit slave address
+ * \param regs the register file, which must remain valid until \ref i2c_slave_deinit
+ */
+void i2c_slave_regs_init(i2c_inst_t *i2c, uint8_t address, i2c_slave_regs_t *regs);
+
+/*! \brief Stop acting as a slave, and return the I2C instance to master mode
+ *  \ingroup pico_i2c_slave
+ *
+ * \param i2c the I2C instance
+ */
+void i2c_slave_deinit(i2c_inst_t *i2c);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
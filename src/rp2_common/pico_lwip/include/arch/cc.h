@@ -73,7 +73,7 @@ typedef int sys_prot_t;
 
 unsigned int pico_lwip_rand(void);
 #ifndef LWIP_RAND
-// Use ROSC based random number generation, more for the fact that rand() may not be seeded, than anything else
+// Use pico_rand (seeded from the ROSC), more for the fact that rand() may not be seeded, than anything else
 #define LWIP_RAND pico_lwip_rand
 #endif
 #endif /* __CC_H__ */
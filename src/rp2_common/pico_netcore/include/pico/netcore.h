@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_NETCORE_H
+#define _PICO_NETCORE_H
+
+#include "pico.h"
+#include "pico/time.h"
+#include "lwip/pbuf.h"
+#include "lwip/ip4_addr.h"
+
+/** \file pico/netcore.h
+ *  \defgroup pico_netcore pico_netcore
+ * Run the wireless driver and lwIP on core 1, with the application on core 0 using them through mailboxes
+ *
+ * With \c pico_cyw43_arch_lwip_threadsafe_background, the CYW43 driver and lwIP run in a low priority IRQ on the core
+ * which initialized them, so the application on that core is interrupted for every packet. \c pico_netcore instead
+ * launches core 1 to run them (still with \c pico_cyw43_arch_lwip_threadsafe_background, initialized on core 1), and
+ * gives the application on core 0 a small socket-like API for UDP and TCP over IPv4, so packet processing never
+ * interrupts core 0.
+ *
+ * The two cores communicate through a pair of lock-free single producer, single consumer rings of messages in shared
+ * memory: requests from core 0 to core 1, and events (results, received data, completed sends and so on) from core 1
+ * to core 0. Each core rings the other's doorbell, by pushing a word into the inter-core (SIO) FIFO, when it adds a
+ * message to an empty ring; so \c pico_netcore owns the FIFOs in both directions, and \c pico_multicore FIFO
+ * functions (including \ref multicore_lockout_victim_init) must not be used alongside it.
+ *
+ * Data moves between the cores without copying:
+ * - received data is handed to the application as the lwIP pbuf chain it arrived in. The application may read the
+ *   chain (but must not modify or free it with lwIP functions), and hands it back with \ref netcore_release when it
+ *   has finished with it, at which point core 1 frees it and, for TCP, opens the receive window again.
+ * - data to send is referenced in place (by a \c PBUF_REF pbuf for UDP, or by \c tcp_write without copying for TCP),
+ *   so it must remain valid, and unmodified, until the send has completed; see \ref netcore_send and
+ *   \ref netcore_wait_sent.
+ *
+ * Core 1 never waits for core 0: if the event ring is full, or the application already holds
+ * \ref PICO_NETCORE_RX_QUEUE received packets for a socket, TCP data is left with lwIP (so the receive window closes
+ * until the application catches up), UDP datagrams are dropped, and incoming TCP connections are reset. Events are
+ * only processed on core 0 when a \c pico_netcore function is called (see \ref netcore_poll), so the application
+ * should call one regularly.
+ *
+ * The functions must all be called from core 0, and not from IRQ handlers. Only one request which needs an answer
+ * from core 1 is in flight at once, and \ref netcore_wifi_connect in particular holds up all the other requests until
+ * it completes (though data keeps flowing in the meantime).
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// PICO_CONFIG: PARAM_ASSERTIONS_ENABLED_NETCORE, Enable/disable assertions in the pico_netcore module, type=bool, default=0, group=pico_netcore
+#ifndef PARAM_ASSERTIONS_ENABLED_NETCORE
+#define PARAM_ASSERTIONS_ENABLED_NETCORE 0
+#endif
+
+// PICO_CONFIG: PICO_NETCORE_MAX_SOCKETS, Maximum number of pico_netcore sockets open at once (including listening ones), type=int, default=8, min=1, max=64, group=pico_netcore
+#ifndef PICO_NETCORE_MAX_SOCKETS
+#define PICO_NETCORE_MAX_SOCKETS 8
+#endif
+
+// PICO_CONFIG: PICO_NETCORE_RING_SIZE, Number of messages in each of the pico_netcore request and event rings, type=int, default=32, min=4, group=pico_netcore
+#ifndef PICO_NETCORE_RING_SIZE
+#define PICO_NETCORE_RING_SIZE 32
+#endif
+
+// PICO_CONFIG: PICO_NETCORE_RX_QUEUE, Number of received packets (or connections, for a listening socket) which may be handed to core 0 for each pico_netcore socket and not yet released, type=int, default=8, min=1, max=255, group=pico_netcore
+#ifndef PICO_NETCORE_RX_QUEUE
+#define PICO_NETCORE_RX_QUEUE 8
+#endif
+
+// PICO_CONFIG: PICO_NETCORE_TX_QUEUE, Number of sends which may be outstanding on each pico_netcore socket, type=int, default=8, min=1, max=255, group=pico_netcore
+#ifndef PICO_NETCORE_TX_QUEUE
+#define PICO_NETCORE_TX_QUEUE 8
+#endif
+
+// PICO_CONFIG: PICO_NETCORE_CORE1_STACK_SIZE, Stack size for core 1 (which also runs the wireless driver and lwIP in IRQs) when running pico_netcore, type=int, default=0x1000, min=0x800, group=pico_netcore
+#ifndef PICO_NETCORE_CORE1_STACK_SIZE
+#define PICO_NETCORE_CORE1_STACK_SIZE 0x1000
+#endif
+
+/*! \brief Start core 1, and initialize the wireless driver and lwIP on it
+ *  \ingroup pico_netcore
+ *
+ * Core 1 must not already be running.
+ *
+ * \param country the country code (see \ref CYW43_COUNTRY_) for the wireless driver
+ * \return 0 on success, or a PICO_ERROR_ code
+ */
+int netcore_init(uint32_t country);
+
+/*! \brief Connect to a wireless network in station mode
+ *  \ingroup pico_netcore
+ *
+ * This blocks until the connection is made (and an address obtained) or fails.
+ *
+ * \param ssid the network name
+ * \param pw the password, or NULL for an open network
+ * \param auth the authorization type (see \c CYW43_AUTH_)
+ * \param timeout_ms how long to wait
+ * \return 0 on success, or a PICO_ERROR_ code
+ */
+int netcore_wifi_connect(const char *ssid, const char *pw, uint32_t auth, uint32_t timeout_ms);
+
+/*! \brief Get the IPv4 address of the wireless interface
+ *  \ingroup pico_netcore
+ *
+ * \return the address, which is zero until connected
+ */
+ip4_addr_t netcore_get_ip4_addr(void);
+
+/*! \brief Open a UDP socket
+ *  \ingroup pico_netcore
+ *
+ * \param port the local port to bind to, or 0 for any
+ * \return the socket handle (which is positive), or a PICO_ERROR_ code
+ */
+int netcore_udp_open(uint16_t port);
+
+/*! \brief Open a TCP connection
+ *  \ingroup pico_netcore
+ *
+ * This blocks until the connection is made or fails.
+ *
+ * \param addr the remote address
+ * \param port the remote port
+ * \return the socket handle (which is positive), or a PICO_ERROR_ code
+ */
+int netcore_tcp_connect(const ip4_addr_t *addr, uint16_t port);
+
+/*! \brief Listen for TCP connections
+ *  \ingroup pico_netcore
+ *
+ * \param port the local port to listen on
+ * \return the socket handle (which is positive), for use with \ref netcore_accept, or a PICO_ERROR_ code
+ */
+int netcore_tcp_listen(uint16_t port);
+
+/*! \brief Accept a TCP connection
+ *  \ingroup pico_netcore
+ *
+ * \param listener the listening socket
+ * \param until when to give up waiting for a connection; use \ref nil_time to not wait
+ * \return the socket handle of the new connection, PICO_ERROR_TIMEOUT if there was none, or another PICO_ERROR_
+ * code
+ */
+int netcore_accept(int listener, absolute_time_t until);
+
+/*! \brief Send data on a socket, without copying it
+ *  \ingroup pico_netcore
+ *
+ * The data is sent from where it is; it must remain valid and unmodified until the send is complete, which may be
+ * checked with \ref netcore_wait_sent. For a TCP socket a send is complete when all the data has been acknowledged
+ * by the other end (or the connection has failed). If \ref PICO_NETCORE_TX_QUEUE sends are already outstanding on
+ * the socket, this first waits for the oldest to complete.
+ *
+ * \param handle the socket, which must be a connected TCP socket (or a UDP socket, after \ref netcore_udp_connect)
+ * \param data the data
+ * \param len the length of the data, which must not be zero (and at most 65535 bytes for UDP)
+ * \return 0 if the send was started, or a PICO_ERROR_ code
+ */
+int netcore_send(int handle, const void *data, size_t len);
+
+/*! \brief Send a UDP datagram to a given address, without copying it
+ *  \ingroup pico_netcore
+ *
+ * As \ref netcore_send
+ *
+ * \param handle the UDP socket
+ * \param data the data
+ * \param len the length of the data, at most 65535 bytes
+ * \param addr the destination address
+ * \param port the destination port
+ * \return 0 if the send was started, or a PICO_ERROR_ code
+ */
+int netcore_sendto(int handle, const void *data, size_t len, const ip4_addr_t *addr, uint16_t port);
+
+/*! \brief Set the default destination of a UDP socket
+ *  \ingroup pico_netcore
+ *
+ * \param handle the UDP socket
+ * \param addr the destination address
+ * \param port the destination port
+ * \return 0 on success, or a PICO_ERROR_ code
+ */
+int netcore_udp_connect(int handle, const ip4_addr_t *addr, uint16_t port);
+
+/*! \brief Wait for all the sends on a socket to complete
+ *  \ingroup pico_netcore
+ *
+ * \param handle the socket
+ * \param until when to give up waiting; use \ref nil_time to just check
+ * \return true if there are no sends outstanding
+ */
+bool netcore_wait_sent(int handle, absolute_time_t until);
+
+/*! \brief Receive data from a socket, without copying it
+ *  \ingroup pico_netcore
+ *
+ * The data is returned as the pbuf chain it was received in, which now belongs to the caller until it is handed back
+ * with \ref netcore_release. For a TCP socket, a packet may hold any part of the stream.
+ *
+ * \param handle the socket
+ * \param until when to give up waiting for data; use \ref nil_time to not wait
+ * \param addr if not NULL, filled in with the address the data came from
+ * \param port if not NULL, filled in with the port the data came from
+ * \return the data, or NULL if there was none by \p until (see \ref netcore_get_error for whether there will be)
+ */
+struct pbuf *netcore_recv(int handle, absolute_time_t until, ip4_addr_t *addr, uint16_t *port);
+
+/*! \brief Hand back received data
+ *  \ingroup pico_netcore
+ *
+ * \param handle the socket the data was received from
+ * \param p the data returned by \ref netcore_recv
+ */
+void netcore_release(int handle, struct pbuf *p);
+
+/*! \brief Get the state of a socket
+ *  \ingroup pico_netcore
+ *
+ * \param handle the socket
+ * \return 0 if the socket is open, PICO_ERROR_NO_DATA if the other end has closed a TCP connection (and all the
+ * data has been received), or another PICO_ERROR_ code if the connection has failed
+ */
+int netcore_get_error(int handle);
+
+/*! \brief Close a socket
+ *  \ingroup pico_netcore
+ *
+ * This first waits for any outstanding sends to complete. Any received data not yet returned by
+ * \ref netcore_recv is discarded.
+ *
+ * \param handle the socket
+ */
+void netcore_close(int handle);
+
+/*! \brief Process the events from core 1 received so far
+ *  \ingroup pico_netcore
+ *
+ * All the other functions do this too, so this need only be called when none of them have been for a while.
+ */
+void netcore_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,885 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include "pico/netcore.h"
+#include "pico/multicore.h"
+#include "pico/cyw43_arch.h"
+#include "hardware/sync.h"
+
+#include "lwip/netif.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+
+#if !PICO_CYW43_ARCH_THREADSAFE_BACKGROUND || !CYW43_LWIP
+#error pico_netcore requires pico_cyw43_arch_lwip_threadsafe_background
+#endif
+
+static_assert(PICO_NETCORE_MAX_SOCKETS <= 64, "");
+static_assert(PICO_NETCORE_RX_QUEUE <= 255 && PICO_NETCORE_TX_QUEUE <= 255, "");
+static_assert(PICO_NETCORE_RING_SIZE >= 4, "");
+
+// A handle is the socket's slot plus a generation number, so that a handle used after its socket has been closed (and
+// the slot reused) is recognized as stale
+#define HANDLE_SLOT(h) ((uint)(h) & 0xffu)
+#define HANDLE_GEN(h) ((uint)(h) >> 8)
+#define MAKE_HANDLE(slot, gen) ((int)((gen) << 8 | (slot)))
+
+enum {
+    // requests from core 0 to core 1
+    REQ_WIFI_CONNECT,   // ptr = wifi_connect_args_t; answered with EVT_RESULT
+    REQ_UDP_OPEN,       // port; answered with EVT_RESULT, with the new handle
+    REQ_UDP_CONNECT,    // handle, addr, port; answered with EVT_RESULT
+    REQ_TCP_CONNECT,    // addr, port; answered with EVT_RESULT, with the new handle, once connected
+    REQ_TCP_LISTEN,     // port; answered with EVT_RESULT, with the new handle
+    REQ_SEND,           // handle, ptr, value = length, addr and port (both zero for the connected address)
+    REQ_RELEASE,        // handle, ptr = the pbuf from an EVT_RECV, or NULL to release an EVT_ACCEPT
+    REQ_CLOSE,          // handle
+
+    // events from core 1 to core 0
+    EVT_RESULT,         // err, value = PICO_ERROR_ code for REQ_WIFI_CONNECT, handle for the new socket
+    EVT_RECV,           // handle, ptr = pbuf, addr and port for UDP
+    EVT_ACCEPT,         // handle = the listener, value = the handle for the new connection
+};
+
+typedef struct {
+    uint8_t type;
+    int8_t err;         // lwIP err_t
+    uint16_t port;
+    int32_t handle;
+    void *ptr;
+    uint32_t value;
+    uint32_t addr;
+} netcore_msg_t;
+
+// A single producer, single consumer ring of messages. head and tail run freely, and are only written by the producer
+// and the consumer respectively
+typedef struct {
+    netcore_msg_t msgs[PICO_NETCORE_RING_SIZE];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+} netcore_ring_t;
+
+typedef struct {
+    const char *ssid;
+    const char *pw;
+    uint32_t auth;
+    uint32_t timeout_ms;
+} wifi_connect_args_t;
+
+static netcore_ring_t request_ring;
+static netcore_ring_t event_ring;
+
+// Per socket state written by core 1 and read by core 0. Both are reset by core 1 when it allocates the slot, before
+// it passes the handle to core 0
+static struct {
+    volatile uint32_t tx_done;  // number of sends completed
+    volatile int8_t error;      // lwIP err_t once the socket has failed
+    volatile bool eof;          // the other end has closed the TCP connection
+} shared_state[PICO_NETCORE_MAX_SOCKETS];
+
+static uint32_t __attribute__((aligned(8))) core1_stack[PICO_NETCORE_CORE1_STACK_SIZE / sizeof(uint32_t)];
+
+static inline uint ring_count(netcore_ring_t *ring) {
+    return ring->head - ring->tail;
+}
+
+// Ring the other core's doorbell. If the FIFO is full the other core has yet to drain it, and will see everything
+// done before this when it does
+static void doorbell(void) {
+    if (multicore_fifo_wready()) {
+        multicore_fifo_push_blocking(0);
+    }
+}
+
+// Only called by the ring's producer
+static bool ring_push(netcore_ring_t *ring, const netcore_msg_t *msg, uint reserve) {
+    uint32_t head = ring->head;
+    if (head - ring->tail + reserve >= PICO_NETCORE_RING_SIZE) return false;
+    ring->msgs[head % PICO_NETCORE_RING_SIZE] = *msg;
+    // the message must be visible to the other core before the head which hands it over
+    __mem_fence_release();
+    ring->head = head + 1;
+    doorbell();
+    return true;
+}
+
+// Only called by the ring's consumer
+static bool ring_pop(netcore_ring_t *ring, netcore_msg_t *msg) {
+    uint32_t tail = ring->tail;
+    if (tail == ring->head) return false;
+    __mem_fence_acquire();
+    *msg = ring->msgs[tail % PICO_NETCORE_RING_SIZE];
+    __mem_fence_release();
+    ring->tail = tail + 1;
+    return true;
+}
+
+static int pico_error_from_lwip(err_t err) {
+    switch (err) {
+        case ERR_OK:
+            return PICO_OK;
+        case ERR_TIMEOUT:
+            return PICO_ERROR_TIMEOUT;
+        case ERR_ARG:
+        case ERR_VAL:
+            return PICO_ERROR_INVALID_ARG;
+        case ERR_USE:
+        case ERR_ALREADY:
+        case ERR_ISCONN:
+        case ERR_INPROGRESS:
+            return PICO_ERROR_NOT_PERMITTED;
+        case ERR_ABRT:
+        case ERR_RST:
+        case ERR_CLSD:
+        case ERR_CONN:
+        case ERR_RTE:
+        case ERR_IF:
+            return PICO_ERROR_IO;
+        default:
+            return PICO_ERROR_GENERIC;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// core 1
+
+enum {
+    SOCK_FREE = 0,
+    SOCK_UDP,
+    SOCK_TCP_CONNECTING,
+    SOCK_TCP,
+    SOCK_TCP_LISTEN,
+    SOCK_TCP_FAILED,    // the pcb has gone, but core 0 has yet to close the socket
+};
+
+typedef struct {
+    const uint8_t *data;
+    uint32_t len;
+} tx_item_t;
+
+typedef struct {
+    union {
+        struct udp_pcb *udp;
+        struct tcp_pcb *tcp;
+    } pcb;
+    uint8_t type;
+    uint8_t gen;
+    uint8_t slot;
+    uint8_t rx_credits;     // number more EVT_RECV (or EVT_ACCEPT) core 0 may be sent before it releases some
+    // TCP sends not yet acknowledged, oldest first
+    tx_item_t tx[PICO_NETCORE_TX_QUEUE];
+    uint8_t tx_first;
+    uint8_t tx_count;
+    uint32_t tx_written;    // bytes passed to tcp_write, counted from the start of the oldest send
+    uint32_t tx_acked;      // bytes acknowledged, counted from the start of the oldest send
+} core1_sock_t;
+
+static core1_sock_t core1_socks[PICO_NETCORE_MAX_SOCKETS];
+
+// Events core 1 pushes on its own account leave room for the one EVT_RESULT which may be owed to core 0, so that the
+// answer to a request can always be delivered without waiting
+#define EVENT_RESERVE 1
+
+static void post_result(err_t err, int value) {
+    netcore_msg_t msg = {.type = EVT_RESULT, .err = err, .value = (uint32_t)value};
+    // core 0 has at most one request awaiting an answer, and EVENT_RESERVE keeps a place for it
+    bool ok = ring_push(&event_ring, &msg, 0);
+    hard_assert(ok);
+}
+
+static core1_sock_t *sock_alloc(uint8_t type) {
+    for (uint i = 0; i < PICO_NETCORE_MAX_SOCKETS; i++) {
+        core1_sock_t *sock = &core1_socks[i];
+        if (sock->type == SOCK_FREE) {
+            uint8_t gen = sock->gen + 1;
+            if (!gen) gen = 1;
+            memset(sock, 0, sizeof(*sock));
+            sock->type = type;
+            sock->gen = gen;
+            sock->slot = (uint8_t)i;
+            sock->rx_credits = PICO_NETCORE_RX_QUEUE;
+            shared_state[i].tx_done = 0;
+            shared_state[i].error = ERR_OK;
+            shared_state[i].eof = false;
+            return sock;
+        }
+    }
+    return NULL;
+}
+
+static inline int sock_handle(core1_sock_t *sock) {
+    return MAKE_HANDLE(sock->slot, sock->gen);
+}
+
+static core1_sock_t *sock_from_handle(int handle) {
+    uint slot = HANDLE_SLOT(handle);
+    if (slot >= PICO_NETCORE_MAX_SOCKETS) return NULL;
+    core1_sock_t *sock = &core1_socks[slot];
+    if (sock->type == SOCK_FREE || sock->gen != HANDLE_GEN(handle)) return NULL;
+    return sock;
+}
+
+static void tx_complete(core1_sock_t *sock, uint count) {
+    if (!count) return;
+    __mem_fence_release();
+    shared_state[sock->slot].tx_done += count;
+    doorbell();
+}
+
+static void tcp_detach(struct tcp_pcb *pcb) {
+    tcp_arg(pcb, NULL);
+    tcp_recv(pcb, NULL);
+    tcp_sent(pcb, NULL);
+    tcp_err(pcb, NULL);
+    tcp_accept(pcb, NULL);
+}
+
+// The connection has failed; the data of any sends is no longer referenced
+static void tcp_fail(core1_sock_t *sock, err_t err) {
+    if (sock->type == SOCK_TCP_CONNECTING) {
+        // core 0 never learnt of this socket
+        sock->type = SOCK_FREE;
+        post_result(err, 0);
+        return;
+    }
+    sock->type = SOCK_TCP_FAILED;
+    sock->pcb.tcp = NULL;
+    tx_complete(sock, sock->tx_count);
+    sock->tx_count = 0;
+    __mem_fence_release();
+    shared_state[sock->slot].error = err;
+    doorbell();
+}
+
+// Pass as much of the queued data to lwIP as there is room for
+static err_t tcp_send_queued(core1_sock_t *sock) {
+    struct tcp_pcb *pcb = sock->pcb.tcp;
+    uint32_t offset = sock->tx_written;
+    bool written = false;
+    for (uint i = 0; i < sock->tx_count; i++) {
+        tx_item_t *item = &sock->tx[(sock->tx_first + i) % PICO_NETCORE_TX_QUEUE];
+        if (offset >= item->len) {
+            offset -= item->len;
+            continue;
+        }
+        while (offset < item->len) {
+            uint16_t room = tcp_sndbuf(pcb);
+            if (!room) break;
+            uint16_t len = (uint16_t)MIN(item->len - offset, room);
+            bool more = offset + len < item->len || i + 1 < sock->tx_count;
+            // no TCP_WRITE_FLAG_COPY: lwIP references the application's data until it is acknowledged
+            err_t err = tcp_write(pcb, item->data + offset, len, more ? TCP_WRITE_FLAG_MORE : 0);
+            if (err == ERR_MEM) break;
+            if (err != ERR_OK) {
+                tcp_abort(pcb);
+                return ERR_ABRT;
+            }
+            offset += len;
+            sock->tx_written += len;
+            written = true;
+        }
+        if (offset < item->len) break;
+        offset = 0;
+    }
+    if (written) tcp_output(pcb);
+    return ERR_OK;
+}
+
+static err_t tcp_sent_cb(void *arg, __unused struct tcp_pcb *pcb, u16_t len) {
+    core1_sock_t *sock = (core1_sock_t *)arg;
+    sock->tx_acked += len;
+    uint done = 0;
+    while (sock->tx_count && sock->tx_acked >= sock->tx[sock->tx_first].len) {
+        uint32_t item_len = sock->tx[sock->tx_first].len;
+        sock->tx_acked -= item_len;
+        sock->tx_written -= item_len;
+        sock->tx_first = (uint8_t)((sock->tx_first + 1) % PICO_NETCORE_TX_QUEUE);
+        sock->tx_count--;
+        done++;
+    }
+    tx_complete(sock, done);
+    return tcp_send_queued(sock);
+}
+
+static err_t tcp_recv_cb(void *arg, __unused struct tcp_pcb *pcb, struct pbuf *p, err_t err) {
+    core1_sock_t *sock = (core1_sock_t *)arg;
+    if (!p) {
+        // the end of the stream comes after all its data, which has already been passed on (or this would have been
+        // held back with it)
+        __mem_fence_release();
+        shared_state[sock->slot].eof = true;
+        doorbell();
+        return ERR_OK;
+    }
+    if (err != ERR_OK) {
+        pbuf_free(p);
+        return ERR_OK;
+    }
+    if (!sock->rx_credits) return ERR_MEM;
+    netcore_msg_t msg = {.type = EVT_RECV, .handle = sock_handle(sock), .ptr = p};
+    // returning ERR_MEM leaves the data with lwIP, which holds off the connection and offers it again later
+    if (!ring_push(&event_ring, &msg, EVENT_RESERVE)) return ERR_MEM;
+    // the window is opened again by tcp_recved when core 0 releases the data
+    sock->rx_credits--;
+    return ERR_OK;
+}
+
+static void tcp_err_cb(void *arg, err_t err) {
+    core1_sock_t *sock = (core1_sock_t *)arg;
+    if (sock) tcp_fail(sock, err);
+}
+
+static void tcp_setup(core1_sock_t *sock, struct tcp_pcb *pcb) {
+    sock->pcb.tcp = pcb;
+    tcp_arg(pcb, sock);
+    tcp_recv(pcb, tcp_recv_cb);
+    tcp_sent(pcb, tcp_sent_cb);
+    tcp_err(pcb, tcp_err_cb);
+}
+
+static err_t tcp_connected_cb(void *arg, __unused struct tcp_pcb *pcb, err_t err) {
+    core1_sock_t *sock = (core1_sock_t *)arg;
+    assert(sock->type == SOCK_TCP_CONNECTING);
+    // lwIP currently only calls this on success; failure comes via tcp_err
+    assert(err == ERR_OK);
+    sock->type = SOCK_TCP;
+    post_result(err, sock_handle(sock));
+    return ERR_OK;
+}
+
+static err_t tcp_accept_cb(void *arg, struct tcp_pcb *newpcb, err_t err) {
+    core1_sock_t *listener = (core1_sock_t *)arg;
+    if (err != ERR_OK || !newpcb) return ERR_VAL;
+    core1_sock_t *sock = NULL;
+    // the check for space in the ring must come first, as there is no way to give back a socket once allocated here
+    if (listener->rx_credits && ring_count(&event_ring) + EVENT_RESERVE < PICO_NETCORE_RING_SIZE) {
+        sock = sock_alloc(SOCK_TCP);
+    }
+    if (!sock) {
+        tcp_abort(newpcb);
+        return ERR_ABRT;
+    }
+    tcp_setup(sock, newpcb);
+    netcore_msg_t msg = {.type = EVT_ACCEPT, .handle = sock_handle(listener), .value = (uint32_t)sock_handle(sock)};
+    bool ok = ring_push(&event_ring, &msg, EVENT_RESERVE);
+    assert(ok);
+    (void)ok;
+    listener->rx_credits--;
+    return ERR_OK;
+}
+
+static void udp_recv_cb(void *arg, __unused struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port) {
+    core1_sock_t *sock = (core1_sock_t *)arg;
+    netcore_msg_t msg = {.type = EVT_RECV, .handle = sock_handle(sock), .ptr = p, .port = port,
+                         .addr = ip4_addr_get_u32(ip_2_ip4(addr))};
+    // UDP may drop datagrams, so that is what happens when core 0 is behind
+    if (!sock->rx_credits || !ring_push(&event_ring, &msg, EVENT_RESERVE)) {
+        pbuf_free(p);
+        return;
+    }
+    sock->rx_credits--;
+}
+
+static void handle_udp_open(const netcore_msg_t *req) {
+    core1_sock_t *sock = sock_alloc(SOCK_UDP);
+    if (!sock) {
+        post_result(ERR_MEM, 0);
+        return;
+    }
+    struct udp_pcb *pcb = udp_new_ip_type(IPADDR_TYPE_V4);
+    err_t err = pcb ? udp_bind(pcb, IP4_ADDR_ANY, req->port) : ERR_MEM;
+    if (err != ERR_OK) {
+        if (pcb) udp_remove(pcb);
+        sock->type = SOCK_FREE;
+        post_result(err, 0);
+        return;
+    }
+    sock->pcb.udp = pcb;
+    udp_recv(pcb, udp_recv_cb, sock);
+    post_result(ERR_OK, sock_handle(sock));
+}
+
+static void handle_udp_connect(const netcore_msg_t *req) {
+    core1_sock_t *sock = sock_from_handle(req->handle);
+    if (!sock || sock->type != SOCK_UDP) {
+        post_result(ERR_ARG, 0);
+        return;
+    }
+    ip_addr_t addr;
+    ip_addr_set_ip4_u32(&addr, req->addr);
+    post_result(udp_connect(sock->pcb.udp, &addr, req->port), 0);
+}
+
+static void handle_tcp_connect(const netcore_msg_t *req) {
+    core1_sock_t *sock = sock_alloc(SOCK_TCP_CONNECTING);
+    if (!sock) {
+        post_result(ERR_MEM, 0);
+        return;
+    }
+    struct tcp_pcb *pcb = tcp_new_ip_type(IPADDR_TYPE_V4);
+    if (!pcb) {
+        sock->type = SOCK_FREE;
+        post_result(ERR_MEM, 0);
+        return;
+    }
+    tcp_setup(sock, pcb);
+    ip_addr_t addr;
+    ip_addr_set_ip4_u32(&addr, req->addr);
+    err_t err = tcp_connect(pcb, &addr, req->port, tcp_connected_cb);
+    if (err != ERR_OK) {
+        tcp_detach(pcb);
+        tcp_abort(pcb);
+        sock->type = SOCK_FREE;
+        post_result(err, 0);
+    }
+    // otherwise the answer comes from tcp_connected_cb or tcp_err_cb
+}
+
+static void handle_tcp_listen(const netcore_msg_t *req) {
+    core1_sock_t *sock = sock_alloc(SOCK_TCP_LISTEN);
+    if (!sock) {
+        post_result(ERR_MEM, 0);
+        return;
+    }
+    struct tcp_pcb *pcb = tcp_new_ip_type(IPADDR_TYPE_V4);
+    err_t err = pcb ? tcp_bind(pcb, IP4_ADDR_ANY, req->port) : ERR_MEM;
+    struct tcp_pcb *listen_pcb = NULL;
+    if (err == ERR_OK) {
+        listen_pcb = tcp_listen_with_backlog_and_err(pcb, TCP_DEFAULT_LISTEN_BACKLOG, &err);
+    }
+    if (!listen_pcb) {
+        if (pcb) tcp_abort(pcb);
+        sock->type = SOCK_FREE;
+        post_result(err, 0);
+        return;
+    }
+    // tcp_listen frees the original pcb
+    sock->pcb.tcp = listen_pcb;
+    tcp_arg(listen_pcb, sock);
+    tcp_accept(listen_pcb, tcp_accept_cb);
+    post_result(ERR_OK, sock_handle(sock));
+}
+
+static void handle_send(const netcore_msg_t *req) {
+    core1_sock_t *sock = sock_from_handle(req->handle);
+    // core 0 only sends on open sockets; it may not yet know one has failed, in which case the send is complete
+    // straight away
+    if (!sock) return;
+    if (sock->type == SOCK_UDP) {
+        struct pbuf *p = req->value <= 0xffff ? pbuf_alloc(PBUF_TRANSPORT, (u16_t)req->value, PBUF_REF) : NULL;
+        err_t err = ERR_MEM;
+        if (p) {
+            p->payload = req->ptr;
+            if (req->port) {
+                ip_addr_t addr;
+                ip_addr_set_ip4_u32(&addr, req->addr);
+                err = udp_sendto(sock->pcb.udp, p, &addr, req->port);
+            } else {
+                err = udp_send(sock->pcb.udp, p);
+            }
+            // the data is copied by the driver (or by the ARP queue while the address is being resolved), so the
+            // send is complete once udp_send returns
+            pbuf_free(p);
+        }
+        // there are no errors on a UDP socket as such; the datagram is lost
+        (void)err;
+        tx_complete(sock, 1);
+    } else if (sock->type == SOCK_TCP) {
+        assert(sock->tx_count < PICO_NETCORE_TX_QUEUE);
+        tx_item_t *item = &sock->tx[(sock->tx_first + sock->tx_count) % PICO_NETCORE_TX_QUEUE];
+        item->data = (const uint8_t *)req->ptr;
+        item->len = req->value;
+        sock->tx_count++;
+        tcp_send_queued(sock);
+    } else {
+        tx_complete(sock, 1);
+    }
+}
+
+static void handle_release(const netcore_msg_t *req) {
+    struct pbuf *p = (struct pbuf *)req->ptr;
+    core1_sock_t *sock = sock_from_handle(req->handle);
+    if (sock) {
+        sock->rx_credits++;
+        if (p && sock->type == SOCK_TCP) {
+            // any data refused while core 0 was behind is offered again from lwIP's TCP timer
+            tcp_recved(sock->pcb.tcp, p->tot_len);
+        }
+    }
+    if (p) pbuf_free(p);
+}
+
+static void handle_close(const netcore_msg_t *req) {
+    core1_sock_t *sock = sock_from_handle(req->handle);
+    if (!sock) return;
+    switch (sock->type) {
+        case SOCK_UDP:
+            udp_remove(sock->pcb.udp);
+            break;
+        case SOCK_TCP:
+        case SOCK_TCP_LISTEN: {
+            struct tcp_pcb *pcb = sock->pcb.tcp;
+            tcp_detach(pcb);
+            if (tcp_close(pcb) != ERR_OK) tcp_abort(pcb);
+            break;
+        }
+        default:
+            break;
+    }
+    sock->type = SOCK_FREE;
+}
+
+static void handle_wifi_connect(const netcore_msg_t *req) {
+    const wifi_connect_args_t *args = (const wifi_connect_args_t *)req->ptr;
+    int rc = cyw43_arch_wifi_connect_timeout_ms(args->ssid, args->pw, args->auth, args->timeout_ms);
+    cyw43_arch_lwip_begin();
+    post_result(ERR_OK, rc);
+    cyw43_arch_lwip_end();
+}
+
+static void handle_request(const netcore_msg_t *req) {
+    switch (req->type) {
+        case REQ_UDP_OPEN: handle_udp_open(req); break;
+        case REQ_UDP_CONNECT: handle_udp_connect(req); break;
+        case REQ_TCP_CONNECT: handle_tcp_connect(req); break;
+        case REQ_TCP_LISTEN: handle_tcp_listen(req); break;
+        case REQ_SEND: handle_send(req); break;
+        case REQ_RELEASE: handle_release(req); break;
+        case REQ_CLOSE: handle_close(req); break;
+        default: panic_unsupported();
+    }
+}
+
+static void core1_entry(void) {
+    // the driver's IRQs, and so lwIP, run on the core which initializes it
+    int rc = (int)multicore_fifo_pop_blocking();
+    rc = cyw43_arch_init_with_country((uint32_t)rc);
+    if (!rc) cyw43_arch_enable_sta_mode();
+    post_result(ERR_OK, rc);
+    if (rc) {
+        // core 0 resets this core
+        while (true) __wfe();
+    }
+    while (true) {
+        multicore_fifo_pop_blocking();
+        // emptying the FIFO first means a doorbell rung for a request not seen below wakes this core again
+        multicore_fifo_drain();
+        netcore_msg_t req;
+        while (ring_pop(&request_ring, &req)) {
+            if (req.type == REQ_WIFI_CONNECT) {
+                // this must not hold the lock, so the driver can make progress
+                handle_wifi_connect(&req);
+            } else {
+                cyw43_arch_lwip_begin();
+                handle_request(&req);
+                cyw43_arch_lwip_end();
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// core 0
+
+typedef struct {
+    void *ptr;          // the pbuf, or for a listener the new connection's handle
+    uint32_t addr;
+    uint16_t port;
+} rx_item_t;
+
+typedef struct {
+    int handle;         // 0 if the slot is not open
+    bool listener;      // rx holds the handles of new connections rather than pbufs
+    uint32_t tx_posted; // number of sends passed to core 1
+    rx_item_t rx[PICO_NETCORE_RX_QUEUE];
+    uint8_t rx_first;
+    uint8_t rx_count;
+} core0_sock_t;
+
+static core0_sock_t core0_socks[PICO_NETCORE_MAX_SOCKETS];
+static bool result_ready;
+static netcore_msg_t result;
+
+static void post_request(const netcore_msg_t *msg) {
+    // core 1 never waits for core 0, so it always makes room eventually
+    while (!ring_push(&request_ring, msg, 0)) {
+        tight_loop_contents();
+    }
+}
+
+static void post_release(int handle, void *p) {
+    netcore_msg_t msg = {.type = REQ_RELEASE, .handle = handle, .ptr = p};
+    post_request(&msg);
+}
+
+static void post_close(int handle) {
+    netcore_msg_t msg = {.type = REQ_CLOSE, .handle = handle};
+    post_request(&msg);
+}
+
+static void sock_open(int handle) {
+    core0_sock_t *sock = &core0_socks[HANDLE_SLOT(handle)];
+    assert(!sock->handle);
+    memset(sock, 0, sizeof(*sock));
+    sock->handle = handle;
+}
+
+static core0_sock_t *sock_get(int handle) {
+    uint slot = HANDLE_SLOT(handle);
+    invalid_params_if(NETCORE, handle <= 0 || slot >= PICO_NETCORE_MAX_SOCKETS);
+    core0_sock_t *sock = &core0_socks[slot];
+    invalid_params_if(NETCORE, sock->handle != handle);
+    return sock;
+}
+
+static void rx_push(core0_sock_t *sock, const netcore_msg_t *msg) {
+    // core 1 never hands over more than PICO_NETCORE_RX_QUEUE unreleased items
+    hard_assert(sock->rx_count < PICO_NETCORE_RX_QUEUE);
+    rx_item_t *item = &sock->rx[(sock->rx_first + sock->rx_count++) % PICO_NETCORE_RX_QUEUE];
+    item->ptr = msg->type == EVT_ACCEPT ? (void *)(uintptr_t)msg->value : msg->ptr;
+    item->addr = msg->addr;
+    item->port = msg->port;
+}
+
+static rx_item_t rx_pop(core0_sock_t *sock) {
+    assert(sock->rx_count);
+    rx_item_t item = sock->rx[sock->rx_first];
+    sock->rx_first = (uint8_t)((sock->rx_first + 1) % PICO_NETCORE_RX_QUEUE);
+    sock->rx_count--;
+    return item;
+}
+
+void netcore_poll(void) {
+    netcore_msg_t msg;
+    while (ring_pop(&event_ring, &msg)) {
+        switch (msg.type) {
+            case EVT_RESULT:
+                assert(!result_ready);
+                result = msg;
+                result_ready = true;
+                break;
+            case EVT_RECV:
+            case EVT_ACCEPT: {
+                core0_sock_t *sock = &core0_socks[HANDLE_SLOT(msg.handle)];
+                if (sock->handle == msg.handle) {
+                    if (msg.type == EVT_ACCEPT) sock_open((int)msg.value);
+                    rx_push(sock, &msg);
+                } else if (msg.type == EVT_ACCEPT) {
+                    // the listener has been closed
+                    post_close((int)msg.value);
+                } else {
+                    post_release(msg.handle, msg.ptr);
+                }
+                break;
+            }
+            default:
+                panic_unsupported();
+        }
+    }
+}
+
+// Wait for the doorbell from core 1 and process the events; returns false if the time was reached first. Callers
+// check their condition before calling this, and a doorbell rung for anything they may have missed is still in the FIFO
+static bool wait_event(absolute_time_t until) {
+    if (is_at_the_end_of_time(until)) {
+        multicore_fifo_pop_blocking();
+    } else {
+        int64_t timeout_us = absolute_time_diff_us(get_absolute_time(), until);
+        uint32_t ignored;
+        if (timeout_us <= 0 || !multicore_fifo_pop_timeout_us((uint64_t)timeout_us, &ignored)) return false;
+    }
+    multicore_fifo_drain();
+    netcore_poll();
+    return true;
+}
+
+static void wait_result(void) {
+    while (!result_ready) {
+        wait_event(at_the_end_of_time);
+    }
+    result_ready = false;
+}
+
+static netcore_msg_t request(const netcore_msg_t *req) {
+    post_request(req);
+    wait_result();
+    return result;
+}
+
+// The answer to a request which opens a socket
+static int request_open(const netcore_msg_t *req) {
+    netcore_msg_t res = request(req);
+    if (res.err != ERR_OK) return pico_error_from_lwip(res.err);
+    int handle = (int)res.value;
+    sock_open(handle);
+    return handle;
+}
+
+int netcore_init(uint32_t country) {
+    multicore_launch_core1_with_stack(core1_entry, core1_stack, sizeof(core1_stack));
+    // the launch handshake is over, so the FIFOs are free for doorbells; the first word is the country
+    multicore_fifo_push_blocking(country);
+    wait_result();
+    int rc = (int)result.value;
+    if (rc) {
+        multicore_reset_core1();
+        // the reset core pushes a word to say it is ready
+        multicore_fifo_pop_blocking();
+    }
+    return rc;
+}
+
+int netcore_wifi_connect(const char *ssid, const char *pw, uint32_t auth, uint32_t timeout_ms) {
+    wifi_connect_args_t args = {.ssid = ssid, .pw = pw, .auth = auth, .timeout_ms = timeout_ms};
+    netcore_msg_t req = {.type = REQ_WIFI_CONNECT, .ptr = &args};
+    return (int)request(&req).value;
+}
+
+ip4_addr_t netcore_get_ip4_addr(void) {
+    // a single word, so it can be read without the lock
+    return *netif_ip4_addr(&cyw43_state.netif[CYW43_ITF_STA]);
+}
+
+int netcore_udp_open(uint16_t port) {
+    netcore_msg_t req = {.type = REQ_UDP_OPEN, .port = port};
+    return request_open(&req);
+}
+
+int netcore_udp_connect(int handle, const ip4_addr_t *addr, uint16_t port) {
+    sock_get(handle);
+    netcore_msg_t req = {.type = REQ_UDP_CONNECT, .handle = handle, .addr = ip4_addr_get_u32(addr), .port = port};
+    return pico_error_from_lwip(request(&req).err);
+}
+
+int netcore_tcp_connect(const ip4_addr_t *addr, uint16_t port) {
+    netcore_msg_t req = {.type = REQ_TCP_CONNECT, .addr = ip4_addr_get_u32(addr), .port = port};
+    return request_open(&req);
+}
+
+int netcore_tcp_listen(uint16_t port) {
+    netcore_msg_t req = {.type = REQ_TCP_LISTEN, .port = port};
+    int handle = request_open(&req);
+    if (handle > 0) core0_socks[HANDLE_SLOT(handle)].listener = true;
+    return handle;
+}
+
+int netcore_accept(int listener, absolute_time_t until) {
+    core0_sock_t *sock = sock_get(listener);
+    do {
+        if (sock->rx_count) {
+            int handle = (int)(uintptr_t)rx_pop(sock).ptr;
+            // give core 1 back the credit for the connection
+            post_release(listener, NULL);
+            return handle;
+        }
+        int err = netcore_get_error(listener);
+        if (err) return err;
+    } while (wait_event(until));
+    return PICO_ERROR_TIMEOUT;
+}
+
+static inline uint32_t tx_outstanding(core0_sock_t *sock) {
+    uint32_t done = shared_state[HANDLE_SLOT(sock->handle)].tx_done;
+    __mem_fence_acquire();
+    return sock->tx_posted - done;
+}
+
+static int post_send(int handle, const void *data, size_t len, uint32_t addr, uint16_t port) {
+    core0_sock_t *sock = sock_get(handle);
+    invalid_params_if(NETCORE, !len);
+    int err = netcore_get_error(handle);
+    if (err && err != PICO_ERROR_NO_DATA) return err;
+    while (tx_outstanding(sock) >= PICO_NETCORE_TX_QUEUE) {
+        wait_event(at_the_end_of_time);
+    }
+    netcore_msg_t req = {.type = REQ_SEND, .handle = handle, .ptr = (void *)data, .value = len, .addr = addr,
+                         .port = port};
+    sock->tx_posted++;
+    post_request(&req);
+    return PICO_OK;
+}
+
+int netcore_send(int handle, const void *data, size_t len) {
+    return post_send(handle, data, len, 0, 0);
+}
+
+int netcore_sendto(int handle, const void *data, size_t len, const ip4_addr_t *addr, uint16_t port) {
+    invalid_params_if(NETCORE, !port || len > 0xffff);
+    return post_send(handle, data, len, ip4_addr_get_u32(addr), port);
+}
+
+bool netcore_wait_sent(int handle, absolute_time_t until) {
+    core0_sock_t *sock = sock_get(handle);
+    do {
+        if (!tx_outstanding(sock)) return true;
+    } while (wait_event(until));
+    return false;
+}
+
+struct pbuf *netcore_recv(int handle, absolute_time_t until, ip4_addr_t *addr, uint16_t *port) {
+    core0_sock_t *sock = sock_get(handle);
+    do {
+        // read the state before the events, so that any data which came before the end of the stream (or a
+        // failure) has been received
+        bool eof = shared_state[HANDLE_SLOT(handle)].eof;
+        bool failed = shared_state[HANDLE_SLOT(handle)].error != ERR_OK;
+        __mem_fence_acquire();
+        netcore_poll();
+        if (sock->rx_count) {
+            rx_item_t item = rx_pop(sock);
+            if (addr) ip4_addr_set_u32(addr, item.addr);
+            if (port) *port = item.port;
+            return (struct pbuf *)item.ptr;
+        }
+        if (eof || failed) break;
+    } while (wait_event(until));
+    return NULL;
+}
+
+void netcore_release(int handle, struct pbuf *p) {
+    sock_get(handle);
+    invalid_params_if(NETCORE, !p);
+    post_release(handle, p);
+}
+
+int netcore_get_error(int handle) {
+    core0_sock_t *sock = sock_get(handle);
+    uint slot = HANDLE_SLOT(handle);
+    int8_t err = shared_state[slot].error;
+    if (err != ERR_OK) return pico_error_from_lwip(err);
+    if (shared_state[slot].eof && !sock->rx_count) {
+        // there may still be data on its way
+        __mem_fence_acquire();
+        netcore_poll();
+        if (!sock->rx_count) return PICO_ERROR_NO_DATA;
+    }
+    return PICO_OK;
+}
+
+// Forget a socket on core 0, and have core 1 close it. Anything received but not yet returned goes back, and connections
+// not yet accepted are closed too
+static void sock_close(core0_sock_t *sock) {
+    int handle = sock->handle;
+    sock->handle = 0;
+    while (sock->rx_count) {
+        rx_item_t item = rx_pop(sock);
+        if (sock->listener) {
+            sock_close(&core0_socks[HANDLE_SLOT((int)(uintptr_t)item.ptr)]);
+        } else {
+            post_release(handle, item.ptr);
+        }
+    }
+    post_close(handle);
+}
+
+void netcore_close(int handle) {
+    core0_sock_t *sock = sock_get(handle);
+    netcore_wait_sent(handle, at_the_end_of_time);
+    netcore_poll();
+    sock_close(sock);
+}
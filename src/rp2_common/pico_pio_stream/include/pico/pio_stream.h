@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_PIO_STREAM_H
+#define _PICO_PIO_STREAM_H
+
+#include "pico.h"
+#include "hardware/pio.h"
+#include "hardware/sync.h"
+
+/** \file pico/pio_stream.h
+ *  \defgroup pico_pio_stream pico_pio_stream
+ * DMA streaming of data to and from a PIO state machine through ring buffers
+ *
+ * A PIO stream moves 32 bit words between a state machine's FIFOs and a ring buffer in each direction, using DMA, so
+ * the CPU is not involved per word. The application writes data to be sent directly into the TX ring buffer and
+ * commits it, and reads received data directly out of the RX ring buffer and releases it (or uses the copying
+ * \ref pio_stream_write / \ref pio_stream_read).
+ *
+ * The DMA is flow controlled in both directions: the TX DMA only sends data which has been committed, and the RX DMA
+ * only writes into space which has been released, so the state machine stalls (rather than data being lost or
+ * repeated) when the application doesn't keep up. These stalls are detected using the PIO FDEBUG flags, and counted as
+ * TX underruns and RX overruns.
+ *
+ * Each direction uses a pair of DMA channels chained to each other. Whenever more data (or space) is made available
+ * while one channel is running, the other is armed to continue from where it will stop, and chained from it, so
+ * a steady stream continues without any gap between transfers. The ring buffers wrap using the DMA address ring
+ * feature, so must be a power of two in size and aligned to their size (see \ref PIO_STREAM_RING_BUFFER).
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// PICO_CONFIG: PARAM_ASSERTIONS_ENABLED_PIO_STREAM, Enable/disable assertions in the PIO stream module, type=bool, default=0, group=pico_pio_stream
+#ifndef PARAM_ASSERTIONS_ENABLED_PIO_STREAM
+#define PARAM_ASSERTIONS_ENABLED_PIO_STREAM 0
+#endif
+
+/*! \brief Declare a suitably aligned static ring buffer for a PIO stream
+ *  \ingroup pico_pio_stream
+ *
+ * \param name the name of the buffer
+ * \param words the size of the buffer in 32 bit words; a power of two between 2 and 8192
+ */
+#define PIO_STREAM_RING_BUFFER(name, words) \
+    static uint32_t __attribute__((aligned((words) * 4))) name[words]
+
+/*! \brief PIO stream configuration
+ *  \ingroup pico_pio_stream
+ */
+typedef struct {
+    PIO pio;                ///< the PIO instance
+    uint sm;                ///< the state machine, which should be configured (but not necessarily enabled) already
+    uint32_t *tx_ring;      ///< TX ring buffer, or NULL for no TX
+    uint tx_ring_words;     ///< size of the TX ring buffer in words
+    uint32_t *rx_ring;      ///< RX ring buffer, or NULL for no RX
+    uint rx_ring_words;     ///< size of the RX ring buffer in words
+} pio_stream_config_t;
+
+/*! \brief PIO stream statistics
+ *  \ingroup pico_pio_stream
+ */
+typedef struct {
+    uint64_t tx_words;      ///< number of words committed for sending
+    uint64_t rx_words;      ///< number of words received and released
+    uint32_t tx_underruns;  ///< number of times the state machine was seen to have stalled on an empty TX FIFO
+    uint32_t rx_overruns;   ///< number of times the state machine was seen to have stalled on a full RX FIFO
+    uint32_t tx_starved;    ///< number of times the TX DMA finished all committed data
+    uint32_t rx_full;       ///< number of times the RX DMA filled all released space
+} pio_stream_stats_t;
+
+// \cond internal
+// one direction of a stream
+typedef struct {
+    uint32_t *ring;
+    uint32_t ring_words;
+    uint32_t app_pos;       // (free running) TX: end of data committed; RX: end of data released
+    uint32_t armed_pos;     // end of the data (TX) or space (RX) handed to the DMA
+    uint32_t seg_start[2];  // start of the segment last armed on each channel
+    uint32_t seg_count[2];
+    uint8_t channel[2];
+    uint8_t active;         // index of the channel which is running, or ran last
+    bool running;           // the active channel's completion has not yet been handled
+    bool queued;            // the other channel is armed, and chained from the active one
+    bool is_tx;
+} pio_stream_dir_t;
+// \endcond
+
+typedef struct {
+    PIO pio;
+    uint8_t sm;
+    spin_lock_t *lock;
+    pio_stream_dir_t tx;
+    pio_stream_dir_t rx;
+    pio_stream_stats_t stats;
+} pio_stream_t;
+
+/*! \brief Initialize and start a PIO stream
+ *  \ingroup pico_pio_stream
+ *
+ * Two DMA channels are claimed for each direction. The RX DMA starts immediately, with the whole RX ring buffer
+ * available to it; the TX DMA starts once data is committed.
+ *
+ * \param stream the stream
+ * \param config the configuration
+ */
+void pio_stream_init(pio_stream_t *stream, const pio_stream_config_t *config);
+
+/*! \brief Stop a PIO stream, and release its DMA channels
+ *  \ingroup pico_pio_stream
+ *
+ * Any data not yet sent or read is discarded.
+ *
+ * \param stream the stream
+ */
+void pio_stream_deinit(pio_stream_t *stream);
+
+/*! \brief Get the free space in the TX ring buffer to write to
+ *  \ingroup pico_pio_stream
+ *
+ * \param stream the stream
+ * \param words filled in with the number of contiguous words which may be written (which may be less than the total
+ *              free space when the free space wraps around the end of the ring buffer)
+ * \return a pointer to the free space
+ */
+uint32_t *pio_stream_tx_acquire(pio_stream_t *stream, uint *words);
+
+/*! \brief Send words written to the space returned by \ref pio_stream_tx_acquire
+ *  \ingroup pico_pio_stream
+ *
+ * \param stream the stream
+ * \param words the number of words written
+ */
+void pio_stream_tx_commit(pio_stream_t *stream, uint words);
+
+/*! \brief Get the received data in the RX ring buffer
+ *  \ingroup pico_pio_stream
+ *
+ * \param stream the stream
+ * \param words filled in with the number of contiguous words which may be read (which may be less than the total
+ *              received when the data wraps around the end of the ring buffer)
+ * \return a pointer to the data
+ */
+const uint32_t *pio_stream_rx_acquire(pio_stream_t *stream, uint *words);
+
+/*! \brief Return space in the RX ring buffer once data from \ref pio_stream_rx_acquire has been used
+ *  \ingroup pico_pio_stream
+ *
+ * \param stream the stream
+ * \param words the number of words used
+ */
+void pio_stream_rx_release(pio_stream_t *stream, uint words);
+
+/*! \brief Copy words into the TX ring buffer and send them, without blocking
+ *  \ingroup pico_pio_stream
+ *
+ * \param stream the stream
+ * \param src the words to send
+ * \param words the number of words
+ * \return the number of words sent, which is less than requested if the ring buffer is full
+ */
+uint pio_stream_write(pio_stream_t *stream, const uint32_t *src, uint words);
+
+/*! \brief Copy received words out of the RX ring buffer, without blocking
+ *  \ingroup pico_pio_stream
+ *
+ * \param stream the stream
+ * \param dst buffer for the words
+ * \param words the maximum number of words to read
+ * \return the number of words read
+ */
+uint pio_stream_read(pio_stream_t *stream, uint32_t *dst, uint words);
+
+/*! \brief Get the statistics of a PIO stream
+ *  \ingroup pico_pio_stream
+ *
+ * \param stream the stream
+ * \param stats filled in with the statistics
+ */
+void pio_stream_get_stats(pio_stream_t *stream, pio_stream_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
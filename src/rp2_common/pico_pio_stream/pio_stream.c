@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+#include "pico/pio_stream.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+// PICO_CONFIG: PICO_PIO_STREAM_DMA_IRQ_INDEX, The DMA IRQ (0 for DMA_IRQ_0 or 1 for DMA_IRQ_1) used by pico_pio_stream, type=int, default=0, min=0, max=1, group=pico_pio_stream
+#ifndef PICO_PIO_STREAM_DMA_IRQ_INDEX
+#define PICO_PIO_STREAM_DMA_IRQ_INDEX 0
+#endif
+
+// the stream using each DMA channel, for the IRQ handler
+static pio_stream_t *channel_streams[NUM_DMA_CHANNELS];
+static uint stream_count;
+
+static inline uint32_t ring_index(const pio_stream_dir_t *dir, uint32_t pos) {
+    return pos & (dir->ring_words - 1);
+}
+
+// the position up to which the DMA may go
+static inline uint32_t dir_limit(const pio_stream_dir_t *dir) {
+    return dir->is_tx ? dir->app_pos : dir->app_pos + dir->ring_words;
+}
+
+// the position up to which the DMA has (at least) got
+static uint32_t dir_done_pos(const pio_stream_dir_t *dir) {
+    if (!dir->running) return dir->armed_pos;
+    uint which = dir->active;
+    return dir->seg_start[which] + dir->seg_count[which] - dma_channel_hw_addr(dir->channel[which])->transfer_count;
+}
+
+// hand everything available to the DMA, if a channel is free; called with the stream's lock held
+static void dir_arm(pio_stream_dir_t *dir) {
+    uint32_t count = dir_limit(dir) - dir->armed_pos;
+    if (!count || dir->queued) return;
+    uint which = dir->running ? dir->active ^ 1u : dir->active;
+    uint channel = dir->channel[which];
+    uint32_t *addr = dir->ring + ring_index(dir, dir->armed_pos);
+    if (dir->is_tx) {
+        dma_channel_set_read_addr(channel, addr, false);
+    } else {
+        dma_channel_set_write_addr(channel, addr, false);
+    }
+    dma_channel_set_trans_count(channel, count, false);
+    dir->seg_start[which] = dir->armed_pos;
+    dir->seg_count[which] = count;
+    dir->armed_pos += count;
+    if (!dir->running) {
+        dir->running = true;
+        dma_channel_start(channel);
+    } else {
+        uint active_channel = dir->channel[dir->active];
+        dma_channel_set_chain_to(active_channel, channel);
+        dir->queued = true;
+        // if the active channel finished before the chain was set up, nothing will start this one. Had the chain
+        // started it, it would be busy, or have finished and raised its (so far unacknowledged) interrupt; the
+        // transfer count can't tell, as it reads back as 0 until the channel is triggered
+        if (!dma_channel_is_busy(active_channel) && !dma_channel_is_busy(channel) &&
+            !(dma_hw->intr & (1u << channel))) {
+            dma_channel_start(channel);
+        }
+    }
+}
+
+// handle completion of the active channel; called with the stream's lock held
+static bool dir_handle_irq(pio_stream_t *stream, pio_stream_dir_t *dir) {
+    if (!dir->running) return false;
+    uint channel = dir->channel[dir->active];
+    if (!dma_irqn_get_channel_status(PICO_PIO_STREAM_DMA_IRQ_INDEX, channel)) return false;
+    dma_irqn_acknowledge_channel(PICO_PIO_STREAM_DMA_IRQ_INDEX, channel);
+    dma_channel_set_chain_to(channel, channel);
+    if (dir->queued) {
+        // the other channel has taken over
+        dir->active ^= 1;
+        dir->queued = false;
+    } else {
+        dir->running = false;
+        if (dir->is_tx) stream->stats.tx_starved++; else stream->stats.rx_full++;
+    }
+    dir_arm(dir);
+    return true;
+}
+
+// count FIFO stalls since the last time; called with the stream's lock held
+static void update_stall_stats(pio_stream_t *stream) {
+    uint32_t fdebug = stream->pio->fdebug;
+    uint32_t clear = 0;
+    if (stream->tx.ring && (fdebug & (1u << (PIO_FDEBUG_TXSTALL_LSB + stream->sm)))) {
+        stream->stats.tx_underruns++;
+        clear |= 1u << (PIO_FDEBUG_TXSTALL_LSB + stream->sm);
+    }
+    if (stream->rx.ring && (fdebug & (1u << (PIO_FDEBUG_RXSTALL_LSB + stream->sm)))) {
+        stream->stats.rx_overruns++;
+        clear |= 1u << (PIO_FDEBUG_RXSTALL_LSB + stream->sm);
+    }
+    // write 1 to clear
+    if (clear) stream->pio->fdebug = clear;
+}
+
+static void __isr __not_in_flash_func(pio_stream_dma_irq_handler)(void) {
+    for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        pio_stream_t *stream = channel_streams[ch];
+        if (!stream || !dma_irqn_get_channel_status(PICO_PIO_STREAM_DMA_IRQ_INDEX, ch)) continue;
+        uint32_t save = spin_lock_blocking(stream->lock);
+        // a chained channel can complete before its predecessor's completion is handled, so handle in order
+        while (dir_handle_irq(stream, &stream->tx) || dir_handle_irq(stream, &stream->rx));
+        update_stall_stats(stream);
+        spin_unlock(stream->lock, save);
+    }
+}
+
+static void dir_init(pio_stream_t *stream, pio_stream_dir_t *dir, uint32_t *ring, uint ring_words, bool is_tx) {
+    memset(dir, 0, sizeof(pio_stream_dir_t));
+    dir->is_tx = is_tx;
+    if (!ring) return;
+    invalid_params_if(PIO_STREAM, ring_words < 2 || ring_words > 8192 || (ring_words & (ring_words - 1)));
+    invalid_params_if(PIO_STREAM, ((uintptr_t)ring) & (ring_words * 4 - 1));
+    dir->ring = ring;
+    dir->ring_words = ring_words;
+    for (uint which = 0; which < 2; which++) {
+        uint channel = (uint)dma_claim_unused_channel(true);
+        dir->channel[which] = (uint8_t)channel;
+        channel_streams[channel] = stream;
+        dma_channel_config c = dma_channel_get_default_config(channel);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+        channel_config_set_read_increment(&c, is_tx);
+        channel_config_set_write_increment(&c, !is_tx);
+        channel_config_set_ring(&c, !is_tx, (uint)__builtin_ctz(ring_words * 4));
+        channel_config_set_dreq(&c, pio_get_dreq(stream->pio, stream->sm, is_tx));
+        if (is_tx) {
+            dma_channel_configure(channel, &c, &stream->pio->txf[stream->sm], ring, 0, false);
+        } else {
+            dma_channel_configure(channel, &c, ring, &stream->pio->rxf[stream->sm], 0, false);
+        }
+        dma_irqn_set_channel_enabled(PICO_PIO_STREAM_DMA_IRQ_INDEX, channel, true);
+    }
+}
+
+static void dir_deinit(pio_stream_dir_t *dir) {
+    if (!dir->ring) return;
+    for (uint which = 0; which < 2; which++) {
+        // stop the channels triggering each other while they are aborted
+        dma_channel_set_chain_to(dir->channel[which], dir->channel[which]);
+    }
+    for (uint which = 0; which < 2; which++) {
+        uint channel = dir->channel[which];
+        dma_irqn_set_channel_enabled(PICO_PIO_STREAM_DMA_IRQ_INDEX, channel, false);
+        dma_channel_abort(channel);
+        dma_irqn_acknowledge_channel(PICO_PIO_STREAM_DMA_IRQ_INDEX, channel);
+        channel_streams[channel] = NULL;
+        dma_channel_unclaim(channel);
+    }
+}
+
+void pio_stream_init(pio_stream_t *stream, const pio_stream_config_t *config) {
+    check_pio_param(config->pio);
+    check_sm_param(config->sm);
+    memset(stream, 0, sizeof(pio_stream_t));
+    stream->pio = config->pio;
+    stream->sm = (uint8_t)config->sm;
+    stream->lock = spin_lock_instance(next_striped_spin_lock_num());
+    dir_init(stream, &stream->tx, config->tx_ring, config->tx_ring_words, true);
+    dir_init(stream, &stream->rx, config->rx_ring, config->rx_ring_words, false);
+    stream->pio->fdebug = ((1u << PIO_FDEBUG_TXSTALL_LSB) | (1u << PIO_FDEBUG_RXSTALL_LSB)) << stream->sm;
+
+    if (!stream_count++) {
+        irq_add_shared_handler(DMA_IRQ_0 + PICO_PIO_STREAM_DMA_IRQ_INDEX, pio_stream_dma_irq_handler,
+                               PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_0 + PICO_PIO_STREAM_DMA_IRQ_INDEX, true);
+    }
+    if (stream->rx.ring) {
+        uint32_t save = spin_lock_blocking(stream->lock);
+        dir_arm(&stream->rx);
+        spin_unlock(stream->lock, save);
+    }
+}
+
+void pio_stream_deinit(pio_stream_t *stream) {
+    uint32_t save = spin_lock_blocking(stream->lock);
+    dir_deinit(&stream->tx);
+    dir_deinit(&stream->rx);
+    spin_unlock(stream->lock, save);
+    if (!--stream_count) {
+        irq_remove_handler(DMA_IRQ_0 + PICO_PIO_STREAM_DMA_IRQ_INDEX, pio_stream_dma_irq_handler);
+    }
+}
+
+uint32_t *pio_stream_tx_acquire(pio_stream_t *stream, uint *words) {
+    pio_stream_dir_t *dir = &stream->tx;
+    invalid_params_if(PIO_STREAM, !dir->ring);
+    uint32_t save = spin_lock_blocking(stream->lock);
+    uint32_t free = dir->ring_words - (dir->app_pos - dir_done_pos(dir));
+    spin_unlock(stream->lock, save);
+    uint32_t index = ring_index(dir, dir->app_pos);
+    *words = MIN(free, dir->ring_words - index);
+    return dir->ring + index;
+}
+
+void pio_stream_tx_commit(pio_stream_t *stream, uint words) {
+    pio_stream_dir_t *dir = &stream->tx;
+    uint32_t save = spin_lock_blocking(stream->lock);
+    assert(dir->app_pos + words - dir_done_pos(dir) <= dir->ring_words);
+    // make sure the data is written before the DMA reads it
+    __compiler_memory_barrier();
+    dir->app_pos += words;
+    stream->stats.tx_words += words;
+    dir_arm(dir);
+    spin_unlock(stream->lock, save);
+}
+
+const uint32_t *pio_stream_rx_acquire(pio_stream_t *stream, uint *words) {
+    pio_stream_dir_t *dir = &stream->rx;
+    invalid_params_if(PIO_STREAM, !dir->ring);
+    uint32_t save = spin_lock_blocking(stream->lock);
+    uint32_t available = dir_done_pos(dir) - dir->app_pos;
+    spin_unlock(stream->lock, save);
+    // make sure the data isn't read before the DMA wrote it
+    __compiler_memory_barrier();
+    uint32_t index = ring_index(dir, dir->app_pos);
+    *words = MIN(available, dir->ring_words - index);
+    return dir->ring + index;
+}
+
+void pio_stream_rx_release(pio_stream_t *stream, uint words) {
+    pio_stream_dir_t *dir = &stream->rx;
+    uint32_t save = spin_lock_blocking(stream->lock);
+    assert(words <= dir_done_pos(dir) - dir->app_pos);
+    dir->app_pos += words;
+    stream->stats.rx_words += words;
+    dir_arm(dir);
+    spin_unlock(stream->lock, save);
+}
+
+uint pio_stream_write(pio_stream_t *stream, const uint32_t *src, uint words) {
+    uint written = 0;
+    while (written < words) {
+        uint space;
+        uint32_t *dst = pio_stream_tx_acquire(stream, &space);
+        if (!space) break;
+        space = MIN(space, words - written);
+        memcpy(dst, src + written, space * 4);
+        pio_stream_tx_commit(stream, space);
+        written += space;
+    }
+    return written;
+}
+
+uint pio_stream_read(pio_stream_t *stream, uint32_t *dst, uint words) {
+    uint read = 0;
+    while (read < words) {
+        uint available;
+        const uint32_t *src = pio_stream_rx_acquire(stream, &available);
+        if (!available) break;
+        available = MIN(available, words - read);
+        memcpy(dst + read, src, available * 4);
+        pio_stream_rx_release(stream, available);
+        read += available;
+    }
+    return read;
+}
+
+void pio_stream_get_stats(pio_stream_t *stream, pio_stream_stats_t *stats) {
+    uint32_t save = spin_lock_blocking(stream->lock);
+    update_stall_stats(stream);
+    *stats = stream->stats;
+    spin_unlock(stream->lock, save);
+}
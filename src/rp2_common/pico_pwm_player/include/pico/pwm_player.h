@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_PWM_PLAYER_H
+#define _PICO_PWM_PLAYER_H
+
+#include "pico.h"
+#include "hardware/pwm.h"
+#include "hardware/dma_desc.h"
+
+/** \file pico/pwm_player.h
+ *  \defgroup pico_pwm_player pico_pwm_player
+ * DMA driven playback of waveforms on PWM slices
+ *
+ * A PWM player writes a buffer of compare values to the CC register of one or more PWM slices, one value per PWM
+ * period, using a DMA channel per slice paced by the slice's DREQ (so the sample rate is the PWM frequency). As the CC
+ * register is double buffered by the hardware, each value takes effect cleanly at the start of a period. Each slice's
+ * playback is run by a looping \ref dma_desc list (so uses a pair of DMA channels) without any CPU involvement, apart
+ * from an interrupt per half buffer when streaming.
+ *
+ * The player can:
+ * - play the buffers once (\ref PWM_PLAYER_ONE_SHOT)
+ * - loop the buffers forever (\ref PWM_PLAYER_LOOP), e.g. for a fixed LED pattern or test tone
+ * - stream (\ref PWM_PLAYER_STREAM), where the buffers are double buffered: while one half is played, the refill
+ *   callback is asked to fill the other
+ *
+ * All slices of a player are started together with \ref pwm_set_mask_enabled, with their counters reset, so stay in
+ * step if they have the same wrap and clock divider.
+ *
+ * The number of distinct levels is limited to wrap + 1, e.g. at a 48 kHz sample rate with a 125 MHz system clock,
+ * wrap is about 2600 (11.3 bits). \ref pwm_player_dither converts 16 bit samples to levels with first order
+ * sigma-delta noise shaping, carrying each sample's rounding error into the next, so that the average level over
+ * several periods has 16 bit resolution, with the quantization noise pushed up in frequency where a low pass output
+ * filter removes it.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// PICO_CONFIG: PARAM_ASSERTIONS_ENABLED_PWM_PLAYER, Enable/disable assertions in the PWM player module, type=bool, default=0, group=pico_pwm_player
+#ifndef PARAM_ASSERTIONS_ENABLED_PWM_PLAYER
+#define PARAM_ASSERTIONS_ENABLED_PWM_PLAYER 0
+#endif
+
+// PICO_CONFIG: PICO_PWM_PLAYER_MAX_SLICES, Maximum number of PWM slices driven by one PWM player, type=int, default=2, min=1, max=8, group=pico_pwm_player
+#ifndef PICO_PWM_PLAYER_MAX_SLICES
+#define PICO_PWM_PLAYER_MAX_SLICES 2
+#endif
+
+/*! \brief PWM player playback mode
+ *  \ingroup pico_pwm_player
+ */
+typedef enum {
+    PWM_PLAYER_ONE_SHOT,    ///< play the buffers once, then leave the last values in place
+    PWM_PLAYER_LOOP,        ///< play the buffers repeatedly
+    PWM_PLAYER_STREAM,      ///< play the buffers repeatedly, calling the refill callback for each half as it is played
+} pwm_player_mode_t;
+
+typedef struct pwm_player pwm_player_t;
+
+/*! \brief Callback to refill half of each slice's buffer
+ *  \ingroup pico_pwm_player
+ *
+ * This is called from the DMA IRQ handler once the given half of the buffers has been played, and should fill it
+ * (see \ref pwm_player_get_buffer) before the other half finishes playing.
+ */
+typedef void (*pwm_player_refill_t)(pwm_player_t *player, uint half);
+
+/*! \brief PWM player configuration
+ *  \ingroup pico_pwm_player
+ */
+typedef struct {
+    uint slice_count;                               ///< number of slices
+    uint slices[PICO_PWM_PLAYER_MAX_SLICES];        ///< the PWM slices, which should be configured but not enabled
+    void *buffers[PICO_PWM_PLAYER_MAX_SLICES];      ///< a buffer of compare values for each slice
+    /// the number of samples in each buffer; must be even when streaming
+    uint samples;
+    /// false: each sample is a uint16_t level, written to both channels; true: each sample is a uint32_t with the
+    /// channel A level in the low 16 bits and channel B in the high 16 bits
+    bool two_channel;
+    pwm_player_mode_t mode;                         ///< the playback mode
+    pwm_player_refill_t refill;                     ///< (stream mode) the refill callback
+    void *user_data;                                ///< for the use of the caller
+} pwm_player_config_t;
+
+/*! \brief A PWM player
+ *  \ingroup pico_pwm_player
+ */
+struct pwm_player {
+    pwm_player_config_t config;
+    uint32_t slice_mask;
+    volatile uint32_t halves_played;    ///< (stream mode) the number of halves played
+    volatile uint32_t late_refills;     ///< (stream mode) the number of times the next half finished during a refill
+    // \cond internal
+    dma_desc_list_t lists[PICO_PWM_PLAYER_MAX_SLICES];
+    dma_desc_t descs[PICO_PWM_PLAYER_MAX_SLICES][3];
+    pwm_player_t *next;
+    // \endcond
+};
+
+/*! \brief Initialize a PWM player
+ *  \ingroup pico_pwm_player
+ *
+ * Two DMA channels are claimed per slice. In stream mode the buffers should be filled before the player is started.
+ *
+ * \param player the player
+ * \param config the configuration, which is copied
+ */
+void pwm_player_init(pwm_player_t *player, const pwm_player_config_t *config);
+
+/*! \brief Start a PWM player
+ *  \ingroup pico_pwm_player
+ *
+ * The counters of all the player's slices are reset, and the slices are enabled together.
+ *
+ * \param player the player
+ */
+void pwm_player_start(pwm_player_t *player);
+
+/*! \brief Stop a PWM player, and disable its slices
+ *  \ingroup pico_pwm_player
+ *
+ * \param player the player
+ */
+void pwm_player_stop(pwm_player_t *player);
+
+/*! \brief Release the DMA channels used by a (stopped) PWM player
+ *  \ingroup pico_pwm_player
+ *
+ * \param player the player
+ */
+void pwm_player_deinit(pwm_player_t *player);
+
+/*! \brief Check whether a one shot PWM player is still playing
+ *  \ingroup pico_pwm_player
+ *
+ * \param player the player
+ * \return true if any slice has not yet played its whole buffer (always true for other modes until stopped)
+ */
+bool pwm_player_is_busy(pwm_player_t *player);
+
+/*! \brief Get a slice's buffer, or half of it
+ *  \ingroup pico_pwm_player
+ *
+ * \param player the player
+ * \param slice_index the index of the slice in the player's configuration
+ * \param half in stream mode, the half (0 or 1) of the buffer; otherwise 0
+ * \return the start of the buffer or half buffer
+ */
+static inline void *pwm_player_get_buffer(pwm_player_t *player, uint slice_index, uint half) {
+    uint sample_size = player->config.two_channel ? 4 : 2;
+    return (uint8_t *)player->config.buffers[slice_index] + half * (player->config.samples / 2) * sample_size;
+}
+
+/*! \brief Sigma-delta dithering state, for one channel
+ *  \ingroup pico_pwm_player
+ */
+typedef struct {
+    uint32_t error;
+} pwm_player_dither_t;
+
+/*! \brief Convert 16 bit samples to PWM levels, with first order sigma-delta dithering
+ *  \ingroup pico_pwm_player
+ *
+ * Samples from 0 to 65535 are scaled to levels from 0 to wrap + 1 (i.e. 0% to 100% duty).
+ *
+ * \param dither the dithering state for the channel, which should start zeroed
+ * \param src the samples
+ * \param dst the levels; may be the same as src
+ * \param count the number of samples
+ * \param wrap the wrap value of the PWM slice, which must be less than 65535
+ */
+void pwm_player_dither(pwm_player_dither_t *dither, const uint16_t *src, uint16_t *dst, uint count, uint16_t wrap);
+
+/*! \brief Convert interleaved pairs of 16 bit samples to two channel PWM samples, with first order sigma-delta
+ * dithering
+ *  \ingroup pico_pwm_player
+ *
+ * \param dither the dithering state for channels A and B, which should start zeroed
+ * \param src the samples, channel A first
+ * \param dst the two channel samples
+ * \param count the number of pairs of samples
+ * \param wrap the wrap value of the PWM slice, which must be less than 65535
+ */
+void pwm_player_dither_two_channel(pwm_player_dither_t dither[2], const uint16_t *src, uint32_t *dst, uint count,
+                                   uint16_t wrap);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
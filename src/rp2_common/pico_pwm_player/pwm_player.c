@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pico/pwm_player.h"
+#include "hardware/irq.h"
+
+// PICO_CONFIG: PICO_PWM_PLAYER_DMA_IRQ_INDEX, The DMA IRQ (0 for DMA_IRQ_0 or 1 for DMA_IRQ_1) used by pico_pwm_player, type=int, default=0, min=0, max=1, group=pico_pwm_player
+#ifndef PICO_PWM_PLAYER_DMA_IRQ_INDEX
+#define PICO_PWM_PLAYER_DMA_IRQ_INDEX 0
+#endif
+
+// streaming players, which need the IRQ
+static pwm_player_t *streaming_players;
+
+static void __isr __not_in_flash_func(pwm_player_dma_irq_handler)(void) {
+    for (pwm_player_t *player = streaming_players; player; player = player->next) {
+        // all the slices run in step, so the first slice's channel signals for all of them
+        uint channel = player->lists[0].data_channel;
+        if (!dma_irqn_get_channel_status(PICO_PWM_PLAYER_DMA_IRQ_INDEX, channel)) continue;
+        dma_irqn_acknowledge_channel(PICO_PWM_PLAYER_DMA_IRQ_INDEX, channel);
+        uint half = player->halves_played & 1;
+        player->halves_played++;
+        player->config.refill(player, half);
+        // if the other half has also finished, the DMA has already started on this one again
+        if (dma_irqn_get_channel_status(PICO_PWM_PLAYER_DMA_IRQ_INDEX, channel)) player->late_refills++;
+    }
+}
+
+void pwm_player_init(pwm_player_t *player, const pwm_player_config_t *config) {
+    invalid_params_if(PWM_PLAYER, !config->slice_count || config->slice_count > PICO_PWM_PLAYER_MAX_SLICES);
+    invalid_params_if(PWM_PLAYER, !config->samples);
+    invalid_params_if(PWM_PLAYER, config->mode == PWM_PLAYER_STREAM && ((config->samples & 1) || !config->refill));
+    player->config = *config;
+    player->slice_mask = 0;
+    player->halves_played = 0;
+    player->late_refills = 0;
+    bool stream = config->mode == PWM_PLAYER_STREAM;
+    for (uint i = 0; i < config->slice_count; i++) {
+        uint slice = config->slices[i];
+        check_slice_num_param(slice);
+        player->slice_mask |= 1u << slice;
+        dma_desc_list_t *list = &player->lists[i];
+        uint data_channel = (uint)dma_claim_unused_channel(true);
+        uint control_channel = (uint)dma_claim_unused_channel(true);
+        dma_desc_list_init(list, player->descs[i], count_of(player->descs[i]), data_channel, control_channel);
+
+        dma_channel_config c = dma_desc_list_get_default_config(list);
+        channel_config_set_transfer_data_size(&c, config->two_channel ? DMA_SIZE_32 : DMA_SIZE_16);
+        channel_config_set_read_increment(&c, true);
+        channel_config_set_write_increment(&c, false);
+        channel_config_set_dreq(&c, pwm_get_dreq(slice));
+        // a 16 bit write to a peripheral register is replicated across both halves, so sets both channels' levels
+        volatile void *cc = &pwm_hw->slice[slice].cc;
+        if (stream) {
+            uint half_samples = config->samples / 2;
+            dma_desc_list_add(list, &c, cc, pwm_player_get_buffer(player, i, 0), half_samples, !i);
+            dma_desc_list_add(list, &c, cc, pwm_player_get_buffer(player, i, 1), half_samples, !i);
+        } else {
+            dma_desc_list_add(list, &c, cc, config->buffers[i], config->samples, false);
+        }
+    }
+    if (stream) {
+        uint channel = player->lists[0].data_channel;
+        dma_irqn_acknowledge_channel(PICO_PWM_PLAYER_DMA_IRQ_INDEX, channel);
+        dma_irqn_set_channel_enabled(PICO_PWM_PLAYER_DMA_IRQ_INDEX, channel, true);
+        if (!streaming_players) {
+            irq_add_shared_handler(DMA_IRQ_0 + PICO_PWM_PLAYER_DMA_IRQ_INDEX, pwm_player_dma_irq_handler,
+                                   PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+            irq_set_enabled(DMA_IRQ_0 + PICO_PWM_PLAYER_DMA_IRQ_INDEX, true);
+        }
+        player->next = streaming_players;
+        streaming_players = player;
+    }
+}
+
+void pwm_player_start(pwm_player_t *player) {
+    player->halves_played = 0;
+    player->late_refills = 0;
+    for (uint i = 0; i < player->config.slice_count; i++) {
+        pwm_set_counter(player->config.slices[i], 0);
+        // each channel waits for the first DREQ from its slice
+        dma_desc_list_start(&player->lists[i], player->config.mode != PWM_PLAYER_ONE_SHOT);
+    }
+    pwm_set_mask_enabled(pwm_hw->en | player->slice_mask);
+}
+
+void pwm_player_stop(pwm_player_t *player) {
+    pwm_set_mask_enabled(pwm_hw->en & ~player->slice_mask);
+    for (uint i = 0; i < player->config.slice_count; i++) {
+        dma_desc_list_abort(&player->lists[i]);
+    }
+    if (player->config.mode == PWM_PLAYER_STREAM) {
+        // aborting may raise a spurious interrupt
+        dma_irqn_acknowledge_channel(PICO_PWM_PLAYER_DMA_IRQ_INDEX, player->lists[0].data_channel);
+    }
+}
+
+void pwm_player_deinit(pwm_player_t *player) {
+    if (player->config.mode == PWM_PLAYER_STREAM) {
+        dma_irqn_set_channel_enabled(PICO_PWM_PLAYER_DMA_IRQ_INDEX, player->lists[0].data_channel, false);
+        pwm_player_t **prev = &streaming_players;
+        while (*prev != player) prev = &(*prev)->next;
+        *prev = player->next;
+        if (!streaming_players) {
+            irq_remove_handler(DMA_IRQ_0 + PICO_PWM_PLAYER_DMA_IRQ_INDEX, pwm_player_dma_irq_handler);
+        }
+    }
+    for (uint i = 0; i < player->config.slice_count; i++) {
+        dma_channel_unclaim(player->lists[i].data_channel);
+        dma_channel_unclaim(player->lists[i].control_channel);
+    }
+}
+
+bool pwm_player_is_busy(pwm_player_t *player) {
+    for (uint i = 0; i < player->config.slice_count; i++) {
+        if (dma_desc_list_is_busy(&player->lists[i])) return true;
+    }
+    return false;
+}
+
+// each sample's rounding error (in 1/65536ths of a level) is carried into the next sample
+void pwm_player_dither(pwm_player_dither_t *dither, const uint16_t *src, uint16_t *dst, uint count, uint16_t wrap) {
+    invalid_params_if(PWM_PLAYER, wrap == 0xffff);
+    uint32_t scale = wrap + 1u;
+    uint32_t error = dither->error;
+    for (uint i = 0; i < count; i++) {
+        uint32_t value = src[i] * scale + error;
+        dst[i] = (uint16_t)(value >> 16);
+        error = value & 0xffffu;
+    }
+    dither->error = error;
+}
+
+void pwm_player_dither_two_channel(pwm_player_dither_t dither[2], const uint16_t *src, uint32_t *dst, uint count,
+                                   uint16_t wrap) {
+    invalid_params_if(PWM_PLAYER, wrap == 0xffff);
+    uint32_t scale = wrap + 1u;
+    uint32_t error_a = dither[0].error;
+    uint32_t error_b = dither[1].error;
+    for (uint i = 0; i < count; i++) {
+        uint32_t a = src[2 * i] * scale + error_a;
+        uint32_t b = src[2 * i + 1] * scale + error_b;
+        dst[i] = (a >> 16) | (b & 0xffff0000u);
+        error_a = a & 0xffffu;
+        error_b = b & 0xffffu;
+    }
+    dither[0].error = error_a;
+    dither[1].error = error_b;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pico/rand.h"
+#include "pico/time.h"
+#include "hardware/structs/rosc.h"
+#include "hardware/sync.h"
+
+// PICO_CONFIG: PICO_RAND_HARVEST_INTERVAL_US, Interval in microseconds between background harvests of ROSC entropy (0 to disable background harvesting), type=int, default=10000, group=pico_rand
+#ifndef PICO_RAND_HARVEST_INTERVAL_US
+#define PICO_RAND_HARVEST_INTERVAL_US 10000
+#endif
+
+// PICO_CONFIG: PICO_RAND_HARVEST_SAMPLES, Number of ROSC random bit samples taken by each background harvest, type=int, default=8, min=1, max=32, group=pico_rand
+#ifndef PICO_RAND_HARVEST_SAMPLES
+#define PICO_RAND_HARVEST_SAMPLES 8
+#endif
+
+// samples not yet credited as a whole bit of entropy
+static uint uncredited_samples;
+
+static uint32_t rosc_sample(uint count) {
+    uint32_t bits = 0;
+    for (uint i = 0; i < count; i++) {
+        bits = (bits << 1) | (rosc_hw->randombit & 1u);
+        // successive samples of the random bit are correlated if taken too close together
+        busy_wait_at_least_cycles(30);
+    }
+    return bits;
+}
+
+static void harvest(uint samples) {
+    uint32_t data[2];
+    data[0] = rosc_sample(samples);
+    // the time also picks up the jitter of whatever ran before
+    data[1] = time_us_32();
+    uncredited_samples += samples;
+    uint bits = uncredited_samples / PICO_RAND_ROSC_SAMPLES_PER_BIT;
+    uncredited_samples -= bits * PICO_RAND_ROSC_SAMPLES_PER_BIT;
+    pico_rand_add_entropy(data, sizeof(data), bits);
+}
+
+#if PICO_RAND_HARVEST_INTERVAL_US && !PICO_TIME_DEFAULT_ALARM_POOL_DISABLED
+#define HARVEST_IN_BACKGROUND 1
+// protects harvesting, which is true while the harvest alarm is pending
+static spin_lock_t *harvest_lock;
+static bool harvesting;
+
+static int64_t harvest_alarm_callback(__unused alarm_id_t id, __unused void *user_data) {
+    // the ROSC may have been stopped to save power
+    if (rosc_hw->status & ROSC_STATUS_ENABLED_BITS) harvest(PICO_RAND_HARVEST_SAMPLES);
+    uint32_t save = spin_lock_blocking(harvest_lock);
+    // stop while the pool is full; drawing on it starts the alarm again
+    bool full = pico_rand_pool_is_full();
+    if (full) harvesting = false;
+    spin_unlock(harvest_lock, save);
+    return full ? 0 : PICO_RAND_HARVEST_INTERVAL_US;
+}
+
+static void start_harvesting(void) {
+    uint32_t save = spin_lock_blocking(harvest_lock);
+    bool start = !harvesting;
+    harvesting = true;
+    spin_unlock(harvest_lock, save);
+    if (start) add_alarm_in_us(PICO_RAND_HARVEST_INTERVAL_US, harvest_alarm_callback, NULL, true);
+}
+#endif
+
+void pico_rand_backend_entropy_drawn(void) {
+#if HARVEST_IN_BACKGROUND
+    // the lock is claimed in pico_rand_backend_init, which seeds the pool before anything can draw on it
+    if (harvest_lock) start_harvesting();
+#endif
+}
+
+void pico_rand_backend_init(void) {
+    if (!(rosc_hw->status & ROSC_STATUS_ENABLED_BITS)) panic("pico_rand needs the ROSC running");
+    // seed the pool all in one go; this takes well under a millisecond
+    uint32_t seeded_samples = 0;
+    while (seeded_samples < PICO_RAND_SEED_ENTROPY_BITS * PICO_RAND_ROSC_SAMPLES_PER_BIT) {
+        harvest(32);
+        seeded_samples += 32;
+    }
+#if HARVEST_IN_BACKGROUND
+    harvest_lock = spin_lock_instance(next_striped_spin_lock_num());
+    // the pool is already full, so harvesting starts once it is first drawn on
+#endif
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICO_SPI_QUEUE_H
+#define _PICO_SPI_QUEUE_H
+
+#include "pico.h"
+#include "hardware/spi.h"
+#include "hardware/sync.h"
+
+/** \file pico/spi_queue.h
+ *  \defgroup pico_spi_queue pico_spi_queue
+ * Asynchronous DMA driven SPI master with a transaction queue
+ *
+ * Transactions are submitted to a queue, and are run one after another by a pair of DMA channels (TX and RX, paced by
+ * the SPI DREQs), with the CPU only involved (in the DMA IRQ handler) at the start and end of each phase of a
+ * transaction. A completion callback may be called for each transaction, or the caller can poll or wait for it.
+ *
+ * Each transaction:
+ * - asserts (drives low) its own chip select GPIO for its duration, if it has one
+ * - optionally sets a new baud rate, and sets its own data size and clock polarity and phase
+ * - optionally sends a command (8 or 16 bits), address (up to 4 bytes) and dummy bytes, as 8 bit frames, discarding
+ *   the data received during them
+ * - transfers its data from a TX buffer (or repeats a fill value), into an RX buffer (or discards it)
+ *
+ * Transactions are owned by the caller, and must not be modified or reused until they are done. The SPI instance must
+ * already have been initialized with spi_init() and its pins set up, and chip select GPIOs initialized as outputs and
+ * driven high.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// PICO_CONFIG: PARAM_ASSERTIONS_ENABLED_SPI_QUEUE, Enable/disable assertions in the SPI queue module, type=bool, default=0, group=pico_spi_queue
+#ifndef PARAM_ASSERTIONS_ENABLED_SPI_QUEUE
+#define PARAM_ASSERTIONS_ENABLED_SPI_QUEUE 0
+#endif
+
+typedef struct spi_transaction spi_transaction_t;
+
+/*! \brief Callback for completion of a transaction
+ *  \ingroup pico_spi_queue
+ *
+ * This is called from the DMA IRQ handler, and may submit further transactions, including this one again (in which case it is
+ * not marked done). The transaction is only marked done once the callback has returned.
+ */
+typedef void (*spi_transaction_callback_t)(spi_transaction_t *transaction);
+
+/*! \brief An SPI transaction
+ *  \ingroup pico_spi_queue
+ *
+ * Fields not needed may be left zero (apart from cs_pin which is -1 for none), e.g.
+ * \code
+ * spi_transaction_t t = {
+ *     .cs_pin = PIN_CS,
+ *     .data_bits = 8,
+ *     .command = 0x03, .command_bits = 8, // read
+ *     .address = 0x1000, .address_bytes = 3,
+ *     .rx_buf = buffer,
+ *     .len = sizeof(buffer),
+ * };
+ * \endcode
+ */
+struct spi_transaction {
+    int cs_pin;                 ///< GPIO driven low during the transaction, or -1 for none
+    uint baudrate;              ///< baud rate to switch to before the transaction, or 0 to leave it unchanged
+    uint8_t data_bits;          ///< bits per data frame (4 to 16); frames of more than 8 bits are in uint16_t buffers
+    spi_cpol_t cpol;            ///< clock polarity
+    spi_cpha_t cpha;            ///< clock phase
+    uint8_t command_bits;       ///< 0, 8 or 16
+    uint8_t address_bytes;      ///< 0 to 4
+    uint8_t dummy_bytes;        ///< 0 to 4 zero bytes sent after the address
+    uint16_t command;           ///< command, sent most significant byte first
+    uint32_t address;           ///< address, sent most significant byte first
+    const void *tx_buf;         ///< data to send, or NULL to send tx_fill repeatedly
+    void *rx_buf;               ///< buffer for received data, or NULL to discard it
+    size_t len;                 ///< number of data frames
+    uint16_t tx_fill;           ///< the frame to send when tx_buf is NULL
+    spi_transaction_callback_t callback; ///< called on completion, or NULL
+    void *user_data;            ///< for the use of the caller
+
+    // \cond internal
+    spi_transaction_t *next;
+    uint8_t header[10];
+    uint8_t header_len;
+    volatile bool done;
+    // \endcond
+};
+
+/*! \brief An SPI transaction queue, for one SPI instance
+ *  \ingroup pico_spi_queue
+ */
+typedef struct {
+    spi_inst_t *spi;
+    spin_lock_t *lock;
+    spi_transaction_t *head;    // the transaction in progress
+    spi_transaction_t *tail;
+    uint8_t tx_channel;
+    uint8_t rx_channel;
+    uint8_t phase;
+    bool busy;                  // a phase is in progress on the DMA
+    uint32_t discard;           // destination for discarded received data
+    uint32_t transactions;      // number of transactions completed
+} spi_queue_t;
+
+/*! \brief Initialize an SPI transaction queue
+ *  \ingroup pico_spi_queue
+ *
+ * Two DMA channels are claimed. Only one queue may be used per SPI instance, and the SPI instance must not be used
+ * by anything else (e.g. the blocking functions) while transactions are queued.
+ *
+ * \param queue the queue
+ * \param spi the (initialized) SPI instance
+ */
+void spi_queue_init(spi_queue_t *queue, spi_inst_t *spi);
+
+/*! \brief Release the DMA channels used by an idle SPI transaction queue
+ *  \ingroup pico_spi_queue
+ *
+ * \param queue the queue
+ */
+void spi_queue_deinit(spi_queue_t *queue);
+
+/*! \brief Add a transaction to the end of the queue, starting it if the queue is idle
+ *  \ingroup pico_spi_queue
+ *
+ * \param queue the queue
+ * \param transaction the transaction, which must remain valid and unmodified until it is done
+ */
+void spi_queue_submit(spi_queue_t *queue, spi_transaction_t *transaction);
+
+/*! \brief Check whether a transaction has completed
+ *  \ingroup pico_spi_queue
+ *
+ * \param transaction the (submitted) transaction
+ * \return true if the transaction has completed (and its callback returned)
+ */
+static inline bool spi_transaction_is_done(const spi_transaction_t *transaction) {
+    return transaction->done;
+}
+
+/*! \brief Wait for a transaction to complete
+ *  \ingroup pico_spi_queue
+ *
+ * \param transaction the (submitted) transaction
+ */
+static inline void spi_transaction_wait_blocking(const spi_transaction_t *transaction) {
+    while (!transaction->done) tight_loop_contents();
+    // stop the compiler hoisting a non volatile buffer access above the completion
+    __compiler_memory_barrier();
+}
+
+/*! \brief Check whether an SPI transaction queue has finished all its transactions
+ *  \ingroup pico_spi_queue
+ *
+ * \param queue the queue
+ * \return true if there are no transactions queued or in progress
+ */
+static inline bool spi_queue_is_idle(const spi_queue_t *queue) {
+    return !*(spi_transaction_t *const volatile *)&queue->head;
+}
+
+/*! \brief Wait for an SPI transaction queue to finish all its transactions
+ *  \ingroup pico_spi_queue
+ *
+ * \param queue the queue
+ */
+static inline void spi_queue_wait_for_idle_blocking(const spi_queue_t *queue) {
+    while (!spi_queue_is_idle(queue)) tight_loop_contents();
+    __compiler_memory_barrier();
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pico/spi_queue.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+
+// PICO_CONFIG: PICO_SPI_QUEUE_DMA_IRQ_INDEX, The DMA IRQ (0 for DMA_IRQ_0 or 1 for DMA_IRQ_1) used by pico_spi_queue, type=int, default=0, min=0, max=1, group=pico_spi_queue
+#ifndef PICO_SPI_QUEUE_DMA_IRQ_INDEX
+#define PICO_SPI_QUEUE_DMA_IRQ_INDEX 0
+#endif
+
+enum {
+    PHASE_HEADER,
+    PHASE_DATA,
+};
+
+static spi_queue_t *queues[NUM_SPIS];
+static uint queue_count;
+
+static void start_dma(spi_queue_t *queue, const volatile void *tx, bool tx_increment, volatile void *rx,
+                      bool rx_increment, size_t count, enum dma_channel_transfer_size size) {
+    spi_hw_t *hw = spi_get_hw(queue->spi);
+    dma_channel_config c = dma_channel_get_default_config(queue->rx_channel);
+    channel_config_set_transfer_data_size(&c, size);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, rx_increment);
+    channel_config_set_dreq(&c, spi_get_dreq(queue->spi, false));
+    dma_channel_configure(queue->rx_channel, &c, rx, &hw->dr, count, false);
+
+    c = dma_channel_get_default_config(queue->tx_channel);
+    channel_config_set_transfer_data_size(&c, size);
+    channel_config_set_read_increment(&c, tx_increment);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, spi_get_dreq(queue->spi, true));
+    dma_channel_configure(queue->tx_channel, &c, &hw->dr, tx, count, false);
+
+    queue->busy = true;
+    dma_start_channel_mask((1u << queue->rx_channel) | (1u << queue->tx_channel));
+}
+
+// start the next phase of the transaction in progress; returns false if the transaction is complete
+static bool start_phase(spi_queue_t *queue) {
+    spi_transaction_t *t = queue->head;
+    if (queue->phase == PHASE_HEADER) {
+        queue->phase = PHASE_DATA;
+        if (t->header_len) {
+            spi_set_format(queue->spi, 8, t->cpol, t->cpha, SPI_MSB_FIRST);
+            start_dma(queue, t->header, true, &queue->discard, false, t->header_len, DMA_SIZE_8);
+            return true;
+        }
+    }
+    if (queue->phase == PHASE_DATA) {
+        // the data phase is the last
+        queue->phase++;
+        if (t->len) {
+            // the SPI is idle here, so can be reconfigured
+            spi_set_format(queue->spi, t->data_bits, t->cpol, t->cpha, SPI_MSB_FIRST);
+            start_dma(queue, t->tx_buf ? t->tx_buf : &t->tx_fill, t->tx_buf != NULL,
+                      t->rx_buf ? t->rx_buf : &queue->discard, t->rx_buf != NULL, t->len,
+                      t->data_bits > 8 ? DMA_SIZE_16 : DMA_SIZE_8);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void start_transaction(spi_queue_t *queue) {
+    spi_transaction_t *t = queue->head;
+    if (t->baudrate) spi_set_baudrate(queue->spi, t->baudrate);
+    if (t->cs_pin >= 0) gpio_put((uint)t->cs_pin, false);
+    queue->phase = PHASE_HEADER;
+}
+
+// called with the queue's lock held; returns with it released
+static void run_queue(spi_queue_t *queue, uint32_t save) {
+    // a transaction submitted to the idle queue from a callback may already have been started
+    while (queue->head && !queue->busy && !start_phase(queue)) {
+        spi_transaction_t *t = queue->head;
+        if (t->cs_pin >= 0) gpio_put((uint)t->cs_pin, true);
+        queue->head = t->next;
+        if (!queue->head) queue->tail = NULL;
+        queue->transactions++;
+        if (queue->head) start_transaction(queue);
+        // the callback may submit more transactions
+        spin_unlock(queue->lock, save);
+        // the transaction is only done once its callback has returned, unless the callback submitted it again (which
+        // sets next); a self link marks it as completing meanwhile
+        t->next = t;
+        __compiler_memory_barrier();
+        if (t->callback) t->callback(t);
+        __compiler_memory_barrier();
+        if (t->next == t) {
+            t->next = NULL;
+            t->done = true;
+        }
+        save = spin_lock_blocking(queue->lock);
+    }
+    spin_unlock(queue->lock, save);
+}
+
+static void __isr __not_in_flash_func(spi_queue_dma_irq_handler)(void) {
+    for (uint i = 0; i < NUM_SPIS; i++) {
+        spi_queue_t *queue = queues[i];
+        // the RX channel finishes last; when it does, every frame has been clocked out and in
+        if (!queue || !dma_irqn_get_channel_status(PICO_SPI_QUEUE_DMA_IRQ_INDEX, queue->rx_channel)) continue;
+        dma_irqn_acknowledge_channel(PICO_SPI_QUEUE_DMA_IRQ_INDEX, queue->rx_channel);
+        uint32_t save = spin_lock_blocking(queue->lock);
+        queue->busy = false;
+        run_queue(queue, save);
+    }
+}
+
+void spi_queue_init(spi_queue_t *queue, spi_inst_t *spi) {
+    uint index = spi_get_index(spi);
+    assert(!queues[index]);
+    queue->spi = spi;
+    queue->lock = spin_lock_instance(next_striped_spin_lock_num());
+    queue->head = queue->tail = NULL;
+    queue->busy = false;
+    queue->transactions = 0;
+    queue->tx_channel = (uint8_t)dma_claim_unused_channel(true);
+    queue->rx_channel = (uint8_t)dma_claim_unused_channel(true);
+    queues[index] = queue;
+    dma_irqn_set_channel_enabled(PICO_SPI_QUEUE_DMA_IRQ_INDEX, queue->rx_channel, true);
+    if (!queue_count++) {
+        irq_add_shared_handler(DMA_IRQ_0 + PICO_SPI_QUEUE_DMA_IRQ_INDEX, spi_queue_dma_irq_handler,
+                               PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_0 + PICO_SPI_QUEUE_DMA_IRQ_INDEX, true);
+    }
+}
+
+void spi_queue_deinit(spi_queue_t *queue) {
+    assert(spi_queue_is_idle(queue));
+    dma_irqn_set_channel_enabled(PICO_SPI_QUEUE_DMA_IRQ_INDEX, queue->rx_channel, false);
+    if (!--queue_count) {
+        irq_remove_handler(DMA_IRQ_0 + PICO_SPI_QUEUE_DMA_IRQ_INDEX, spi_queue_dma_irq_handler);
+    }
+    queues[spi_get_index(queue->spi)] = NULL;
+    dma_channel_unclaim(queue->tx_channel);
+    dma_channel_unclaim(queue->rx_channel);
+}
+
+void spi_queue_submit(spi_queue_t *queue, spi_transaction_t *t) {
+    invalid_params_if(SPI_QUEUE, t->data_bits < 4 || t->data_bits > 16);
+    invalid_params_if(SPI_QUEUE, t->command_bits != 0 && t->command_bits != 8 && t->command_bits != 16);
+    invalid_params_if(SPI_QUEUE, t->address_bytes > 4 || t->dummy_bytes > 4);
+    uint n = 0;
+    for (int shift = t->command_bits - 8; shift >= 0; shift -= 8) t->header[n++] = (uint8_t)(t->command >> shift);
+    for (int shift = t->address_bytes * 8 - 8; shift >= 0; shift -= 8) t->header[n++] = (uint8_t)(t->address >> shift);
+    for (uint i = 0; i < t->dummy_bytes; i++) t->header[n++] = 0;
+    t->header_len = (uint8_t)n;
+    t->next = NULL;
+    t->done = false;
+
+    uint32_t save = spin_lock_blocking(queue->lock);
+    if (queue->tail) {
+        queue->tail->next = t;
+        queue->tail = t;
+        spin_unlock(queue->lock, save);
+    } else {
+        queue->head = queue->tail = t;
+        start_transaction(queue);
+        run_queue(queue, save);
+    }
+}
@@ -7,6 +7,7 @@
 #include "pico/stdlib.h"
 #include "hardware/pll.h"
 #include "hardware/clocks.h"
+#include "pico/pll_solver.h"
 #if LIB_PICO_STDIO_UART
 #include "pico/stdio_uart.h"
 #else
@@ -70,23 +71,12 @@ void set_sys_clock_pll(uint32_t vco_freq, uint post_div1, uint post_div2) {
 }
 
 bool check_sys_clock_khz(uint32_t freq_khz, uint *vco_out, uint *postdiv1_out, uint *postdiv_out) {
-    uint crystal_freq_khz = clock_get_hz(clk_ref) / 1000;
-    for (uint fbdiv = 320; fbdiv >= 16; fbdiv--) {
-        uint vco = fbdiv * crystal_freq_khz;
-        if (vco < PICO_PLL_VCO_MIN_FREQ_MHZ * 1000  || vco > PICO_PLL_VCO_MAX_FREQ_MHZ * 1000) continue;
-        for (uint postdiv1 = 7; postdiv1 >= 1; postdiv1--) {
-            for (uint postdiv2 = postdiv1; postdiv2 >= 1; postdiv2--) {
-                uint out = vco / (postdiv1 * postdiv2);
-                if (out == freq_khz && !(vco % (postdiv1 * postdiv2))) {
-                    *vco_out = vco * 1000;
-                    *postdiv1_out = postdiv1;
-                    *postdiv_out = postdiv2;
-                    return true;
-                }
-            }
-        }
-    }
-    return false;
+    pll_solution_t solution;
+    if (!pll_solve_khz(clock_get_hz(clk_ref) / 1000, freq_khz, &solution) || !solution.exact) return false;
+    *vco_out = solution.vco_khz * 1000;
+    *postdiv1_out = solution.postdiv1;
+    *postdiv_out = solution.postdiv2;
+    return true;
 }
 
 void setup_default_uart() {
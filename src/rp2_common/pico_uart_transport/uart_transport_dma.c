@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pico/uart_transport.h"
+#include "pico/time.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+// PICO_CONFIG: PICO_UART_TRANSPORT_DMA_IRQ_INDEX, The DMA IRQ (0 for DMA_IRQ_0 or 1 for DMA_IRQ_1) used by pico_uart_transport, type=int, default=0, min=0, max=1, group=pico_uart_transport
+#ifndef PICO_UART_TRANSPORT_DMA_IRQ_INDEX
+#define PICO_UART_TRANSPORT_DMA_IRQ_INDEX 0
+#endif
+
+// PICO_CONFIG: PICO_UART_TRANSPORT_RX_IDLE_CHARS, Number of character times without a byte received after which the RX DMA is stopped and the data so far delivered, type=int, default=8, min=1, group=pico_uart_transport
+#ifndef PICO_UART_TRANSPORT_RX_IDLE_CHARS
+#define PICO_UART_TRANSPORT_RX_IDLE_CHARS 8
+#endif
+
+#define UART_ERROR_INTERRUPTS (UART_UARTIMSC_OEIM_BITS | UART_UARTIMSC_BEIM_BITS | UART_UARTIMSC_PEIM_BITS | \
+                               UART_UARTIMSC_FEIM_BITS)
+
+// the transport using each DMA channel, and each UART, for the IRQ handlers
+static uart_transport_t *channel_transports[NUM_DMA_CHANNELS];
+static uart_transport_t *uart_transports[NUM_UARTS];
+static uint transport_count;
+
+static inline uint32_t rx_half_size(const uart_transport_t *transport) {
+    return transport->config.rx_ring_size / 2;
+}
+
+// the (free running) RX ring position which the DMA has reached; called with the lock held
+static uint32_t rx_dma_pos(const uart_transport_t *transport) {
+    // a channel which has completed reads a count of zero until it is triggered again
+    uint channel = transport->rx_channel[transport->rx_active];
+    return transport->rx_dma_pos + rx_half_size(transport) - dma_channel_hw_addr(channel)->transfer_count;
+}
+
+// start the RX channels from the start of the ring; channel n always fills half n
+static void rx_start(uart_transport_t *transport) {
+    uint32_t half = rx_half_size(transport);
+    for (uint which = 0; which < 2; which++) {
+        uint channel = transport->rx_channel[which];
+        dma_channel_set_chain_to(channel, transport->rx_channel[which ^ 1]);
+        dma_channel_set_write_addr(channel, transport->config.rx_ring + which * half, false);
+        dma_channel_set_trans_count(channel, half, false);
+    }
+    transport->rx_active = 0;
+    dma_channel_start(transport->rx_channel[0]);
+}
+
+static void rx_stop(uart_transport_t *transport) {
+    for (uint which = 0; which < 2; which++) {
+        // stop the channels triggering each other while they are aborted
+        dma_channel_set_chain_to(transport->rx_channel[which], transport->rx_channel[which]);
+    }
+    for (uint which = 0; which < 2; which++) {
+        dma_channel_abort(transport->rx_channel[which]);
+        dma_irqn_acknowledge_channel(PICO_UART_TRANSPORT_DMA_IRQ_INDEX, transport->rx_channel[which]);
+    }
+}
+
+// handle the completion of RX halves, and decode everything received; called with the lock held
+static uint rx_handle_dma(uart_transport_t *transport) {
+    uint32_t half = rx_half_size(transport);
+    for (;;) {
+        uint which = transport->rx_active;
+        uint channel = transport->rx_channel[which];
+        if (!dma_irqn_get_channel_status(PICO_UART_TRANSPORT_DMA_IRQ_INDEX, channel)) break;
+        dma_irqn_acknowledge_channel(PICO_UART_TRANSPORT_DMA_IRQ_INDEX, channel);
+        // re-arm the channel for its half, before the other channel finishes and chains to it
+        dma_channel_set_write_addr(channel, transport->config.rx_ring + which * half, false);
+        transport->rx_dma_pos += half;
+        transport->rx_active = (uint8_t)(which ^ 1);
+        if (dma_irqn_get_channel_status(PICO_UART_TRANSPORT_DMA_IRQ_INDEX, transport->rx_channel[which ^ 1])) {
+            // the other half has been filled too, so this channel may have been chained to before being re-armed,
+            // and the ring has been overwritten; start again from the beginning of the ring
+            rx_stop(transport);
+            uint32_t size = transport->config.rx_ring_size;
+            transport->rx_dma_pos = (transport->rx_dma_pos + size) & ~(size - 1);
+            transport->rx_pos = transport->rx_dma_pos;
+            transport->stats.ring_overruns++;
+            uart_transport_rx_lost(transport);
+            rx_start(transport);
+            return 0;
+        }
+    }
+    return uart_transport_rx_ring(transport, rx_dma_pos(transport));
+}
+
+static int64_t rx_idle_alarm_callback(alarm_id_t id, void *user_data);
+
+// switch from the RX FIFO interrupts to the DMA at the start of a burst, with an alarm to notice when the line goes
+// idle again; called with the lock held
+static bool rx_dma_resume(uart_transport_t *transport) {
+    // (not fire_if_past, which would run the callback here, with the lock held)
+    alarm_id_t id = add_alarm_in_us(transport->rx_idle_us, rx_idle_alarm_callback, transport, false);
+    if (id <= 0) return false;
+    uart_hw_t *hw = uart_get_hw(transport->config.uart);
+    transport->rx_idle_alarm = id;
+    transport->rx_idle_pos = rx_dma_pos(transport);
+    hw_clear_bits(&hw->imsc, UART_UARTIMSC_RXIM_BITS);
+    hw_set_bits(&hw->dmacr, UART_UARTDMACR_RXDMAE_BITS);
+    return true;
+}
+
+// The RX DREQ is asserted for every byte in the FIFO, so while the DMA is running nothing is left in the FIFO for the
+// receive timeout, and a frame which doesn't complete a half of the ring would sit there until more data arrives.
+// Instead this alarm delivers what the DMA has written so far, and once nothing more has arrived since the last time,
+// stops the DMA and goes back to the RX FIFO interrupts
+static int64_t rx_idle_alarm_callback(alarm_id_t id, void *user_data) {
+    uart_transport_t *transport = (uart_transport_t *)user_data;
+    uart_hw_t *hw = uart_get_hw(transport->config.uart);
+    int64_t reschedule_us = 0;
+    uint delivered = 0;
+    uint32_t save = spin_lock_blocking(transport->lock);
+    // (the alarm may have been cancelled by uart_transport_deinit after it fired)
+    if (transport->rx_idle_alarm == id) {
+        delivered = rx_handle_dma(transport);
+        uint32_t pos = rx_dma_pos(transport);
+        if (pos != transport->rx_idle_pos) {
+            transport->rx_idle_pos = pos;
+            reschedule_us = transport->rx_idle_us;
+        } else {
+            // bytes arriving from now on wait in the FIFO for the RX interrupts
+            hw_clear_bits(&hw->dmacr, UART_UARTDMACR_RXDMAE_BITS);
+            delivered += rx_handle_dma(transport);
+            transport->rx_idle_alarm = 0;
+            hw_set_bits(&hw->imsc, UART_UARTIMSC_RXIM_BITS);
+        }
+    }
+    spin_unlock(transport->lock, save);
+    uart_transport_notify(transport, delivered);
+    return reschedule_us;
+}
+
+void uart_transport_backend_start_tx(uart_transport_t *transport) {
+    if (transport->tx_busy) return;
+    uint32_t count = transport->tx_head - transport->tx_tail;
+    if (!count) return;
+    uint32_t size = transport->config.tx_ring_size;
+    uint32_t index = transport->tx_tail & (size - 1);
+    count = MIN(count, size - index);
+    transport->tx_dma_count = count;
+    transport->tx_busy = true;
+    dma_channel_transfer_from_buffer_now(transport->tx_channel, transport->config.tx_ring + index, count);
+}
+
+// called with the lock held
+static void tx_handle_dma(uart_transport_t *transport) {
+    uint channel = transport->tx_channel;
+    if (!transport->tx_busy || !dma_irqn_get_channel_status(PICO_UART_TRANSPORT_DMA_IRQ_INDEX, channel)) return;
+    dma_irqn_acknowledge_channel(PICO_UART_TRANSPORT_DMA_IRQ_INDEX, channel);
+    transport->tx_busy = false;
+    transport->tx_tail += transport->tx_dma_count;
+    uart_transport_backend_start_tx(transport);
+}
+
+static void __isr __not_in_flash_func(uart_transport_dma_irq_handler)(void) {
+    for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        uart_transport_t *transport = channel_transports[ch];
+        if (!transport || !dma_irqn_get_channel_status(PICO_UART_TRANSPORT_DMA_IRQ_INDEX, ch)) continue;
+        uint32_t save = spin_lock_blocking(transport->lock);
+        uint delivered = rx_handle_dma(transport);
+        tx_handle_dma(transport);
+        spin_unlock(transport->lock, save);
+        uart_transport_notify(transport, delivered);
+    }
+}
+
+static void __not_in_flash_func(uart_transport_uart_irq_handler)(uart_transport_t *transport) {
+    uart_hw_t *hw = uart_get_hw(transport->config.uart);
+    uint delivered = 0;
+    uint32_t save = spin_lock_blocking(transport->lock);
+    uint32_t status = hw->mis;
+    if (status & UART_UARTMIS_OEMIS_BITS) transport->stats.rx_overruns++;
+    if (status & (UART_UARTMIS_BEMIS_BITS | UART_UARTMIS_PEMIS_BITS | UART_UARTMIS_FEMIS_BITS)) {
+        transport->stats.line_errors++;
+    }
+    hw->icr = status & UART_ERROR_INTERRUPTS;
+    if (status & (UART_UARTMIS_RXMIS_BITS | UART_UARTMIS_RTMIS_BITS)) {
+        if ((status & UART_UARTMIS_RTMIS_BITS) || transport->rx_idle_alarm || !rx_dma_resume(transport)) {
+            // the line has gone idle with bytes left in the RX FIFO (a frame too short to reach the RX FIFO level).
+            // Stop the DMA taking any more, so the bytes can be drained here in order, after those the DMA has already
+            // written to the ring
+            hw_clear_bits(&hw->dmacr, UART_UARTDMACR_RXDMAE_BITS);
+            delivered += rx_handle_dma(transport);
+            while (!(hw->fr & UART_UARTFR_RXFE_BITS)) {
+                uint8_t b = (uint8_t)hw->dr;
+                delivered += uart_transport_rx_bytes(transport, &b, 1);
+            }
+            hw->icr = UART_UARTICR_RTIC_BITS | UART_UARTICR_RXIC_BITS;
+            if (transport->rx_idle_alarm) hw_set_bits(&hw->dmacr, UART_UARTDMACR_RXDMAE_BITS);
+        }
+    }
+    spin_unlock(transport->lock, save);
+    uart_transport_notify(transport, delivered);
+}
+
+static void __isr __not_in_flash_func(uart0_transport_irq_handler)(void) {
+    uart_transport_uart_irq_handler(uart_transports[0]);
+}
+
+static void __isr __not_in_flash_func(uart1_transport_irq_handler)(void) {
+    uart_transport_uart_irq_handler(uart_transports[1]);
+}
+
+static uint claim_channel(uart_transport_t *transport) {
+    uint channel = (uint)dma_claim_unused_channel(true);
+    channel_transports[channel] = transport;
+    dma_irqn_set_channel_enabled(PICO_UART_TRANSPORT_DMA_IRQ_INDEX, channel, true);
+    return channel;
+}
+
+static void release_channel(uint channel) {
+    dma_irqn_set_channel_enabled(PICO_UART_TRANSPORT_DMA_IRQ_INDEX, channel, false);
+    dma_channel_abort(channel);
+    dma_irqn_acknowledge_channel(PICO_UART_TRANSPORT_DMA_IRQ_INDEX, channel);
+    channel_transports[channel] = NULL;
+    dma_channel_unclaim(channel);
+}
+
+void uart_transport_backend_init(uart_transport_t *transport) {
+    uart_inst_t *uart = transport->config.uart;
+    uint index = uart_get_index(uart);
+    assert(!uart_transports[index]);
+    uart_transports[index] = transport;
+    uart_hw_t *hw = uart_get_hw(uart);
+
+    for (uint which = 0; which < 2; which++) {
+        uint channel = claim_channel(transport);
+        transport->rx_channel[which] = (uint8_t)channel;
+        dma_channel_config c = dma_channel_get_default_config(channel);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+        channel_config_set_read_increment(&c, false);
+        channel_config_set_write_increment(&c, true);
+        channel_config_set_dreq(&c, uart_get_dreq(uart, false));
+        dma_channel_configure(channel, &c, transport->config.rx_ring, &hw->dr, 0, false);
+    }
+    uint channel = claim_channel(transport);
+    transport->tx_channel = (uint8_t)channel;
+    dma_channel_config c = dma_channel_get_default_config(channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, uart_get_dreq(uart, true));
+    dma_channel_configure(channel, &c, &hw->dr, transport->config.tx_ring, 0, false);
+
+    if (!transport_count++) {
+        irq_add_shared_handler(DMA_IRQ_0 + PICO_UART_TRANSPORT_DMA_IRQ_INDEX, uart_transport_dma_irq_handler,
+                               PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_0 + PICO_UART_TRANSPORT_DMA_IRQ_INDEX, true);
+    }
+
+    // the bit period is 64 * ibrd + fbrd quarter cycles of clk_peri; take a character as 10 bits
+    uint64_t divisor = ((uint64_t)hw->ibrd << 6) | hw->fbrd;
+    transport->rx_idle_us = (uint32_t)(divisor * 10 * PICO_UART_TRANSPORT_RX_IDLE_CHARS * 1000000 /
+                                       (4ull * clock_get_hz(clk_peri)));
+    transport->rx_idle_alarm = 0;
+
+    // the RX DMA channels are armed, but only run once the RX FIFO interrupt sees the start of a burst
+    rx_start(transport);
+    // the lowest RX FIFO level (1/8 full): a frame shorter than this is left in the FIFO for the receive timeout
+    hw_write_masked(&hw->ifls, 0, UART_UARTIFLS_RXIFLSEL_BITS);
+    hw->dmacr = UART_UARTDMACR_TXDMAE_BITS;
+    hw->icr = UART_UARTICR_BITS;
+    hw->imsc = UART_UARTIMSC_RXIM_BITS | UART_UARTIMSC_RTIM_BITS | UART_ERROR_INTERRUPTS;
+    irq_set_exclusive_handler(UART0_IRQ + index, index ? uart1_transport_irq_handler : uart0_transport_irq_handler);
+    irq_set_enabled(UART0_IRQ + index, true);
+}
+
+void uart_transport_backend_deinit(uart_transport_t *transport) {
+    uint index = uart_get_index(transport->config.uart);
+    uart_hw_t *hw = uart_get_hw(transport->config.uart);
+    irq_set_enabled(UART0_IRQ + index, false);
+    irq_remove_handler(UART0_IRQ + index, index ? uart1_transport_irq_handler : uart0_transport_irq_handler);
+
+    uint32_t save = spin_lock_blocking(transport->lock);
+    if (transport->rx_idle_alarm) {
+        cancel_alarm(transport->rx_idle_alarm);
+        transport->rx_idle_alarm = 0;
+    }
+    // (after the alarm, which may re-enable the RX interrupt)
+    hw->imsc = 0;
+    hw->dmacr = 0;
+    rx_stop(transport);
+    for (uint which = 0; which < 2; which++) release_channel(transport->rx_channel[which]);
+    release_channel(transport->tx_channel);
+    transport->tx_busy = false;
+    spin_unlock(transport->lock, save);
+    uart_transports[index] = NULL;
+
+    if (!--transport_count) {
+        irq_remove_handler(DMA_IRQ_0 + PICO_UART_TRANSPORT_DMA_IRQ_INDEX, uart_transport_dma_irq_handler);
+    }
+}
+
+void uart_transport_backend_poll(uart_transport_t *transport) {
+    uint32_t save = spin_lock_blocking(transport->lock);
+    uint delivered = rx_handle_dma(transport);
+    spin_unlock(transport->lock, save);
+    uart_transport_notify(transport, delivered);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/lz4.h"
+#include "pico/bootrom.h"
+#include "pico/binary_info.h"
+#include "boot/uf2z.h"
+#include "hardware/flash.h"
+#include "hardware/watchdog.h"
+
+// Loaded into RAM by the bootrom from a compressed UF2 (see boot/uf2z.h), along with the container of compressed
+// flash sectors, which this programs into flash.
+//
+// When it has finished it leaves the time taken, in microseconds, in watchdog scratch register 0 (with UF2Z_MAGIC in
+// scratch register 1 to say so), which the programmed application may report. If the container is invalid, or a
+// sector doesn't read back correctly after programming, it returns to BOOTSEL mode without rebooting into flash, with
+// the number of the block which failed in scratch register 0 (and the inverse of UF2Z_MAGIC in scratch register 1).
+
+bi_decl(bi_program_description("Programs a compressed UF2 into flash"))
+
+static uint8_t sector[UF2Z_BLOCK_SIZE];
+
+static bool program_block(const struct uf2z_block *block, const uint8_t *data) {
+    if (block->flash_offset % UF2Z_BLOCK_SIZE || !block->size || block->size > UF2Z_BLOCK_SIZE ||
+        block->size % FLASH_PAGE_SIZE || block->compressed_size > block->size) {
+        return false;
+    }
+#ifdef PICO_FLASH_SIZE_BYTES
+    if (block->flash_offset + UF2Z_BLOCK_SIZE > PICO_FLASH_SIZE_BYTES) return false;
+#endif
+    if (block->compressed_size == block->size) {
+        memcpy(sector, data, block->size);
+    } else if (lz4_decompress_block(data, block->compressed_size, sector, sizeof(sector)) != block->size) {
+        return false;
+    }
+    flash_range_erase(block->flash_offset, UF2Z_BLOCK_SIZE);
+    flash_range_program(block->flash_offset, sector, block->size);
+    // read back without the XIP cache, which may hold stale data
+    return !memcmp((const void *)(XIP_NOCACHE_NOALLOC_BASE + block->flash_offset), sector, block->size);
+}
+
+static void __attribute__((noreturn)) fail(uint32_t block_num) {
+    watchdog_hw->scratch[0] = block_num;
+    watchdog_hw->scratch[1] = ~UF2Z_MAGIC;
+    reset_usb_boot(0, 0);
+}
+
+int main() {
+    uint64_t start_us = time_us_64();
+    const struct uf2z_header *header = (const struct uf2z_header *)UF2Z_CONTAINER_ADDR;
+    if (header->magic != UF2Z_MAGIC || header->version != UF2Z_VERSION ||
+        header->data_size > UF2Z_CONTAINER_MAX_SIZE - sizeof(*header)) {
+        fail(0);
+    }
+    const uint8_t *p = (const uint8_t *)(header + 1);
+    const uint8_t *end = p + header->data_size;
+    for (uint32_t i = 0; i < header->num_blocks; i++) {
+        const struct uf2z_block *block = (const struct uf2z_block *)p;
+        p += sizeof(*block);
+        if (p > end || block->compressed_size > (uint32_t)(end - p) || !program_block(block, p)) fail(i);
+        p += (block->compressed_size + 3u) & ~3u;
+    }
+    watchdog_hw->scratch[0] = (uint32_t)(time_us_64() - start_us);
+    watchdog_hw->scratch[1] = UF2Z_MAGIC;
+    if (header->flags & UF2Z_FLAG_MORE_PARTS) reset_usb_boot(0, 0);
+    watchdog_reboot(0, 0, 0);
+    while (true) tight_loop_contents();
+}
@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/icmp.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/netif.h"
+#include "lwip/raw.h"
+
+// Measures the background processing of pico_cyw43_arch_threadsafe_background: how often an idle (but connected)
+// device wakes up to service lwIP timeouts and the CYW43, and the round trip time of pings to the gateway, both
+// back to back and after long enough idle for the CYW43 bus to have gone to sleep
+
+#define IDLE_SECONDS 10
+#define PING_COUNT 20
+#define PING_ID 0xafaf
+#define PING_DATA_SIZE 32
+#define PING_TIMEOUT_MS 1000
+
+static struct raw_pcb *ping_pcb;
+static u16_t ping_seq;
+static uint64_t ping_sent_us;
+static volatile uint64_t ping_rtt_us;
+static volatile bool ping_received;
+
+static u8_t ping_recv(__unused void *arg, __unused struct raw_pcb *pcb, struct pbuf *p,
+                      __unused const ip_addr_t *addr) {
+    // a raw ICMP pcb gets the whole IP packet
+    if (p->tot_len >= PBUF_IP_HLEN + sizeof(struct icmp_echo_hdr) && !pbuf_remove_header(p, PBUF_IP_HLEN)) {
+        struct icmp_echo_hdr *echo = (struct icmp_echo_hdr *)p->payload;
+        if (ICMPH_TYPE(echo) == ICMP_ER && echo->id == PING_ID && echo->seqno == lwip_htons(ping_seq)) {
+            ping_rtt_us = time_us_64() - ping_sent_us;
+            ping_received = true;
+            pbuf_free(p);
+            return 1;
+        }
+        pbuf_add_header(p, PBUF_IP_HLEN);
+    }
+    return 0;
+}
+
+static void ping_send(const ip_addr_t *addr) {
+    struct pbuf *p = pbuf_alloc(PBUF_IP, sizeof(struct icmp_echo_hdr) + PING_DATA_SIZE, PBUF_RAM);
+    if (!p) return;
+    struct icmp_echo_hdr *echo = (struct icmp_echo_hdr *)p->payload;
+    ICMPH_TYPE_SET(echo, ICMP_ECHO);
+    ICMPH_CODE_SET(echo, 0);
+    echo->id = PING_ID;
+    echo->seqno = lwip_htons(++ping_seq);
+    memset(echo + 1, 0xa5, PING_DATA_SIZE);
+    echo->chksum = 0;
+    echo->chksum = inet_chksum(echo, p->len);
+    ping_received = false;
+    ping_sent_us = time_us_64();
+    raw_sendto(ping_pcb, p, addr);
+    pbuf_free(p);
+}
+
+static void ping_series(const ip_addr_t *addr, uint count, uint interval_ms) {
+    uint64_t min_us = UINT64_MAX, max_us = 0, total_us = 0;
+    uint received = 0;
+    for (uint i = 0; i < count; i++) {
+        absolute_time_t start = get_absolute_time();
+        cyw43_arch_lwip_begin();
+        ping_send(addr);
+        cyw43_arch_lwip_end();
+        absolute_time_t timeout = make_timeout_time_ms(PING_TIMEOUT_MS);
+        while (!ping_received && !time_reached(timeout)) {
+            sleep_ms(1);
+        }
+        if (ping_received) {
+            received++;
+            total_us += ping_rtt_us;
+            min_us = MIN(min_us, ping_rtt_us);
+            max_us = MAX(max_us, ping_rtt_us);
+        }
+        sleep_until(delayed_by_ms(start, interval_ms));
+    }
+    if (received) {
+        printf("  %u of %u replies, round trip min %llu avg %llu max %llu us\n", received, count,
+               (unsigned long long)min_us, (unsigned long long)(total_us / received), (unsigned long long)max_us);
+    } else {
+        printf("  no replies\n");
+    }
+}
+
+int main() {
+    stdio_init_all();
+    if (cyw43_arch_init()) {
+        printf("failed to initialize\n");
+        return 1;
+    }
+    cyw43_arch_enable_sta_mode();
+    printf("connecting to %s\n", WIFI_SSID);
+    if (cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK, 30000)) {
+        printf("failed to connect\n");
+        return 1;
+    }
+    ip_addr_t gateway;
+    cyw43_arch_lwip_begin();
+    ip_addr_copy_from_ip4(gateway, *netif_ip4_gw(netif_default));
+    ping_pcb = raw_new(IP_PROTO_ICMP);
+    raw_recv(ping_pcb, ping_recv, NULL);
+    raw_bind(ping_pcb, IP_ADDR_ANY);
+    cyw43_arch_lwip_end();
+
+    printf("background processing: %s\n", PICO_CYW43_ARCH_EVENT_DRIVEN ? "event driven" : "periodic");
+    while (true) {
+        cyw43_arch_background_stats_t stats;
+        cyw43_arch_get_background_stats(&stats, true);
+        sleep_ms(IDLE_SECONDS * 1000);
+        cyw43_arch_get_background_stats(&stats, true);
+        printf("idle for %d s: %lu.%lu wakeups/s, %lu dispatches for %lu requests\n", IDLE_SECONDS,
+               (unsigned long)(stats.wakeups / IDLE_SECONDS), (unsigned long)(stats.wakeups * 10 / IDLE_SECONDS % 10),
+               (unsigned long)stats.dispatches, (unsigned long)stats.dispatch_requests);
+
+        printf("ping %s back to back:\n", ipaddr_ntoa(&gateway));
+        ping_series(&gateway, PING_COUNT, 0);
+        printf("ping %s every 3 s (after the bus has gone to sleep):\n", ipaddr_ntoa(&gateway));
+        ping_series(&gateway, 5, 3000);
+    }
+}
@@ -0,0 +1,333 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/test.h"
+#include "cyw43_bus_pio_spi.pio.h"
+
+PICOTEST_MODULE_NAME("CYW43_BUS_PIO", "CYW43 PIO SPI bus programs in a host simulation of the bus timing");
+
+// The CYW43 bus PIO programs (assembled by pioasm from the driver's source) are run by a minimal simulation of a
+// state machine, configured as the driver configures it: one side-set pin (the clock), autopull and autopush of 32
+// bits, shifting left, and the clock divider as 8.8 fixed point. The simulated chip samples the data pin on each
+// rising edge of the clock while receiving a command, then drives a response bit from each falling edge, starting
+// with the one which turns the data pin around, valid after a configurable delay (the board and chip's output delay).
+
+#define SYS_CLK_HZ 125000000
+
+typedef struct {
+    const char *name;
+    const uint16_t *instructions;
+    uint offset_lp1_end;
+    uint offset_end;
+    uint sample_half_clocks;    // expected time from the turnaround to sampling the first response bit
+} spi_program_t;
+
+#define SPI_PROGRAM(NAME, HALF_CLOCKS) { #NAME, NAME ## _program_instructions, NAME ## _offset_lp1_end, \
+                                         NAME ## _offset_end, HALF_CLOCKS }
+
+// in the order the driver's calibration tries them
+static const spi_program_t programs[] = {
+        SPI_PROGRAM(spi_gap01_sample0, 2),
+        SPI_PROGRAM(spi_gap0_sample1, 1),
+        SPI_PROGRAM(spi_gap010_sample1, 3),
+};
+
+static const uint16_t clock_divs[] = {0x100, 0x180, 0x200, 0x300, 0x400};
+
+#define MAX_WORDS 4
+
+typedef struct {
+    // host
+    bool clock;
+    bool data_out;
+    bool data_oe;
+    double data_changed_ns;
+    // chip
+    uint cmd_bits;
+    uint32_t cmd[MAX_WORDS];
+    const uint32_t *response;
+    uint response_bits;
+    double delay_ns;
+    double falls_ns[MAX_WORDS * 32 + 2]; // falling edges from the turnaround on
+    uint fall_count;
+    double last_rise_ns;
+    double min_setup_ns;
+    double min_hold_ns;
+} bus_t;
+
+typedef struct {
+    uint32_t x, y, osr, isr;
+    uint osr_count, isr_count;
+    uint pc;
+    const uint32_t *tx_fifo;
+    uint tx_remaining;
+    uint32_t *rx_fifo;
+    uint rx_count;
+} sm_t;
+
+static bool chip_data(bus_t *bus, double now_ns) {
+    // before the first response bit is valid, the data pin has the wrong value
+    bool first = bus->response_bits && (bus->response[0] >> 31);
+    int bit = -1;
+    for (uint i = 0; i < bus->fall_count && bus->falls_ns[i] + bus->delay_ns <= now_ns; i++) bit = (int)i;
+    if (bit < 0) return !first;
+    if ((uint)bit >= bus->response_bits) return false;
+    return (bus->response[bit / 32] >> (31 - bit % 32)) & 1;
+}
+
+static void set_clock(bus_t *bus, bool clock, double now_ns, uint tx_bits) {
+    if (clock == bus->clock) return;
+    bus->clock = clock;
+    if (clock) {
+        bus->last_rise_ns = now_ns;
+        if (bus->cmd_bits < tx_bits) {
+            hard_assert(bus->data_oe);
+            bus->min_setup_ns = MIN(bus->min_setup_ns, now_ns - bus->data_changed_ns);
+            bus->cmd[bus->cmd_bits / 32] |= (uint32_t)bus->data_out << (31 - bus->cmd_bits % 32);
+            bus->cmd_bits++;
+        }
+    } else if (bus->cmd_bits == tx_bits && bus->fall_count < count_of(bus->falls_ns)) {
+        bus->falls_ns[bus->fall_count++] = now_ns;
+    }
+}
+
+static void set_data(bus_t *bus, bool value, double now_ns) {
+    if (value == bus->data_out) return;
+    if (bus->last_rise_ns >= 0) bus->min_hold_ns = MIN(bus->min_hold_ns, now_ns - bus->last_rise_ns);
+    bus->data_out = value;
+    bus->data_changed_ns = now_ns;
+}
+
+static uint32_t *reg_for(sm_t *sm, uint index) {
+    return index == 1 ? &sm->x : index == 2 ? &sm->y : NULL;
+}
+
+// run one transfer as cyw43_spi_transfer() does, returning the number of clocks for which the state machine ran
+static uint run_transfer(const spi_program_t *program, uint16_t clock_div, bus_t *bus,
+                         const uint32_t *tx, uint tx_words, uint32_t *rx, uint rx_words) {
+    uint tx_bits = tx_words * 32;
+    sm_t sm = {
+            .x = tx_bits - 1,
+            .y = rx_words ? rx_words * 32 - 1 : 0,
+            .osr_count = 32,
+            .tx_fifo = tx,
+            .tx_remaining = tx_words,
+            .rx_fifo = rx,
+    };
+    uint wrap_top = (rx_words ? program->offset_end : program->offset_lp1_end) - 1;
+    bus->data_oe = true;
+    bus->data_changed_ns = -1e9;
+    bus->last_rise_ns = -1;
+    bus->min_setup_ns = bus->min_hold_ns = 1e9;
+    bus->clock = false;
+    double clock_ns = 1e9 / SYS_CLK_HZ;
+    uint slot = 0;
+    for (;;) {
+        uint16_t instr = program->instructions[sm.pc];
+        uint cycle = (uint)(((uint64_t)slot * clock_div) >> 8);
+        double now_ns = cycle * clock_ns;
+        // the side-set takes effect even if the instruction stalls
+        set_clock(bus, (instr >> 12) & 1, now_ns, tx_bits);
+        uint op = instr >> 13;
+        uint index = (instr >> 5) & 7;
+        uint operand = instr & 0x1f;
+        uint next_pc = sm.pc == wrap_top ? 0 : sm.pc + 1;
+        switch (op) {
+            case 0: { // jmp
+                bool taken;
+                switch (index) {
+                    case 0: taken = true; break;
+                    case 2: taken = sm.x-- != 0; break;
+                    case 4: taken = sm.y-- != 0; break;
+                    default: taken = false; hard_assert(false);
+                }
+                if (taken) next_pc = operand;
+                break;
+            }
+            case 2: { // in
+                uint n = operand ? operand : 32;
+                hard_assert(index == 0 && n == 1);
+                sm.isr = (sm.isr << 1) | chip_data(bus, now_ns);
+                if (++sm.isr_count == 32) {
+                    hard_assert(sm.rx_count < rx_words);
+                    sm.rx_fifo[sm.rx_count++] = sm.isr;
+                    sm.isr_count = 0;
+                }
+                break;
+            }
+            case 3: { // out
+                uint n = operand ? operand : 32;
+                hard_assert(index == 0 && n == 1);
+                if (sm.osr_count == 32) {
+                    if (!sm.tx_remaining) {
+                        // stalled with nothing more to send: the transfer is over
+                        hard_assert(!sm.pc && bus->cmd_bits == tx_bits && sm.rx_count == rx_words);
+                        return slot / 2;
+                    }
+                    sm.osr = *sm.tx_fifo++;
+                    sm.tx_remaining--;
+                    sm.osr_count = 0;
+                }
+                set_data(bus, sm.osr >> 31, now_ns);
+                sm.osr <<= 1;
+                sm.osr_count++;
+                break;
+            }
+            case 5: { // mov (nop is mov y, y)
+                uint32_t *dest = reg_for(&sm, index);
+                uint32_t *src = reg_for(&sm, instr & 7);
+                hard_assert(dest && src && !(instr & 0x18));
+                *dest = *src;
+                break;
+            }
+            case 7: // set
+                hard_assert(index == 4 && operand == 0);
+                bus->data_oe = false;
+                break;
+            default:
+                hard_assert(false);
+        }
+        sm.pc = next_pc;
+        slot += 1 + ((instr >> 8) & 0xf);
+    }
+}
+
+static uint32_t lcg = 1;
+
+// a register read: a command word, then a response word; returns true if both got through intact
+static bool read_ok(const spi_program_t *program, uint16_t clock_div, double delay_ns, uint32_t value) {
+    lcg = lcg * 1664525u + 1013904223u;
+    uint32_t cmd = lcg & 0x7fffffff;
+    uint32_t rx;
+    bus_t bus = {.response = &value, .response_bits = 32, .delay_ns = delay_ns};
+    run_transfer(program, clock_div, &bus, &cmd, 1, &rx, 1);
+    return bus.cmd[0] == cmd && rx == value;
+}
+
+// the driver's link self-test, as far as the bus timing goes
+static bool link_ok(const spi_program_t *program, uint16_t clock_div, double delay_ns) {
+    static const uint32_t patterns[] = {0xfeedbead, 0, 0xffffffff, 0xaaaaaaaa, 0x55555555};
+    for (uint i = 0; i < count_of(patterns); i++) {
+        if (!read_ok(program, clock_div, delay_ns, patterns[i])) return false;
+    }
+    for (uint i = 0; i < 32; i++) {
+        if (!read_ok(program, clock_div, delay_ns, 1u << i)) return false;
+    }
+    return true;
+}
+
+static uint32_t bus_clock_hz(uint sys_clk_hz, uint16_t clock_div) {
+    return (uint32_t)((uint64_t)sys_clk_hz * 128 / clock_div);
+}
+
+// the driver's calibration: the fastest clock, within the limit, at which any program passes
+static bool calibrate(double delay_ns, uint32_t max_clock_hz, const spi_program_t **program, uint16_t *clock_div) {
+    for (uint d = 0; d < count_of(clock_divs); d++) {
+        if (bus_clock_hz(SYS_CLK_HZ, clock_divs[d]) > max_clock_hz) continue;
+        for (uint p = 0; p < count_of(programs); p++) {
+            if (link_ok(&programs[p], clock_divs[d], delay_ns)) {
+                *program = &programs[p];
+                *clock_div = clock_divs[d];
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int main() {
+    PICOTEST_START();
+
+    PICOTEST_START_SECTION("commands are sent intact, with at least a state machine cycle of setup and hold");
+        for (uint p = 0; p < count_of(programs); p++) {
+            for (uint d = 0; d < count_of(clock_divs); d++) {
+                uint32_t tx[MAX_WORDS];
+                for (uint i = 0; i < MAX_WORDS; i++) tx[i] = lcg = lcg * 1664525u + 1013904223u;
+                bus_t bus = {0};
+                uint clocks = run_transfer(&programs[p], clock_divs[d], &bus, tx, MAX_WORDS, NULL, 0);
+                PICOTEST_CHECK(!memcmp(bus.cmd, tx, sizeof(tx)), "command corrupted");
+                PICOTEST_CHECK(clocks == MAX_WORDS * 32, "wrong number of clocks");
+                PICOTEST_CHECK(!bus.clock, "clock left high");
+                double min_ns = (clock_divs[d] >> 8) * 1e9 / SYS_CLK_HZ;
+                PICOTEST_CHECK(bus.min_setup_ns >= min_ns && bus.min_hold_ns >= min_ns, "setup or hold too short");
+            }
+        }
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("responses are received intact within each program's window of delays");
+        // the first response bit is valid from delay_ns after the turnaround, until a clock later, so a program
+        // sampling it s after the turnaround works for delays between s - T and s
+        for (uint p = 0; p < count_of(programs); p++) {
+            for (uint d = 0; d < count_of(clock_divs); d++) {
+                if (clock_divs[d] & 0xff) continue;
+                double half_clock_ns = (clock_divs[d] >> 8) * 1e9 / SYS_CLK_HZ;
+                double sample_ns = programs[p].sample_half_clocks * half_clock_ns;
+                uint failures = 0;
+                for (double delay_ns = 0.5; delay_ns < 100; delay_ns += 1.0) {
+                    bool expected = delay_ns > sample_ns - 2 * half_clock_ns && delay_ns < sample_ns;
+                    if (read_ok(&programs[p], clock_divs[d], delay_ns, 0xfeedbead) != expected) failures++;
+                }
+                PICOTEST_CHECK(!failures, "response sampled outside the expected window");
+            }
+        }
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("with a fractional divider each program still has a window of delays");
+        for (uint p = 0; p < count_of(programs); p++) {
+            double first = -1, last = -1;
+            bool contiguous = true;
+            for (double delay_ns = 0.5; delay_ns < 100; delay_ns += 1.0) {
+                if (link_ok(&programs[p], 0x180, delay_ns)) {
+                    if (first < 0) first = delay_ns;
+                    else if (last != delay_ns - 1.0) contiguous = false;
+                    last = delay_ns;
+                }
+            }
+            printf("  %-20s divider 1.5: delays %.1f to %.1f ns\n", programs[p].name, first, last);
+            PICOTEST_CHECK(first >= 0 && contiguous, "no single window of working delays");
+        }
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("the default setting works for a range of delays");
+        for (double delay_ns = 0.5; delay_ns < 32; delay_ns += 1.0) {
+            PICOTEST_CHECK(link_ok(&programs[0], 0x200, delay_ns), "default setting failed");
+        }
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("calibration picks the fastest working setting for the delay");
+        static const struct {
+            double delay_ns;
+            uint32_t max_clock_hz;
+            uint expected_program;
+            uint16_t expected_div;
+        } cases[] = {
+                {5.5,  50000000, 0, 0x180},
+                {20.5, 50000000, 0, 0x180},
+                {30.5, 50000000, 2, 0x180},
+                {5.5,  70000000, 0, 0x100},
+                {18.5, 70000000, 2, 0x100},
+                {30.5, 30000000, 0, 0x300},
+        };
+        for (uint i = 0; i < count_of(cases); i++) {
+            const spi_program_t *program = NULL;
+            uint16_t clock_div = 0;
+            bool found = calibrate(cases[i].delay_ns, cases[i].max_clock_hz, &program, &clock_div);
+            PICOTEST_CHECK(found, "no setting found");
+            uint32_t clock_hz = bus_clock_hz(SYS_CLK_HZ, clock_div);
+            printf("  delay %4.1f ns, max %2u MHz: %-20s divider %u.%02u, %5.2f MHz, %.2f MB/s\n", cases[i].delay_ns,
+                   (uint)(cases[i].max_clock_hz / 1000000), program->name, clock_div >> 8,
+                   (clock_div & 0xff) * 100 / 256, clock_hz / 1e6, clock_hz / 8e6);
+            PICOTEST_CHECK(program == &programs[cases[i].expected_program] && clock_div == cases[i].expected_div,
+                           "unexpected setting chosen");
+        }
+    PICOTEST_END_SECTION();
+
+    PICOTEST_END_TEST();
+}
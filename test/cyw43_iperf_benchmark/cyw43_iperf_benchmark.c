@@ -0,0 +1,50 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "cyw43_spi_sg.h"
+#include "lwip/ip_addr.h"
+#include "lwip/netif.h"
+#include "lwip/apps/lwiperf.h"
+
+// An iperf server: each test run reports its throughput, and how many frames went straight between pbufs and the
+// CYW43 bus rather than being copied through the driver's buffer
+
+static void iperf_report(__unused void *arg, enum lwiperf_report_type report_type, __unused const ip_addr_t *local_addr,
+                         __unused u16_t local_port, const ip_addr_t *remote_addr, __unused u16_t remote_port,
+                         u32_t bytes_transferred, u32_t ms_duration, u32_t bandwidth_kbitpsec) {
+    cyw43_pbuf_stats_t stats;
+    cyw43_pbuf_get_stats(&stats, true);
+    printf("report %d from %s: %lu bytes in %lu ms, %lu kbit/s\n", report_type, ipaddr_ntoa(remote_addr),
+           (unsigned long)bytes_transferred, (unsigned long)ms_duration, (unsigned long)bandwidth_kbitpsec);
+    printf("  rx frames direct %lu copied %lu no pbuf %lu, tx frames direct %lu copied %lu, copies avoided %lu bytes\n",
+           (unsigned long)stats.rx_frames_direct, (unsigned long)stats.rx_frames_copied,
+           (unsigned long)stats.rx_no_pbuf, (unsigned long)stats.tx_frames_direct,
+           (unsigned long)stats.tx_frames_copied, (unsigned long)stats.bytes_not_copied);
+}
+
+int main() {
+    stdio_init_all();
+    if (cyw43_arch_init()) {
+        printf("failed to initialize\n");
+        return 1;
+    }
+    cyw43_arch_enable_sta_mode();
+    printf("connecting to %s\n", WIFI_SSID);
+    if (cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK, 30000)) {
+        printf("failed to connect\n");
+        return 1;
+    }
+    printf("iperf server at %s port %d\n", ip4addr_ntoa(netif_ip4_addr(netif_list)), LWIPERF_TCP_PORT_DEFAULT);
+    lwiperf_start_tcp_server_default(iperf_report, NULL);
+    while (true) {
+        cyw43_arch_poll();
+        sleep_ms(1);
+    }
+}
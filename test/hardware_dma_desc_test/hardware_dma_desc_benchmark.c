@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/dma_desc.h"
+
+// Compares gathering many small buffers with a descriptor list against re-arming a single channel from the CPU for
+// each buffer. The CPU involvement is shown as the number of iterations of a counting loop the CPU manages while the
+// transfers run (none when it is re-arming the channel itself)
+
+#define FRAGMENT_SIZES 4
+#define NUM_FRAGMENTS 128
+#define MAX_FRAGMENT_SIZE 256
+#define REPEATS 32
+
+static uint8_t src[NUM_FRAGMENTS * MAX_FRAGMENT_SIZE];
+static uint8_t dst[NUM_FRAGMENTS * MAX_FRAGMENT_SIZE];
+static dma_desc_t descs[NUM_FRAGMENTS + 1];
+
+static uint32_t gather_rearm(uint channel, uint fragment_size) {
+    dma_channel_config c = dma_channel_get_default_config(channel);
+    channel_config_set_write_increment(&c, true);
+    dma_channel_set_config(channel, &c, false);
+    uint32_t start = time_us_32();
+    for (uint r = 0; r < REPEATS; r++) {
+        for (uint i = 0; i < NUM_FRAGMENTS; i++) {
+            dma_channel_wait_for_finish_blocking(channel);
+            dma_channel_hw_t *hw = dma_channel_hw_addr(channel);
+            // fragments are taken from spread out source locations
+            hw->read_addr = (uintptr_t)(src + ((i * 37) % NUM_FRAGMENTS) * MAX_FRAGMENT_SIZE);
+            hw->write_addr = (uintptr_t)(dst + i * fragment_size);
+            hw->al1_transfer_count_trig = fragment_size / 4;
+        }
+        dma_channel_wait_for_finish_blocking(channel);
+    }
+    return time_us_32() - start;
+}
+
+static uint32_t gather_desc(dma_desc_list_t *list, uint fragment_size, uint32_t *free_iterations) {
+    dma_channel_config c = dma_desc_list_get_default_config(list);
+    channel_config_set_write_increment(&c, true);
+    volatile uint32_t count = 0;
+    uint32_t start = time_us_32();
+    for (uint r = 0; r < REPEATS; r++) {
+        dma_desc_list_clear(list);
+        for (uint i = 0; i < NUM_FRAGMENTS; i++) {
+            dma_desc_list_add(list, &c, dst + i * fragment_size, src + ((i * 37) % NUM_FRAGMENTS) * MAX_FRAGMENT_SIZE,
+                              fragment_size / 4, false);
+        }
+        dma_desc_list_start(list, false);
+        while (dma_desc_list_is_busy(list)) count++;
+    }
+    *free_iterations = count;
+    return time_us_32() - start;
+}
+
+int main() {
+    stdio_init_all();
+    for (uint i = 0; i < sizeof(src); i++) src[i] = (uint8_t)i;
+
+    uint data_channel = (uint)dma_claim_unused_channel(true);
+    uint control_channel = (uint)dma_claim_unused_channel(true);
+    dma_desc_list_t list;
+    dma_desc_list_init(&list, descs, count_of(descs), data_channel, control_channel);
+
+    printf("gather %d fragments x %d repeats\n", NUM_FRAGMENTS, REPEATS);
+    printf("fragment  re-arm us  MB/s   desc us  MB/s   desc free CPU loop iterations\n");
+    for (uint f = 0; f < FRAGMENT_SIZES; f++) {
+        uint fragment_size = 16u << (f * 2);
+        uint32_t bytes = fragment_size * NUM_FRAGMENTS * REPEATS;
+        uint32_t rearm_us = gather_rearm(data_channel, fragment_size);
+        memset(dst, 0, sizeof(dst));
+        uint32_t free_iterations;
+        uint32_t desc_us = gather_desc(&list, fragment_size, &free_iterations);
+        bool ok = true;
+        for (uint i = 0; i < NUM_FRAGMENTS; i++) {
+            ok &= !memcmp(dst + i * fragment_size, src + ((i * 37) % NUM_FRAGMENTS) * MAX_FRAGMENT_SIZE, fragment_size);
+        }
+        printf("%8u %10u %5u %9u %5u %10u%s\n", fragment_size, (uint) rearm_us, (uint) (bytes / rearm_us),
+               (uint) desc_us, (uint) (bytes / desc_us), (uint) free_iterations, ok ? "" : "  MISMATCH");
+    }
+    return 0;
+}
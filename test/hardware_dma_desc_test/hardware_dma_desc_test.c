@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/dma_desc.h"
+#include "pico/test.h"
+
+PICOTEST_MODULE_NAME("DMA_DESC", "DMA descriptor list test");
+
+#define NUM_FRAGMENTS 32
+
+static uint8_t src[NUM_FRAGMENTS * (NUM_FRAGMENTS + 1) / 2];
+static uint8_t dst[sizeof(src)];
+static uint32_t words[4];
+static uint32_t scattered[4][4];
+static dma_desc_t descs[NUM_FRAGMENTS + 1];
+static dma_desc_list_t list;
+
+// the data channel's interrupt is routed to DMA_IRQ_0 (which is not enabled in the NVIC) so it can be polled
+static bool data_channel_irq(void) {
+    return dma_channel_get_irq0_status(list.data_channel);
+}
+
+static void clear_data_channel_irq(void) {
+    dma_channel_acknowledge_irq0(list.data_channel);
+}
+
+int main() {
+    stdio_init_all();
+
+    for (uint i = 0; i < sizeof(src); i++) src[i] = (uint8_t)(i * 7 + 3);
+    for (uint i = 0; i < 4; i++) words[i] = 0x01010101u * (i + 1);
+    uint data_channel = (uint)dma_claim_unused_channel(true);
+    uint control_channel = (uint)dma_claim_unused_channel(true);
+    dma_desc_list_init(&list, descs, count_of(descs), data_channel, control_channel);
+    dma_channel_set_irq0_enabled(data_channel, true);
+
+    PICOTEST_START();
+
+    PICOTEST_START_SECTION("gather");
+        // gather fragments of 1, 2, ... NUM_FRAGMENTS bytes (in reverse order) into one buffer
+        dma_channel_config c = dma_desc_list_get_default_config(&list);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+        channel_config_set_write_increment(&c, true);
+        uint offset = sizeof(src);
+        uint8_t *out = dst;
+        for (uint len = 1; len <= NUM_FRAGMENTS; len++) {
+            offset -= len;
+            dma_desc_list_add(&list, &c, out, src + offset, len, false);
+            out += len;
+        }
+        clear_data_channel_irq();
+        dma_desc_list_start(&list, false);
+        dma_desc_list_wait_for_finish_blocking(&list);
+        PICOTEST_CHECK(data_channel_irq(), "no IRQ at end of list");
+        offset = sizeof(src);
+        out = dst;
+        bool ok = true;
+        for (uint len = 1; len <= NUM_FRAGMENTS; len++) {
+            offset -= len;
+            ok &= !memcmp(out, src + offset, len);
+            out += len;
+        }
+        PICOTEST_CHECK(ok, "gathered data mismatch");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("scatter with per descriptor IRQ");
+        // scatter each word to the start of a row, and replicate it across the row (no read increment)
+        dma_desc_list_clear(&list);
+        dma_channel_config c = dma_desc_list_get_default_config(&list);
+        channel_config_set_write_increment(&c, true);
+        dma_desc_list_add(&list, &c, scattered[0], &words[0], 1, false);
+        channel_config_set_read_increment(&c, false);
+        for (uint i = 1; i < 4; i++) {
+            dma_desc_list_add(&list, &c, scattered[i], &words[i], 4, i == 1);
+        }
+        clear_data_channel_irq();
+        dma_desc_list_start(&list, false);
+        dma_desc_list_wait_for_finish_blocking(&list);
+        PICOTEST_CHECK(data_channel_irq(), "no IRQ");
+        PICOTEST_CHECK(scattered[0][0] == words[0] && !scattered[0][1], "wrong first row");
+        bool ok = true;
+        for (uint i = 1; i < 4; i++) {
+            for (uint j = 0; j < 4; j++) ok &= scattered[i][j] == words[i];
+        }
+        PICOTEST_CHECK(ok, "scattered data mismatch");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("loop");
+        // copy a changing word to two places forever
+        dma_desc_list_clear(&list);
+        dma_channel_config c = dma_desc_list_get_default_config(&list);
+        channel_config_set_dreq(&c, dma_get_timer_dreq(0));
+        dma_timer_claim(0);
+        dma_timer_set_fraction(0, 1, 1000);
+        words[0] = 0;
+        scattered[0][0] = scattered[0][1] = 1;
+        dma_desc_list_add(&list, &c, &scattered[0][0], &words[0], 1, false);
+        dma_desc_list_add(&list, &c, &scattered[0][1], &words[0], 1, false);
+        clear_data_channel_irq();
+        dma_desc_list_start(&list, true);
+        sleep_ms(1);
+        PICOTEST_CHECK(dma_desc_list_is_busy(&list), "looping list stopped");
+        PICOTEST_CHECK(!scattered[0][0] && !scattered[0][1], "not copied");
+        words[0] = 2;
+        sleep_ms(1);
+        PICOTEST_CHECK(scattered[0][0] == 2 && scattered[0][1] == 2, "list did not loop");
+        PICOTEST_CHECK(!data_channel_irq(), "IRQ from looping list");
+        dma_desc_list_abort(&list);
+        PICOTEST_CHECK(!dma_desc_list_is_busy(&list), "aborted list still busy");
+        words[0] = 3;
+        sleep_ms(1);
+        PICOTEST_CHECK(scattered[0][0] == 2, "copied after abort");
+        dma_timer_unclaim(0);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_END_TEST();
+}
@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/test.h"
+#include "hardware/irq.h"
+#include "hardware/irq_profile.h"
+
+PICOTEST_MODULE_NAME("IRQ_PROFILE", "IRQ profile test");
+
+static uint low_irq, high_irq;
+static volatile uint low_count, high_count, shared_count;
+
+static void high_handler(void) {
+    high_count++;
+    busy_wait_us_32(1000);
+}
+
+static void low_handler(void) {
+    low_count++;
+    busy_wait_us_32(2000);
+    // preempt ourselves with the higher priority IRQ
+    irq_set_pending(high_irq);
+    busy_wait_us_32(2000);
+}
+
+static void shared_handler(void) {
+    shared_count++;
+}
+
+int main() {
+    stdio_init_all();
+
+    PICOTEST_START();
+
+    low_irq = (uint)user_irq_claim_unused(true);
+    high_irq = (uint)user_irq_claim_unused(true);
+    irq_set_priority(low_irq, PICO_LOWEST_IRQ_PRIORITY);
+    irq_set_priority(high_irq, PICO_HIGHEST_IRQ_PRIORITY);
+
+    PICOTEST_START_SECTION("exclusive handler");
+        irq_set_exclusive_handler(high_irq, high_handler);
+        PICOTEST_CHECK(irq_get_exclusive_handler(high_irq) == high_handler, "profiling should be transparent to irq_get_exclusive_handler");
+        irq_set_enabled(high_irq, true);
+        for (int i = 0; i < 10; i++) {
+            irq_set_pending(high_irq);
+        }
+        irq_profile_stats_t stats;
+        PICOTEST_CHECK(irq_profile_get_handler_stats(high_irq, high_handler, &stats), "no stats for handler");
+        PICOTEST_CHECK(stats.count == 10 && high_count == 10, "wrong call count");
+        PICOTEST_CHECK(stats.min_cycles > 0 && stats.min_cycles <= irq_profile_stats_avg_cycles(&stats), "bad minimum");
+        PICOTEST_CHECK(irq_profile_stats_avg_cycles(&stats) <= stats.max_cycles, "bad maximum");
+        uint32_t total = 0;
+        for (uint b = 0; b < PICO_IRQ_PROFILE_HISTOGRAM_BUCKETS; b++) total += stats.histogram[b];
+        PICOTEST_CHECK(total == 10, "histogram doesn't match count");
+        PICOTEST_CHECK(!stats.preemptions, "unexpected preemption");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("preemption");
+        irq_profile_reset();
+        irq_set_exclusive_handler(low_irq, low_handler);
+        irq_set_enabled(low_irq, true);
+        irq_set_pending(low_irq);
+        irq_profile_stats_t low_stats, high_stats;
+        PICOTEST_CHECK(irq_profile_get_handler_stats(low_irq, low_handler, &low_stats), "no stats for handler");
+        PICOTEST_CHECK(irq_profile_get_handler_stats(high_irq, high_handler, &high_stats), "no stats for handler");
+        PICOTEST_CHECK(low_stats.count == 1 && high_stats.count == 1, "wrong call count");
+        PICOTEST_CHECK(low_stats.preemptions == 1, "preemption not counted");
+        // the low priority handler is timed excluding the nested handler, so should take ~4 times as long as it, not ~5
+        PICOTEST_CHECK(low_stats.total_cycles * 2 < high_stats.total_cycles * 9, "nested handler time not excluded");
+        irq_set_enabled(low_irq, false);
+        irq_remove_handler(low_irq, low_handler);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("shared handlers");
+        irq_profile_reset();
+        irq_add_shared_handler(low_irq, shared_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_add_shared_handler(low_irq, high_handler, PICO_SHARED_IRQ_HANDLER_HIGHEST_ORDER_PRIORITY);
+        irq_set_enabled(low_irq, true);
+        irq_set_pending(low_irq);
+        irq_set_pending(low_irq);
+        irq_profile_stats_t stats;
+        PICOTEST_CHECK(irq_profile_get_handler_stats(low_irq, shared_handler, &stats) && stats.count == 2, "wrong shared handler count");
+        PICOTEST_CHECK(irq_profile_get_irq_stats(low_irq, &stats) && stats.count == 4, "wrong combined count");
+        irq_set_enabled(low_irq, false);
+        irq_remove_handler(low_irq, shared_handler);
+        irq_remove_handler(low_irq, high_handler);
+        PICOTEST_CHECK(irq_profile_get_handler_stats(low_irq, shared_handler, &stats) && stats.count == 2, "stats lost on removal");
+    PICOTEST_END_SECTION();
+
+    irq_profile_dump();
+
+    PICOTEST_END_TEST();
+}
@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/test.h"
+#include "hardware/pio_loader.h"
+
+PICOTEST_MODULE_NAME("PIO_LOADER", "PIO program loader test");
+
+#define NOP 0xa042 // mov y, y
+// each filler program starts with a different "set x, <length>" so they aren't shared
+#define FILLER(n) 0xe020 | (n)
+
+static const uint16_t a_instructions[] = {FILLER(4), NOP, NOP, NOP};
+static const uint16_t a_copy_instructions[] = {FILLER(4), NOP, NOP, NOP};
+static const uint16_t b_instructions[] = {FILLER(8), NOP, NOP, NOP, NOP, NOP, NOP, NOP};
+static const uint16_t d_instructions[] = {FILLER(6), NOP, NOP, NOP, NOP, NOP};
+static const uint16_t e_instructions[] = {FILLER(21), NOP, NOP, NOP, NOP, NOP, NOP, NOP, NOP, NOP, NOP, NOP,
+                                          NOP, NOP, NOP, NOP, NOP, NOP, NOP, NOP, NOP};
+// pushes 5 to the RX FIFO forever, with a JMP back to the start which must be relocated
+static const uint16_t c_instructions[] = {
+        0xe025, // set x, 5
+        0xa0c1, // mov isr, x
+        0x8020, // push block
+        0x0000, // jmp 0
+};
+
+static const pio_program_t a = {a_instructions, count_of(a_instructions), -1};
+static const pio_program_t a_copy = {a_copy_instructions, count_of(a_copy_instructions), -1};
+static const pio_program_t b = {b_instructions, count_of(b_instructions), -1};
+static const pio_program_t c = {c_instructions, count_of(c_instructions), -1};
+static const pio_program_t d = {d_instructions, count_of(d_instructions), -1};
+static const pio_program_t e = {e_instructions, count_of(e_instructions), -1};
+
+static void start_sm(PIO pio, uint sm, uint offset, bool enable) {
+    pio_sm_config config = pio_get_default_sm_config();
+    sm_config_set_wrap(&config, offset, offset + c.length - 1);
+    pio_sm_init(pio, sm, offset, &config);
+    pio_sm_set_enabled(pio, sm, enable);
+}
+
+int main() {
+    setup_default_uart();
+    PICOTEST_START();
+
+    pio_clear_instruction_memory(pio0);
+    pio_clear_instruction_memory(pio1);
+
+    int ha, hb, hc, hd;
+    PICOTEST_START_SECTION("sharing");
+        ha = pio_loader_add_program_to_pio(pio0, &a, true);
+        PICOTEST_CHECK(pio_loader_add_program_to_pio(pio0, &a, true) == ha, "same program not shared");
+        PICOTEST_CHECK(pio_loader_add_program(&a_copy, true) == ha, "identical program not shared");
+        PICOTEST_CHECK(pio_loader_get_offset(ha) == 28, "wrong offset");
+        pio_loader_remove_program(ha);
+        pio_loader_remove_program(ha);
+        PICOTEST_CHECK(pio_loader_get_largest_free_gap(pio0) == 28, "program removed while still referenced");
+        pio_loader_remove_program(ha);
+        PICOTEST_CHECK(pio_loader_get_largest_free_gap(pio0) == 32, "program not removed");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("best fit");
+        hb = pio_loader_add_program_to_pio(pio0, &b, true);
+        hc = pio_loader_add_program_to_pio(pio0, &c, true);
+        PICOTEST_CHECK(pio_loader_get_offset(hb) == 24 && pio_loader_get_offset(hc) == 20, "wrong offsets");
+        pio_loader_remove_program(hb);
+        // gaps of 8 above c and 20 below
+        hd = pio_loader_add_program(&d, true);
+        PICOTEST_CHECK(pio_loader_get_pio(hd) == pio0, "not placed in the smallest gap");
+        PICOTEST_CHECK(pio_loader_get_offset(hd) == 26, "not placed in the smallest gap");
+        pio_loader_remove_program(hd);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("compaction");
+        uint sm = (uint)pio_claim_unused_sm(pio0, true);
+        start_sm(pio0, sm, pio_loader_get_offset(hc), false);
+        pio_loader_attach_sm(hc, sm);
+        PICOTEST_CHECK(pio_loader_add_program_to_pio(pio0, &e, false) < 0, "program should not fit");
+
+        // c is running, so can't be moved
+        pio_sm_set_enabled(pio0, sm, true);
+        PICOTEST_CHECK(pio_loader_compact() == 0, "running program moved");
+        PICOTEST_CHECK(pio_sm_get_blocking(pio0, sm) == 5, "program not running");
+        pio_sm_set_enabled(pio0, sm, false);
+
+        PICOTEST_CHECK(pio_loader_compact() == 1, "idle program not moved");
+        uint offset = pio_loader_get_offset(hc);
+        PICOTEST_CHECK(offset == 28, "wrong offset after compaction");
+        PICOTEST_CHECK(pio_loader_get_largest_free_gap(pio0) == 28, "free space not combined");
+        PICOTEST_CHECK(pio0->instr_mem[offset + 3] == pio_encode_jmp(offset), "JMP not relocated");
+        uint32_t execctrl = pio0->sm[sm].execctrl;
+        PICOTEST_CHECK(((execctrl & PIO_SM0_EXECCTRL_WRAP_TOP_BITS) >> PIO_SM0_EXECCTRL_WRAP_TOP_LSB) == offset + 3,
+                       "wrap top not relocated");
+        PICOTEST_CHECK(((execctrl & PIO_SM0_EXECCTRL_WRAP_BOTTOM_BITS) >> PIO_SM0_EXECCTRL_WRAP_BOTTOM_LSB) == offset,
+                       "wrap bottom not relocated");
+        uint pc = pio_sm_get_pc(pio0, sm);
+        PICOTEST_CHECK(pc >= offset && pc < offset + c.length, "PC not relocated");
+
+        // the relocated program still runs
+        while (!pio_sm_is_rx_fifo_empty(pio0, sm)) pio_sm_get(pio0, sm);
+        pio_sm_set_enabled(pio0, sm, true);
+        PICOTEST_CHECK(pio_sm_get_blocking(pio0, sm) == 5, "relocated program not running");
+        PICOTEST_CHECK(pio_sm_get_blocking(pio0, sm) == 5, "relocated program not running");
+        pio_sm_set_enabled(pio0, sm, false);
+
+        int he = pio_loader_add_program_to_pio(pio0, &e, false);
+        PICOTEST_CHECK(he >= 0, "program should fit after compaction");
+        pio_loader_remove_program(he);
+        pio_loader_detach_sm(hc, sm);
+        pio_loader_remove_program(hc);
+        pio_sm_unclaim(pio0, sm);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("both instances");
+        int he0 = pio_loader_add_program(&e, true);
+        int he1 = pio_loader_add_program(&e, true);
+        int hb1 = pio_loader_add_program(&b, true);
+        // e is shared, and b goes in the 11 instruction gap next to it rather than on the empty instance
+        PICOTEST_CHECK(he0 == he1, "program not shared");
+        PICOTEST_CHECK(pio_loader_get_pio(hb1) == pio_loader_get_pio(he0), "not placed in the smallest gap");
+        int he_other = pio_loader_add_program_to_pio(pio_loader_get_pio(he0) == pio0 ? pio1 : pio0, &e, true);
+        PICOTEST_CHECK(he_other != he0, "program shared across instances");
+        pio_loader_remove_program(he0);
+        pio_loader_remove_program(he1);
+        pio_loader_remove_program(hb1);
+        pio_loader_remove_program(he_other);
+        PICOTEST_CHECK(pio_loader_get_largest_free_gap(pio0) == 32 && pio_loader_get_largest_free_gap(pio1) == 32,
+                       "programs not removed");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_END_TEST();
+}
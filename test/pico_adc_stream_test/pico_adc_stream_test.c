@@ -0,0 +1,128 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+
+#include "pico/stdlib.h"
+#include "pico/adc_stream.h"
+#include "pico/adc_stream_synthetic.h"
+#include "pico/test.h"
+
+PICOTEST_MODULE_NAME("ADC_STREAM", "ADC stream buffering test (synthetic source)");
+
+#define BLOCK_SAMPLES 8
+#define NUM_BLOCKS 4
+
+ADC_STREAM_BUFFER(buffer, BLOCK_SAMPLES, NUM_BLOCKS);
+
+static adc_stream_t stream;
+static uint callback_count;
+static uint32_t last_callback_sequence;
+
+static void block_callback(adc_stream_t *s, const adc_stream_block_t *block) {
+    callback_count++;
+    last_callback_sequence = block->sequence;
+}
+
+// check the samples of each input in a block are consecutive samples (in round robin order) of that input
+static bool check_demux(const adc_stream_block_t *block) {
+    uint16_t samples[NUM_ADC_CHANNELS][BLOCK_SAMPLES];
+    uint16_t *buffers[NUM_ADC_CHANNELS];
+    uint counts[NUM_ADC_CHANNELS];
+    for (uint i = 0; i < NUM_ADC_CHANNELS; i++) buffers[i] = samples[i];
+    adc_stream_demux(&stream, block, buffers, counts);
+    uint total = 0;
+    for (uint i = 0; i < stream.num_inputs; i++) {
+        uint input = stream.inputs[i];
+        total += counts[input];
+        for (uint j = 0; j < counts[input]; j++) {
+            uint32_t sample_num = block->sequence * BLOCK_SAMPLES + (i + stream.num_inputs - block->phase) % stream.num_inputs + j * stream.num_inputs;
+            if (samples[input][j] != (uint16_t)((input << 9) | (sample_num & 0x1ff))) return false;
+        }
+    }
+    return total == BLOCK_SAMPLES;
+}
+
+int main() {
+    stdio_init_all();
+
+    adc_stream_config_t config = {
+        .input_mask = 0x7,
+        .sample_rate = 500000,
+        .buffer = buffer,
+        .block_samples = BLOCK_SAMPLES,
+        .num_blocks = NUM_BLOCKS,
+    };
+    adc_stream_block_t block;
+    adc_stream_stats_t stats;
+
+    PICOTEST_START();
+
+    PICOTEST_START_SECTION("round robin demux");
+        adc_stream_init(&stream, &config);
+        PICOTEST_CHECK(stream.num_inputs == 3, "wrong input count");
+        adc_stream_start(&stream);
+        PICOTEST_CHECK(!adc_stream_try_get_block(&stream, &block), "block before any were filled");
+        adc_stream_synthetic_fill_blocks(2);
+        for (uint i = 0; i < 2; i++) {
+            PICOTEST_CHECK(adc_stream_try_get_block(&stream, &block), "no block");
+            PICOTEST_CHECK(block.sequence == i, "wrong sequence");
+            PICOTEST_CHECK(block.phase == (i * BLOCK_SAMPLES) % 3, "wrong phase");
+            PICOTEST_CHECK(check_demux(&block), "wrong demuxed samples");
+            adc_stream_release_block(&stream, &block);
+        }
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("overrun");
+        // two blocks are being filled, so only two can be held by the application
+        adc_stream_synthetic_fill_blocks(3);
+        adc_stream_get_stats(&stream, &stats);
+        PICOTEST_CHECK(stats.blocks == 5 && stats.overruns == 1, "overrun not counted");
+        adc_stream_get_block_blocking(&stream, &block);
+        PICOTEST_CHECK(block.sequence == 2, "wrong sequence");
+        PICOTEST_CHECK(check_demux(&block), "wrong demuxed samples");
+        adc_stream_release_block(&stream, &block);
+        adc_stream_get_block_blocking(&stream, &block);
+        PICOTEST_CHECK(block.sequence == 3, "wrong sequence");
+        adc_stream_release_block(&stream, &block);
+        adc_stream_synthetic_fill_blocks(1);
+        adc_stream_get_block_blocking(&stream, &block);
+        PICOTEST_CHECK(block.sequence == 5, "dropped block delivered");
+        PICOTEST_CHECK(check_demux(&block), "wrong demuxed samples");
+        adc_stream_release_block(&stream, &block);
+        adc_stream_get_stats(&stream, &stats);
+        PICOTEST_CHECK(stats.delivered == 5, "deliveries not counted");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("missed irq");
+        adc_stream_synthetic_miss_irq();
+        adc_stream_synthetic_fill_blocks(1);
+        adc_stream_get_block_blocking(&stream, &block);
+        PICOTEST_CHECK(block.sequence == 8 && block.phase == 0, "restart not visible in sequence");
+        adc_stream_release_block(&stream, &block);
+        adc_stream_get_stats(&stream, &stats);
+        PICOTEST_CHECK(stats.restarts == 1, "restart not counted");
+        adc_stream_stop(&stream);
+        PICOTEST_CHECK(!adc_stream_synthetic_fill_blocks(1), "filled stopped stream");
+        adc_stream_deinit(&stream);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("callback");
+        config.callback = block_callback;
+        config.input_mask = 0x10;
+        adc_stream_init(&stream, &config);
+        adc_stream_start(&stream);
+        // blocks are returned as soon as the callback returns, so there are never overruns
+        adc_stream_synthetic_fill_blocks(100);
+        adc_stream_get_stats(&stream, &stats);
+        PICOTEST_CHECK(callback_count == 100 && last_callback_sequence == 99, "callback not called");
+        PICOTEST_CHECK(stats.delivered == 100 && !stats.overruns, "wrong stats");
+        adc_stream_stop(&stream);
+        adc_stream_deinit(&stream);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_END_TEST();
+}
@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/crc.h"
+
+// Compares the throughput of crc_update (which uses the DMA sniffer on device) with the software implementation,
+// for buffers in RAM and (on device) flash
+
+#define BUFFER_SIZE 32768
+#define TOTAL_BYTES (1024 * 1024)
+
+static uint8_t buffer[BUFFER_SIZE] __attribute__((aligned(4)));
+
+typedef uint32_t (*crc_func_t)(crc_type_t type, uint32_t crc, const void *data, size_t len);
+
+static float mb_per_s(crc_func_t func, crc_type_t type, const uint8_t *data, uint size) {
+    uint repeats = TOTAL_BYTES / size;
+    uint32_t crc = crc_initial_value(type);
+    absolute_time_t start = get_absolute_time();
+    for (uint r = 0; r < repeats; r++) {
+        crc = func(type, crc, data, size);
+    }
+    int64_t us = absolute_time_diff_us(start, get_absolute_time());
+    // use the result so the calls can't be removed
+    if (crc == 0x12345678) printf(".");
+    return us ? (float)(repeats * size) / (float)us : 0;
+}
+
+static void benchmark(const char *name, const uint8_t *data) {
+    static const uint sizes[] = {64, 256, 4096, BUFFER_SIZE};
+    static const struct {
+        crc_type_t type;
+        const char *name;
+    } types[] = {
+            {CRC_32, "CRC-32"},
+            {CRC_16_CCITT, "CRC-16-CCITT"},
+            {CRC_SUM32, "SUM32"},
+    };
+    printf("%s\n", name);
+    printf("  %-14s %8s %12s %12s\n", "algorithm", "size", "crc_update", "software");
+    for (uint t = 0; t < count_of(types); t++) {
+        for (uint s = 0; s < count_of(sizes); s++) {
+            float hw = mb_per_s(crc_update, types[t].type, data, sizes[s]);
+            float sw = mb_per_s(crc_update_software, types[t].type, data, sizes[s]);
+            printf("  %-14s %8u %7.2f MB/s %7.2f MB/s\n", types[t].name, sizes[s], hw, sw);
+        }
+    }
+}
+
+int main() {
+    setup_default_uart();
+    for (uint i = 0; i < BUFFER_SIZE; i++) buffer[i] = (uint8_t)(i * 31 + 7);
+    benchmark("RAM", buffer);
+#if PICO_ON_DEVICE
+    // the start of flash (i.e. this program) is as good as anything to read
+    benchmark("Flash (XIP)", (const uint8_t *)XIP_BASE);
+#endif
+    return 0;
+}
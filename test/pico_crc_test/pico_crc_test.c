@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/crc.h"
+#include "pico/test.h"
+#if PICO_ON_DEVICE
+#include "pico/crc_sniff.h"
+#include "hardware/dma.h"
+#endif
+
+PICOTEST_MODULE_NAME("CRC", "CRC and checksum test");
+
+static const uint32_t check_values[CRC_TYPE_COUNT] = {
+        [CRC_32] = 0xcbf43926,
+        [CRC_32_MPEG2] = 0x0376e6e7,
+        [CRC_16_CCITT] = 0x29b1,
+        [CRC_16_XMODEM] = 0x31c3,
+        [CRC_16_KERMIT] = 0x2189,
+};
+
+static uint8_t data[1024 + 8] __attribute__((aligned(4)));
+
+// straightforward bit at a time implementation to check against
+static uint32_t reference_crc(crc_type_t type, const uint8_t *bytes, size_t len) {
+    uint32_t poly = type == CRC_32 || type == CRC_32_MPEG2 ? 0x04c11db7 : 0x1021;
+    uint width = type == CRC_32 || type == CRC_32_MPEG2 ? 32 : 16;
+    bool reflected = type == CRC_32 || type == CRC_16_KERMIT;
+    uint32_t top = 1u << (width - 1);
+    uint32_t crc = type == CRC_32 || type == CRC_32_MPEG2 ? 0xffffffff : type == CRC_16_CCITT ? 0xffff : 0;
+    for (size_t i = 0; i < len; i++) {
+        for (uint bit = 0; bit < 8; bit++) {
+            uint in = reflected ? (bytes[i] >> bit) & 1 : (bytes[i] >> (7 - bit)) & 1;
+            bool feedback = !!(crc & top) != in;
+            crc = (crc << 1) & (top | (top - 1));
+            if (feedback) crc ^= poly;
+        }
+    }
+    if (reflected) {
+        uint32_t r = 0;
+        for (uint bit = 0; bit < width; bit++) if (crc & (1u << bit)) r |= top >> bit;
+        crc = r;
+    }
+    return type == CRC_32 ? ~crc : crc;
+}
+
+int main() {
+    setup_default_uart();
+    PICOTEST_START();
+
+    for (uint i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(i * 167 + (i >> 8) * 13 + 1);
+
+    PICOTEST_START_SECTION("check values");
+        for (crc_type_t type = CRC_32; type <= CRC_16_KERMIT; type++) {
+            PICOTEST_CHECK(crc_compute(type, "123456789", 9) == check_values[type], "wrong check value");
+            PICOTEST_CHECK(crc_update_software(type, crc_initial_value(type), "123456789", 9) == check_values[type],
+                           "wrong software check value");
+        }
+        PICOTEST_CHECK(crc_compute(CRC_32, NULL, 0) == crc_initial_value(CRC_32), "wrong empty value");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("all alignments and lengths");
+        // lengths either side of the point at which the DMA is used on device
+        static const uint lengths[] = {1, 3, 4, 7, 63, 64, 65, 67, 100, 256, 1021, 1024};
+        for (crc_type_t type = CRC_32; type <= CRC_16_KERMIT; type++) {
+            for (uint offset = 0; offset < 4; offset++) {
+                for (uint l = 0; l < count_of(lengths); l++) {
+                    uint32_t expected = reference_crc(type, data + offset, lengths[l]);
+                    PICOTEST_CHECK(crc_compute(type, data + offset, lengths[l]) == expected, "wrong crc");
+                    PICOTEST_CHECK(crc_update_software(type, crc_initial_value(type), data + offset, lengths[l]) == expected,
+                                   "wrong software crc");
+                }
+            }
+        }
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("in pieces");
+        for (crc_type_t type = CRC_32; type < CRC_TYPE_COUNT; type++) {
+            uint32_t whole = crc_compute(type, data, 1024);
+            for (uint split = 0; split <= 1024; split += type == CRC_SUM32 ? 4 : 31) {
+                uint32_t crc = crc_update(type, crc_initial_value(type), data, split);
+                crc = crc_update(type, crc, data + split, 1024 - split);
+                PICOTEST_CHECK(crc == whole, "pieces differ from whole");
+            }
+        }
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("checksums");
+        uint32_t sum = 0;
+        uint parity = 0;
+        for (uint i = 0; i < 1024; i += 4) {
+            uint32_t word;
+            memcpy(&word, data + i, 4);
+            sum += word;
+            parity ^= (uint)__builtin_parity(word);
+        }
+        PICOTEST_CHECK(crc_compute(CRC_SUM32, data, 1024) == sum, "wrong sum");
+        PICOTEST_CHECK(crc_compute(CRC_PARITY, data, 1024) == parity, "wrong parity");
+        PICOTEST_CHECK(crc_compute(CRC_PARITY, data + 1, 1023) == (parity ^ (uint)__builtin_parity(data[0])),
+                       "wrong unaligned parity");
+    PICOTEST_END_SECTION();
+
+#if PICO_ON_DEVICE
+    PICOTEST_START_SECTION("sniff a user transfer");
+        static uint8_t copy[1024];
+        uint chan = (uint)dma_claim_unused_channel(true);
+        for (crc_type_t type = CRC_32; type <= CRC_16_KERMIT; type++) {
+            for (uint size = DMA_SIZE_8; size <= DMA_SIZE_32; size++) {
+                dma_channel_config c = dma_channel_get_default_config(chan);
+                channel_config_set_transfer_data_size(&c, (enum dma_channel_transfer_size)size);
+                channel_config_set_write_increment(&c, true);
+                dma_channel_configure(chan, &c, copy, data, 1024 >> size, false);
+                crc_sniff_start(chan, type, crc_initial_value(type));
+                dma_channel_start(chan);
+                dma_channel_wait_for_finish_blocking(chan);
+                PICOTEST_CHECK(crc_sniff_finish() == crc_compute(type, data, 1024), "wrong sniffed crc");
+            }
+        }
+        PICOTEST_CHECK(!memcmp(copy, data, 1024), "sniffed transfer corrupted");
+        dma_channel_unclaim(chan);
+    PICOTEST_END_SECTION();
+#endif
+
+    PICOTEST_END_TEST();
+}
@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "pico/test.h"
+#include "pico/dvfs.h"
+#include "hardware/clocks.h"
+#include "hardware/pwm.h"
+#include "hardware/uart.h"
+
+PICOTEST_MODULE_NAME("DVFS", "DVFS test");
+
+static uint pre_count, post_count;
+static uint32_t notified_new_hz;
+
+static void notifier(enum dvfs_phase phase, const dvfs_transition_t *t, void *user_data) {
+    PICOTEST_CHECK(user_data == &pre_count, "wrong user data");
+    if (phase == DVFS_PRE_CHANGE) {
+        PICOTEST_CHECK(clock_get_hz(clk_sys) == t->old_sys_hz, "clock changed before DVFS_PRE_CHANGE");
+        pre_count++;
+    } else {
+        PICOTEST_CHECK(clock_get_hz(clk_sys) == t->new_sys_hz, "clock not changed by DVFS_POST_CHANGE");
+        notified_new_hz = t->new_sys_hz;
+        post_count++;
+    }
+}
+
+static bool within_percent(uint32_t a, uint32_t b, uint percent) {
+    return (uint32_t)abs((int32_t)(a - b)) <= b / 100 * percent;
+}
+
+int main() {
+    setup_default_uart();
+    PICOTEST_START();
+
+    dvfs_init(NULL, 0);
+    uint count = dvfs_get_level_count();
+#if PICO_DEFAULT_UART_BAUD_RATE
+    uint baud = uart_get_hw(uart_default)->ibrd ? (4 * clock_get_hz(clk_peri)) /
+            ((uart_get_hw(uart_default)->ibrd << 6) + uart_get_hw(uart_default)->fbrd) : 0;
+#endif
+
+    // a PWM slice counting at 1 MHz
+    uint slice = 0;
+    pwm_config config = pwm_get_default_config();
+    pwm_config_set_clkdiv(&config, (float)clock_get_hz(clk_sys) / 1000000);
+    pwm_init(slice, &config, true);
+
+    PICOTEST_START_SECTION("Initial level");
+        PICOTEST_CHECK(count == 4, "expected the 4 default levels");
+        // the default 125 MHz
+        PICOTEST_CHECK(dvfs_get_level() == 1, "current level not identified");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("Level transitions");
+        PICOTEST_CHECK(dvfs_add_notifier(notifier, &pre_count), "could not add notifier");
+        static const uint sequence[] = {0, 3, 1, 2, 0, 2, 3, 1};
+        for (uint i = 0; i < count_of(sequence); i++) {
+            uint level = sequence[i];
+            dvfs_set_level(level);
+            uint32_t sys_khz = dvfs_get_level_info(level)->sys_khz;
+            uint32_t measured_khz = frequency_count_khz(CLOCKS_FC0_SRC_VALUE_CLK_SYS);
+            printf("level %d: clk_sys %d Hz (measured %d kHz), clk_peri %d Hz\n", level, (int)clock_get_hz(clk_sys),
+                   (int)measured_khz, (int)clock_get_hz(clk_peri));
+            PICOTEST_CHECK(dvfs_get_level() == (int)level, "level not changed");
+            PICOTEST_CHECK(clock_get_hz(clk_sys) == sys_khz * 1000, "clk_sys not at level frequency");
+            PICOTEST_CHECK(notified_new_hz == clock_get_hz(clk_sys), "notifier not told the new frequency");
+            PICOTEST_CHECK(within_percent(measured_khz, sys_khz, 1), "measured clk_sys differs");
+#if PICO_DEFAULT_UART_BAUD_RATE
+            uint new_baud = (4 * clock_get_hz(clk_peri)) /
+                    ((uart_get_hw(uart_default)->ibrd << 6) + uart_get_hw(uart_default)->fbrd);
+            PICOTEST_CHECK(within_percent(new_baud, baud, 1), "UART baud rate not kept");
+#endif
+            // the slice should still count at 1 MHz
+            uint16_t start = pwm_get_counter(slice);
+            busy_wait_us_32(1000);
+            uint16_t ticks = (uint16_t)(pwm_get_counter(slice) - start);
+            PICOTEST_CHECK(ticks >= 980 && ticks <= 1020, "PWM counting rate not kept");
+        }
+        PICOTEST_CHECK(pre_count == count_of(sequence) && post_count == count_of(sequence), "notifier not called");
+        dvfs_set_level(dvfs_get_level());
+        PICOTEST_CHECK(pre_count == count_of(sequence), "notifier called for no change");
+        dvfs_remove_notifier(notifier, &pre_count);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("Transition latency");
+        dvfs_stats_t stats;
+        dvfs_get_stats(&stats, true);
+        printf("%d transitions, average %d us, max %d us; last: notify %d us, vreg %d us, switch %d us\n",
+               (int)stats.transitions, (int)(stats.total_us / stats.transitions), (int)stats.max_us,
+               (int)stats.last_notify_us, (int)stats.last_vreg_us, (int)stats.last_switch_us);
+        PICOTEST_CHECK(stats.transitions == 8, "wrong transition count");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("Governor");
+        dvfs_set_level(1);
+        dvfs_governor_config_t config = dvfs_governor_get_default_config();
+        config.period_ms = 10;
+        PICOTEST_CHECK(dvfs_governor_start(&config), "could not start governor");
+        // mostly idle, so the governor should move down to the lowest level
+        absolute_time_t until = make_timeout_time_ms(200);
+        while (absolute_time_diff_us(get_absolute_time(), until) > 0) {
+            dvfs_sleep_until(make_timeout_time_ms(5));
+            busy_wait_us_32(100);
+        }
+        PICOTEST_CHECK(dvfs_get_level() == 0, "governor didn't move down when idle");
+        // busy, so it should move up to the highest
+        busy_wait_ms(200);
+        PICOTEST_CHECK(dvfs_get_level() == (int)count - 1, "governor didn't move up when busy");
+        dvfs_governor_stop();
+        dvfs_set_level(1);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_END_TEST();
+}
@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/test.h"
+#include "pico/i2c_queue.h"
+
+PICOTEST_MODULE_NAME("I2C_QUEUE", "I2C transaction queue test");
+
+// Nothing needs to be connected to the default I2C pins (which are pulled up internally); every transaction is to an
+// absent device, so is aborted when its address is not acknowledged, which exercises queueing, completion and the
+// error statistics
+
+#define TRANSACTIONS 4
+
+static uint completion_order[TRANSACTIONS];
+static uint completion_count;
+
+static void record_completion(i2c_transaction_t *t) {
+    completion_order[completion_count++] = (uint)(uintptr_t)t->user_data;
+}
+
+static uint8_t reg = 0x10;
+static uint8_t data[32];
+static const i2c_op_t ops[] = { I2C_OP_WRITE_BUF(&reg, 1), I2C_OP_READ_BUF(data, sizeof(data)) };
+
+static bool run_transactions(i2c_queue_t *queue) {
+    static i2c_transaction_t t[TRANSACTIONS];
+    completion_count = 0;
+    for (uint i = 0; i < TRANSACTIONS; i++) {
+        t[i] = (i2c_transaction_t) {
+                .addr = (uint8_t)(0x50 + i),
+                .ops = ops,
+                .op_count = count_of(ops),
+                .callback = record_completion,
+                .user_data = (void *)(uintptr_t)i,
+        };
+        i2c_queue_submit(queue, &t[i]);
+    }
+    i2c_queue_wait_for_idle_blocking(queue);
+    bool ok = completion_count == TRANSACTIONS;
+    for (uint i = 0; i < TRANSACTIONS; i++) {
+        ok &= completion_order[i] == i && i2c_transaction_is_done(&t[i]) && t[i].result == PICO_ERROR_GENERIC &&
+              (t[i].abort_source & I2C_IC_TX_ABRT_SOURCE_ABRT_7B_ADDR_NOACK_BITS);
+    }
+    return ok;
+}
+
+int main() {
+    setup_default_uart();
+    PICOTEST_START();
+
+    i2c_init(i2c_default, 100000);
+    gpio_set_function(PICO_DEFAULT_I2C_SDA_PIN, GPIO_FUNC_I2C);
+    gpio_set_function(PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C);
+    gpio_pull_up(PICO_DEFAULT_I2C_SDA_PIN);
+    gpio_pull_up(PICO_DEFAULT_I2C_SCL_PIN);
+
+    i2c_queue_t queue;
+    i2c_queue_init(&queue, i2c_default);
+    i2c_queue_stats_t stats;
+
+    PICOTEST_START_SECTION("IRQ driven transactions complete in order");
+        PICOTEST_CHECK(run_transactions(&queue), "transactions did not complete as expected");
+        i2c_queue_get_stats(&queue, &stats, true);
+        PICOTEST_CHECK(stats.transactions == TRANSACTIONS, "wrong transaction count");
+        PICOTEST_CHECK(stats.aborts == TRANSACTIONS && stats.address_nacks == TRANSACTIONS, "wrong abort counts");
+        PICOTEST_CHECK(!stats.dma_transactions, "DMA used without a buffer");
+        PICOTEST_CHECK(!stats.bytes_read && !stats.bytes_written, "bytes counted for aborted transactions");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("DMA driven transactions complete in order");
+        static uint16_t cmd_buffer[64];
+        i2c_queue_set_dma_buffer(&queue, cmd_buffer, count_of(cmd_buffer));
+        PICOTEST_CHECK(run_transactions(&queue), "transactions did not complete as expected");
+        i2c_queue_get_stats(&queue, &stats, true);
+        PICOTEST_CHECK(stats.dma_transactions == TRANSACTIONS, "DMA not used");
+        PICOTEST_CHECK(stats.address_nacks == TRANSACTIONS, "wrong abort counts");
+        i2c_queue_set_dma_buffer(&queue, NULL, 0);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("blocking functions still work after deinit");
+        i2c_queue_deinit(&queue);
+        uint8_t rxdata;
+        PICOTEST_CHECK(i2c_read_timeout_us(i2c_default, 0x50, &rxdata, 1, false, 10000) == PICO_ERROR_GENERIC,
+                       "unexpected result from absent device");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_END_TEST();
+}
@@ -0,0 +1,173 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/test.h"
+#include "pico/i2c_slave.h"
+
+PICOTEST_MODULE_NAME("I2C_SLAVE", "I2C slave test");
+
+// I2C0 is the master, and I2C1 the slave: connect GPIO 4 to 6 (SDA) and 5 to 7 (SCL), with external pull-ups (e.g.
+// 2.2K to 3V3), as the internal ones are too weak for 1 MHz
+
+#define MASTER_SDA_PIN 4
+#define MASTER_SCL_PIN 5
+#define SLAVE_SDA_PIN 6
+#define SLAVE_SCL_PIN 7
+#define SLAVE_ADDR 0x17
+#define BAUDRATE 1000000
+
+static void setup_pins(uint sda, uint scl) {
+    gpio_set_function(sda, GPIO_FUNC_I2C);
+    gpio_set_function(scl, GPIO_FUNC_I2C);
+    gpio_pull_up(sda);
+    gpio_pull_up(scl);
+}
+
+static volatile uint finished_count;
+static volatile uint finished_transfers;
+static volatile bool finished_is_read;
+
+static bool wait_for_finish(uint transfers) {
+    absolute_time_t timeout = make_timeout_time_ms(100);
+    while (finished_transfers < transfers) {
+        if (time_reached(timeout)) return false;
+    }
+    return true;
+}
+
+// register file
+
+static uint8_t reg_mem[64];
+static uint written_first, written_count;
+
+static void regs_written(i2c_slave_regs_t *regs, uint first, uint count) {
+    written_first = first;
+    written_count = count;
+    finished_transfers++;
+}
+
+// streaming
+
+#define STREAM_BYTES 4096
+#define CHUNK 100
+
+static uint8_t master_buf[STREAM_BYTES];
+static uint8_t slave_rx[STREAM_BYTES];
+
+static inline uint8_t pattern(uint i) {
+    return (uint8_t)(i * 13 + (i >> 8));
+}
+
+static uint8_t *stream_rx_buffer(void *context, uint offset, uint *len) {
+    if (offset >= STREAM_BYTES) return NULL;
+    *len = MIN(CHUNK, STREAM_BYTES - offset);
+    return slave_rx + offset;
+}
+
+static const uint8_t *stream_tx_data(void *context, uint offset, uint *len) {
+    static uint8_t chunk[CHUNK];
+    if (offset >= STREAM_BYTES) return NULL;
+    *len = MIN(CHUNK, STREAM_BYTES - offset);
+    for (uint i = 0; i < *len; i++) chunk[i] = pattern(offset + i);
+    return chunk;
+}
+
+static void stream_finish(void *context, bool is_read, uint count) {
+    finished_is_read = is_read;
+    finished_count = count;
+    finished_transfers++;
+}
+
+static const i2c_slave_handler_t stream_handler = {
+        .rx_buffer = stream_rx_buffer,
+        .tx_data = stream_tx_data,
+        .finish = stream_finish,
+};
+
+int main() {
+    setup_default_uart();
+    PICOTEST_START();
+
+    i2c_init(i2c0, BAUDRATE);
+    setup_pins(MASTER_SDA_PIN, MASTER_SCL_PIN);
+    i2c_init(i2c1, BAUDRATE);
+    setup_pins(SLAVE_SDA_PIN, SLAVE_SCL_PIN);
+
+    PICOTEST_START_SECTION("register file");
+        i2c_slave_regs_t regs = {
+                .mem = reg_mem,
+                .size = sizeof(reg_mem),
+                .increment_block = 16,
+                .addr_bytes = 1,
+                .written = regs_written,
+        };
+        i2c_slave_regs_init(i2c1, SLAVE_ADDR, &regs);
+
+        // write 4 registers at 0x1e, which wrap around within the block at 0x10
+        finished_transfers = 0;
+        uint8_t cmd[] = {0x1e, 1, 2, 3, 4};
+        PICOTEST_CHECK(i2c_write_blocking(i2c0, SLAVE_ADDR, cmd, sizeof(cmd), false) == sizeof(cmd), "write failed");
+        PICOTEST_CHECK(wait_for_finish(1), "written callback not called");
+        PICOTEST_CHECK(written_first == 0x1e && written_count == 4, "wrong registers reported written");
+        PICOTEST_CHECK(reg_mem[0x1e] == 1 && reg_mem[0x1f] == 2 && reg_mem[0x10] == 3 && reg_mem[0x11] == 4,
+                       "registers not written");
+
+        // read them back from the same address
+        uint8_t data[4];
+        memset(data, 0, sizeof(data));
+        PICOTEST_CHECK(i2c_write_blocking(i2c0, SLAVE_ADDR, cmd, 1, true) == 1, "address write failed");
+        PICOTEST_CHECK(i2c_read_blocking(i2c0, SLAVE_ADDR, data, sizeof(data), false) == sizeof(data), "read failed");
+        PICOTEST_CHECK(!memcmp(data, cmd + 1, sizeof(data)), "wrong data read");
+
+        // a further read continues from where the last one ended
+        reg_mem[0x12] = 0x5a;
+        PICOTEST_CHECK(i2c_read_blocking(i2c0, SLAVE_ADDR, data, 1, false) == 1, "read failed");
+        PICOTEST_CHECK(data[0] == 0x5a, "address not auto-incremented");
+        i2c_slave_deinit(i2c1);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("streaming write");
+        i2c_slave_init(i2c1, SLAVE_ADDR, &stream_handler);
+        for (uint i = 0; i < STREAM_BYTES; i++) master_buf[i] = pattern(i);
+        finished_transfers = 0;
+        absolute_time_t start = get_absolute_time();
+        int rc = i2c_write_blocking(i2c0, SLAVE_ADDR, master_buf, STREAM_BYTES, false);
+        int64_t us = absolute_time_diff_us(start, get_absolute_time());
+        PICOTEST_CHECK(rc == STREAM_BYTES, "write failed");
+        PICOTEST_CHECK(wait_for_finish(1), "finish not called");
+        PICOTEST_CHECK(!finished_is_read && finished_count == STREAM_BYTES, "wrong byte count received");
+        PICOTEST_CHECK(!memcmp(master_buf, slave_rx, STREAM_BYTES), "received data differs from sent data");
+        printf("%d bytes written in %d us\n", STREAM_BYTES, (int)us);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("streaming read");
+        memset(master_buf, 0, sizeof(master_buf));
+        finished_transfers = 0;
+        absolute_time_t start = get_absolute_time();
+        int rc = i2c_read_blocking(i2c0, SLAVE_ADDR, master_buf, STREAM_BYTES, false);
+        int64_t us = absolute_time_diff_us(start, get_absolute_time());
+        PICOTEST_CHECK(rc == STREAM_BYTES, "read failed");
+        PICOTEST_CHECK(wait_for_finish(1), "finish not called");
+        // bytes put in the TX FIFO beyond those read must not be counted
+        PICOTEST_CHECK(finished_is_read && finished_count == STREAM_BYTES, "wrong byte count sent");
+        bool ok = true;
+        for (uint i = 0; i < STREAM_BYTES; i++) ok &= master_buf[i] == pattern(i);
+        PICOTEST_CHECK(ok, "read data differs from slave data");
+        printf("%d bytes read in %d us\n", STREAM_BYTES, (int)us);
+
+        // a short read stops before the end of the slave's data
+        finished_transfers = 0;
+        PICOTEST_CHECK(i2c_read_blocking(i2c0, SLAVE_ADDR, master_buf, 3, false) == 3, "read failed");
+        PICOTEST_CHECK(wait_for_finish(1), "finish not called");
+        PICOTEST_CHECK(finished_count == 3, "wrong byte count sent");
+        i2c_slave_deinit(i2c1);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_END_TEST();
+}
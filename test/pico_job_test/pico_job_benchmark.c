@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "pico/stdlib.h"
+#include "pico/job.h"
+
+// Compares running each kernel on one core against running it with parallel_for/parallel_reduce across both cores
+
+#define BUFFER_SIZE (32 * 1024)
+#define CRC_BLOCK_SIZE 1024
+#define FLOAT_COUNT 20000
+#define REPEATS 8
+
+static uint8_t src[BUFFER_SIZE];
+static uint8_t dst[BUFFER_SIZE];
+static uint32_t block_crcs[BUFFER_SIZE / CRC_BLOCK_SIZE];
+
+// memory bound: copy BUFFER_SIZE bytes in 256 byte pieces
+static void copy_range(__unused void *arg, uint32_t begin, uint32_t end) {
+    memcpy(dst + begin * 256, src + begin * 256, (end - begin) * 256);
+}
+
+static uint32_t crc32_bitwise(const uint8_t *data, size_t len) {
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xedb88320u & -(crc & 1u));
+        }
+    }
+    return ~crc;
+}
+
+// compute bound (integer): CRC32 of each CRC_BLOCK_SIZE byte block
+static void crc_range(__unused void *arg, uint32_t begin, uint32_t end) {
+    for (uint32_t block = begin; block < end; block++) {
+        block_crcs[block] = crc32_bitwise(src + block * CRC_BLOCK_SIZE, CRC_BLOCK_SIZE);
+    }
+}
+
+// compute bound (float): sum of a function evaluated at FLOAT_COUNT points
+static void float_range(__unused void *arg, uint32_t begin, uint32_t end, void *acc) {
+    float sum = 0;
+    for (uint32_t i = begin; i < end; i++) {
+        float x = (float) i * 0.001f;
+        sum += sinf(x) * sqrtf(x + 1.0f);
+    }
+    *(float *) acc += sum;
+}
+
+static void float_combine(void *acc, const void *value) {
+    *(float *) acc += *(const float *) value;
+}
+
+static uint64_t time_copy(bool parallel) {
+    uint64_t start = time_us_64();
+    for (int r = 0; r < REPEATS; r++) {
+        if (parallel) parallel_for(0, BUFFER_SIZE / 256, 8, copy_range, NULL);
+        else copy_range(NULL, 0, BUFFER_SIZE / 256);
+    }
+    return time_us_64() - start;
+}
+
+static uint64_t time_crc(bool parallel) {
+    uint64_t start = time_us_64();
+    for (int r = 0; r < REPEATS; r++) {
+        if (parallel) parallel_for(0, count_of(block_crcs), 1, crc_range, NULL);
+        else crc_range(NULL, 0, count_of(block_crcs));
+    }
+    return time_us_64() - start;
+}
+
+static uint64_t time_float(bool parallel, float *result) {
+    uint64_t start = time_us_64();
+    for (int r = 0; r < REPEATS; r++) {
+        *result = 0;
+        if (parallel) parallel_reduce(0, FLOAT_COUNT, 500, float_range, float_combine, result, sizeof(float), NULL);
+        else float_range(NULL, 0, FLOAT_COUNT, result);
+    }
+    return time_us_64() - start;
+}
+
+static void report(const char *name, uint64_t bytes, uint64_t single_us, uint64_t parallel_us) {
+    if (!single_us) single_us = 1;
+    if (!parallel_us) parallel_us = 1;
+    printf("%-8s %10llu %10llu %10.2f %10.2f %8.2fx\n", name, (unsigned long long) single_us,
+           (unsigned long long) parallel_us, (double) bytes / (double) single_us, (double) bytes / (double) parallel_us,
+           (double) single_us / (double) parallel_us);
+}
+
+int main() {
+    stdio_init_all();
+    job_system_init();
+
+    for (uint i = 0; i < BUFFER_SIZE; i++) {
+        src[i] = (uint8_t) (i * 31 + (i >> 8));
+    }
+
+    printf("kernel    1 core us  2 core us  1 core MB/s 2 core MB/s  speedup\n");
+
+    uint64_t single_us = time_copy(false);
+    uint64_t parallel_us = time_copy(true);
+    report("memcpy", (uint64_t) BUFFER_SIZE * REPEATS, single_us, parallel_us);
+    if (memcmp(src, dst, BUFFER_SIZE)) printf("memcpy mismatch\n");
+
+    single_us = time_crc(false);
+    uint32_t expected = block_crcs[count_of(block_crcs) - 1];
+    parallel_us = time_crc(true);
+    report("crc32", (uint64_t) BUFFER_SIZE * REPEATS, single_us, parallel_us);
+    if (block_crcs[count_of(block_crcs) - 1] != expected) printf("crc mismatch\n");
+
+    float single_result, parallel_result;
+    single_us = time_float(false, &single_result);
+    parallel_us = time_float(true, &parallel_result);
+    report("float", (uint64_t) FLOAT_COUNT * sizeof(float) * REPEATS, single_us, parallel_us);
+    // the summation order differs, so allow for rounding
+    if (fabsf(single_result - parallel_result) > fabsf(single_result) * 1e-3f) printf("float mismatch\n");
+
+    job_stats_t stats;
+    for (uint core = 0; core < NUM_CORES; core++) {
+        job_system_get_stats(core, &stats);
+        printf("core %d: run %d stolen %d doorbells %d idle %dus\n", core, stats.jobs_run, stats.jobs_stolen,
+               stats.doorbells, (int) stats.idle_time_us);
+    }
+    return 0;
+}
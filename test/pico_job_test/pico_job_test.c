@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/test.h"
+#include "pico/job.h"
+
+PICOTEST_MODULE_NAME("pico_job", "job system test");
+
+#define COUNT 10000
+
+static uint16_t visits[COUNT];
+
+static void visit(__unused void *arg, uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+        visits[i]++;
+    }
+}
+
+static void sum_range(__unused void *arg, uint32_t begin, uint32_t end, void *acc) {
+    for (uint32_t i = begin; i < end; i++) {
+        *(uint64_t *) acc += i;
+    }
+}
+
+static void sum_combine(void *acc, const void *value) {
+    *(uint64_t *) acc += *(const uint64_t *) value;
+}
+
+// each outer job runs an inner parallel_for over its own slice of visits
+static void nested_outer(__unused void *arg, uint32_t begin, uint32_t end) {
+    for (uint32_t slice = begin; slice < end; slice++) {
+        parallel_for(slice * 100, (slice + 1) * 100, 7, visit, NULL);
+    }
+}
+
+static void submitted_job(void *arg, uint32_t begin, uint32_t end) {
+    uint32_t *results = (uint32_t *) arg;
+    results[begin] = end;
+}
+
+int main() {
+    setup_default_uart();
+
+    PICOTEST_START();
+
+    job_system_init();
+
+    PICOTEST_START_SECTION("parallel_for visits each index once");
+        memset(visits, 0, sizeof(visits));
+        parallel_for(0, COUNT, 16, visit, NULL);
+        uint bad = 0;
+        for (uint i = 0; i < COUNT; i++) {
+            if (visits[i] != 1) bad++;
+        }
+        PICOTEST_CHECK(!bad, "indices not visited exactly once");
+        // an empty range should not call the body
+        parallel_for(5, 5, 16, visit, NULL);
+        PICOTEST_CHECK(visits[5] == 1, "empty range called body");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("parallel_reduce");
+        uint64_t sum = 0;
+        parallel_reduce(0, COUNT, 32, sum_range, sum_combine, &sum, sizeof(sum), NULL);
+        PICOTEST_CHECK(sum == (uint64_t) COUNT * (COUNT - 1) / 2, "wrong sum");
+        sum = 0;
+        parallel_reduce(100, 100, 32, sum_range, sum_combine, &sum, sizeof(sum), NULL);
+        PICOTEST_CHECK(!sum, "empty range should give the identity");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("nested jobs");
+        memset(visits, 0, sizeof(visits));
+        parallel_for(0, COUNT / 100, 1, nested_outer, NULL);
+        uint bad = 0;
+        for (uint i = 0; i < COUNT; i++) {
+            if (visits[i] != 1) bad++;
+        }
+        PICOTEST_CHECK(!bad, "indices not visited exactly once");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("job groups and stats");
+        job_system_reset_stats();
+        // more jobs than fit in the deque, so some are run inline
+        static uint32_t results[PICO_JOB_DEQUE_SIZE * 2];
+        job_group_t group;
+        job_group_init(&group);
+        for (uint i = 0; i < count_of(results); i++) {
+            job_submit(&group, submitted_job, results, i, i * 3);
+        }
+        job_group_wait(&group);
+        PICOTEST_CHECK(!group.pending, "group not complete");
+        uint bad = 0;
+        for (uint i = 0; i < count_of(results); i++) {
+            if (results[i] != i * 3) bad++;
+        }
+        PICOTEST_CHECK(!bad, "job results wrong");
+        job_stats_t stats[NUM_CORES];
+        uint32_t run = 0, stolen = 0;
+        for (uint core = 0; core < NUM_CORES; core++) {
+            job_system_get_stats(core, &stats[core]);
+            run += stats[core].jobs_run;
+            stolen += stats[core].jobs_stolen;
+            printf("core %d: run %d stolen %d inline %d doorbells %d idle %dus\n", core, stats[core].jobs_run,
+                   stats[core].jobs_stolen, stats[core].jobs_run_inline, stats[core].doorbells,
+                   (int) stats[core].idle_time_us);
+        }
+        PICOTEST_CHECK(run == count_of(results), "wrong number of jobs run");
+        // core 0 doesn't take jobs while submitting, so only those stolen by core 1 free up space
+        PICOTEST_CHECK((int) stats[0].jobs_run_inline >= (int) (count_of(results) - PICO_JOB_DEQUE_SIZE - stolen), "deque overflow not run inline");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_END_TEST();
+}
@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/lz4.h"
+#include "pico/test.h"
+
+PICOTEST_MODULE_NAME("LZ4", "LZ4 block compression test");
+
+#define MAX_SIZE 20000u
+
+static uint8_t src[MAX_SIZE];
+static uint8_t compressed[LZ4_COMPRESS_BOUND(MAX_SIZE)];
+static uint8_t out[MAX_SIZE];
+
+static uint32_t rand_state = 1;
+
+static uint8_t next_rand(void) {
+    rand_state = rand_state * 1103515245u + 12345u;
+    return (uint8_t)(rand_state >> 16);
+}
+
+enum fill { ZEROS, RANDOM, TEXT };
+
+static void fill_src(enum fill fill, uint32_t size) {
+    static const char words[] = "one two three four five six seven eight nine ten ";
+    for (uint32_t i = 0; i < size; i++) {
+        switch (fill) {
+            case ZEROS: src[i] = 0; break;
+            case RANDOM: src[i] = next_rand(); break;
+            default: src[i] = (uint8_t)words[(i * 7 + (i / 97)) % (sizeof(words) - 1)]; break;
+        }
+    }
+}
+
+// returns the compressed size, or 0 if the data didn't survive the round trip
+static uint32_t round_trip(uint32_t size) {
+    uint32_t len = lz4_compress_block(src, size, compressed, LZ4_COMPRESS_BOUND(size));
+    if (!len) return 0;
+    memset(out, 0xaa, sizeof(out));
+    int32_t out_len = lz4_decompress_block(compressed, len, out, sizeof(out));
+    if (out_len != (int32_t)size || memcmp(src, out, size)) return 0;
+    return len;
+}
+
+int main() {
+    PICOTEST_START();
+
+    PICOTEST_START_SECTION("round trips");
+        static const uint32_t sizes[] = {0, 1, 5, 12, 13, 17, 100, 255, 256, 4096, 4097, MAX_SIZE};
+        static const char *fill_names[] = {"zeros", "random", "text"};
+        for (uint f = ZEROS; f <= TEXT; f++) {
+            for (uint i = 0; i < count_of(sizes); i++) {
+                fill_src((enum fill)f, sizes[i]);
+                uint32_t len = round_trip(sizes[i]);
+                if (!len) printf("round trip of %d bytes of %s failed\n", (int)sizes[i], fill_names[f]);
+                PICOTEST_CHECK_AND_ABORT(len, "round trip failed");
+                PICOTEST_CHECK(len <= LZ4_COMPRESS_BOUND(sizes[i]), "compressed size is over the bound");
+                if (sizes[i] == MAX_SIZE) {
+                    printf("%s: %d -> %d bytes\n", fill_names[f], (int)sizes[i], (int)len);
+                    PICOTEST_CHECK(f == RANDOM || len < sizes[i] / 4, "compressed poorly");
+                }
+            }
+        }
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("compression fails cleanly when the output is too small");
+        fill_src(RANDOM, 4096);
+        PICOTEST_CHECK(!lz4_compress_block(src, 4096, compressed, 4096), "random data should not fit");
+        PICOTEST_CHECK(!lz4_compress_block(src, LZ4_MAX_INPUT_SIZE + 1, compressed, sizeof(compressed)),
+                       "input too large should fail");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("decompress a reference block");
+        // "abcabcabcabcabcabcabcab" followed by "xyz12": 3 literals, a match of 20 at offset 3, then 5 literals
+        static const uint8_t block[] = {0x3f, 'a', 'b', 'c', 0x03, 0x00, 0x01, 0x50, 'x', 'y', 'z', '1', '2'};
+        static const char expected[] = "abcabcabcabcabcabcabcabxyz12";
+        int32_t len = lz4_decompress_block(block, sizeof(block), out, sizeof(out));
+        PICOTEST_CHECK(len == (int32_t)strlen(expected) && !memcmp(out, expected, strlen(expected)),
+                       "reference block decompressed wrongly");
+        // the exact output size is fine, one less is not
+        PICOTEST_CHECK(lz4_decompress_block(block, sizeof(block), out, strlen(expected)) == len,
+                       "exact output size should work");
+        PICOTEST_CHECK(lz4_decompress_block(block, sizeof(block), out, strlen(expected) - 1) == -1,
+                       "output overflow not detected");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("malformed blocks");
+        static const uint8_t zero_offset[] = {0x10, 'a', 0x00, 0x00, 0x00};
+        static const uint8_t offset_too_far[] = {0x10, 'a', 0x02, 0x00, 0x00};
+        static const uint8_t literals_past_end[] = {0x50, 'a', 'b'};
+        static const uint8_t length_past_end[] = {0xf0, 0xff};
+        PICOTEST_CHECK(lz4_decompress_block(zero_offset, sizeof(zero_offset), out, sizeof(out)) == -1,
+                       "zero offset not detected");
+        PICOTEST_CHECK(lz4_decompress_block(offset_too_far, sizeof(offset_too_far), out, sizeof(out)) == -1,
+                       "offset before the start not detected");
+        PICOTEST_CHECK(lz4_decompress_block(literals_past_end, sizeof(literals_past_end), out, sizeof(out)) == -1,
+                       "literals past the end not detected");
+        PICOTEST_CHECK(lz4_decompress_block(length_past_end, sizeof(length_past_end), out, sizeof(out)) == -1,
+                       "length past the end not detected");
+        PICOTEST_CHECK(lz4_decompress_block(NULL, 0, out, sizeof(out)) == -1, "empty block not detected");
+        // every truncation of a real block must fail (or at worst decode to fewer bytes), never overrun
+        fill_src(TEXT, 4096);
+        uint32_t clen = lz4_compress_block(src, 4096, compressed, sizeof(compressed));
+        bool ok = true;
+        for (uint32_t l = 0; l < clen; l++) {
+            int32_t r = lz4_decompress_block(compressed, l, out, 4096);
+            if (r == 4096) ok = false;
+        }
+        PICOTEST_CHECK(ok, "a truncated block decompressed fully");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_END_TEST();
+}
@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#if BENCHMARK_SINGLE_CORE
+#include "pico/cyw43_arch.h"
+#include "lwip/netif.h"
+#include "lwip/tcp.h"
+#else
+#include "pico/netcore.h"
+#include "pico/cyw43_arch.h"
+#endif
+
+// Runs a 1 kHz control loop on core 0, which busy waits for each tick and records how late it got there, while a TCP
+// sink on port 5001 counts the bytes received. With BENCHMARK_SINGLE_CORE the network stack runs in IRQs on core 0
+// (plain pico_cyw43_arch_lwip_threadsafe_background), and otherwise on core 1 with pico_netcore, where the control
+// loop drains the received data itself each tick
+
+#define SINK_PORT 5001
+#define TICK_US 1000
+#define REPORT_SECONDS 5
+#define LATE_THRESHOLD_US 20
+
+static uint64_t bytes_received;
+
+#if BENCHMARK_SINGLE_CORE
+static err_t sink_recv(__unused void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err) {
+    if (!p) {
+        tcp_arg(pcb, NULL);
+        tcp_recv(pcb, NULL);
+        if (tcp_close(pcb) != ERR_OK) {
+            tcp_abort(pcb);
+            return ERR_ABRT;
+        }
+        return ERR_OK;
+    }
+    if (err == ERR_OK) {
+        bytes_received += p->tot_len;
+        tcp_recved(pcb, p->tot_len);
+    }
+    pbuf_free(p);
+    return ERR_OK;
+}
+
+static err_t sink_accept(__unused void *arg, struct tcp_pcb *pcb, err_t err) {
+    if (err != ERR_OK || !pcb) return ERR_VAL;
+    tcp_recv(pcb, sink_recv);
+    return ERR_OK;
+}
+
+static void network_init(void) {
+    if (cyw43_arch_init()) panic("failed to initialize");
+    cyw43_arch_enable_sta_mode();
+    printf("connecting to %s\n", WIFI_SSID);
+    if (cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK, 30000)) {
+        panic("failed to connect");
+    }
+    cyw43_arch_lwip_begin();
+    struct tcp_pcb *pcb = tcp_new_ip_type(IPADDR_TYPE_V4);
+    if (!pcb || tcp_bind(pcb, IP4_ADDR_ANY, SINK_PORT) != ERR_OK) panic("failed to bind");
+    pcb = tcp_listen(pcb);
+    tcp_accept(pcb, sink_accept);
+    printf("listening on %s port %d\n", ip4addr_ntoa(netif_ip4_addr(netif_default)), SINK_PORT);
+    cyw43_arch_lwip_end();
+}
+
+static void network_tick(void) {
+    // all the work happens in the background
+}
+#else
+static int listener;
+static int connection;
+
+static void network_init(void) {
+    if (netcore_init(PICO_CYW43_ARCH_DEFAULT_COUNTRY_CODE)) panic("failed to initialize");
+    printf("connecting to %s\n", WIFI_SSID);
+    if (netcore_wifi_connect(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK, 30000)) {
+        panic("failed to connect");
+    }
+    listener = netcore_tcp_listen(SINK_PORT);
+    if (listener < 0) panic("failed to listen");
+    ip4_addr_t addr = netcore_get_ip4_addr();
+    printf("listening on %s port %d\n", ip4addr_ntoa(&addr), SINK_PORT);
+}
+
+static void network_tick(void) {
+    if (!connection) {
+        int rc = netcore_accept(listener, nil_time);
+        if (rc > 0) connection = rc;
+        return;
+    }
+    struct pbuf *p;
+    while ((p = netcore_recv(connection, nil_time, NULL, NULL))) {
+        bytes_received += p->tot_len;
+        netcore_release(connection, p);
+    }
+    if (netcore_get_error(connection)) {
+        netcore_close(connection);
+        connection = 0;
+    }
+}
+#endif
+
+int main() {
+    stdio_init_all();
+    network_init();
+    printf("network stack on core %d; %d us ticks\n", BENCHMARK_SINGLE_CORE ? 0 : 1, TICK_US);
+
+    absolute_time_t tick = get_absolute_time();
+    while (true) {
+        uint64_t total_late_us = 0;
+        uint32_t max_late_us = 0, late_ticks = 0, ticks = 0;
+        uint32_t save = save_and_disable_interrupts();
+        uint64_t start_bytes = bytes_received;
+        restore_interrupts(save);
+        uint64_t start_us = time_us_64();
+        for (; ticks < REPORT_SECONDS * 1000000 / TICK_US; ticks++) {
+            tick = delayed_by_us(tick, TICK_US);
+            busy_wait_until(tick);
+            // the time from the tick to here is how late a control loop would have been to act
+            uint32_t late_us = (uint32_t)absolute_time_diff_us(tick, get_absolute_time());
+            total_late_us += late_us;
+            max_late_us = MAX(max_late_us, late_us);
+            if (late_us > LATE_THRESHOLD_US) late_ticks++;
+            // don't try to catch up on whole ticks missed
+            if (late_us > TICK_US) tick = get_absolute_time();
+            network_tick();
+        }
+        uint64_t elapsed_us = time_us_64() - start_us;
+        save = save_and_disable_interrupts();
+        uint64_t bytes = bytes_received - start_bytes;
+        restore_interrupts(save);
+        uint32_t kbit_per_sec = (uint32_t)(bytes * 8000 / elapsed_us);
+        printf("%lu.%03lu Mbit/s; tick lateness avg %lu us, max %lu us, %lu of %lu ticks over %d us\n",
+               (unsigned long)(kbit_per_sec / 1000), (unsigned long)(kbit_per_sec % 1000),
+               (unsigned long)(total_late_us / ticks), (unsigned long)max_late_us, (unsigned long)late_ticks,
+               (unsigned long)ticks, LATE_THRESHOLD_US);
+    }
+}
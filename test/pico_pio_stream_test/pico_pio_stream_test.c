@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/test.h"
+#include "pico/pio_stream.h"
+
+PICOTEST_MODULE_NAME("PIO_STREAM", "PIO stream test");
+
+// copies each word from the TX FIFO to the RX FIFO (using autopull and autopush), one word every 2 cycles
+static const uint16_t loopback_instructions[] = {
+        0x6020, // out x, 32
+        0x4020, // in x, 32
+};
+
+static const pio_program_t loopback_program = {
+        .instructions = loopback_instructions,
+        .length = count_of(loopback_instructions),
+        .origin = -1,
+};
+
+#define RING_WORDS 256
+#define TOTAL_WORDS 200000
+
+PIO_STREAM_RING_BUFFER(tx_ring, RING_WORDS);
+PIO_STREAM_RING_BUFFER(rx_ring, RING_WORDS);
+
+static inline uint32_t pattern(uint32_t i) {
+    return i * 2654435761u;
+}
+
+int main() {
+    setup_default_uart();
+    PICOTEST_START();
+
+    PIO pio = pio0;
+    uint sm = (uint)pio_claim_unused_sm(pio, true);
+    uint offset = pio_add_program(pio, &loopback_program);
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset, offset + loopback_program.length - 1);
+    sm_config_set_out_shift(&c, true, true, 32);
+    sm_config_set_in_shift(&c, true, true, 32);
+    pio_sm_init(pio, sm, offset, &c);
+
+    pio_stream_t stream;
+    pio_stream_config_t config = {
+            .pio = pio,
+            .sm = sm,
+            .tx_ring = tx_ring,
+            .tx_ring_words = RING_WORDS,
+            .rx_ring = rx_ring,
+            .rx_ring_words = RING_WORDS,
+    };
+    pio_stream_init(&stream, &config);
+    pio_sm_set_enabled(pio, sm, true);
+
+    PICOTEST_START_SECTION("zero copy loopback");
+        uint32_t sent = 0, received = 0, errors = 0;
+        absolute_time_t start = get_absolute_time();
+        while (received < TOTAL_WORDS) {
+            uint words;
+            uint32_t *dst = pio_stream_tx_acquire(&stream, &words);
+            words = MIN(words, TOTAL_WORDS - sent);
+            for (uint i = 0; i < words; i++) dst[i] = pattern(sent + i);
+            pio_stream_tx_commit(&stream, words);
+            sent += words;
+            const uint32_t *src = pio_stream_rx_acquire(&stream, &words);
+            for (uint i = 0; i < words; i++) {
+                if (src[i] != pattern(received + i)) errors++;
+            }
+            pio_stream_rx_release(&stream, words);
+            received += words;
+        }
+        int64_t us = absolute_time_diff_us(start, get_absolute_time());
+        PICOTEST_CHECK(!errors, "received data differs from sent data");
+        printf("%u words in %d us: %d kword/s\n", TOTAL_WORDS, (int)us, (int)(TOTAL_WORDS * 1000ll / us));
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("flow control");
+        pio_stream_stats_t stats;
+        pio_stream_get_stats(&stream, &stats);
+        uint32_t rx_overruns = stats.rx_overruns;
+        // send more than fits in the RX ring buffer and FIFO without reading, so the state machine stalls
+        static uint32_t buffer[RING_WORDS * 2];
+        for (uint i = 0; i < count_of(buffer); i++) buffer[i] = pattern(i);
+        uint32_t sent = 0;
+        absolute_time_t timeout = make_timeout_time_ms(100);
+        while (sent < count_of(buffer) && !time_reached(timeout)) {
+            sent += pio_stream_write(&stream, buffer + sent, count_of(buffer) - sent);
+        }
+        PICOTEST_CHECK(sent == count_of(buffer), "TX ring buffer did not drain");
+        sleep_ms(1);
+        pio_stream_get_stats(&stream, &stats);
+        PICOTEST_CHECK(stats.rx_overruns > rx_overruns, "RX stall not counted");
+        PICOTEST_CHECK(stats.rx_full, "RX ring buffer full not counted");
+        // nothing was lost while stalled
+        uint32_t received = 0;
+        timeout = make_timeout_time_ms(100);
+        while (received < count_of(buffer) && !time_reached(timeout)) {
+            uint32_t word;
+            if (pio_stream_read(&stream, &word, 1)) {
+                PICOTEST_CHECK(word == pattern(received), "wrong data after stall");
+                received++;
+            }
+        }
+        PICOTEST_CHECK(received == count_of(buffer), "data lost");
+        pio_stream_get_stats(&stream, &stats);
+        PICOTEST_CHECK(stats.tx_words == TOTAL_WORDS + count_of(buffer) && stats.rx_words == stats.tx_words, "wrong word counts");
+        printf("TX underruns %u, RX overruns %u, TX starved %u, RX full %u\n", (uint)stats.tx_underruns,
+               (uint)stats.rx_overruns, (uint)stats.tx_starved, (uint)stats.rx_full);
+    PICOTEST_END_SECTION();
+
+    pio_sm_set_enabled(pio, sm, false);
+    pio_stream_deinit(&stream);
+    pio_remove_program(pio, &loopback_program, offset);
+    pio_sm_unclaim(pio, sm);
+
+    PICOTEST_END_TEST();
+}
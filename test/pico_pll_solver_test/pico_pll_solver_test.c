@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+
+#include "pico/stdlib.h"
+#include "pico/pll_solver.h"
+#include "pico/test.h"
+
+PICOTEST_MODULE_NAME("PLL", "PLL solver test (host, against exhaustive search)");
+
+// Highest possible output, from the fastest VCO with no post division
+#define MAX_TARGET_KHZ (PICO_PLL_VCO_MAX_FREQ_MHZ * 1000)
+
+bool pll_solver_test_cpp_constexpr(void);
+
+static const uint32_t ref_khz_list[] = {12000, 10000, 19200, 5000};
+
+// The search check_sys_clock_khz used to do: the first exact match from the highest feedback divider down, then the
+// highest postdiv1 and postdiv2
+static bool brute_force_exact(uint32_t ref_khz, uint32_t target_khz, pll_solution_t *out) {
+    for (uint fbdiv = PICO_PLL_FBDIV_MAX; fbdiv >= PICO_PLL_FBDIV_MIN; fbdiv--) {
+        uint vco = fbdiv * ref_khz;
+        if (vco < PICO_PLL_VCO_MIN_FREQ_MHZ * 1000 || vco > PICO_PLL_VCO_MAX_FREQ_MHZ * 1000) continue;
+        for (uint postdiv1 = 7; postdiv1 >= 1; postdiv1--) {
+            for (uint postdiv2 = postdiv1; postdiv2 >= 1; postdiv2--) {
+                uint out_khz = vco / (postdiv1 * postdiv2);
+                if (out_khz == target_khz && !(vco % (postdiv1 * postdiv2))) {
+                    out->vco_khz = vco;
+                    out->fbdiv = (uint16_t)fbdiv;
+                    out->postdiv1 = (uint8_t)postdiv1;
+                    out->postdiv2 = (uint8_t)postdiv2;
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// Every combination, keeping the closest in the same order, comparing errors with doubles rather than exactly
+static void brute_force_closest(uint32_t ref_khz, uint32_t target_khz, pll_solution_t *out, double *err_out) {
+    double best_err = 1e30;
+    for (uint fbdiv = PICO_PLL_FBDIV_MAX; fbdiv >= PICO_PLL_FBDIV_MIN; fbdiv--) {
+        uint vco = fbdiv * ref_khz;
+        if (vco < PICO_PLL_VCO_MIN_FREQ_MHZ * 1000 || vco > PICO_PLL_VCO_MAX_FREQ_MHZ * 1000) continue;
+        for (uint postdiv1 = 7; postdiv1 >= 1; postdiv1--) {
+            for (uint postdiv2 = postdiv1; postdiv2 >= 1; postdiv2--) {
+                double err = (double)vco / (postdiv1 * postdiv2) - target_khz;
+                if (err < 0) err = -err;
+                if (err < best_err) {
+                    best_err = err;
+                    out->vco_khz = vco;
+                    out->fbdiv = (uint16_t)fbdiv;
+                    out->postdiv1 = (uint8_t)postdiv1;
+                    out->postdiv2 = (uint8_t)postdiv2;
+                }
+            }
+        }
+    }
+    *err_out = best_err;
+}
+
+static bool same_params(const pll_solution_t *a, const pll_solution_t *b) {
+    return a->vco_khz == b->vco_khz && a->fbdiv == b->fbdiv && a->postdiv1 == b->postdiv1 &&
+           a->postdiv2 == b->postdiv2;
+}
+
+int main() {
+    PICOTEST_START();
+
+    PICOTEST_START_SECTION("exact matches against exhaustive search");
+        for (uint r = 0; r < count_of(ref_khz_list); r++) {
+            uint32_t ref_khz = ref_khz_list[r];
+            uint exact = 0, mismatches = 0;
+            // every exactly achievable frequency is a VCO frequency divided by a post divider product, so all the
+            // targets which could match are covered by trying each kHz up to the fastest VCO
+            for (uint32_t target_khz = 1; target_khz <= MAX_TARGET_KHZ; target_khz++) {
+                pll_solution_t expected = {0}, solution = pll_solve_khz_inline(ref_khz, target_khz);
+                bool found = brute_force_exact(ref_khz, target_khz, &expected);
+                if (found != solution.exact || (found && !same_params(&expected, &solution))) {
+                    if (mismatches++ < 5) {
+                        printf("ref %u kHz target %u kHz: expected %s %u/%u/%u, got %s %u/%u/%u\n", ref_khz, target_khz,
+                               found ? "exact" : "none", expected.vco_khz, expected.postdiv1, expected.postdiv2,
+                               solution.exact ? "exact" : "inexact", solution.vco_khz, solution.postdiv1,
+                               solution.postdiv2);
+                    }
+                }
+                exact += found;
+            }
+            printf("ref %u kHz: %u exactly achievable frequencies\n", ref_khz, exact);
+            PICOTEST_CHECK(!mismatches, "solver disagrees with exhaustive search");
+        }
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("closest matches against exhaustive search");
+        uint mismatches = 0;
+        for (uint r = 0; r < count_of(ref_khz_list); r++) {
+            uint32_t ref_khz = ref_khz_list[r];
+            // every kHz through the usual system clock range for the usual crystal, and a sparser sweep otherwise
+            uint32_t dense_khz = ref_khz == 12000 ? 300000 : 0;
+            for (uint32_t target_khz = 1; target_khz <= MAX_TARGET_KHZ + 10000;
+                 target_khz += target_khz < dense_khz ? 1 : 97) {
+                pll_solution_t expected = {0}, solution = pll_solve_khz_inline(ref_khz, target_khz);
+                double expected_err;
+                brute_force_closest(ref_khz, target_khz, &expected, &expected_err);
+                double err = (double)solution.vco_khz / (solution.postdiv1 * solution.postdiv2) - target_khz;
+                if (err < 0) err = -err;
+                // the floating point search may break an exact tie either way, so compare the error, and the
+                // parameters only where the errors differ clearly
+                bool ok = err <= expected_err + 1e-9 && (err < expected_err - 1e-9 || err > expected_err + 1e-9 ||
+                                                         solution.vco_khz >= expected.vco_khz);
+                int64_t out_hz = (int64_t)((double)solution.vco_khz * 1000 / (solution.postdiv1 * solution.postdiv2)
+                                           + 0.5);
+                ok &= solution.out_hz == out_hz && solution.error_hz == out_hz - (int64_t)target_khz * 1000;
+                ok &= solution.exact == (err == 0);
+                if (!ok && mismatches++ < 5) {
+                    printf("ref %u kHz target %u kHz: expected %u/%u/%u (error %f kHz), got %u/%u/%u (error %f kHz)\n",
+                           ref_khz, target_khz, expected.vco_khz, expected.postdiv1, expected.postdiv2, expected_err,
+                           solution.vco_khz, solution.postdiv1, solution.postdiv2, err);
+                }
+            }
+        }
+        PICOTEST_CHECK(!mismatches, "solver is not the closest");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("no solution");
+        pll_solution_t solution;
+        PICOTEST_CHECK(!pll_solve_khz(12000, 0, &solution), "zero target solved");
+        // the VCO can't reach 750 MHz from 1 MHz, nor stay below 1.6 GHz from 120 MHz
+        PICOTEST_CHECK(!pll_solve_khz(1000, 125000, &solution), "slow reference solved");
+        PICOTEST_CHECK(!pll_solve_khz(120000, 125000, &solution), "fast reference solved");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("cache");
+        // more distinct requests than the cache holds, repeated, must give the same answers as the inline solver
+        bool ok = true;
+        for (uint pass = 0; pass < 3; pass++) {
+            for (uint i = 0; i < PICO_PLL_SOLVER_CACHE_SIZE + 2; i++) {
+                uint32_t target_khz = 100000 + i * 3333 + (pass == 2 ? 0 : i % 2);
+                pll_solution_t cached, inline_solution = pll_solve_khz_inline(12000, target_khz);
+                ok &= pll_solve_khz(12000, target_khz, &cached);
+                ok &= same_params(&cached, &inline_solution) && cached.out_hz == inline_solution.out_hz &&
+                      cached.error_hz == inline_solution.error_hz && cached.exact == inline_solution.exact;
+                // the same target from another reference must not come from the cache
+                ok &= pll_solve_khz(10000, target_khz, &cached);
+                inline_solution = pll_solve_khz_inline(10000, target_khz);
+                ok &= same_params(&cached, &inline_solution);
+            }
+        }
+        PICOTEST_CHECK(ok, "cached result differs");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("constexpr");
+        PICOTEST_CHECK(pll_solver_test_cpp_constexpr(), "C++ compile time checks were not built");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_END_TEST();
+}
@@ -0,0 +1,26 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pico/pll_solver.h"
+
+// pll_solve_khz_inline must be usable at compile time from C++
+#if __cplusplus >= 201402L
+// the default 125 MHz system clock
+constexpr pll_solution_t sys_125mhz = pll_solve_khz_inline(12000, 125000);
+static_assert(sys_125mhz.exact && sys_125mhz.vco_khz == 1500000 && sys_125mhz.postdiv1 == 6 &&
+              sys_125mhz.postdiv2 == 2, "");
+// 48 MHz from the highest VCO
+constexpr pll_solution_t usb_48mhz = pll_solve_khz_inline(12000, 48000);
+static_assert(usb_48mhz.exact && usb_48mhz.vco_khz == 1440000 && usb_48mhz.postdiv1 == 6 &&
+              usb_48mhz.postdiv2 == 5, "");
+// 133.7 MHz is not achievable exactly
+constexpr pll_solution_t near_133_7mhz = pll_solve_khz_inline(12000, 133700);
+static_assert(!near_133_7mhz.exact && near_133_7mhz.vco_khz && near_133_7mhz.error_hz != 0, "");
+#endif
+
+extern "C" bool pll_solver_test_cpp_constexpr(void) {
+    return __cplusplus >= 201402L;
+}
@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/irq.h"
+#include "pico/pwm_player.h"
+
+// Measures the CPU load of playing a dithered sine wave at a 48 kHz sample rate, by counting iterations of an idle
+// loop against those in the same time with nothing running: first with the PWM player streaming, then with the
+// usual alternative of setting each level from the PWM wrap interrupt. No external wiring is needed
+
+#define SAMPLE_RATE 48000
+#define RUN_MS 500
+#define SINE_SAMPLES 480
+
+static int16_t sine[SINE_SAMPLES];
+static uint sine_pos;
+static uint16_t wrap;
+static pwm_player_dither_t dither;
+
+static uint32_t idle_loop(int64_t us) {
+    uint32_t count = 0;
+    absolute_time_t end = make_timeout_time_us(us);
+    while (!time_reached(end)) {
+        count++;
+        __asm volatile ("" : "+r" (count));
+    }
+    return count;
+}
+
+static void next_samples(uint16_t *dst, uint count) {
+    for (uint i = 0; i < count; i++) {
+        dst[i] = (uint16_t)(sine[sine_pos] + 0x8000);
+        if (++sine_pos == SINE_SAMPLES) sine_pos = 0;
+    }
+    pwm_player_dither(&dither, dst, dst, count, wrap);
+}
+
+static void refill(pwm_player_t *player, uint half) {
+    next_samples(pwm_player_get_buffer(player, 0, half), player->config.samples / 2);
+}
+
+static void __isr pwm_wrap_irq_handler(void) {
+    pwm_clear_irq(0);
+    uint16_t level;
+    next_samples(&level, 1);
+    pwm_set_both_levels(0, level, level);
+}
+
+static void setup_slice(void) {
+    pwm_config c = pwm_get_default_config();
+    pwm_config_set_wrap(&c, wrap);
+    pwm_init(0, &c, false);
+    sine_pos = 0;
+    dither.error = 0;
+}
+
+static void benchmark_player(uint32_t idle_count, uint samples) {
+    static uint16_t buffer[1024];
+    setup_slice();
+    pwm_player_config_t config = {
+            .slice_count = 1,
+            .slices = {0},
+            .buffers = {buffer},
+            .samples = samples,
+            .mode = PWM_PLAYER_STREAM,
+            .refill = refill,
+    };
+    next_samples(buffer, samples);
+    pwm_player_t player;
+    pwm_player_init(&player, &config);
+    pwm_player_start(&player);
+    uint32_t busy_count = idle_loop(RUN_MS * 1000);
+    pwm_player_stop(&player);
+    pwm_player_deinit(&player);
+    printf("PWM player, %4u sample buffer: %3d%% CPU free, %u late refills\n", samples,
+           (int)(busy_count * 100ull / idle_count), (uint)player.late_refills);
+}
+
+static void benchmark_wrap_irq(uint32_t idle_count) {
+    setup_slice();
+    pwm_clear_irq(0);
+    pwm_set_irq_enabled(0, true);
+    irq_set_exclusive_handler(PWM_IRQ_WRAP, pwm_wrap_irq_handler);
+    irq_set_enabled(PWM_IRQ_WRAP, true);
+    pwm_set_enabled(0, true);
+    uint32_t busy_count = idle_loop(RUN_MS * 1000);
+    pwm_set_enabled(0, false);
+    irq_set_enabled(PWM_IRQ_WRAP, false);
+    pwm_set_irq_enabled(0, false);
+    irq_remove_handler(PWM_IRQ_WRAP, pwm_wrap_irq_handler);
+    printf("PWM wrap IRQ:                  %3d%% CPU free\n", (int)(busy_count * 100ull / idle_count));
+}
+
+int main() {
+    stdio_init_all();
+    for (uint i = 0; i < SINE_SAMPLES; i++) {
+        sine[i] = (int16_t)(32767 * sinf(2 * (float)M_PI * (float)i / SINE_SAMPLES));
+    }
+    wrap = (uint16_t)(clock_get_hz(clk_sys) / SAMPLE_RATE - 1);
+    printf("%u Hz sample rate, wrap %u\n", SAMPLE_RATE, wrap);
+
+    uint32_t idle_count = idle_loop(RUN_MS * 1000);
+    static const uint buffer_samples[] = {32, 128, 1024};
+    for (uint i = 0; i < count_of(buffer_samples); i++) benchmark_player(idle_count, buffer_samples[i]);
+    benchmark_wrap_irq(idle_count);
+    printf("done\n");
+    return 0;
+}
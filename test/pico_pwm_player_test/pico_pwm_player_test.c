@@ -0,0 +1,149 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "pico/test.h"
+#include "pico/pwm_player.h"
+
+PICOTEST_MODULE_NAME("PWM_PLAYER", "PWM player test");
+
+// the slices don't need to be connected to any pins; the test checks the values reaching their CC registers
+
+#define SLICE_A 0
+#define SLICE_B 1
+#define SAMPLES 64
+
+static uint16_t buffer_a[SAMPLES];
+static uint16_t buffer_b[SAMPLES];
+static uint32_t buffer_ab[SAMPLES];
+
+static void setup_slice(uint slice, uint16_t wrap, float div) {
+    pwm_config c = pwm_get_default_config();
+    pwm_config_set_wrap(&c, wrap);
+    pwm_config_set_clkdiv(&c, div);
+    pwm_init(slice, &c, false);
+}
+
+static pwm_player_config_t player_config(pwm_player_mode_t mode) {
+    return (pwm_player_config_t) {
+            .slice_count = 1,
+            .slices = {SLICE_A},
+            .buffers = {buffer_a},
+            .samples = SAMPLES,
+            .mode = mode,
+    };
+}
+
+static bool in_buffer_a(uint32_t cc) {
+    for (uint i = 0; i < SAMPLES; i++) {
+        if (cc == (buffer_a[i] | (uint32_t)buffer_a[i] << 16)) return true;
+    }
+    return false;
+}
+
+static void refill(pwm_player_t *player, uint half) {
+    uint16_t *buf = (uint16_t *)pwm_player_get_buffer(player, 0, half);
+    for (uint i = 0; i < SAMPLES / 2; i++) buf[i] = (uint16_t)(player->halves_played + i);
+}
+
+int main() {
+    setup_default_uart();
+    PICOTEST_START();
+
+    for (uint i = 0; i < SAMPLES; i++) {
+        buffer_a[i] = (uint16_t)(i * 3 + 1);
+        buffer_b[i] = (uint16_t)(i * 5 + 2);
+        buffer_ab[i] = (i * 7 + 3) | (i * 11 + 4) << 16;
+    }
+    pwm_player_t player;
+
+    PICOTEST_START_SECTION("one shot on two synchronized slices");
+        setup_slice(SLICE_A, 199, 1.f);
+        setup_slice(SLICE_B, 199, 1.f);
+        pwm_player_config_t config = player_config(PWM_PLAYER_ONE_SHOT);
+        config.slice_count = 2;
+        config.slices[1] = SLICE_B;
+        config.buffers[1] = buffer_b;
+        pwm_player_init(&player, &config);
+        pwm_player_start(&player);
+        while (pwm_player_is_busy(&player)) tight_loop_contents();
+        PICOTEST_CHECK(pwm_hw->slice[SLICE_A].cc == (buffer_a[SAMPLES - 1] * 0x10001u), "last sample not in CC");
+        PICOTEST_CHECK(pwm_hw->slice[SLICE_B].cc == buffer_b[SAMPLES - 1] * 0x10001u,
+                       "last sample not in CC of second slice");
+        int diff = (int)pwm_get_counter(SLICE_A) - (int)pwm_get_counter(SLICE_B);
+        PICOTEST_CHECK(diff >= -2 && diff <= 2, "slices not in step");
+        pwm_player_stop(&player);
+        pwm_player_deinit(&player);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("two channel one shot");
+        pwm_player_config_t config = player_config(PWM_PLAYER_ONE_SHOT);
+        config.buffers[0] = buffer_ab;
+        config.two_channel = true;
+        pwm_player_init(&player, &config);
+        pwm_player_start(&player);
+        while (pwm_player_is_busy(&player)) tight_loop_contents();
+        PICOTEST_CHECK(pwm_hw->slice[SLICE_A].cc == buffer_ab[SAMPLES - 1], "last sample not in CC");
+        pwm_player_stop(&player);
+        pwm_player_deinit(&player);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("loop");
+        pwm_player_config_t config = player_config(PWM_PLAYER_LOOP);
+        pwm_player_init(&player, &config);
+        pwm_player_start(&player);
+        // at 625 kHz, the buffer plays about 100 times in 10 ms; the CC register holds the previous test's value until
+        // the first sample is written
+        sleep_us(10);
+        bool ok = true;
+        absolute_time_t end = make_timeout_time_ms(10);
+        while (!time_reached(end)) ok &= in_buffer_a(pwm_hw->slice[SLICE_A].cc);
+        PICOTEST_CHECK(ok, "CC value not from the buffer");
+        PICOTEST_CHECK(pwm_player_is_busy(&player), "loop stopped");
+        pwm_player_stop(&player);
+        pwm_player_deinit(&player);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("stream at 48 kHz");
+        uint16_t wrap = (uint16_t)(clock_get_hz(clk_sys) / 48000 - 1);
+        setup_slice(SLICE_A, wrap, 1.f);
+        pwm_player_config_t config = player_config(PWM_PLAYER_STREAM);
+        config.refill = refill;
+        pwm_player_init(&player, &config);
+        pwm_player_start(&player);
+        sleep_ms(100);
+        uint32_t halves = player.halves_played;
+        pwm_player_stop(&player);
+        // 4800 samples in 100 ms
+        uint expected = 4800 / (SAMPLES / 2);
+        PICOTEST_CHECK(halves >= expected - 2 && halves <= expected + 2, "wrong number of refills");
+        PICOTEST_CHECK(!player.late_refills, "late refills");
+        pwm_player_deinit(&player);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("sigma-delta dithering");
+        // the average level matches a 16 bit sample much more closely than the PWM resolution
+        static uint16_t samples[4096];
+        const uint16_t wrap = 99;
+        bool ok = true;
+        for (uint value = 0; value < 65536; value += 4099) {
+            for (uint i = 0; i < count_of(samples); i++) samples[i] = (uint16_t)value;
+            pwm_player_dither_t dither = {0};
+            pwm_player_dither(&dither, samples, samples, count_of(samples), wrap);
+            uint32_t sum = 0;
+            for (uint i = 0; i < count_of(samples); i++) sum += samples[i];
+            // sum * 65536 / count is the average level in 1/65536ths, which should be within one sample's rounding
+            // error of value * (wrap + 1)
+            int64_t error = (int64_t)sum * 65536 / count_of(samples) - (int64_t)value * (wrap + 1);
+            ok &= error > -16 && error <= 16;
+        }
+        PICOTEST_CHECK(ok, "dithered average wrong");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_END_TEST();
+}
@@ -0,0 +1,144 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "pico/stdlib.h"
+#include "pico/rand.h"
+#include "pico/test.h"
+
+PICOTEST_MODULE_NAME("RAND", "random number generator test (host statistical tests)");
+
+// Statistical tests of the generator output; the limits are at least 5 standard deviations out, so a correct
+// generator essentially never fails them
+
+#define WORDS (1u << 18)
+#define BITS (WORDS * 32.0)
+
+static uint32_t words[WORDS];
+
+// RFC 8439 section 2.3.2
+static const uint32_t chacha20_in[16] = {
+        0x61707865, 0x3320646e, 0x79622d32, 0x6b206574, 0x03020100, 0x07060504, 0x0b0a0908, 0x0f0e0d0c,
+        0x13121110, 0x17161514, 0x1b1a1918, 0x1f1e1d1c, 0x00000001, 0x09000000, 0x4a000000, 0x00000000,
+};
+static const uint32_t chacha20_out[16] = {
+        0xe4e7f110, 0x15593bd1, 0x1fdd0f50, 0xc47120a3, 0xc7f4d1c7, 0x0368c033, 0x9aaa2204, 0x4e6cd4c3,
+        0x466482d2, 0x09aa9f07, 0x05d7c214, 0xa2028bd9, 0xd19c12b5, 0xb94e16de, 0xe883d0cb, 0x4e3c50a2,
+};
+
+int main() {
+    PICOTEST_START();
+
+    PICOTEST_START_SECTION("ChaCha block function");
+        uint32_t out[16];
+        pico_rand_chacha_block(chacha20_in, out, 20);
+        PICOTEST_CHECK(!memcmp(out, chacha20_out, sizeof(out)), "RFC 8439 test vector mismatch");
+        memcpy(out, chacha20_in, sizeof(out));
+        pico_rand_chacha_block(out, out, 20);
+        PICOTEST_CHECK(!memcmp(out, chacha20_out, sizeof(out)), "in place block mismatch");
+    PICOTEST_END_SECTION();
+
+    for (uint i = 0; i < WORDS; i++) words[i] = get_rand_32();
+    double ones = 0;
+
+    PICOTEST_START_SECTION("frequency");
+        // all the bits together, and each bit position separately
+        uint32_t position_ones[32] = {0};
+        for (uint i = 0; i < WORDS; i++) {
+            ones += __builtin_popcount(words[i]);
+            for (uint b = 0; b < 32; b++) position_ones[b] += (words[i] >> b) & 1;
+        }
+        printf("ones %.0f of %.0f\n", ones, BITS);
+        PICOTEST_CHECK(fabs(ones - BITS / 2) < 5 * sqrt(BITS) / 2, "bias in bits");
+        bool ok = true;
+        for (uint b = 0; b < 32; b++) {
+            ok &= fabs(position_ones[b] - WORDS / 2.0) < 5 * sqrt(WORDS) / 2;
+        }
+        PICOTEST_CHECK(ok, "bias in a bit position");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("runs");
+        // the number of runs of identical bits, given the number of ones
+        double runs = 1;
+        uint prev = words[0] & 1;
+        for (uint i = 0; i < WORDS; i++) {
+            for (uint b = 0; b < 32; b++) {
+                uint bit = (words[i] >> b) & 1;
+                runs += bit != prev;
+                prev = bit;
+            }
+        }
+        double pi = ones / BITS;
+        double expected = 2 * BITS * pi * (1 - pi) + 1;
+        double sd = 2 * sqrt(2 * BITS) * pi * (1 - pi);
+        printf("runs %.0f expected %.0f\n", runs, expected);
+        PICOTEST_CHECK(fabs(runs - expected) < 5 * sd, "wrong number of runs");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("byte distribution");
+        // chi-square over the 256 byte values, and over pairs of consecutive nibbles
+        static uint32_t bytes[256], pairs[256];
+        const uint8_t *data = (const uint8_t *)words;
+        for (uint i = 0; i < WORDS * 4; i++) {
+            bytes[data[i]]++;
+            if (i) pairs[(data[i - 1] & 0xf) << 4 | (data[i] & 0xf)]++;
+        }
+        double chi_bytes = 0, chi_pairs = 0;
+        double expected_bytes = WORDS * 4 / 256.0, expected_pairs = (WORDS * 4 - 1) / 256.0;
+        for (uint i = 0; i < 256; i++) {
+            chi_bytes += (bytes[i] - expected_bytes) * (bytes[i] - expected_bytes) / expected_bytes;
+            chi_pairs += (pairs[i] - expected_pairs) * (pairs[i] - expected_pairs) / expected_pairs;
+        }
+        // 255 degrees of freedom: mean 255, standard deviation 22.6
+        printf("chi-square bytes %.1f nibble pairs %.1f\n", chi_bytes, chi_pairs);
+        PICOTEST_CHECK(chi_bytes > 255 - 5 * 22.6 && chi_bytes < 255 + 5 * 22.6, "byte distribution wrong");
+        PICOTEST_CHECK(chi_pairs > 255 - 5 * 22.6 && chi_pairs < 255 + 5 * 22.6, "nibble pair distribution wrong");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("serial correlation");
+        double sum = 0, sum_sq = 0, sum_lag = 0;
+        for (uint i = 0; i < WORDS; i++) {
+            double x = words[i] / 4294967296.0 - 0.5;
+            sum += x;
+            sum_sq += x * x;
+            if (i) sum_lag += x * (words[i - 1] / 4294967296.0 - 0.5);
+        }
+        double correlation = (sum_lag / (WORDS - 1) - (sum / WORDS) * (sum / WORDS)) / (sum_sq / WORDS);
+        printf("serial correlation %f\n", correlation);
+        PICOTEST_CHECK(fabs(correlation) < 5 / sqrt(WORDS), "consecutive words correlated");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("64 and 128 bit numbers");
+        uint64_t a = get_rand_64(), b = get_rand_64();
+        PICOTEST_CHECK(a != b && (uint32_t)a != (uint32_t)(a >> 32), "64 bit numbers repeat");
+        rng_128_t c, d;
+        get_rand_128(&c);
+        get_rand_128(&d);
+        PICOTEST_CHECK(memcmp(&c, &d, sizeof(c)) && c.r[0] != c.r[1], "128 bit numbers repeat");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("reseeding");
+        // once enough entropy has been added, the next rekey draws a new seed from the pool; the output must still look
+        // random (and not, e.g. repeat the output from before)
+        static const char extra[] = "not very random data";
+        pico_rand_add_entropy(extra, sizeof(extra), PICO_RAND_SEED_ENTROPY_BITS);
+        uint same = 0;
+        double reseeded_ones = 0;
+        for (uint i = 0; i < PICO_RAND_REKEY_BLOCKS * 16 * 4; i++) {
+            uint32_t v = get_rand_32();
+            same += v == words[i];
+            reseeded_ones += __builtin_popcount(v);
+        }
+        double n = PICO_RAND_REKEY_BLOCKS * 16 * 4 * 32.0;
+        PICOTEST_CHECK(!same, "output repeated");
+        PICOTEST_CHECK(fabs(reseeded_ones - n / 2) < 5 * sqrt(n) / 2, "bias in bits after reseeding");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_END_TEST();
+}
@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/spi_queue.h"
+
+// Compares the throughput of the SPI queue with the blocking functions, and measures how much CPU time is left over
+// while the queue runs, by counting iterations of an idle loop against those in the same time with nothing running.
+// The SPI's internal loopback is used, so no external wiring is needed
+
+#define BENCH_SPI spi0
+#define BUFFER_SIZE 4096
+#define TRANSACTIONS 64
+
+static uint8_t tx[BUFFER_SIZE], rx[BUFFER_SIZE];
+
+static uint32_t idle_loop(volatile bool *done, int64_t max_us) {
+    uint32_t count = 0;
+    absolute_time_t end = make_timeout_time_us(max_us);
+    while (done ? !*done : !time_reached(end)) {
+        count++;
+        __asm volatile ("" : "+r" (count));
+    }
+    return count;
+}
+
+static volatile bool queue_done;
+
+static void last_done(spi_transaction_t *t) {
+    queue_done = true;
+}
+
+static void benchmark(uint baudrate) {
+    spi_set_baudrate(BENCH_SPI, baudrate);
+    uint total = BUFFER_SIZE * TRANSACTIONS;
+
+    absolute_time_t start = get_absolute_time();
+    for (uint i = 0; i < TRANSACTIONS; i++) spi_write_blocking(BENCH_SPI, tx, BUFFER_SIZE);
+    int64_t write_us = absolute_time_diff_us(start, get_absolute_time());
+
+    start = get_absolute_time();
+    for (uint i = 0; i < TRANSACTIONS; i++) spi_write_read_blocking(BENCH_SPI, tx, rx, BUFFER_SIZE);
+    int64_t write_read_us = absolute_time_diff_us(start, get_absolute_time());
+
+    spi_queue_t queue;
+    spi_queue_init(&queue, BENCH_SPI);
+    static spi_transaction_t t[TRANSACTIONS];
+    for (uint i = 0; i < TRANSACTIONS; i++) {
+        t[i] = (spi_transaction_t) {
+                .cs_pin = -1,
+                .data_bits = 8,
+                .tx_buf = tx,
+                .rx_buf = rx,
+                .len = BUFFER_SIZE,
+                .callback = i == TRANSACTIONS - 1 ? last_done : NULL,
+        };
+    }
+    queue_done = false;
+    start = get_absolute_time();
+    for (uint i = 0; i < TRANSACTIONS; i++) spi_queue_submit(&queue, &t[i]);
+    uint32_t busy_count = idle_loop(&queue_done, 0);
+    int64_t queue_us = absolute_time_diff_us(start, get_absolute_time());
+    spi_queue_deinit(&queue);
+
+    uint32_t idle_count = idle_loop(NULL, queue_us);
+
+    printf("%7u baud: write_blocking %5d KB/s, write_read_blocking %5d KB/s, queue %5d KB/s with %3d%% CPU free\n",
+           spi_get_baudrate(BENCH_SPI), (int)(total * 1000ll / 1024 / write_us),
+           (int)(total * 1000ll / 1024 / write_read_us), (int)(total * 1000ll / 1024 / queue_us),
+           idle_count ? (int)(busy_count * 100ull / idle_count) : 0);
+}
+
+int main() {
+    stdio_init_all();
+    spi_init(BENCH_SPI, 1000000);
+    hw_set_bits(&spi_get_hw(BENCH_SPI)->cr1, SPI_SSPCR1_LBM_BITS);
+    for (uint i = 0; i < BUFFER_SIZE; i++) tx[i] = (uint8_t)i;
+
+    static const uint baudrates[] = {1000000, 8000000, 31250000, 62500000};
+    for (uint i = 0; i < count_of(baudrates); i++) benchmark(baudrates[i]);
+    printf("done\n");
+    return 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/test.h"
+#include "pico/spi_queue.h"
+
+PICOTEST_MODULE_NAME("SPI_QUEUE", "SPI transaction queue test");
+
+// the SPI's internal loopback connects TX to RX, so no external wiring is needed
+#define TEST_SPI spi0
+#define CS_PIN 17
+
+#define LEN 1000
+
+static uint8_t tx8[LEN], rx8[LEN];
+static uint16_t tx16[LEN], rx16[LEN];
+
+static uint completion_order[4];
+static uint completion_count;
+
+static void record_completion(spi_transaction_t *t) {
+    completion_order[completion_count++] = (uint)(uintptr_t)t->user_data;
+}
+
+int main() {
+    setup_default_uart();
+    PICOTEST_START();
+
+    spi_init(TEST_SPI, 8000000);
+    hw_set_bits(&spi_get_hw(TEST_SPI)->cr1, SPI_SSPCR1_LBM_BITS);
+    gpio_init(CS_PIN);
+    gpio_put(CS_PIN, true);
+    gpio_set_dir(CS_PIN, GPIO_OUT);
+
+    for (uint i = 0; i < LEN; i++) {
+        tx8[i] = (uint8_t)(i * 7 + 1);
+        tx16[i] = (uint16_t)(i * 40503u);
+    }
+
+    spi_queue_t queue;
+    spi_queue_init(&queue, TEST_SPI);
+
+    PICOTEST_START_SECTION("8 bit loopback");
+        spi_transaction_t t = {
+                .cs_pin = CS_PIN,
+                .data_bits = 8,
+                .tx_buf = tx8,
+                .rx_buf = rx8,
+                .len = LEN,
+        };
+        spi_queue_submit(&queue, &t);
+        PICOTEST_CHECK(!gpio_get(CS_PIN), "chip select not asserted");
+        spi_transaction_wait_blocking(&t);
+        PICOTEST_CHECK(gpio_get(CS_PIN), "chip select not deasserted");
+        PICOTEST_CHECK(!memcmp(tx8, rx8, LEN), "received data differs from sent data");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("16 bit loopback with baud rate change");
+        spi_transaction_t t = {
+                .cs_pin = -1,
+                .baudrate = 2000000,
+                .data_bits = 16,
+                .cpol = SPI_CPOL_1,
+                .cpha = SPI_CPHA_1,
+                .tx_buf = tx16,
+                .rx_buf = rx16,
+                .len = LEN,
+        };
+        spi_queue_submit(&queue, &t);
+        spi_transaction_wait_blocking(&t);
+        PICOTEST_CHECK(!memcmp(tx16, rx16, sizeof(tx16)), "received data differs from sent data");
+        PICOTEST_CHECK(spi_get_baudrate(TEST_SPI) <= 2000000, "baud rate not changed");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("command and address phases");
+        // the header bytes are received (and discarded) before the data, so only the data is in the RX buffer
+        memset(rx8, 0, LEN);
+        spi_transaction_t t = {
+                .cs_pin = CS_PIN,
+                .baudrate = 8000000,
+                .data_bits = 8,
+                .command = 0x0b, .command_bits = 8,
+                .address = 0x123456, .address_bytes = 3,
+                .dummy_bytes = 1,
+                .tx_buf = tx8,
+                .rx_buf = rx8,
+                .len = 16,
+        };
+        spi_queue_submit(&queue, &t);
+        spi_transaction_wait_blocking(&t);
+        PICOTEST_CHECK(t.header_len == 5, "wrong header length");
+        PICOTEST_CHECK(!memcmp(t.header, (uint8_t[]){0x0b, 0x12, 0x34, 0x56, 0}, 5), "wrong header");
+        PICOTEST_CHECK(!memcmp(tx8, rx8, 16), "received data differs from sent data");
+        PICOTEST_CHECK(!rx8[16], "data received beyond the transaction");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("queued transactions complete in order");
+        spi_transaction_t t[4];
+        memset(rx8, 0, LEN);
+        completion_count = 0;
+        for (uint i = 0; i < count_of(t); i++) {
+            t[i] = (spi_transaction_t) {
+                    .cs_pin = i & 1 ? CS_PIN : -1,
+                    .data_bits = 8,
+                    .tx_buf = i == 2 ? NULL : tx8 + i * 100,
+                    .tx_fill = 0xa5,
+                    .rx_buf = i == 3 ? NULL : rx8 + i * 100,
+                    .len = 100,
+                    .callback = record_completion,
+                    .user_data = (void *)(uintptr_t)i,
+            };
+            spi_queue_submit(&queue, &t[i]);
+        }
+        spi_queue_wait_for_idle_blocking(&queue);
+        PICOTEST_CHECK(completion_count == 4, "wrong number of callbacks");
+        for (uint i = 0; i < count_of(t); i++) {
+            PICOTEST_CHECK(completion_order[i] == i, "transactions completed out of order");
+            PICOTEST_CHECK(spi_transaction_is_done(&t[i]), "transaction not done");
+        }
+        PICOTEST_CHECK(!memcmp(tx8, rx8, 200), "received data differs from sent data");
+        bool filled = true;
+        for (uint i = 200; i < 300; i++) filled &= rx8[i] == 0xa5;
+        PICOTEST_CHECK(filled, "fill value not sent");
+        PICOTEST_CHECK(!rx8[300], "data received for a transaction with no RX buffer");
+    PICOTEST_END_SECTION();
+
+    spi_queue_deinit(&queue);
+    PICOTEST_END_TEST();
+}
@@ -0,0 +1,18 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Stands in for an RTOS integration: the lock owner is the core, and each core has a priority which the test sets
+#ifndef _LOCK_PRIORITY_HOOKS_H
+#define _LOCK_PRIORITY_HOOKS_H
+
+#include <stdint.h>
+
+extern volatile uint8_t test_core_priorities[];
+
+#define lock_get_caller_priority() (test_core_priorities[get_core_num()])
+#define lock_set_owner_priority(owner, priority) (test_core_priorities[owner] = (priority))
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+
+#include "pico/stdlib.h"
+#include "pico/sync.h"
+#include "pico/multicore.h"
+#include "pico/test.h"
+
+PICOTEST_MODULE_NAME("LOCK_STATS", "lock contention statistics test");
+
+#define HOLD_US 2000
+// a lock from the range reserved for spin_lock_claim_unused(), so that no SDK locks share it
+#define TEST_SPIN_LOCK_NUM 31
+
+static mutex_t mutex;
+static recursive_mutex_t recursive_mutex;
+static semaphore_t sem;
+
+// core 1 holds each lock for HOLD_US while core 0 waits for it
+static void core1_entry(void) {
+    multicore_fifo_pop_blocking();
+    mutex_enter_blocking(&mutex);
+    multicore_fifo_push_blocking(1);
+    busy_wait_us_32(HOLD_US);
+    mutex_exit(&mutex);
+
+    multicore_fifo_pop_blocking();
+    busy_wait_us_32(HOLD_US);
+    sem_release(&sem);
+
+    multicore_fifo_pop_blocking();
+    spin_lock_t *lock = spin_lock_instance(TEST_SPIN_LOCK_NUM);
+    uint32_t save = spin_lock_blocking(lock);
+    multicore_fifo_push_blocking(3);
+    busy_wait_us_32(HOLD_US);
+    spin_unlock(lock, save);
+    while (true) tight_loop_contents();
+}
+
+int main() {
+    stdio_init_all();
+
+    mutex_init(&mutex);
+    recursive_mutex_init(&recursive_mutex);
+    sem_init(&sem, 1, 1);
+    spin_lock_claim(TEST_SPIN_LOCK_NUM);
+    spin_lock_init(TEST_SPIN_LOCK_NUM);
+    PICOTEST_CHECK(mutex_stats_register(&mutex, "mutex"), "registration failed");
+    PICOTEST_CHECK(recursive_mutex_stats_register(&recursive_mutex, "recursive mutex"), "registration failed");
+    PICOTEST_CHECK(sem_stats_register(&sem, "semaphore"), "registration failed");
+    PICOTEST_CHECK(spin_lock_stats_register(TEST_SPIN_LOCK_NUM, "test spin lock"), "registration failed");
+    PICOTEST_CHECK(lock_stats_table.num_registered == 4, "wrong registration count");
+    multicore_launch_core1(core1_entry);
+
+    PICOTEST_START();
+
+    PICOTEST_START_SECTION("mutex");
+        mutex_enter_blocking(&mutex);
+        PICOTEST_CHECK(!mutex_enter_timeout_us(&mutex, 10), "entered owned mutex");
+        mutex_exit(&mutex);
+        PICOTEST_CHECK(mutex.stats.acquires == 1 && !mutex.stats.contentions, "uncontended acquire miscounted");
+        multicore_fifo_push_blocking(0);
+        multicore_fifo_pop_blocking();
+        mutex_enter_blocking(&mutex);
+        mutex_exit(&mutex);
+        PICOTEST_CHECK(mutex.stats.acquires == 3, "acquires not counted");
+        PICOTEST_CHECK(mutex.stats.contentions == 1, "contention not counted");
+        PICOTEST_CHECK(mutex.stats.core_acquires[0] == 2 && mutex.stats.core_acquires[1] == 1, "wrong core counts");
+        PICOTEST_CHECK(mutex.stats.total_wait_us > 0, "wait not timed");
+        PICOTEST_CHECK(mutex.stats.max_hold_us >= HOLD_US, "hold not timed");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("recursive mutex");
+        recursive_mutex_enter_blocking(&recursive_mutex);
+        PICOTEST_CHECK(recursive_mutex_try_enter(&recursive_mutex, NULL), "couldn't re-enter");
+        busy_wait_us_32(HOLD_US);
+        recursive_mutex_exit(&recursive_mutex);
+        recursive_mutex_exit(&recursive_mutex);
+        PICOTEST_CHECK(recursive_mutex.stats.acquires == 1, "nested entry counted");
+        PICOTEST_CHECK(recursive_mutex.stats.max_hold_us >= HOLD_US, "hold not timed");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("semaphore");
+        PICOTEST_CHECK(sem_try_acquire(&sem), "couldn't acquire");
+        multicore_fifo_push_blocking(0);
+        sem_acquire_blocking(&sem);
+        PICOTEST_CHECK(sem.stats.acquires == 2, "acquires not counted");
+        PICOTEST_CHECK(sem.stats.contentions == 1, "contention not counted");
+        PICOTEST_CHECK(sem.stats.total_wait_us > 0, "wait not timed");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("spin lock");
+        lock_stats_t *stats = &spin_lock_stats[TEST_SPIN_LOCK_NUM];
+        multicore_fifo_push_blocking(0);
+        multicore_fifo_pop_blocking();
+        spin_lock_t *lock = spin_lock_instance(TEST_SPIN_LOCK_NUM);
+        uint32_t save = spin_lock_blocking(lock);
+        spin_unlock(lock, save);
+        PICOTEST_CHECK(stats->acquires == 2, "acquires not counted");
+        PICOTEST_CHECK(stats->contentions == 1, "contention not counted");
+        PICOTEST_CHECK(stats->spins > 0, "spins not counted");
+        PICOTEST_CHECK(stats->max_hold_us >= HOLD_US, "hold not timed");
+    PICOTEST_END_SECTION();
+
+    lock_stats_dump();
+
+    PICOTEST_START_SECTION("reset");
+        lock_stats_reset();
+        PICOTEST_CHECK(!mutex.stats.acquires && !sem.stats.contentions && !spin_lock_stats[TEST_SPIN_LOCK_NUM].spins, "not reset");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_END_TEST();
+}
@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+
+#include "pico/stdlib.h"
+#include "pico/sync.h"
+#include "pico/multicore.h"
+#include "pico/test.h"
+
+PICOTEST_MODULE_NAME("SYNC", "pi_mutex and rwlock test");
+
+volatile uint8_t test_core_priorities[NUM_CORES];
+
+static pi_mutex_t pi_mutex;
+static rwlock_t rwlock;
+static volatile bool core1_read_blocked;
+
+// core 1 acts as a low priority owner/other reader, in step with core 0 via the FIFO
+static void core1_entry(void) {
+    // pi_mutex: hold the mutex until core 0's priority has been inherited
+    pi_mutex_enter_blocking(&pi_mutex);
+    multicore_fifo_push_blocking(1);
+    while (test_core_priorities[1] != test_core_priorities[0]) tight_loop_contents();
+    pi_mutex_exit(&pi_mutex);
+
+    // pi_mutex: hold the mutex while core 0 times out
+    multicore_fifo_pop_blocking();
+    pi_mutex_enter_blocking(&pi_mutex);
+    multicore_fifo_push_blocking(2);
+    multicore_fifo_pop_blocking();
+    pi_mutex_exit(&pi_mutex);
+
+    // rwlock: hold a read lock until a writer is waiting, then check new readers are held off
+    multicore_fifo_pop_blocking();
+    rwlock_read_enter_blocking(&rwlock);
+    multicore_fifo_push_blocking(3);
+    multicore_fifo_pop_blocking();
+    while (!rwlock.writers_waiting) tight_loop_contents();
+    multicore_fifo_push_blocking(rwlock_read_try_enter(&rwlock));
+    rwlock_read_exit(&rwlock);
+
+    // rwlock: wait to read while core 0 writes
+    multicore_fifo_pop_blocking();
+    core1_read_blocked = true;
+    rwlock_read_enter_blocking(&rwlock);
+    core1_read_blocked = false;
+    rwlock_read_exit(&rwlock);
+    multicore_fifo_push_blocking(4);
+    while (true) tight_loop_contents();
+}
+
+int main() {
+    stdio_init_all();
+
+    pi_mutex_init(&pi_mutex);
+    rwlock_init(&rwlock);
+    test_core_priorities[0] = 5;
+    test_core_priorities[1] = 1;
+    multicore_launch_core1(core1_entry);
+
+    PICOTEST_START();
+
+    PICOTEST_START_SECTION("pi_mutex priority inheritance");
+        multicore_fifo_pop_blocking();
+        uint32_t owner;
+        PICOTEST_CHECK(!pi_mutex_try_enter(&pi_mutex, &owner), "entered owned mutex");
+        PICOTEST_CHECK(owner == 1, "wrong owner");
+        pi_mutex_enter_blocking(&pi_mutex);
+        PICOTEST_CHECK(pi_mutex.owner == 0, "not owner after enter");
+        PICOTEST_CHECK(test_core_priorities[1] == 1, "owner priority not restored on exit");
+        PICOTEST_CHECK(pi_mutex.contentions == 1, "contention not counted");
+        PICOTEST_CHECK(pi_mutex.priority_boosts == 1, "priority boost not counted");
+        pi_mutex_exit(&pi_mutex);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("pi_mutex timeout");
+        multicore_fifo_push_blocking(0);
+        multicore_fifo_pop_blocking();
+        PICOTEST_CHECK(!pi_mutex_enter_timeout_ms(&pi_mutex, 10), "entered owned mutex");
+        PICOTEST_CHECK(pi_mutex.contentions == 2, "contention not counted");
+        // the owner keeps the inherited priority until it exits
+        PICOTEST_CHECK(test_core_priorities[1] == 5, "priority not inherited");
+        multicore_fifo_push_blocking(0);
+        pi_mutex_enter_blocking(&pi_mutex);
+        PICOTEST_CHECK(test_core_priorities[1] == 1, "owner priority not restored on exit");
+        pi_mutex_exit(&pi_mutex);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("rwlock shared and exclusive");
+        PICOTEST_CHECK(rwlock_write_try_enter(&rwlock), "couldn't write unheld lock");
+        PICOTEST_CHECK(!rwlock_read_try_enter(&rwlock), "read while writing");
+        rwlock_write_exit(&rwlock);
+        multicore_fifo_push_blocking(0);
+        multicore_fifo_pop_blocking();
+        // core 1 is reading
+        PICOTEST_CHECK(rwlock_read_try_enter(&rwlock), "readers excluded each other");
+        PICOTEST_CHECK(rwlock.readers == 2, "wrong reader count");
+        rwlock_read_exit(&rwlock);
+        PICOTEST_CHECK(!rwlock_write_try_enter(&rwlock), "wrote while reader held lock");
+        PICOTEST_CHECK(!rwlock_write_enter_block_until(&rwlock, make_timeout_time_ms(10)), "wrote while reader held lock");
+        PICOTEST_CHECK(!rwlock.writers_waiting, "timed out writer still waiting");
+        PICOTEST_CHECK(rwlock.write_contentions == 1, "contention not counted");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("rwlock writer preference");
+        multicore_fifo_push_blocking(0);
+        rwlock_write_enter_blocking(&rwlock);
+        PICOTEST_CHECK(!multicore_fifo_pop_blocking(), "reader entered while writer waiting");
+        PICOTEST_CHECK(rwlock.write_contentions == 2, "contention not counted");
+        multicore_fifo_push_blocking(0);
+        while (!core1_read_blocked) tight_loop_contents();
+        sleep_ms(10);
+        rwlock_write_exit(&rwlock);
+        multicore_fifo_pop_blocking();
+        PICOTEST_CHECK(rwlock.read_contentions == 1, "contention not counted");
+        PICOTEST_CHECK(!rwlock.readers && !lock_is_owner_id_valid(rwlock.writer), "lock still held");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_END_TEST();
+}
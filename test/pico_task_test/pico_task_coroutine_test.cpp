@@ -0,0 +1,40 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pico/task_coroutine.h"
+
+#if defined(__cpp_impl_coroutine)
+static pico::coroutine_task producer(queue_t *q, int count) {
+    for (int i = 0; i < count; i++) {
+        co_await pico::sleep_ms(1);
+        uint32_t value = (uint32_t)i;
+        queue_add_blocking(q, &value);
+    }
+}
+
+static pico::coroutine_task consumer(queue_t *q, int count, int *received) {
+    while (*received < count) {
+        uint32_t value;
+        co_await pico::queue_remove(q, &value);
+        if (value == (uint32_t)*received) (*received)++;
+        co_await pico::yield();
+    }
+}
+
+extern "C" int coroutine_queue_test(queue_t *q, int count) {
+    int received = 0;
+    auto p = producer(q, count);
+    auto c = consumer(q, count, &received);
+    c.start();
+    p.start();
+    task_scheduler_run_until_done();
+    return p.done() && c.done() ? received : 0;
+}
+#else
+extern "C" int coroutine_queue_test(queue_t *q, int count) {
+    return -1;
+}
+#endif
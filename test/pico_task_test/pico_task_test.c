@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/test.h"
+#include "pico/task.h"
+
+PICOTEST_MODULE_NAME("TASK", "task scheduler test");
+
+// implemented in pico_task_coroutine_test.cpp; returns the number of values received, or -1 if not supported
+int coroutine_queue_test(queue_t *q, int count);
+
+static queue_t queue;
+static semaphore_t sem;
+static task_event_t event;
+static char trace[64];
+static uint trace_len;
+
+static void record(char c) {
+    if (trace_len < sizeof(trace) - 1) trace[trace_len++] = c;
+}
+
+typedef struct {
+    int i;
+    uint32_t value;
+    absolute_time_t wake;
+} producer_state_t;
+
+static void producer_task(task_t *task) {
+    producer_state_t *state = (producer_state_t *)task->user_data;
+    TASK_BEGIN(task);
+    for (state->i = 0; state->i < 3; state->i++) {
+        state->wake = make_timeout_time_ms(5);
+        TASK_SLEEP_UNTIL(task, state->wake);
+        if (!time_reached(state->wake)) record('!');
+        state->value = (uint32_t)state->i;
+        queue_add_blocking(&queue, &state->value);
+        record('p');
+    }
+    TASK_END(task);
+}
+
+static void consumer_task(task_t *task) {
+    static uint32_t value;
+    static int received;
+    TASK_BEGIN(task);
+    for (received = 0; received < 3; received++) {
+        TASK_QUEUE_REMOVE(task, &queue, &value);
+        record((char)('0' + value));
+    }
+    // wait for the other tasks to release the semaphore then the event
+    TASK_SEM_ACQUIRE(task, &sem);
+    record('s');
+    TASK_WAIT_EVENT(task, &event);
+    record('e');
+    TASK_END(task);
+}
+
+static void yield_task(task_t *task) {
+    TASK_BEGIN(task);
+    record('a');
+    TASK_YIELD(task);
+    record('b');
+    sem_release(&sem);
+    TASK_YIELD(task);
+    task_event_signal(&event);
+    TASK_END(task);
+}
+
+int main() {
+    stdio_init_all();
+
+    PICOTEST_START();
+
+    queue_init(&queue, sizeof(uint32_t), 4);
+    sem_init(&sem, 0, 1);
+    task_event_init(&event);
+
+    PICOTEST_START_SECTION("C tasks");
+        producer_state_t producer_state;
+        task_t producer, consumer, yielder;
+        task_init(&producer, "producer", producer_task, &producer_state);
+        task_init(&consumer, "consumer", consumer_task, NULL);
+        task_init(&yielder, "yielder", yield_task, NULL);
+        task_start(&consumer);
+        task_start(&producer);
+        task_start(&yielder);
+        task_scheduler_run_until_done();
+        trace[trace_len] = 0;
+        printf("trace %s\n", trace);
+        PICOTEST_CHECK(task_is_done(&producer) && task_is_done(&consumer) && task_is_done(&yielder), "tasks not done");
+        PICOTEST_CHECK(!strcmp(trace, "abp0p1p2se"), "tasks ran in the wrong order");
+        PICOTEST_CHECK(producer.run_count == 4, "wrong producer run count");
+        PICOTEST_CHECK(producer.max_latency_us < 5000, "excessive latency");
+        task_scheduler_dump();
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("C++ coroutine tasks");
+        int rc = coroutine_queue_test(&queue, 5);
+        PICOTEST_CHECK(rc == 5 || rc == -1, "coroutine did not receive all values");
+    PICOTEST_END_SECTION();
+
+    PICOTEST_END_TEST();
+}
@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/uart_transport.h"
+#include "pico/test.h"
+
+PICOTEST_MODULE_NAME("UART_TRANSPORT_DMA", "UART transport DMA receive test (UART internal loopback)");
+
+// The transport's UART is put in loopback mode, so it receives everything it sends. Each frame is sent with nothing
+// after it, so it must be delivered by the UART interrupts and the idle check alone (uart_transport_poll is never
+// called): a frame shorter than the RX FIFO level by the receive timeout, and a longer one (which doesn't complete a
+// half of the RX ring) by the idle check stopping the DMA
+
+#define RING_SIZE 256
+#define FRAME_COUNT 4
+#define MAX_FRAME_LEN 200
+
+static uint8_t rx_ring[RING_SIZE], tx_ring[RING_SIZE];
+static uint8_t frame_buffer[FRAME_COUNT * MAX_FRAME_LEN];
+static uart_transport_t transport;
+static volatile uint callbacks;
+
+static void frame_received(uart_transport_t *t) {
+    callbacks++;
+}
+
+static void init(uint baud) {
+    uart_init(uart1, baud);
+    hw_set_bits(&uart_get_hw(uart1)->cr, UART_UARTCR_LBE_BITS);
+    uart_transport_config_t config = {
+            .uart = uart1,
+            .framing = UART_TRANSPORT_COBS,
+            .rx_ring = rx_ring,
+            .rx_ring_size = RING_SIZE,
+            .tx_ring = tx_ring,
+            .tx_ring_size = RING_SIZE,
+            .frame_buffer = frame_buffer,
+            .frame_count = FRAME_COUNT,
+            .max_frame_len = MAX_FRAME_LEN,
+            .frame_received = frame_received,
+    };
+    uart_transport_init(&transport, &config);
+    callbacks = 0;
+}
+
+static void deinit(void) {
+    uart_transport_deinit(&transport);
+    uart_deinit(uart1);
+}
+
+// send a frame on its own, and check it comes back without anything else being sent
+static bool received_alone(uint len, uint seed) {
+    static uint8_t frame[MAX_FRAME_LEN];
+    for (uint i = 0; i < len; i++) frame[i] = (uint8_t)((i + seed) * 37);
+    uint before = callbacks;
+    if (!uart_transport_send(&transport, frame, len)) return false;
+    absolute_time_t timeout = make_timeout_time_ms(100);
+    while (callbacks == before && !time_reached(timeout)) tight_loop_contents();
+    uint got_len;
+    const uint8_t *got = uart_transport_get_frame(&transport, &got_len);
+    bool ok = got && got_len == len && !memcmp(got, frame, len);
+    if (got) uart_transport_release_frame(&transport);
+    // and nothing else arrived
+    return ok && !uart_transport_get_frame(&transport, &got_len);
+}
+
+int main() {
+    setup_default_uart();
+    PICOTEST_START();
+
+    static const uint bauds[] = {115200, 1000000};
+    for (uint b = 0; b < count_of(bauds); b++) {
+        printf("%u baud\n", bauds[b]);
+        init(bauds[b]);
+
+        PICOTEST_START_SECTION("short frame");
+            // 3 bytes on the wire, below the RX FIFO level
+            PICOTEST_CHECK(received_alone(1, 0), "1 byte frame not delivered");
+            PICOTEST_CHECK(received_alone(2, 1), "2 byte frame not delivered");
+        PICOTEST_END_SECTION();
+
+        PICOTEST_START_SECTION("frame shorter than half the ring");
+            PICOTEST_CHECK(received_alone(20, 2), "20 byte frame not delivered");
+            PICOTEST_CHECK(received_alone(100, 3), "100 byte frame not delivered");
+            // after the line has been idle, and the DMA stopped
+            sleep_ms(10);
+            PICOTEST_CHECK(received_alone(20, 4), "frame after idle not delivered");
+        PICOTEST_END_SECTION();
+
+        PICOTEST_START_SECTION("frame ending part way through a half");
+            // completes one half of the ring, then ends in the other
+            PICOTEST_CHECK(received_alone(MAX_FRAME_LEN, 5), "long frame not delivered");
+            for (uint len = 1; len < 40; len += 3) {
+                PICOTEST_CHECK(received_alone(len, len), "frame after a long one not delivered");
+            }
+        PICOTEST_END_SECTION();
+
+        uart_transport_stats_t stats;
+        uart_transport_get_stats(&transport, &stats, false);
+        PICOTEST_CHECK(!stats.framing_errors && !stats.rx_overruns && !stats.ring_overruns && !stats.line_errors,
+                       "receive errors");
+        deinit();
+    }
+
+    PICOTEST_END_TEST();
+}
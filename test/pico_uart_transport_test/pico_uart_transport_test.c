@@ -0,0 +1,207 @@
+/**
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "pico/stdlib.h"
+#include "pico/uart_transport.h"
+#include "pico/test.h"
+
+PICOTEST_MODULE_NAME("UART_TRANSPORT", "UART transport framing test (host pty loopback)");
+
+// The transport's UART is attached to a pty, and the test plays the other end of the line through the pty's slave
+// device, checking the encoding of sent frames and feeding in encoded data to be received
+
+#define RING_SIZE 1024
+#define FRAME_COUNT 4
+#define MAX_FRAME_LEN 300
+
+static uint8_t rx_ring[RING_SIZE], tx_ring[RING_SIZE];
+static uint8_t frame_buffer[FRAME_COUNT * MAX_FRAME_LEN];
+static uart_transport_t transport;
+static uart_transport_framing_t framing;
+static uint callbacks;
+static int line;
+
+static void frame_received(uart_transport_t *t) {
+    callbacks++;
+}
+
+static void init(uart_transport_framing_t f) {
+    framing = f;
+    uart_transport_config_t config = {
+            .uart = uart1,
+            .framing = framing,
+            .rx_ring = rx_ring,
+            .rx_ring_size = RING_SIZE,
+            .tx_ring = tx_ring,
+            .tx_ring_size = RING_SIZE,
+            .frame_buffer = frame_buffer,
+            .frame_count = FRAME_COUNT,
+            .max_frame_len = MAX_FRAME_LEN,
+            .frame_received = frame_received,
+    };
+    uart_transport_init(&transport, &config);
+    callbacks = 0;
+}
+
+// read a frame the transport has sent, from the other end of the line
+static uint line_read_frame(uint8_t *buf, uint max) {
+    uint8_t delimiter = framing == UART_TRANSPORT_COBS ? 0x00 : 0xc0;
+    uint delimiters = framing == UART_TRANSPORT_COBS ? 1 : 2;
+    uint len = 0;
+    struct pollfd p = {.fd = line, .events = POLLIN};
+    while (delimiters && len < max && poll(&p, 1, 100) == 1) {
+        if (read(line, buf + len, 1) != 1) break;
+        if (buf[len++] == delimiter) delimiters--;
+    }
+    return len;
+}
+
+static void line_write(const uint8_t *data, uint len) {
+    if (write(line, data, len) != (ssize_t)len) return;
+    // wait for the data to cross the pty
+    absolute_time_t timeout = make_timeout_time_ms(100);
+    while (!uart_is_readable(uart1) && !time_reached(timeout)) tight_loop_contents();
+    do {
+        uart_transport_poll(&transport);
+        sleep_ms(1);
+    } while (uart_is_readable(uart1));
+}
+
+static bool sends_as(const uint8_t *frame, uint len, const uint8_t *encoded, uint encoded_len) {
+    static uint8_t buf[RING_SIZE];
+    if (!uart_transport_send(&transport, frame, len)) return false;
+    if (line_read_frame(buf, sizeof(buf)) != encoded_len || memcmp(buf, encoded, encoded_len)) return false;
+    // nothing else was sent
+    struct pollfd p = {.fd = line, .events = POLLIN};
+    return !poll(&p, 1, 0);
+}
+
+static bool receives(const uint8_t *frame, uint len) {
+    uint frame_len;
+    const uint8_t *f = uart_transport_get_frame(&transport, &frame_len);
+    if (!f || frame_len != len || memcmp(f, frame, len)) return false;
+    uart_transport_release_frame(&transport);
+    return true;
+}
+
+int main() {
+    stdio_init_all();
+    PICOTEST_START();
+
+    const char *name = uart_host_open_pty(uart1);
+    PICOTEST_CHECK_AND_ABORT(name, "couldn't create a pty");
+    line = open(name, O_RDWR | O_NOCTTY);
+    PICOTEST_CHECK_AND_ABORT(line >= 0, "couldn't open the pty");
+
+    static uint8_t big[MAX_FRAME_LEN + 1];
+    static uint8_t encoded[RING_SIZE];
+    uart_transport_stats_t stats;
+    uint len;
+
+    PICOTEST_START_SECTION("COBS encoding");
+        init(UART_TRANSPORT_COBS);
+        PICOTEST_CHECK(sends_as((const uint8_t[]){0x00}, 1, (const uint8_t[]){0x01, 0x01, 0x00}, 3), "");
+        PICOTEST_CHECK(sends_as((const uint8_t[]){0x00, 0x00}, 2, (const uint8_t[]){0x01, 0x01, 0x01, 0x00}, 4), "");
+        PICOTEST_CHECK(sends_as((const uint8_t[]){0x11, 0x22, 0x00, 0x33}, 4,
+                                (const uint8_t[]){0x03, 0x11, 0x22, 0x02, 0x33, 0x00}, 6), "");
+        PICOTEST_CHECK(sends_as((const uint8_t[]){0x11, 0x00, 0x00, 0x00}, 4,
+                                (const uint8_t[]){0x02, 0x11, 0x01, 0x01, 0x01, 0x00}, 6), "");
+        // a 254 byte block is not followed by a zero
+        for (uint i = 0; i < 255; i++) big[i] = (uint8_t)(i + 1);
+        encoded[0] = 0xff;
+        memcpy(encoded + 1, big, 254);
+        encoded[255] = 0;
+        PICOTEST_CHECK(sends_as(big, 254, encoded, 256), "254 bytes");
+        encoded[255] = 0x02;
+        encoded[256] = 0xff;
+        encoded[257] = 0;
+        PICOTEST_CHECK(sends_as(big, 255, encoded, 258), "255 bytes");
+        uart_transport_deinit(&transport);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("SLIP encoding");
+        init(UART_TRANSPORT_SLIP);
+        PICOTEST_CHECK(sends_as((const uint8_t[]){0x01, 0xc0, 0x02, 0xdb, 0x03}, 5,
+                                (const uint8_t[]){0xc0, 0x01, 0xdb, 0xdc, 0x02, 0xdb, 0xdd, 0x03, 0xc0}, 9), "");
+        uart_transport_deinit(&transport);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("COBS decoding and errors");
+        init(UART_TRANSPORT_COBS);
+        // a leading delimiter, and line noise ending in one, are ignored or counted
+        line_write((const uint8_t[]){0x00, 0x03, 0x11, 0x22, 0x02, 0x33, 0x00}, 7);
+        PICOTEST_CHECK(callbacks == 1, "no callback");
+        PICOTEST_CHECK(receives((const uint8_t[]){0x11, 0x22, 0x00, 0x33}, 4), "frame wrong");
+        // a frame ending part way through a block
+        line_write((const uint8_t[]){0x04, 0x11, 0x22, 0x00, 0x01, 0x01, 0x00}, 7);
+        PICOTEST_CHECK(receives((const uint8_t[]){0x00}, 1), "frame after error wrong");
+        // a frame which is too long
+        for (uint i = 0; i < MAX_FRAME_LEN + 1; i++) big[i] = 0x55;
+        PICOTEST_CHECK(uart_transport_send(&transport, big, MAX_FRAME_LEN + 1), "");
+        len = line_read_frame(encoded, sizeof(encoded));
+        line_write(encoded, len);
+        PICOTEST_CHECK(!uart_transport_get_frame(&transport, &len), "oversize frame delivered");
+        // more frames than buffers
+        for (uint i = 0; i < FRAME_COUNT + 1; i++) {
+            line_write((const uint8_t[]){0x02, (uint8_t)(i + 1), 0x00}, 3);
+        }
+        for (uint i = 0; i < FRAME_COUNT; i++) {
+            PICOTEST_CHECK(receives((const uint8_t[]){(uint8_t)(i + 1)}, 1), "buffered frame wrong");
+        }
+        PICOTEST_CHECK(!uart_transport_get_frame(&transport, &len), "dropped frame delivered");
+        uart_transport_get_stats(&transport, &stats, true);
+        PICOTEST_CHECK(stats.frames_received == 2 + FRAME_COUNT, "frames_received wrong");
+        PICOTEST_CHECK(stats.framing_errors == 1, "framing_errors wrong");
+        PICOTEST_CHECK(stats.oversize_frames == 1, "oversize_frames wrong");
+        PICOTEST_CHECK(stats.dropped_frames == 1, "dropped_frames wrong");
+        uart_transport_deinit(&transport);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("SLIP decoding and errors");
+        init(UART_TRANSPORT_SLIP);
+        line_write((const uint8_t[]){0xc0, 0x01, 0xdb, 0xdc, 0xdb, 0xdd, 0xc0, 0xc0, 0x01, 0xdb, 0x01, 0xc0}, 12);
+        PICOTEST_CHECK(receives((const uint8_t[]){0x01, 0xc0, 0xdb}, 3), "frame wrong");
+        PICOTEST_CHECK(!uart_transport_get_frame(&transport, &len), "bad frame delivered");
+        uart_transport_get_stats(&transport, &stats, true);
+        PICOTEST_CHECK(stats.frames_received == 1 && stats.framing_errors == 1, "stats wrong");
+        uart_transport_deinit(&transport);
+    PICOTEST_END_SECTION();
+
+    PICOTEST_START_SECTION("loopback");
+        // frames of random length and content, sent back by the other end of the line
+        for (uint f = 0; f < 2; f++) {
+            init((uart_transport_framing_t)f);
+            srand(f + 1);
+            bool ok = true;
+            for (uint i = 0; i < 200 && ok; i++) {
+                uint frame_len = 1 + (uint)rand() % MAX_FRAME_LEN;
+                for (uint j = 0; j < frame_len; j++) {
+                    // plenty of delimiters and escapes
+                    big[j] = (uint8_t)(rand() % 4 ? rand() : (rand() & 1 ? 0x00 : 0xc0));
+                }
+                ok &= uart_transport_send(&transport, big, frame_len);
+                uint encoded_len = line_read_frame(encoded, sizeof(encoded));
+                line_write(encoded, encoded_len);
+                ok &= receives(big, frame_len);
+            }
+            PICOTEST_CHECK(ok, f ? "SLIP loopback failed" : "COBS loopback failed");
+            uart_transport_get_stats(&transport, &stats, false);
+            PICOTEST_CHECK(stats.frames_sent == 200 && stats.frames_received == 200, "frame counts wrong");
+            uart_transport_deinit(&transport);
+        }
+    PICOTEST_END_SECTION();
+
+    close(line);
+    uart_host_close_pty(uart1);
+    PICOTEST_END_TEST();
+}
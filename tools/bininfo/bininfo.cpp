@@ -0,0 +1,580 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include "bininfo.h"
+#include "boot/uf2.h"
+#include "elf.h"
+#include "pico/binary_info/defs.h"
+#include "pico/binary_info/structure.h"
+
+#if defined(_WIN32)
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// limits to stop a corrupt image sending us round in circles
+#define MAX_ENTRIES 16384u
+#define MAX_MAPPINGS 64u
+#define MAX_LIST_DEPTH 4u
+#define MAX_SIZED_DATA 65536u
+
+int mapped_file::open(const char *filename) {
+    close();
+#if defined(_WIN32)
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) return ERROR_READ_FAILED;
+    _copy.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    _data = _copy.data();
+    _size = _copy.size();
+#else
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0) return ERROR_READ_FAILED;
+    struct stat st;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return ERROR_READ_FAILED;
+    }
+    _size = (size_t)st.st_size;
+    if (_size) {
+        void *p = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            return ERROR_READ_FAILED;
+        }
+        _data = (const uint8_t *)p;
+        _mapped = true;
+    }
+    ::close(fd);
+#endif
+    return 0;
+}
+
+void mapped_file::close() {
+#if !defined(_WIN32)
+    if (_mapped) munmap((void *)_data, _size);
+#endif
+    _mapped = false;
+    _copy.clear();
+    _data = nullptr;
+    _size = 0;
+}
+
+int memory_image::fail(int code, const char *msg) {
+    _error = msg;
+    return code;
+}
+
+const char *memory_image::format_name() const {
+    switch (_format) {
+        case image_format::ELF: return "elf";
+        case image_format::UF2: return "uf2";
+        default: return "bin";
+    }
+}
+
+int memory_image::load(const uint8_t *data, size_t size, uint32_t bin_base) {
+    segments.clear();
+    uf2_data = nullptr;
+    uf2_blocks = 0;
+    uf2_indexed = false;
+    _error.clear();
+    uint32_t magic = 0;
+    if (size >= 4) memcpy(&magic, data, 4);
+    if (magic == ELF_MAGIC) {
+        _format = image_format::ELF;
+        return load_elf(data, size);
+    }
+    if (magic == UF2_MAGIC_START0) {
+        _format = image_format::UF2;
+        return load_uf2(data, size);
+    }
+    _format = image_format::BIN;
+    if (!size || size > UINT32_MAX - bin_base) return fail(ERROR_FORMAT, "Empty or oversized binary");
+    segments.push_back({bin_base, (uint32_t)size, data});
+    return 0;
+}
+
+int memory_image::load_elf(const uint8_t *data, size_t size) {
+    elf32_header eh;
+    if (size < sizeof(eh)) return fail(ERROR_FORMAT, "Truncated ELF header");
+    memcpy(&eh, data, sizeof(eh));
+    if (eh.common.version != 1 || eh.common.version2 != 1) {
+        return fail(ERROR_FORMAT, "Unrecognized ELF version");
+    }
+    if (eh.common.arch_class != 1 || eh.common.endianness != 1) {
+        return fail(ERROR_INCOMPATIBLE, "Require 32 bit little-endian ELF");
+    }
+    if (eh.common.machine != EM_ARM) {
+        return fail(ERROR_INCOMPATIBLE, "Not an ARM executable");
+    }
+    if (eh.ph_entry_size != sizeof(elf32_ph_entry) ||
+        (uint64_t)eh.ph_offset + (uint64_t)eh.ph_num * sizeof(elf32_ph_entry) > size) {
+        return fail(ERROR_FORMAT, "Invalid ELF32 program header");
+    }
+    for (uint i = 0; i < eh.ph_num; i++) {
+        elf32_ph_entry entry;
+        memcpy(&entry, data + eh.ph_offset + i * sizeof(entry), sizeof(entry));
+        uint32_t mapped_size = std::min(entry.filez, entry.memsz);
+        if (entry.type != PT_LOAD || !mapped_size) continue;
+        if ((uint64_t)entry.offset + mapped_size > size) return fail(ERROR_FORMAT, "ELF segment is outside the file");
+        // pointers are looked up at their load (physical) addresses, with the binary info address mapping table
+        // used to translate those of data copied elsewhere at runtime
+        segments.push_back({entry.paddr, mapped_size, data + entry.offset});
+    }
+    if (segments.empty()) return fail(ERROR_INCOMPATIBLE, "The ELF has no loadable segments");
+    std::sort(segments.begin(), segments.end(), [](const segment &a, const segment &b) { return a.addr < b.addr; });
+    return 0;
+}
+
+static bool uf2_block_valid(const uf2_block *block) {
+    return block->magic_start0 == UF2_MAGIC_START0 && block->magic_start1 == UF2_MAGIC_START1 &&
+           block->magic_end == UF2_MAGIC_END && !(block->flags & UF2_FLAG_NOT_MAIN_FLASH) &&
+           block->payload_size && block->payload_size <= sizeof(block->data);
+}
+
+int memory_image::load_uf2(const uint8_t *data, size_t size) {
+    if (size % sizeof(uf2_block)) return fail(ERROR_FORMAT, "UF2 file size is not a multiple of 512 bytes");
+    if (size / sizeof(uf2_block) > UINT32_MAX) return fail(ERROR_FORMAT, "UF2 file is too large");
+    uf2_data = data;
+    uf2_blocks = (uint32_t)(size / sizeof(uf2_block));
+    // the blocks are indexed on demand (see find_uf2), as typically only the first few are needed
+    return 0;
+}
+
+// Find the segment containing an address, in a UF2. Blocks are almost always in address order with equal payload
+// sizes and no gaps, in which case the right block is found directly; otherwise all the blocks are indexed
+const memory_image::segment *memory_image::find_uf2(uint32_t addr) const {
+    if (!uf2_indexed) {
+        const uf2_block *first = (const uf2_block *)uf2_data;
+        if (uf2_block_valid(first) && addr >= first->target_addr) {
+            uint64_t index = (addr - first->target_addr) / first->payload_size;
+            if (index < uf2_blocks) {
+                const uf2_block *block = first + index;
+                if (uf2_block_valid(block) && block->target_addr <= addr &&
+                    addr - block->target_addr < block->payload_size) {
+                    segments.assign(1, {block->target_addr, block->payload_size, block->data});
+                    return &segments[0];
+                }
+            }
+        }
+        segments.clear();
+        for (uint32_t i = 0; i < uf2_blocks; i++) {
+            const uf2_block *block = (const uf2_block *)uf2_data + i;
+            if (uf2_block_valid(block)) segments.push_back({block->target_addr, block->payload_size, block->data});
+        }
+        std::sort(segments.begin(), segments.end(), [](const segment &a, const segment &b) { return a.addr < b.addr; });
+        uf2_indexed = true;
+    }
+    return nullptr;
+}
+
+const memory_image::segment *memory_image::find(uint32_t addr) const {
+    if (_format == image_format::UF2 && !uf2_indexed) {
+        const segment *seg = find_uf2(addr);
+        if (seg || !uf2_indexed) return seg;
+    }
+    // the last segment starting at or before addr
+    auto it = std::upper_bound(segments.begin(), segments.end(), addr,
+                               [](uint32_t a, const segment &s) { return a < s.addr; });
+    if (it == segments.begin()) return nullptr;
+    --it;
+    return addr - it->addr < it->size ? &*it : nullptr;
+}
+
+bool memory_image::read(uint32_t addr, void *dest, uint32_t len) const {
+    uint8_t *out = (uint8_t *)dest;
+    while (len) {
+        const segment *seg = find(addr);
+        if (!seg) return false;
+        uint32_t offset = addr - seg->addr;
+        uint32_t n = std::min(len, seg->size - offset);
+        memcpy(out, seg->data + offset, n);
+        out += n;
+        addr += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool memory_image::read_string(uint32_t addr, std::string &s, uint32_t max_len) const {
+    s.clear();
+    while (s.size() < max_len) {
+        const segment *seg = find(addr);
+        if (!seg) return false;
+        uint32_t offset = addr - seg->addr;
+        const char *p = (const char *)seg->data + offset;
+        uint32_t avail = std::min(seg->size - offset, max_len - (uint32_t)s.size());
+        const char *nul = (const char *)memchr(p, 0, avail);
+        if (nul) {
+            s.append(p, nul - p);
+            return true;
+        }
+        s.append(p, avail);
+        addr += avail;
+    }
+    return true;
+}
+
+uint32_t memory_image::binary_start() const {
+    if (find(FLASH_BASE)) return FLASH_BASE + BOOT2_SIZE;
+    if (_format == image_format::UF2 && !uf2_indexed) {
+        const uf2_block *first = (const uf2_block *)uf2_data;
+        if (uf2_block_valid(first)) return first->target_addr;
+        find(0); // build the index
+    }
+    return segments.empty() ? 0 : segments[0].addr;
+}
+
+namespace {
+    struct reader {
+        const memory_image &image;
+        binary_info &info;
+
+        // translate a runtime address to where it is stored in the image
+        uint32_t translate(uint32_t addr) const {
+            for (const auto &m : info.mappings) {
+                if (addr >= m.dest_addr_start && addr < m.dest_addr_end) {
+                    return m.source_addr_start + (addr - m.dest_addr_start);
+                }
+            }
+            return addr;
+        }
+
+        template<typename T> bool read(uint32_t addr, T &t) const {
+            return image.read(translate(addr), &t, sizeof(t));
+        }
+
+        bool read_string(uint32_t addr, std::string &s) const {
+            return addr && image.read_string(translate(addr), s);
+        }
+
+        bool read_entry(uint32_t addr, binary_info_entry &e, uint depth) const {
+            binary_info_core_t core;
+            if (!read(addr, core)) return false;
+            e.addr = addr;
+            e.type = core.type;
+            e.tag = core.tag;
+            switch (core.type) {
+                case BINARY_INFO_TYPE_SIZED_DATA: {
+                    uint32_t length;
+                    if (!read(addr + offsetof(binary_info_sized_data_t, length), length)) return false;
+                    e.data.resize(std::min(length, MAX_SIZED_DATA));
+                    if (!e.data.empty() &&
+                        !image.read(translate(addr + offsetof(binary_info_sized_data_t, bytes)), e.data.data(),
+                                    (uint32_t)e.data.size())) {
+                        return false;
+                    }
+                    break;
+                }
+                case BINARY_INFO_TYPE_BINARY_INFO_LIST_ZERO_TERMINATED: {
+                    binary_info_list_zero_terminated_t list;
+                    if (!read(addr, list)) return false;
+                    if (depth < MAX_LIST_DEPTH) {
+                        read_list(list.list, 0, e.children, depth + 1);
+                    }
+                    break;
+                }
+                case BINARY_INFO_TYPE_ID_AND_INT: {
+                    binary_info_id_and_int_t bi;
+                    if (!read(addr, bi)) return false;
+                    e.id = bi.id;
+                    e.value = bi.value;
+                    break;
+                }
+                case BINARY_INFO_TYPE_ID_AND_STRING: {
+                    binary_info_id_and_string_t bi;
+                    if (!read(addr, bi)) return false;
+                    e.id = bi.id;
+                    read_string(bi.value, e.label);
+                    break;
+                }
+                case BINARY_INFO_TYPE_BLOCK_DEVICE: {
+                    binary_info_block_device_t bi;
+                    if (!read(addr, bi)) return false;
+                    read_string(bi.name, e.label);
+                    e.address = bi.address;
+                    e.size = bi.size;
+                    e.flags = bi.flags;
+                    if (bi.extra && depth < MAX_LIST_DEPTH) {
+                        binary_info_entry extra;
+                        if (read_entry(bi.extra, extra, depth + 1)) e.children.push_back(std::move(extra));
+                    }
+                    break;
+                }
+                case BINARY_INFO_TYPE_PINS_WITH_FUNC: {
+                    binary_info_pins_with_func_t bi;
+                    if (!read(addr, bi)) return false;
+                    uint32_t encoding = bi.pin_encoding;
+                    e.func = (encoding >> 3) & 0xf;
+                    if ((encoding & 7) == BI_PINS_ENCODING_RANGE) {
+                        uint plo = (encoding >> 7) & 0x1f;
+                        uint phi = (encoding >> 12) & 0x1f;
+                        for (uint pin = plo; pin <= phi; pin++) e.pins.push_back((uint8_t)pin);
+                    } else if ((encoding & 7) == BI_PINS_ENCODING_MULTI) {
+                        // up to 5 pins; fewer are encoded by repeating the last
+                        for (uint i = 0; i < 5; i++) {
+                            uint8_t pin = (encoding >> (7 + i * 5)) & 0x1f;
+                            if (i && pin == e.pins.back()) break;
+                            e.pins.push_back(pin);
+                        }
+                    }
+                    for (auto pin : e.pins) e.pin_mask |= 1u << pin;
+                    break;
+                }
+                case BINARY_INFO_TYPE_PINS_WITH_NAME: {
+                    binary_info_pins_with_name_t bi;
+                    if (!read(addr, bi)) return false;
+                    e.pin_mask = bi.pin_mask;
+                    read_string(bi.label, e.label);
+                    break;
+                }
+                case BINARY_INFO_TYPE_NAMED_GROUP: {
+                    binary_info_named_group_t bi;
+                    if (!read(addr, bi)) return false;
+                    e.parent_id = bi.parent_id;
+                    e.flags = bi.flags;
+                    e.group_tag = bi.group_tag;
+                    e.id = bi.group_id;
+                    read_string(bi.label, e.label);
+                    break;
+                }
+                default:
+                    // RAW_DATA and BSON have no length we can rely on, so are reported by type only
+                    break;
+            }
+            return true;
+        }
+
+        // read an array of entry pointers, up to end, or to a null pointer if end is 0
+        void read_list(uint32_t addr, uint32_t end, std::vector<binary_info_entry> &entries, uint depth) const {
+            for (uint n = 0; n < MAX_ENTRIES && (end ? addr < end : true); n++, addr += 4) {
+                uint32_t ptr;
+                if (!read(addr, ptr) || (!end && !ptr)) break;
+                binary_info_entry e;
+                if (read_entry(ptr, e, depth)) entries.push_back(std::move(e));
+            }
+        }
+    };
+}
+
+int read_binary_info(const memory_image &image, binary_info &info, std::string &error) {
+    info = binary_info();
+    uint32_t base = image.binary_start();
+    // the header starts within the first 256 bytes, so may extend past them
+    const uint scan_words = 256 / 4 + 4;
+    uint32_t words[scan_words];
+    if (!image.read(base, words, sizeof(words))) {
+        // a short image; read what there is
+        memset(words, 0, sizeof(words));
+        for (uint i = 0; i < scan_words && image.read_u32(base + i * 4, words[i]); i++) {}
+    }
+    uint i;
+    for (i = 0; i + 4 < scan_words; i++) {
+        if (words[i] == BINARY_INFO_MARKER_START && words[i + 4] == BINARY_INFO_MARKER_END) break;
+    }
+    if (i + 4 >= scan_words) {
+        error = "No binary info header found";
+        return ERROR_NOT_FOUND;
+    }
+    info.header_addr = base + i * 4;
+    info.start = words[i + 1];
+    info.end = words[i + 2];
+    uint32_t mapping_addr = words[i + 3];
+    for (uint n = 0; n < MAX_MAPPINGS; n++, mapping_addr += sizeof(address_mapping)) {
+        address_mapping m;
+        if (!image.read(mapping_addr, &m, sizeof(m)) || !m.source_addr_start) break;
+        info.mappings.push_back(m);
+    }
+    if (info.end < info.start || info.end - info.start > MAX_ENTRIES * 4) {
+        error = "Invalid binary info header";
+        return ERROR_FORMAT;
+    }
+    reader r{image, info};
+    r.read_list(info.start, info.end, info.entries, 0);
+    return 0;
+}
+
+static void write_json_string(FILE *out, const std::string &s) {
+    fputc('"', out);
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if (c == '\n') {
+            fputs("\\n", out);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static const char *type_name(uint type) {
+    switch (type) {
+        case BINARY_INFO_TYPE_RAW_DATA: return "raw_data";
+        case BINARY_INFO_TYPE_SIZED_DATA: return "sized_data";
+        case BINARY_INFO_TYPE_BINARY_INFO_LIST_ZERO_TERMINATED: return "list";
+        case BINARY_INFO_TYPE_BSON: return "bson";
+        case BINARY_INFO_TYPE_ID_AND_INT: return "id_and_int";
+        case BINARY_INFO_TYPE_ID_AND_STRING: return "id_and_string";
+        case BINARY_INFO_TYPE_BLOCK_DEVICE: return "block_device";
+        case BINARY_INFO_TYPE_PINS_WITH_FUNC: return "pins_with_func";
+        case BINARY_INFO_TYPE_PINS_WITH_NAME: return "pins_with_name";
+        case BINARY_INFO_TYPE_NAMED_GROUP: return "named_group";
+        default: return nullptr;
+    }
+}
+
+static const char *rp_id_name(uint32_t id) {
+    switch (id) {
+        case BINARY_INFO_ID_RP_PROGRAM_NAME: return "program_name";
+        case BINARY_INFO_ID_RP_PROGRAM_VERSION_STRING: return "program_version_string";
+        case BINARY_INFO_ID_RP_PROGRAM_BUILD_DATE_STRING: return "program_build_date_string";
+        case BINARY_INFO_ID_RP_BINARY_END: return "binary_end";
+        case BINARY_INFO_ID_RP_PROGRAM_URL: return "program_url";
+        case BINARY_INFO_ID_RP_PROGRAM_DESCRIPTION: return "program_description";
+        case BINARY_INFO_ID_RP_PROGRAM_FEATURE: return "program_feature";
+        case BINARY_INFO_ID_RP_PROGRAM_BUILD_ATTRIBUTE: return "program_build_attribute";
+        case BINARY_INFO_ID_RP_SDK_VERSION: return "sdk_version";
+        case BINARY_INFO_ID_RP_PICO_BOARD: return "pico_board";
+        case BINARY_INFO_ID_RP_BOOT2_NAME: return "boot2_name";
+        case BINARY_INFO_ID_RP_LOCK_STATS_TABLE: return "lock_stats_table";
+        default: return nullptr;
+    }
+}
+
+static const char *gpio_function_name(uint func) {
+    static const char *names[] = {"xip", "spi", "uart", "i2c", "pwm", "sio", "pio0", "pio1", "gpck", "usb"};
+    return func < sizeof(names) / sizeof(names[0]) ? names[func] : nullptr;
+}
+
+static void write_tag(FILE *out, const char *key, uint16_t tag) {
+    char c1 = (char)(tag & 0xff), c2 = (char)(tag >> 8);
+    if (c1 >= 0x20 && c1 < 0x7f && c2 >= 0x20 && c2 < 0x7f && c1 != '"' && c2 != '"' && c1 != '\\' && c2 != '\\') {
+        fprintf(out, "\"%s\": \"%c%c\"", key, c1, c2);
+    } else {
+        fprintf(out, "\"%s\": %u", key, tag);
+    }
+}
+
+static void write_entry_json(FILE *out, const binary_info_entry &e, uint indent) {
+    fprintf(out, "%*s{\"address\": \"0x%08x\", ", indent, "", e.addr);
+    const char *name = type_name(e.type);
+    if (name) fprintf(out, "\"type\": \"%s\", ", name);
+    else fprintf(out, "\"type\": %u, ", e.type);
+    write_tag(out, "tag", e.tag);
+    const char *id_name = e.tag == BINARY_INFO_TAG_RASPBERRY_PI ? rp_id_name(e.id) : nullptr;
+    switch (e.type) {
+        case BINARY_INFO_TYPE_SIZED_DATA:
+            fputs(", \"data\": \"", out);
+            for (auto b : e.data) fprintf(out, "%02x", b);
+            fputc('"', out);
+            break;
+        case BINARY_INFO_TYPE_ID_AND_INT:
+        case BINARY_INFO_TYPE_ID_AND_STRING:
+            fprintf(out, ", \"id\": \"0x%08x\"", e.id);
+            if (id_name) fprintf(out, ", \"name\": \"%s\"", id_name);
+            fputs(", \"value\": ", out);
+            if (e.type == BINARY_INFO_TYPE_ID_AND_INT) fprintf(out, "%d", e.value);
+            else write_json_string(out, e.label);
+            break;
+        case BINARY_INFO_TYPE_BLOCK_DEVICE: {
+            static const char *pt[] = {"unknown", "mbr", "gpt", "none"};
+            fputs(", \"name\": ", out);
+            write_json_string(out, e.label);
+            fprintf(out, ", \"device_address\": \"0x%08x\", \"size\": %u, \"read\": %s, \"write\": %s, "
+                         "\"reformat\": %s, \"partition_table\": \"%s\"", e.address, e.size,
+                    e.flags & BINARY_INFO_BLOCK_DEV_FLAG_READ ? "true" : "false",
+                    e.flags & BINARY_INFO_BLOCK_DEV_FLAG_WRITE ? "true" : "false",
+                    e.flags & BINARY_INFO_BLOCK_DEV_FLAG_REFORMAT ? "true" : "false", pt[(e.flags >> 4) & 3]);
+            break;
+        }
+        case BINARY_INFO_TYPE_PINS_WITH_FUNC: {
+            const char *func = gpio_function_name(e.func);
+            if (func) fprintf(out, ", \"function\": \"%s\"", func);
+            else fprintf(out, ", \"function\": %u", e.func);
+            fputs(", \"pins\": [", out);
+            for (size_t i = 0; i < e.pins.size(); i++) fprintf(out, "%s%u", i ? ", " : "", e.pins[i]);
+            fputc(']', out);
+            break;
+        }
+        case BINARY_INFO_TYPE_PINS_WITH_NAME: {
+            // one label for all the pins, or '|' separated labels for each pin in ascending order
+            std::vector<std::string> labels;
+            size_t pos = 0, bar;
+            while ((bar = e.label.find('|', pos)) != std::string::npos) {
+                labels.push_back(e.label.substr(pos, bar - pos));
+                pos = bar + 1;
+            }
+            labels.push_back(e.label.substr(pos));
+            fputs(", \"pins\": [", out);
+            uint n = 0;
+            for (uint pin = 0; pin < 32; pin++) {
+                if (!(e.pin_mask & (1u << pin))) continue;
+                fprintf(out, "%s{\"pin\": %u, \"name\": ", n ? ", " : "", pin);
+                write_json_string(out, labels.size() == 1 ? labels[0] : n < labels.size() ? labels[n] : "");
+                fputc('}', out);
+                n++;
+            }
+            fputc(']', out);
+            break;
+        }
+        case BINARY_INFO_TYPE_NAMED_GROUP: {
+            const char *parent_name = e.tag == BINARY_INFO_TAG_RASPBERRY_PI ? rp_id_name(e.parent_id) : nullptr;
+            fprintf(out, ", \"parent_id\": \"0x%08x\"", e.parent_id);
+            if (parent_name) fprintf(out, ", \"parent_name\": \"%s\"", parent_name);
+            fputs(", ", out);
+            write_tag(out, "group_tag", e.group_tag);
+            fprintf(out, ", \"group_id\": \"0x%08x\", \"label\": ", e.id);
+            write_json_string(out, e.label);
+            fprintf(out, ", \"show_if_empty\": %s, \"separate_commas\": %s, \"sort_alpha\": %s, \"advanced\": %s",
+                    e.flags & BI_NAMED_GROUP_SHOW_IF_EMPTY ? "true" : "false",
+                    e.flags & BI_NAMED_GROUP_SEPARATE_COMMAS ? "true" : "false",
+                    e.flags & BI_NAMED_GROUP_SORT_ALPHA ? "true" : "false",
+                    e.flags & BI_NAMED_GROUP_ADVANCED ? "true" : "false");
+            break;
+        }
+        default:
+            break;
+    }
+    if (e.type == BINARY_INFO_TYPE_BINARY_INFO_LIST_ZERO_TERMINATED || e.type == BINARY_INFO_TYPE_BLOCK_DEVICE) {
+        fprintf(out, ", \"%s\": [", e.type == BINARY_INFO_TYPE_BLOCK_DEVICE ? "extra" : "entries");
+        for (size_t i = 0; i < e.children.size(); i++) {
+            fputs(i ? ",\n" : "\n", out);
+            write_entry_json(out, e.children[i], indent + 2);
+        }
+        if (!e.children.empty()) fprintf(out, "\n%*s", indent, "");
+        fputc(']', out);
+    }
+    fputc('}', out);
+}
+
+void write_binary_info_json(FILE *out, const char *filename, const memory_image &image, const binary_info &info) {
+    fputs("{\"file\": ", out);
+    write_json_string(out, filename);
+    fprintf(out, ", \"format\": \"%s\", \"header_address\": \"0x%08x\",\n \"address_mappings\": [", image.format_name(),
+            info.header_addr);
+    for (size_t i = 0; i < info.mappings.size(); i++) {
+        const auto &m = info.mappings[i];
+        fprintf(out, "%s{\"source\": \"0x%08x\", \"dest_start\": \"0x%08x\", \"dest_end\": \"0x%08x\"}", i ? ", " : "",
+                m.source_addr_start, m.dest_addr_start, m.dest_addr_end);
+    }
+    fputs("],\n \"entries\": [", out);
+    for (size_t i = 0; i < info.entries.size(); i++) {
+        fputs(i ? ",\n" : "\n", out);
+        write_entry_json(out, info.entries[i], 2);
+    }
+    fputs(info.entries.empty() ? "]}" : "\n ]}", out);
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _BININFO_H
+#define _BININFO_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Reads the binary info (see pico/binary_info.h) embedded in an RP2040 image, without needing to disassemble or
+// even fully read the image: the binary info header is found by scanning the first 256 bytes of the binary (after
+// the flash second stage for a flash binary), and from there only the entries, and the strings and lists they point
+// to, are read.
+
+#define ERROR_ARGS -1
+#define ERROR_FORMAT -2
+#define ERROR_INCOMPATIBLE -3
+#define ERROR_READ_FAILED -4
+#define ERROR_NOT_FOUND -5
+
+typedef unsigned int uint;
+
+enum class image_format {
+    ELF,
+    UF2,
+    BIN,
+};
+
+// A file's contents, memory mapped where possible (so only the parts of the file actually looked at are read)
+class mapped_file {
+public:
+    mapped_file() = default;
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+    ~mapped_file() { close(); }
+
+    int open(const char *filename);
+    void close();
+
+    const uint8_t *data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    const uint8_t *_data = nullptr;
+    size_t _size = 0;
+    bool _mapped = false;
+    std::vector<uint8_t> _copy;
+};
+
+// The RP2040 address space as seen by a loaded image. This refers to, rather than copies, the file data, which must
+// remain valid while it is in use.
+class memory_image {
+public:
+    // Load an image, detecting its format from its contents (anything neither ELF nor UF2 being taken as a binary
+    // loaded at bin_base)
+    int load(const uint8_t *data, size_t size, uint32_t bin_base = FLASH_BASE);
+
+    image_format format() const { return _format; }
+    const char *format_name() const;
+    // The address the binary starts at (after the flash second stage for a flash binary)
+    uint32_t binary_start() const;
+
+    // Read bytes, which need not all be in one segment; returns false if any byte is not in the image
+    bool read(uint32_t addr, void *dest, uint32_t len) const;
+    bool read_u32(uint32_t addr, uint32_t &value) const { return read(addr, &value, 4); }
+    // Read a null terminated string, of at most max_len characters
+    bool read_string(uint32_t addr, std::string &s, uint32_t max_len = 1024) const;
+
+    const std::string &error() const { return _error; }
+
+    static const uint32_t FLASH_BASE = 0x10000000u;
+    static const uint32_t BOOT2_SIZE = 0x100u;
+
+private:
+    struct segment {
+        uint32_t addr;
+        uint32_t size;
+        const uint8_t *data;
+    };
+
+    int load_elf(const uint8_t *data, size_t size);
+    int load_uf2(const uint8_t *data, size_t size);
+    int fail(int code, const char *msg);
+    const segment *find(uint32_t addr) const;
+    const segment *find_uf2(uint32_t addr) const;
+
+    image_format _format = image_format::BIN;
+    std::string _error;
+    // sorted by address, and not overlapping
+    mutable std::vector<segment> segments;
+    // for UF2, the blocks are only all indexed if a block isn't where it would be in a contiguous image
+    const uint8_t *uf2_data = nullptr;
+    uint32_t uf2_blocks = 0;
+    mutable bool uf2_indexed = false;
+};
+
+// A decoded binary info entry. Which fields are used depends on the type
+struct binary_info_entry {
+    uint32_t addr = 0;
+    uint16_t type = 0;
+    uint16_t tag = 0;
+    uint32_t id = 0;                    // ID_AND_INT, ID_AND_STRING; the group id for NAMED_GROUP
+    int32_t value = 0;                  // ID_AND_INT
+    std::string label;                  // ID_AND_STRING value, PINS_WITH_NAME labels, BLOCK_DEVICE or NAMED_GROUP name
+    uint32_t parent_id = 0;             // NAMED_GROUP
+    uint16_t group_tag = 0;             // NAMED_GROUP
+    uint16_t flags = 0;                 // NAMED_GROUP, BLOCK_DEVICE
+    uint32_t address = 0;               // BLOCK_DEVICE
+    uint32_t size = 0;                  // BLOCK_DEVICE
+    uint32_t pin_mask = 0;              // PINS_WITH_FUNC, PINS_WITH_NAME
+    std::vector<uint8_t> pins;          // PINS_WITH_FUNC, in the order encoded
+    uint func = 0;                      // PINS_WITH_FUNC; a GPIO_FUNC_ value
+    std::vector<uint8_t> data;          // SIZED_DATA
+    std::vector<binary_info_entry> children; // LIST_ZERO_TERMINATED items, or the BLOCK_DEVICE extra entry
+};
+
+struct address_mapping {
+    uint32_t source_addr_start;
+    uint32_t dest_addr_start;
+    uint32_t dest_addr_end;
+};
+
+struct binary_info {
+    uint32_t header_addr = 0;
+    uint32_t start = 0;
+    uint32_t end = 0;
+    std::vector<address_mapping> mappings;
+    std::vector<binary_info_entry> entries;
+};
+
+// Find and decode the binary info in an image. Entries which can't be read (because they point outside the image)
+// are skipped; returns ERROR_NOT_FOUND if the image has no binary info header
+int read_binary_info(const memory_image &image, binary_info &info, std::string &error);
+
+// Write a JSON object describing the binary info of a file
+void write_binary_info_json(FILE *out, const char *filename, const memory_image &image, const binary_info &info);
+
+#endif
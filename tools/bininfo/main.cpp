@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include "bininfo.h"
+
+static int usage() {
+    fprintf(stderr, "Usage: bininfo (-base <address>) (-benchmark <iterations>) <ELF, UF2 or BIN file>...\n\n");
+    fprintf(stderr, "Print the binary info of each file as a JSON array of objects (one per file).\n\n");
+    fprintf(stderr, "options:\n");
+    fprintf(stderr, "  -base <address>           the address a BIN file is loaded at (default 0x%08x)\n",
+            memory_image::FLASH_BASE);
+    fprintf(stderr, "  -benchmark <iterations>   instead, read the binary info of all the files the given number\n");
+    fprintf(stderr, "                            of times, and report how long it took\n");
+    return ERROR_ARGS;
+}
+
+static int read_file(const char *filename, uint32_t bin_base, mapped_file &file, memory_image &image,
+                     binary_info &info, std::string &error) {
+    int rc = file.open(filename);
+    if (rc) {
+        error = "Can't open input file";
+        return rc;
+    }
+    rc = image.load(file.data(), file.size(), bin_base);
+    if (rc) {
+        error = image.error();
+        return rc;
+    }
+    return read_binary_info(image, info, error);
+}
+
+static int benchmark(const std::vector<const char *> &files, uint32_t bin_base, long iterations) {
+    uint64_t images = 0, entries = 0, failures = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        for (const char *filename : files) {
+            // open and map each file every time, as indexing a corpus would
+            mapped_file file;
+            memory_image image;
+            binary_info info;
+            std::string error;
+            if (read_file(filename, bin_base, file, image, info, error)) failures++;
+            entries += info.entries.size();
+            images++;
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%llu images (%llu without binary info) with %llu entries in %.3f s: %.0f images/s, %.2f us per image\n",
+           (unsigned long long)images, (unsigned long long)failures, (unsigned long long)entries, secs,
+           secs > 0 ? (double)images / secs : 0.0, images ? secs * 1e6 / (double)images : 0.0);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    uint32_t bin_base = memory_image::FLASH_BASE;
+    long iterations = 0;
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (!strcmp(argv[arg], "-base") && arg + 1 < argc) {
+            bin_base = (uint32_t)strtoul(argv[++arg], nullptr, 0);
+        } else if (!strcmp(argv[arg], "-benchmark") && arg + 1 < argc) {
+            iterations = strtol(argv[++arg], nullptr, 0);
+            if (iterations <= 0) return usage();
+        } else {
+            return usage();
+        }
+    }
+    if (arg == argc) return usage();
+    std::vector<const char *> files(argv + arg, argv + argc);
+    if (iterations) return benchmark(files, bin_base, iterations);
+
+    int rc = 0;
+    printf("[");
+    for (size_t i = 0; i < files.size(); i++) {
+        mapped_file file;
+        memory_image image;
+        binary_info info;
+        std::string error;
+        printf(i ? ",\n" : "\n");
+        int file_rc = read_file(files[i], bin_base, file, image, info, error);
+        if (file_rc) {
+            // report the failure in the output, so one bad file doesn't spoil a whole inventory
+            printf("{\"file\": \"");
+            for (const char *c = files[i]; *c; c++) {
+                if (*c == '"' || *c == '\\') putchar('\\');
+                putchar(*c);
+            }
+            printf("\", \"error\": \"%s\"}", error.c_str());
+            fprintf(stderr, "ERROR: %s: %s\n", files[i], error.c_str());
+            if (!rc) rc = file_rc;
+        } else {
+            write_binary_info_json(stdout, files[i], image, info);
+        }
+    }
+    printf("\n]\n");
+    return rc;
+}
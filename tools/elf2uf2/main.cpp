@@ -11,7 +11,10 @@
 #include <cstring>
 #include <cstdarg>
 #include <algorithm>
+#include <string>
 #include "boot/uf2.h"
+#include "boot/uf2z.h"
+#include "pico/lz4.h"
 #include "elf.h"
 
 typedef unsigned int uint;
@@ -93,7 +96,8 @@ struct page_fragment {
 };
 
 static int usage() {
-    fprintf(stderr, "Usage: elf2uf2 (-v) <input ELF file> <output UF2 file>\n");
+    fprintf(stderr, "Usage: elf2uf2 (-v) (-z <loader ELF file>) <input ELF file> <output UF2 file>\n");
+    fprintf(stderr, "  -z  write a compressed UF2, which the given loader (pico_uf2z_loader) programs into flash\n");
     return ERROR_ARGS;
 }
 
@@ -242,11 +246,13 @@ static bool is_address_mapped(const std::map<uint32_t, std::vector<page_fragment
     return true;
 }
 
-int elf2uf2(FILE *in, FILE *out) {
+typedef std::map<uint32_t, std::vector<page_fragment>> page_map;
+
+// Read the pages of an ELF, adding padding pages to a flash binary
+static int read_pages(FILE *in, page_map &pages, bool &ram_style) {
     elf32_header eh;
-    std::map<uint32_t, std::vector<page_fragment>> pages;
     int rc = read_and_check_elf32_header(in, eh);
-    bool ram_style = false;
+    ram_style = false;
     address_ranges valid_ranges = {};
     if (!rc) {
         ram_style = is_address_initialized(rp2040_address_ranges_ram, eh.entry);
@@ -264,7 +270,6 @@ int elf2uf2(FILE *in, FILE *out) {
     if (pages.empty()) {
         return fail(ERROR_INCOMPATIBLE, "The input file has no memory pages");
     }
-    uint page_num = 0;
     if (ram_style) {
         uint32_t expected_ep_main_ram = UINT32_MAX;
         uint32_t expected_ep_xip_sram = UINT32_MAX;
@@ -321,6 +326,12 @@ int elf2uf2(FILE *in, FILE *out) {
             }
         }
     }
+    return 0;
+}
+
+static int write_uf2(FILE *in, const page_map &pages, FILE *out) {
+    uint page_num = 0;
+    int rc;
     uf2_block block;
     block.magic_start0 = UF2_MAGIC_START0;
     block.magic_start1 = UF2_MAGIC_START1;
@@ -346,11 +357,216 @@ int elf2uf2(FILE *in, FILE *out) {
     return 0;
 }
 
+int elf2uf2(FILE *in, FILE *out) {
+    page_map pages;
+    bool ram_style;
+    int rc = read_pages(in, pages, ram_style);
+    if (rc) return rc;
+    return write_uf2(in, pages, out);
+}
+
+// A compressed flash sector, ready to go in a uf2z container
+struct compressed_block {
+    uf2z_block header;
+    std::vector<uint8_t> data;
+
+    uint32_t container_size() const {
+        return (uint32_t)(sizeof(header) + ((data.size() + 3) & ~3u));
+    }
+};
+
+static std::string part_filename(const char *filename, uint part) {
+    std::string name(filename);
+    if (!part) return name;
+    // out.uf2 -> out.part2.uf2
+    std::string suffix = ".part" + std::to_string(part + 1);
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos || name.find('/', dot) != std::string::npos) return name + suffix;
+    return name.substr(0, dot) + suffix + name.substr(dot);
+}
+
+// Write one part of a compressed UF2: the loader's pages followed by the container, as a RAM UF2
+static int write_uf2z_part(FILE *loader, const page_map &loader_pages, const std::vector<uint8_t> &container,
+                           FILE *out) {
+    uf2_block block;
+    block.magic_start0 = UF2_MAGIC_START0;
+    block.magic_start1 = UF2_MAGIC_START1;
+    block.flags = UF2_FLAG_FAMILY_ID_PRESENT;
+    block.payload_size = PAGE_SIZE;
+    block.num_blocks = (uint32_t)(loader_pages.size() + (container.size() + PAGE_SIZE - 1) / PAGE_SIZE);
+    block.file_size = RP2040_FAMILY_ID;
+    block.magic_end = UF2_MAGIC_END;
+    block.block_no = 0;
+    for (auto &page_entry : loader_pages) {
+        block.target_addr = page_entry.first;
+        memset(block.data, 0, sizeof(block.data));
+        int rc = realize_page(loader, page_entry.second, block.data, sizeof(block.data));
+        if (rc) return rc;
+        if (1 != fwrite(&block, sizeof(uf2_block), 1, out)) return fail_write_error();
+        block.block_no++;
+    }
+    for (uint32_t offset = 0; offset < container.size(); offset += PAGE_SIZE) {
+        block.target_addr = UF2Z_CONTAINER_ADDR + offset;
+        memset(block.data, 0, sizeof(block.data));
+        memcpy(block.data, container.data() + offset, std::min((size_t)PAGE_SIZE, container.size() - offset));
+        if (1 != fwrite(&block, sizeof(uf2_block), 1, out)) return fail_write_error();
+        block.block_no++;
+    }
+    return 0;
+}
+
+// Check none of the loader's memory overlaps the container. This has to look at the segments themselves, as the pages
+// only cover initialized data, and not the bss (which is zeroed by crt0.S before the loader could check it)
+static int check_loader_memory(FILE *loader) {
+    elf32_header eh;
+    if (fseek(loader, 0, SEEK_SET)) {
+        return fail_read_error();
+    }
+    int rc = read_and_check_elf32_header(loader, eh);
+    if (rc) return rc;
+    std::vector<elf32_ph_entry> entries(eh.ph_num);
+    if (eh.ph_num && (fseek(loader, eh.ph_offset, SEEK_SET) ||
+                      eh.ph_num != fread(&entries[0], sizeof(struct elf32_ph_entry), eh.ph_num, loader))) {
+        return fail_read_error();
+    }
+    for (const auto &entry : entries) {
+        if (entry.type == PT_LOAD && entry.memsz && entry.vaddr < UF2Z_CONTAINER_ADDR + UF2Z_CONTAINER_MAX_SIZE &&
+            entry.vaddr + entry.memsz > UF2Z_CONTAINER_ADDR) {
+            return fail(ERROR_INCOMPATIBLE, "The loader's memory %08x->%08x overlaps the container at %08x",
+                        entry.vaddr, entry.vaddr + entry.memsz, UF2Z_CONTAINER_ADDR);
+        }
+    }
+    return 0;
+}
+
+int elf2uf2z(FILE *in, FILE *loader, FILE *out, const char *out_filename) {
+    page_map pages, loader_pages;
+    bool ram_style;
+    int rc = read_pages(in, pages, ram_style);
+    if (rc) return rc;
+    if (ram_style) return fail(ERROR_INCOMPATIBLE, "Only flash binaries can be compressed");
+    rc = read_pages(loader, loader_pages, ram_style);
+    if (rc) return rc;
+    if (!ram_style || loader_pages.begin()->first < MAIN_RAM_START ||
+        loader_pages.rbegin()->first + PAGE_SIZE > UF2Z_CONTAINER_ADDR) {
+        return fail(ERROR_INCOMPATIBLE, "The loader must be a RAM binary below %08x", UF2Z_CONTAINER_ADDR);
+    }
+    rc = check_loader_memory(loader);
+    if (rc) return rc;
+
+    // gather the pages into sectors, and compress each one
+    std::vector<compressed_block> blocks;
+    std::vector<uint8_t> sector(UF2Z_BLOCK_SIZE);
+    std::vector<uint8_t> compressed(LZ4_COMPRESS_BOUND(UF2Z_BLOCK_SIZE));
+    uint32_t uncompressed_size = 0;
+    for (auto it = pages.begin(); it != pages.end();) {
+        uint32_t sector_addr = it->first & ~(UF2Z_BLOCK_SIZE - 1);
+        std::fill(sector.begin(), sector.end(), 0);
+        uint32_t size = 0;
+        for (; it != pages.end() && it->first < sector_addr + UF2Z_BLOCK_SIZE; ++it) {
+            uint32_t page_offset = it->first - sector_addr;
+            rc = realize_page(in, it->second, sector.data() + page_offset, PAGE_SIZE);
+            if (rc) return rc;
+            size = page_offset + PAGE_SIZE;
+        }
+        compressed_block block;
+        block.header.flash_offset = sector_addr - FLASH_START;
+        block.header.size = (uint16_t)size;
+        uint32_t compressed_size = lz4_compress_block(sector.data(), size, compressed.data(),
+                                                      (uint32_t)compressed.size());
+        if (compressed_size && compressed_size < size) {
+            block.data.assign(compressed.begin(), compressed.begin() + compressed_size);
+        } else {
+            // store it as it is
+            block.data.assign(sector.begin(), sector.begin() + size);
+        }
+        block.header.compressed_size = (uint16_t)block.data.size();
+        uncompressed_size += size;
+        blocks.push_back(std::move(block));
+    }
+
+    // split the blocks into parts which each fit in RAM
+    std::vector<std::pair<size_t, size_t>> parts; // first block, number of blocks
+    uint32_t part_size = 0;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        uint32_t block_size = blocks[i].container_size();
+        if (parts.empty() || sizeof(uf2z_header) + part_size + block_size > UF2Z_CONTAINER_MAX_SIZE) {
+            parts.emplace_back(i, 0);
+            part_size = 0;
+        }
+        parts.back().second++;
+        part_size += block_size;
+    }
+
+    uint32_t total_compressed = 0;
+    uint32_t total_uf2_blocks = 0;
+    std::vector<std::string> part_files; // the parts after the first, which is written to out
+    for (uint part = 0; part < parts.size(); part++) {
+        std::vector<uint8_t> container(sizeof(uf2z_header));
+        uf2z_header header;
+        header.magic = UF2Z_MAGIC;
+        header.version = UF2Z_VERSION;
+        header.flags = part + 1 < parts.size() ? UF2Z_FLAG_MORE_PARTS : 0;
+        header.part = (uint16_t)part;
+        header.num_parts = (uint16_t)parts.size();
+        header.num_blocks = (uint32_t)parts[part].second;
+        header.uncompressed_size = 0;
+        for (size_t i = parts[part].first; i < parts[part].first + parts[part].second; i++) {
+            const compressed_block &block = blocks[i];
+            const uint8_t *h = (const uint8_t *)&block.header;
+            container.insert(container.end(), h, h + sizeof(block.header));
+            container.insert(container.end(), block.data.begin(), block.data.end());
+            container.resize((container.size() + 3) & ~3u);
+            header.uncompressed_size += block.header.size;
+        }
+        header.data_size = (uint32_t)(container.size() - sizeof(header));
+        memcpy(container.data(), &header, sizeof(header));
+        total_compressed += header.data_size + (uint32_t)sizeof(header);
+
+        std::string filename = part_filename(out_filename, part);
+        FILE *part_out = out;
+        if (part) {
+            part_out = fopen(filename.c_str(), "wb");
+            if (!part_out) {
+                rc = fail(ERROR_WRITE_FAILED, "Can't open output file '%s'", filename.c_str());
+                break;
+            }
+            part_files.push_back(filename);
+        }
+        rc = write_uf2z_part(loader, loader_pages, container, part_out);
+        if (part && fclose(part_out) && !rc) rc = fail_write_error();
+        if (rc) break;
+        uint32_t uf2_blocks = (uint32_t)(loader_pages.size() + (container.size() + PAGE_SIZE - 1) / PAGE_SIZE);
+        total_uf2_blocks += uf2_blocks;
+        if (verbose) {
+            printf("Part %d / %d: %d sectors in %d UF2 blocks (%s)\n", part + 1, (int)parts.size(),
+                   (int)header.num_blocks, uf2_blocks, filename.c_str());
+        }
+    }
+    if (rc) {
+        // don't leave an incomplete set of parts behind (the caller removes the first)
+        for (const auto &filename : part_files) remove(filename.c_str());
+        return rc;
+    }
+    if (verbose) {
+        printf("Compressed %d bytes of flash to %d bytes (%.1f%%): %d UF2 blocks, instead of %d uncompressed\n",
+               uncompressed_size, total_compressed, 100.0 * total_compressed / uncompressed_size, total_uf2_blocks,
+               (int)pages.size());
+    }
+    return 0;
+}
+
 int main(int argc, char **argv) {
     int arg = 1;
-    if (arg < argc && !strcmp(argv[arg], "-v")) {
-        verbose = true;
-        arg++;
+    const char *loader_filename = nullptr;
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (!strcmp(argv[arg], "-v")) {
+            verbose = true;
+        } else if (!strcmp(argv[arg], "-z") && arg + 1 < argc) {
+            loader_filename = argv[++arg];
+        } else {
+            return usage();
+        }
     }
     if (argc < arg + 2) {
         return usage();
@@ -368,7 +584,18 @@ int main(int argc, char **argv) {
         return ERROR_ARGS;
     }
 
-    int rc = elf2uf2(in, out);
+    int rc;
+    if (loader_filename) {
+        FILE *loader = fopen(loader_filename, "rb");
+        if (!loader) {
+            fprintf(stderr, "Can't open loader file '%s'\n", loader_filename);
+            return ERROR_ARGS;
+        }
+        rc = elf2uf2z(in, loader, out, out_filename);
+        fclose(loader);
+    } else {
+        rc = elf2uf2(in, out);
+    }
     fclose(in);
     fclose(out);
     if (rc) {
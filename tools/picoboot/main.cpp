@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "boot/uf2.h"
+#include "picoboot_client.h"
+#include "picoboot_sim.h"
+#if PICOBOOT_USB
+#include "picoboot_usb.h"
+#endif
+
+#define SRAM_END 0x20042000u
+
+struct options {
+    picoboot_program_options program;
+    uint sim_devices = 0;
+    uint passes = 1;
+    bool reboot = false;
+};
+
+static int usage() {
+    fprintf(stderr, "Usage: picoboot (-sim <devices>) (-depth <n>) (-no-skip) (-no-verify) (-passes <n>) (-reboot) <UF2 or BIN file>\n\n");
+    fprintf(stderr, "Program a flash image into every RP2040 in BOOTSEL mode at once, reporting each device's throughput.\n\n");
+    fprintf(stderr, "options:\n");
+    fprintf(stderr, "  -sim <devices>   program the given number of simulated devices instead\n");
+    fprintf(stderr, "  -depth <n>       have at most n commands outstanding (1 waits for each command in turn)\n");
+    fprintf(stderr, "  -no-skip         program every sector, rather than only those not already holding the image\n");
+    fprintf(stderr, "  -no-verify       don't read the programmed sectors back\n");
+    fprintf(stderr, "  -passes <n>      program the image n times (later passes show the cost of checking a programmed device)\n");
+    fprintf(stderr, "  -reboot          reboot each device into the new image afterwards\n");
+    return ERROR_ARGS;
+}
+
+// Load a UF2 (its blocks for flash) or a BIN (which is loaded at the start of flash) as one contiguous image
+static int load_image(const char *filename, uint32_t &addr, std::vector<uint8_t> &image) {
+    FILE *in = fopen(filename, "rb");
+    if (!in) {
+        fprintf(stderr, "ERROR: Can't open input file '%s'\n", filename);
+        return ERROR_ARGS;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(in);
+
+    uf2_block block;
+    if (data.size() < sizeof(block) || (memcpy(&block, data.data(), sizeof(block)),
+            block.magic_start0 != UF2_MAGIC_START0 || block.magic_start1 != UF2_MAGIC_START1)) {
+        addr = PICOBOOT_FLASH_START;
+        image = std::move(data);
+        return image.empty() ? ERROR_FORMAT : 0;
+    }
+    uint32_t start = UINT32_MAX, end = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t offset = 0; offset + sizeof(block) <= data.size(); offset += sizeof(block)) {
+            memcpy(&block, data.data() + offset, sizeof(block));
+            if (block.magic_start0 != UF2_MAGIC_START0 || block.magic_start1 != UF2_MAGIC_START1 ||
+                block.magic_end != UF2_MAGIC_END || (block.flags & UF2_FLAG_NOT_MAIN_FLASH) ||
+                ((block.flags & UF2_FLAG_FAMILY_ID_PRESENT) && block.file_size != RP2040_FAMILY_ID) ||
+                block.payload_size > sizeof(block.data) || block.target_addr < PICOBOOT_FLASH_START ||
+                block.target_addr + block.payload_size > PICOBOOT_FLASH_END) {
+                continue;
+            }
+            if (!pass) {
+                start = std::min(start, block.target_addr);
+                end = std::max(end, block.target_addr + block.payload_size);
+            } else {
+                memcpy(image.data() + block.target_addr - addr, block.data, block.payload_size);
+            }
+        }
+        if (!pass) {
+            if (start >= end) {
+                fprintf(stderr, "ERROR: The UF2 has nothing to program into flash\n");
+                return ERROR_FORMAT;
+            }
+            addr = start & ~(PICOBOOT_FLASH_SECTOR_SIZE - 1);
+            image.assign(end - addr, 0xff);
+        }
+    }
+    return 0;
+}
+
+static std::mutex output_mutex;
+
+static int program_device(picoboot_transport &transport, uint32_t addr, const std::vector<uint8_t> &image,
+                          const options &opts, bool exclusive) {
+    picoboot_client client(transport);
+    int rc = exclusive ? client.exclusive_access(EXCLUSIVE) : 0;
+    for (uint pass = 0; !rc && pass < opts.passes; pass++) {
+        picoboot_stats stats;
+        rc = client.program_flash(addr, image.data(), (uint32_t)image.size(), opts.program, stats);
+        if (!rc) {
+            std::lock_guard<std::mutex> lock(output_mutex);
+            printf("%s: %u bytes in %.3f s (%.1f KB/s): %u of %u sectors programmed, %u commands, "
+                   "%llu bytes erased, %llu written, %llu read\n",
+                   transport.name().c_str(), stats.image_size, (double)stats.elapsed_us / 1e6, stats.throughput() / 1024,
+                   stats.sectors - stats.sectors_skipped, stats.sectors, stats.commands,
+                   (unsigned long long)stats.bytes_erased, (unsigned long long)stats.bytes_written,
+                   (unsigned long long)stats.bytes_read);
+        }
+    }
+    if (!rc && opts.reboot) rc = client.reboot(0, SRAM_END, 500);
+    if (rc) {
+        std::lock_guard<std::mutex> lock(output_mutex);
+        fprintf(stderr, "ERROR: %s\n", client.error().c_str());
+    }
+    return rc;
+}
+
+int main(int argc, char **argv) {
+    options opts;
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (!strcmp(argv[arg], "-sim") && arg + 1 < argc) {
+            opts.sim_devices = (uint)strtoul(argv[++arg], nullptr, 0);
+            if (!opts.sim_devices) return usage();
+        } else if (!strcmp(argv[arg], "-depth") && arg + 1 < argc) {
+            opts.program.pipeline_depth = (uint)strtoul(argv[++arg], nullptr, 0);
+            if (!opts.program.pipeline_depth) return usage();
+        } else if (!strcmp(argv[arg], "-passes") && arg + 1 < argc) {
+            opts.passes = (uint)strtoul(argv[++arg], nullptr, 0);
+            if (!opts.passes) return usage();
+        } else if (!strcmp(argv[arg], "-no-skip")) {
+            opts.program.skip_matching = false;
+        } else if (!strcmp(argv[arg], "-no-verify")) {
+            opts.program.verify = false;
+        } else if (!strcmp(argv[arg], "-reboot")) {
+            opts.reboot = true;
+        } else {
+            return usage();
+        }
+    }
+    if (arg + 1 != argc) return usage();
+    uint32_t addr;
+    std::vector<uint8_t> image;
+    int rc = load_image(argv[arg], addr, image);
+    if (rc) return rc;
+
+    std::vector<std::unique_ptr<picoboot_transport>> transports;
+    if (opts.sim_devices) {
+        for (uint i = 0; i < opts.sim_devices; i++) {
+            transports.emplace_back(new picoboot_simulator("sim " + std::to_string(i)));
+        }
+    } else {
+#if PICOBOOT_USB
+        std::string error;
+        transports = picoboot_usb_open_all(error);
+        if (!error.empty()) fprintf(stderr, "%s", error.c_str());
+        if (transports.empty()) {
+            fprintf(stderr, "ERROR: No RP2040 devices in BOOTSEL mode were found\n");
+            return ERROR_NOT_FOUND;
+        }
+#else
+        fprintf(stderr, "ERROR: picoboot was built without libusb, so only supports simulated devices (-sim)\n");
+        return ERROR_ARGS;
+#endif
+    }
+
+    // each device is independent, so program them all at once
+    std::vector<int> results(transports.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < transports.size(); i++) {
+        threads.emplace_back([&, i]() {
+            results[i] = program_device(*transports[i], addr, image, opts, !opts.sim_devices);
+        });
+    }
+    for (auto &t : threads) t.join();
+    rc = 0;
+    for (size_t i = 0; i < transports.size(); i++) {
+        if (!results[i] && opts.sim_devices) {
+            // check the simulated flash really does hold the image now
+            auto &flash = static_cast<picoboot_simulator &>(*transports[i]).flash();
+            uint32_t offset = addr - PICOBOOT_FLASH_START;
+            if (offset + image.size() > flash.size() ||
+                memcmp(flash.data() + offset, image.data(), image.size())) {
+                fprintf(stderr, "ERROR: %s: the flash does not hold the image\n", transports[i]->name().c_str());
+                results[i] = ERROR_VERIFY;
+            }
+        }
+        if (!rc) rc = results[i];
+    }
+    return rc;
+}
@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include "picoboot_client.h"
+
+uint64_t picoboot_transport::time_us() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char *picoboot_status_name(uint32_t status) {
+    switch (status) {
+        case PICOBOOT_OK: return "ok";
+        case PICOBOOT_UNKNOWN_CMD: return "unknown command";
+        case PICOBOOT_INVALID_CMD_LENGTH: return "invalid command length";
+        case PICOBOOT_INVALID_TRANSFER_LENGTH: return "invalid transfer length";
+        case PICOBOOT_INVALID_ADDRESS: return "invalid address";
+        case PICOBOOT_BAD_ALIGNMENT: return "bad alignment";
+        case PICOBOOT_INTERLEAVED_WRITE: return "interleaved write";
+        case PICOBOOT_REBOOTING: return "rebooting";
+        default: return "unknown error";
+    }
+}
+
+static const char *cmd_name(uint8_t id) {
+    switch (id) {
+        case PC_EXCLUSIVE_ACCESS: return "EXCLUSIVE_ACCESS";
+        case PC_REBOOT: return "REBOOT";
+        case PC_FLASH_ERASE: return "FLASH_ERASE";
+        case PC_READ: return "READ";
+        case PC_WRITE: return "WRITE";
+        case PC_EXIT_XIP: return "EXIT_XIP";
+        case PC_ENTER_CMD_XIP: return "ENTER_CMD_XIP";
+        case PC_EXEC: return "EXEC";
+        case PC_VECTORIZE_FLASH: return "VECTORIZE_FLASH";
+        default: return "unknown";
+    }
+}
+
+static std::string describe(const picoboot_cmd &cmd) {
+    char buf[64];
+    if (cmd.bCmdId == PC_READ || cmd.bCmdId == PC_WRITE || cmd.bCmdId == PC_FLASH_ERASE) {
+        snprintf(buf, sizeof(buf), "%s %08x+%x", cmd_name(cmd.bCmdId), cmd.range_cmd.dAddr, cmd.range_cmd.dSize);
+    } else {
+        snprintf(buf, sizeof(buf), "%s", cmd_name(cmd.bCmdId));
+    }
+    return buf;
+}
+
+int picoboot_client::fail(int code, const std::string &msg) {
+    _error = transport.name() + ": " + msg;
+    return code;
+}
+
+picoboot_cmd picoboot_client::make_cmd(uint8_t id, uint8_t cmd_size, uint32_t transfer_length) {
+    picoboot_cmd cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.dMagic = PICOBOOT_MAGIC;
+    cmd.dToken = next_token++;
+    cmd.bCmdId = id;
+    cmd.bCmdSize = cmd_size;
+    cmd.dTransferLength = transfer_length;
+    return cmd;
+}
+
+picoboot_cmd picoboot_client::make_range_cmd(uint8_t id, uint32_t addr, uint32_t size, uint32_t transfer_length) {
+    picoboot_cmd cmd = make_cmd(id, sizeof(cmd.range_cmd), transfer_length);
+    cmd.range_cmd.dAddr = addr;
+    cmd.range_cmd.dSize = size;
+    return cmd;
+}
+
+void picoboot_client::abandon() {
+    in_flight.clear();
+    transport.reset();
+}
+
+int picoboot_client::queue(const picoboot_cmd &cmd, const uint8_t *out_data,
+                           std::function<int(pending &)> on_complete, uint depth) {
+    while (in_flight.size() >= depth) {
+        int rc = complete_oldest();
+        if (rc) return rc;
+    }
+    in_flight.emplace_back();
+    pending &p = in_flight.back();
+    p.cmd = cmd;
+    p.on_complete = std::move(on_complete);
+    if (cmd.bCmdId & 0x80u) p.buffer.resize(cmd.dTransferLength);
+    commands++;
+    if (transport.submit(cmd, out_data, p.buffer.data())) {
+        in_flight.pop_back();
+        abandon();
+        return fail(ERROR_CONNECTION, "can't send " + describe(cmd));
+    }
+    return 0;
+}
+
+int picoboot_client::complete_oldest() {
+    picoboot_cmd_status status;
+    memset(&status, 0, sizeof(status));
+    int rc = transport.wait(status);
+    pending p = std::move(in_flight.front());
+    in_flight.pop_front();
+    if (rc) {
+        abandon();
+        if (rc == ERROR_COMMAND) {
+            return fail(rc, describe(p.cmd) + " failed: " + picoboot_status_name(status.dStatusCode));
+        }
+        return fail(rc, describe(p.cmd) + " failed: no response");
+    }
+    return p.on_complete ? p.on_complete(p) : 0;
+}
+
+int picoboot_client::complete_all() {
+    while (!in_flight.empty()) {
+        int rc = complete_oldest();
+        if (rc) return rc;
+    }
+    return 0;
+}
+
+int picoboot_client::run(const picoboot_cmd &cmd, const uint8_t *out_data, uint8_t *in_data) {
+    int rc = queue(cmd, out_data, [in_data](pending &p) {
+        if (in_data) std::copy(p.buffer.begin(), p.buffer.end(), in_data);
+        return 0;
+    }, 1);
+    if (!rc) rc = complete_all();
+    return rc;
+}
+
+int picoboot_client::exclusive_access(picoboot_exclusive_type type) {
+    picoboot_cmd cmd = make_cmd(PC_EXCLUSIVE_ACCESS, sizeof(cmd.exclusive_cmd), 0);
+    cmd.exclusive_cmd.bExclusive = (uint8_t)type;
+    return run(cmd, nullptr, nullptr);
+}
+
+int picoboot_client::reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms) {
+    picoboot_cmd cmd = make_cmd(PC_REBOOT, sizeof(cmd.reboot_cmd), 0);
+    cmd.reboot_cmd.dPC = pc;
+    cmd.reboot_cmd.dSP = sp;
+    cmd.reboot_cmd.dDelayMS = delay_ms;
+    return run(cmd, nullptr, nullptr);
+}
+
+int picoboot_client::exit_xip() {
+    return run(make_cmd(PC_EXIT_XIP, 0, 0), nullptr, nullptr);
+}
+
+int picoboot_client::enter_cmd_xip() {
+    return run(make_cmd(PC_ENTER_CMD_XIP, 0, 0), nullptr, nullptr);
+}
+
+int picoboot_client::exec(uint32_t addr) {
+    picoboot_cmd cmd = make_cmd(PC_EXEC, sizeof(cmd.address_only_cmd), 0);
+    cmd.address_only_cmd.dAddr = addr;
+    return run(cmd, nullptr, nullptr);
+}
+
+int picoboot_client::flash_erase(uint32_t addr, uint32_t size) {
+    return run(make_range_cmd(PC_FLASH_ERASE, addr, size, 0), nullptr, nullptr);
+}
+
+int picoboot_client::write(uint32_t addr, const uint8_t *data, uint32_t size) {
+    return run(make_range_cmd(PC_WRITE, addr, size, size), data, nullptr);
+}
+
+int picoboot_client::read(uint32_t addr, uint8_t *data, uint32_t size) {
+    return run(make_range_cmd(PC_READ, addr, size, size), nullptr, data);
+}
+
+int picoboot_client::program_flash(uint32_t addr, const uint8_t *data, uint32_t size,
+                                   const picoboot_program_options &options, picoboot_stats &stats) {
+    if (addr % PICOBOOT_FLASH_SECTOR_SIZE || addr < PICOBOOT_FLASH_START || !size ||
+        size > PICOBOOT_FLASH_END - addr) {
+        return fail(ERROR_ARGS, "the image must start at a flash sector, and fit in flash");
+    }
+    stats = picoboot_stats();
+    stats.image_size = size;
+    stats.sectors = (size + PICOBOOT_FLASH_SECTOR_SIZE - 1) / PICOBOOT_FLASH_SECTOR_SIZE;
+    // what each sector should hold
+    std::vector<uint8_t> image(stats.sectors * PICOBOOT_FLASH_SECTOR_SIZE, 0xff);
+    std::copy(data, data + size, image.begin());
+
+    uint start_commands = commands;
+    uint64_t start_us = transport.time_us();
+    int rc = exit_xip();
+    if (!rc) rc = program_sectors(addr, image, options, stats);
+    if (rc) abandon();
+    stats.commands = commands - start_commands;
+    stats.elapsed_us = transport.time_us() - start_us;
+    return rc;
+}
+
+static bool is_erased(const uint8_t *data, uint32_t size) {
+    return std::all_of(data, data + size, [](uint8_t b) { return b == 0xff; });
+}
+
+int picoboot_client::program_sectors(uint32_t addr, const std::vector<uint8_t> &image,
+                                     const picoboot_program_options &options, picoboot_stats &stats) {
+    uint depth = transport.max_in_flight();
+    if (options.pipeline_depth) depth = std::min(depth, options.pipeline_depth);
+    depth = std::max(depth, 1u);
+
+    const uint n = stats.sectors;
+    // sectors found to need programming, in order; reads complete in order, so sectors before known have been read
+    std::deque<uint> to_program;
+    uint next_read = 0;
+    uint known = 0;
+    if (!options.skip_matching) {
+        for (uint i = 0; i < n; i++) to_program.push_back(i);
+        next_read = known = n;
+    }
+    auto sector_addr = [addr](uint i) { return addr + i * PICOBOOT_FLASH_SECTOR_SIZE; };
+    auto sector_data = [&image](uint i) { return image.data() + i * PICOBOOT_FLASH_SECTOR_SIZE; };
+
+    while (true) {
+        int rc;
+        // the run of consecutive sectors at the front of the queue, which is erased with one command: it ends at the
+        // end of a 64K block (which the device can erase in one go), or at a sector known not to need programming
+        uint run = 0;
+        while (run < to_program.size() && to_program[run] == to_program.front() + run &&
+               (!run || sector_addr(to_program.front() + run) % PICOBOOT_FLASH_BLOCK_SIZE)) {
+            run++;
+        }
+        uint run_end = run ? to_program.front() + run : 0;
+        if (run && (run_end < known || known == n || !(sector_addr(run_end) % PICOBOOT_FLASH_BLOCK_SIZE))) {
+            uint first = to_program.front();
+            to_program.erase(to_program.begin(), to_program.begin() + run);
+            // queue the erase and all the data behind it, so the upload follows the erase without waiting for it
+            uint32_t erase_size = run * PICOBOOT_FLASH_SECTOR_SIZE;
+            rc = queue(make_range_cmd(PC_FLASH_ERASE, sector_addr(first), erase_size, 0), nullptr, nullptr, depth);
+            if (rc) return rc;
+            stats.bytes_erased += erase_size;
+            for (uint i = first; i < run_end; i++) {
+                // only the pages which aren't left erased need writing
+                const uint8_t *sector = sector_data(i);
+                uint32_t begin = 0, end = PICOBOOT_FLASH_SECTOR_SIZE;
+                while (begin < end && is_erased(sector + begin, PICOBOOT_FLASH_PAGE_SIZE)) begin += PICOBOOT_FLASH_PAGE_SIZE;
+                while (end > begin && is_erased(sector + end - PICOBOOT_FLASH_PAGE_SIZE, PICOBOOT_FLASH_PAGE_SIZE)) end -= PICOBOOT_FLASH_PAGE_SIZE;
+                if (begin < end) {
+                    rc = queue(make_range_cmd(PC_WRITE, sector_addr(i) + begin, end - begin, end - begin),
+                               sector + begin, nullptr, depth);
+                    if (rc) return rc;
+                    stats.bytes_written += end - begin;
+                }
+            }
+            if (options.verify) {
+                uint32_t size = run * PICOBOOT_FLASH_SECTOR_SIZE;
+                rc = queue(make_range_cmd(PC_READ, sector_addr(first), size, size), nullptr,
+                           [this, first, sector_data](pending &p) {
+                               if (memcmp(p.buffer.data(), sector_data(first), p.buffer.size())) {
+                                   return fail(ERROR_VERIFY, "verify failed at " + describe(p.cmd));
+                               }
+                               return 0;
+                           }, depth);
+                if (rc) return rc;
+                stats.bytes_read += size;
+            }
+        } else if (next_read < n) {
+            uint i = next_read++;
+            rc = queue(make_range_cmd(PC_READ, sector_addr(i), PICOBOOT_FLASH_SECTOR_SIZE, PICOBOOT_FLASH_SECTOR_SIZE),
+                       nullptr, [i, &known, &to_program, &stats, sector_data](pending &p) {
+                           if (memcmp(p.buffer.data(), sector_data(i), PICOBOOT_FLASH_SECTOR_SIZE)) {
+                               to_program.push_back(i);
+                           } else {
+                               stats.sectors_skipped++;
+                           }
+                           known = i + 1;
+                           return 0;
+                       }, depth);
+            if (rc) return rc;
+            stats.bytes_read += PICOBOOT_FLASH_SECTOR_SIZE;
+        } else if (!in_flight.empty()) {
+            rc = complete_oldest();
+            if (rc) return rc;
+        } else {
+            assert(to_program.empty());
+            return 0;
+        }
+    }
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICOBOOT_CLIENT_H
+#define _PICOBOOT_CLIENT_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define NO_PICO_PLATFORM
+#ifndef __packed
+#define __packed __attribute__((packed))
+#endif
+#ifndef __aligned
+#define __aligned(x) __attribute__((aligned(x)))
+#endif
+#include "boot/picoboot.h"
+
+// A host side client for the PICOBOOT interface (see boot/picoboot.h) of an RP2040 in BOOTSEL mode.
+//
+// Commands are sent through a picoboot_transport, which may have several commands outstanding at once, so the
+// client can keep the device busy: the next commands (and their data) are already queued when one completes,
+// rather than each waiting a USB round trip for the host to notice the last one finished. The transport is either
+// USB (picoboot_usb.h) or a simulated device with an in-memory flash (picoboot_sim.h).
+
+#define ERROR_ARGS -1
+#define ERROR_FORMAT -2
+#define ERROR_INCOMPATIBLE -3
+#define ERROR_READ_FAILED -4
+#define ERROR_NOT_FOUND -5
+#define ERROR_CONNECTION -6
+#define ERROR_COMMAND -7
+#define ERROR_VERIFY -8
+
+typedef unsigned int uint;
+
+#define PICOBOOT_FLASH_START 0x10000000u
+#define PICOBOOT_FLASH_END 0x11000000u
+#define PICOBOOT_FLASH_PAGE_SIZE 256u
+#define PICOBOOT_FLASH_SECTOR_SIZE 4096u
+#define PICOBOOT_FLASH_BLOCK_SIZE 65536u
+
+class picoboot_transport {
+public:
+    virtual ~picoboot_transport() = default;
+
+    // Queue a command. Its data phase is cmd.dTransferLength bytes, from out_data, or (for a command with the top bit
+    // of bCmdId set) into in_data; the buffer must remain valid until the command has completed
+    virtual int submit(const picoboot_cmd &cmd, const uint8_t *out_data, uint8_t *in_data) = 0;
+    // Wait for the oldest outstanding command to complete. On failure, status is the device's status for it, and
+    // any commands queued after it are abandoned (the interface must be reset before sending more)
+    virtual int wait(picoboot_cmd_status &status) = 0;
+    // Abandon any outstanding commands, and reset the interface (PICOBOOT_IF_RESET)
+    virtual int reset() = 0;
+    // The most commands which may be outstanding at once
+    virtual uint max_in_flight() const = 0;
+    virtual std::string name() const = 0;
+    // A clock for measuring throughput; the simulator keeps simulated time
+    virtual uint64_t time_us();
+};
+
+struct picoboot_program_options {
+    // read each sector first, and leave it alone if it already holds the image
+    bool skip_matching = true;
+    // read each programmed sector back
+    bool verify = true;
+    // the most commands to have outstanding at once (0 for the transport's maximum, 1 to wait for each in turn)
+    uint pipeline_depth = 0;
+};
+
+struct picoboot_stats {
+    uint32_t image_size = 0;
+    uint sectors = 0;
+    uint sectors_skipped = 0;       // already held the image
+    uint commands = 0;
+    uint64_t bytes_read = 0;
+    uint64_t bytes_written = 0;
+    uint64_t bytes_erased = 0;
+    uint64_t elapsed_us = 0;
+
+    // the rate the image was programmed at, in bytes per second
+    double throughput() const { return elapsed_us ? image_size * 1e6 / (double)elapsed_us : 0.0; }
+};
+
+class picoboot_client {
+public:
+    explicit picoboot_client(picoboot_transport &transport) : transport(transport) {}
+
+    // The commands, each waiting for completion
+    int exclusive_access(picoboot_exclusive_type type);
+    int reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms);
+    int exit_xip();
+    int enter_cmd_xip();
+    int exec(uint32_t addr);
+    int flash_erase(uint32_t addr, uint32_t size);
+    int write(uint32_t addr, const uint8_t *data, uint32_t size);
+    int read(uint32_t addr, uint8_t *data, uint32_t size);
+
+    // Program an image into flash: addr must be at the start of a flash sector, and the rest of the last sector
+    // after the image is left erased. Sectors are read, erased, programmed and verified with as many commands
+    // outstanding as the options allow, and runs of sectors are erased together where possible.
+    int program_flash(uint32_t addr, const uint8_t *data, uint32_t size, const picoboot_program_options &options,
+                      picoboot_stats &stats);
+
+    const std::string &error() const { return _error; }
+
+private:
+    struct pending {
+        picoboot_cmd cmd;
+        std::vector<uint8_t> buffer;        // read data
+        std::function<int(pending &)> on_complete;
+    };
+
+    picoboot_cmd make_cmd(uint8_t id, uint8_t cmd_size, uint32_t transfer_length);
+    picoboot_cmd make_range_cmd(uint8_t id, uint32_t addr, uint32_t size, uint32_t transfer_length);
+    // queue a command, first waiting for the oldest if depth are outstanding
+    int queue(const picoboot_cmd &cmd, const uint8_t *out_data, std::function<int(pending &)> on_complete,
+              uint depth);
+    int complete_oldest();
+    int complete_all();
+    // abandon the outstanding commands after a failure
+    void abandon();
+    int program_sectors(uint32_t addr, const std::vector<uint8_t> &image, const picoboot_program_options &options,
+                        picoboot_stats &stats);
+    int run(const picoboot_cmd &cmd, const uint8_t *out_data, uint8_t *in_data);
+    int fail(int code, const std::string &msg);
+
+    picoboot_transport &transport;
+    std::deque<pending> in_flight;
+    uint32_t next_token = 1;
+    uint commands = 0;
+    std::string _error;
+};
+
+const char *picoboot_status_name(uint32_t status);
+
+#endif
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "picoboot_sim.h"
+
+#define SRAM_START 0x20000000u
+#define SRAM_SIZE (264u * 1024)
+
+picoboot_simulator::picoboot_simulator(std::string name, uint32_t flash_size, uint max_in_flight) :
+        _name(std::move(name)), _max_in_flight(max_in_flight), _flash(flash_size, 0xff), ram(SRAM_SIZE) {
+}
+
+uint8_t *picoboot_simulator::memory(uint32_t addr, uint32_t size, bool write) {
+    if (addr >= PICOBOOT_FLASH_START && addr < PICOBOOT_FLASH_START + _flash.size() &&
+        size <= PICOBOOT_FLASH_START + _flash.size() - addr) {
+        // flash is only written by (and read through the buffer of) the flash commands
+        return write ? nullptr : &_flash[addr - PICOBOOT_FLASH_START];
+    }
+    if (addr >= SRAM_START && addr < SRAM_START + SRAM_SIZE && size <= SRAM_START + SRAM_SIZE - addr) {
+        return &ram[addr - SRAM_START];
+    }
+    return nullptr;
+}
+
+static bool is_flash(uint32_t addr) {
+    return addr >= PICOBOOT_FLASH_START && addr < PICOBOOT_FLASH_END;
+}
+
+uint32_t picoboot_simulator::execute(const picoboot_cmd &cmd, const uint8_t *out_data, uint8_t *in_data,
+                                     uint64_t &duration_us) {
+    duration_us = (uint64_t)cmd.dTransferLength * 1000u / _timing.bytes_per_ms;
+    if (cmd.dMagic != PICOBOOT_MAGIC) return PICOBOOT_UNKNOWN_CMD;
+    if (_rebooting) return PICOBOOT_REBOOTING;
+    uint32_t addr = cmd.range_cmd.dAddr;
+    uint32_t size = cmd.range_cmd.dSize;
+    switch (cmd.bCmdId) {
+        case PC_EXCLUSIVE_ACCESS:
+            if (cmd.bCmdSize != sizeof(cmd.exclusive_cmd)) return PICOBOOT_INVALID_CMD_LENGTH;
+            if (cmd.dTransferLength) return PICOBOOT_INVALID_TRANSFER_LENGTH;
+            _exclusive = cmd.exclusive_cmd.bExclusive;
+            return PICOBOOT_OK;
+        case PC_REBOOT:
+            if (cmd.bCmdSize != sizeof(cmd.reboot_cmd)) return PICOBOOT_INVALID_CMD_LENGTH;
+            if (cmd.dTransferLength) return PICOBOOT_INVALID_TRANSFER_LENGTH;
+            _rebooting = true;
+            _reboot_pc = cmd.reboot_cmd.dPC;
+            return PICOBOOT_OK;
+        case PC_EXIT_XIP:
+        case PC_ENTER_CMD_XIP:
+            if (cmd.bCmdSize) return PICOBOOT_INVALID_CMD_LENGTH;
+            if (cmd.dTransferLength) return PICOBOOT_INVALID_TRANSFER_LENGTH;
+            xip = cmd.bCmdId == PC_ENTER_CMD_XIP;
+            return PICOBOOT_OK;
+        case PC_EXEC:
+        case PC_VECTORIZE_FLASH:
+            if (cmd.bCmdSize != sizeof(cmd.address_only_cmd)) return PICOBOOT_INVALID_CMD_LENGTH;
+            if (cmd.dTransferLength) return PICOBOOT_INVALID_TRANSFER_LENGTH;
+            if (!memory(cmd.address_only_cmd.dAddr, 4, false)) return PICOBOOT_INVALID_ADDRESS;
+            // there is nothing to run the code
+            return cmd.bCmdId == PC_EXEC ? PICOBOOT_UNKNOWN_ERROR : PICOBOOT_OK;
+        case PC_FLASH_ERASE: {
+            if (cmd.bCmdSize != sizeof(cmd.range_cmd)) return PICOBOOT_INVALID_CMD_LENGTH;
+            if (cmd.dTransferLength) return PICOBOOT_INVALID_TRANSFER_LENGTH;
+            if (!is_flash(addr) || !memory(addr, size, false)) return PICOBOOT_INVALID_ADDRESS;
+            if ((addr | size) % PICOBOOT_FLASH_SECTOR_SIZE) return PICOBOOT_BAD_ALIGNMENT;
+            uint8_t *p = &_flash[addr - PICOBOOT_FLASH_START];
+            std::fill(p, p + size, 0xff);
+            // erase aligned 64K blocks as such, like the bootrom's flash_range_erase
+            for (uint32_t offset = 0; offset < size;) {
+                if (!((addr + offset) % PICOBOOT_FLASH_BLOCK_SIZE) && size - offset >= PICOBOOT_FLASH_BLOCK_SIZE) {
+                    duration_us += _timing.block_erase_us;
+                    offset += PICOBOOT_FLASH_BLOCK_SIZE;
+                } else {
+                    duration_us += _timing.sector_erase_us;
+                    offset += PICOBOOT_FLASH_SECTOR_SIZE;
+                }
+            }
+            return PICOBOOT_OK;
+        }
+        case PC_READ:
+        case PC_WRITE: {
+            if (cmd.bCmdSize != sizeof(cmd.range_cmd)) return PICOBOOT_INVALID_CMD_LENGTH;
+            if (cmd.dTransferLength != size) return PICOBOOT_INVALID_TRANSFER_LENGTH;
+            if (cmd.bCmdId == PC_READ) {
+                const uint8_t *p = memory(addr, size, false);
+                if (!p) return PICOBOOT_INVALID_ADDRESS;
+                memcpy(in_data, p, size);
+                return PICOBOOT_OK;
+            }
+            if (is_flash(addr)) {
+                if (!memory(addr, size, false)) return PICOBOOT_INVALID_ADDRESS;
+                if ((addr | size) % PICOBOOT_FLASH_PAGE_SIZE) return PICOBOOT_BAD_ALIGNMENT;
+                // programming can only clear bits
+                uint8_t *p = &_flash[addr - PICOBOOT_FLASH_START];
+                for (uint32_t i = 0; i < size; i++) p[i] &= out_data[i];
+                duration_us += (uint64_t)(size / PICOBOOT_FLASH_PAGE_SIZE) * _timing.page_program_us;
+                return PICOBOOT_OK;
+            }
+            uint8_t *p = memory(addr, size, true);
+            if (!p) return PICOBOOT_INVALID_ADDRESS;
+            memcpy(p, out_data, size);
+            return PICOBOOT_OK;
+        }
+        default:
+            return PICOBOOT_UNKNOWN_CMD;
+    }
+}
+
+int picoboot_simulator::submit(const picoboot_cmd &cmd, const uint8_t *out_data, uint8_t *in_data) {
+    if (completions.size() >= _max_in_flight) return ERROR_ARGS;
+    completion c;
+    memset(&c.status, 0, sizeof(c.status));
+    c.status.dToken = cmd.dToken;
+    c.status.bCmdId = cmd.bCmdId;
+    uint64_t duration_us = 0;
+    // after a failure the device stalls the endpoints, so nothing more gets through until a reset
+    c.status.dStatusCode = stalled ? (uint32_t)PICOBOOT_UNKNOWN_ERROR : execute(cmd, out_data, in_data, duration_us);
+    if (c.status.dStatusCode != PICOBOOT_OK) stalled = true;
+    uint64_t start_us = std::max(host_us + _timing.turnaround_us, device_us);
+    c.done_us = device_us = start_us + duration_us;
+    completions.push_back(c);
+    return 0;
+}
+
+int picoboot_simulator::wait(picoboot_cmd_status &status) {
+    if (completions.empty()) return ERROR_ARGS;
+    completion c = completions.front();
+    completions.pop_front();
+    host_us = std::max(host_us, c.done_us + _timing.turnaround_us);
+    status = c.status;
+    return status.dStatusCode == PICOBOOT_OK ? 0 : ERROR_COMMAND;
+}
+
+int picoboot_simulator::reset() {
+    // the commands already accepted have been carried out, but their results are lost
+    if (!completions.empty()) host_us = std::max(host_us, completions.back().done_us);
+    completions.clear();
+    host_us += 2 * _timing.turnaround_us;
+    stalled = false;
+    return 0;
+}
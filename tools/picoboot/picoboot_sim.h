@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICOBOOT_SIM_H
+#define _PICOBOOT_SIM_H
+
+#include "picoboot_client.h"
+
+// A simulated RP2040 in BOOTSEL mode, implementing the PICOBOOT command set (with the bootrom's checks of commands,
+// addresses and alignment) against an in-memory flash and RAM. Flash behaves like the real thing: programming can only
+// clear bits, so writing without erasing first leaves the wrong contents.
+//
+// Time is simulated too, from a simple model of a full speed USB connection and the flash, so the throughput of
+// different ways of using the interface can be compared: the device handles one command at a time, each taking the
+// time for its data to cross the bus plus the time the flash takes; and a command only reaches the device a USB
+// round trip after it is submitted, as the completion of one only reaches the host a round trip after it happens.
+class picoboot_simulator : public picoboot_transport {
+public:
+    struct timing {
+        uint32_t turnaround_us = 1000;          // a USB frame, from the host to the device or back
+        uint32_t bytes_per_ms = 1000;           // bulk transfer rate
+        uint32_t sector_erase_us = 45000;       // typical for W25Q16JV
+        uint32_t block_erase_us = 150000;       // an aligned 64K block
+        uint32_t page_program_us = 400;
+    };
+
+    explicit picoboot_simulator(std::string name = "sim", uint32_t flash_size = 2u * 1024 * 1024,
+                                uint max_in_flight = 16);
+
+    int submit(const picoboot_cmd &cmd, const uint8_t *out_data, uint8_t *in_data) override;
+    int wait(picoboot_cmd_status &status) override;
+    int reset() override;
+    uint max_in_flight() const override { return _max_in_flight; }
+    std::string name() const override { return _name; }
+    uint64_t time_us() override { return host_us; }
+
+    void set_timing(const timing &t) { _timing = t; }
+    void set_max_in_flight(uint n) { _max_in_flight = n; }
+    std::vector<uint8_t> &flash() { return _flash; }
+    bool xip_enabled() const { return xip; }
+    uint8_t exclusive() const { return _exclusive; }
+    uint32_t reboot_pc() const { return _reboot_pc; }
+    bool rebooting() const { return _rebooting; }
+
+private:
+    struct completion {
+        uint64_t done_us;
+        picoboot_cmd_status status;
+    };
+
+    // carry out a command, returning its status and how long the device takes over it
+    uint32_t execute(const picoboot_cmd &cmd, const uint8_t *out_data, uint8_t *in_data, uint64_t &duration_us);
+    uint8_t *memory(uint32_t addr, uint32_t size, bool write);
+
+    std::string _name;
+    uint _max_in_flight;
+    timing _timing;
+    std::vector<uint8_t> _flash;
+    std::vector<uint8_t> ram;
+    std::deque<completion> completions;
+    uint64_t host_us = 0;
+    uint64_t device_us = 0;
+    bool stalled = false;
+    bool xip = true;
+    uint8_t _exclusive = NOT_EXCLUSIVE;
+    bool _rebooting = false;
+    uint32_t _reboot_pc = 0;
+};
+
+#endif
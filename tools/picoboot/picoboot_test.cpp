@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <cstdio>
+#include <cstring>
+#include "picoboot_client.h"
+#include "picoboot_sim.h"
+
+// Tests of picoboot_client against picoboot_simulator: programming, skipping sectors which already hold the image,
+// the same result whatever the pipeline depth, and recovery after each kind of failed command
+
+static int failures;
+
+#define CHECK(cond, msg) do { \
+    if (!(cond)) { \
+        printf("    FAILED: %s (%s, line %d)\n", msg, #cond, __LINE__); \
+        failures++; \
+    } \
+} while (0)
+
+static const uint32_t IMAGE_SIZE = 100 * 1024 + 300;  // ends part way through a sector
+static const uint IMAGE_SECTORS = (IMAGE_SIZE + PICOBOOT_FLASH_SECTOR_SIZE - 1) / PICOBOOT_FLASH_SECTOR_SIZE;
+
+static std::vector<uint8_t> make_image(uint32_t seed) {
+    std::vector<uint8_t> image(IMAGE_SIZE);
+    for (auto &b : image) {
+        seed = seed * 1103515245u + 12345u;
+        b = (uint8_t)(seed >> 16);
+    }
+    return image;
+}
+
+// whether the flash holds the image, with the rest of its last sector erased
+static bool flash_holds(picoboot_simulator &sim, const std::vector<uint8_t> &image) {
+    const std::vector<uint8_t> &flash = sim.flash();
+    if (memcmp(flash.data(), image.data(), image.size())) return false;
+    for (uint32_t i = (uint32_t)image.size(); i < IMAGE_SECTORS * PICOBOOT_FLASH_SECTOR_SIZE; i++) {
+        if (flash[i] != 0xff) return false;
+    }
+    return true;
+}
+
+static void test_program() {
+    printf("program\n");
+    picoboot_simulator sim;
+    picoboot_client client(sim);
+    std::vector<uint8_t> image = make_image(1);
+    picoboot_program_options options;
+    picoboot_stats stats;
+
+    int rc = client.program_flash(PICOBOOT_FLASH_START, image.data(), IMAGE_SIZE, options, stats);
+    CHECK(!rc, "fresh program failed");
+    CHECK(flash_holds(sim, image), "flash does not hold the image");
+    CHECK(stats.sectors == IMAGE_SECTORS, "wrong sector count");
+    CHECK(stats.sectors_skipped == 0, "erased sectors were skipped");
+
+    // programming it again only needs the sectors read
+    rc = client.program_flash(PICOBOOT_FLASH_START, image.data(), IMAGE_SIZE, options, stats);
+    CHECK(!rc, "second program failed");
+    CHECK(stats.sectors_skipped == IMAGE_SECTORS, "unchanged sectors were not all skipped");
+    CHECK(!stats.bytes_erased && !stats.bytes_written, "unchanged sectors were programmed");
+    CHECK(flash_holds(sim, image), "flash does not hold the image after skipping");
+
+    // change one sector, then only that one is programmed (and verified)
+    image[5 * PICOBOOT_FLASH_SECTOR_SIZE + 17] ^= 0x55;
+    rc = client.program_flash(PICOBOOT_FLASH_START, image.data(), IMAGE_SIZE, options, stats);
+    CHECK(!rc, "program of a changed sector failed");
+    CHECK(stats.sectors_skipped == IMAGE_SECTORS - 1, "more than the changed sector was programmed");
+    CHECK(stats.bytes_erased == PICOBOOT_FLASH_SECTOR_SIZE, "wrong amount erased");
+    CHECK(flash_holds(sim, image), "flash does not hold the changed image");
+
+    // without skipping, every sector is programmed again
+    options.skip_matching = false;
+    rc = client.program_flash(PICOBOOT_FLASH_START, image.data(), IMAGE_SIZE, options, stats);
+    CHECK(!rc, "program without skipping failed");
+    CHECK(stats.sectors_skipped == 0, "sectors were skipped with skip_matching off");
+    CHECK(flash_holds(sim, image), "flash does not hold the image without skipping");
+}
+
+static void test_pipeline_depth() {
+    printf("pipeline depth\n");
+    std::vector<uint8_t> old_image = make_image(2);
+    std::vector<uint8_t> image = old_image;
+    // leave some sectors as they were, so the skipped sectors can be compared too
+    for (uint sector = 0; sector < IMAGE_SECTORS; sector += 3) {
+        image[sector * PICOBOOT_FLASH_SECTOR_SIZE] ^= 0xff;
+    }
+    picoboot_stats stats[2];
+    picoboot_simulator sims[2] = {picoboot_simulator("depth 1"), picoboot_simulator("depth N")};
+    for (int i = 0; i < 2; i++) {
+        picoboot_client client(sims[i]);
+        picoboot_program_options options;
+        int rc = client.program_flash(PICOBOOT_FLASH_START, old_image.data(), IMAGE_SIZE, options, stats[i]);
+        CHECK(!rc, "program of the old image failed");
+        options.pipeline_depth = i ? 0 : 1;
+        rc = client.program_flash(PICOBOOT_FLASH_START, image.data(), IMAGE_SIZE, options, stats[i]);
+        CHECK(!rc, "program failed");
+        CHECK(flash_holds(sims[i], image), "flash does not hold the image");
+    }
+    CHECK(sims[0].flash() == sims[1].flash(), "flash differs between pipeline depths");
+    CHECK(stats[0].sectors_skipped == stats[1].sectors_skipped, "skipped sectors differ between pipeline depths");
+    CHECK(stats[0].sectors_skipped == IMAGE_SECTORS - (IMAGE_SECTORS + 2) / 3, "wrong number of sectors skipped");
+    CHECK(stats[0].bytes_erased == stats[1].bytes_erased && stats[0].bytes_written == stats[1].bytes_written &&
+          stats[0].bytes_read == stats[1].bytes_read, "work done differs between pipeline depths");
+    CHECK(stats[1].elapsed_us < stats[0].elapsed_us, "pipelining was not faster");
+}
+
+// after a failed command, the next must succeed
+static void check_recovers(picoboot_client &client, picoboot_simulator &sim, const std::vector<uint8_t> &image) {
+    uint8_t buf[PICOBOOT_FLASH_PAGE_SIZE];
+    CHECK(!client.read(PICOBOOT_FLASH_START, buf, sizeof(buf)), "read after a failure failed");
+    // (a failed program may have already changed the flash before the failure, so compare with what it holds)
+    CHECK(!memcmp(buf, sim.flash().data(), sizeof(buf)), "read after a failure returned the wrong data");
+    picoboot_program_options options;
+    picoboot_stats stats;
+    CHECK(!client.program_flash(PICOBOOT_FLASH_START, image.data(), IMAGE_SIZE, options, stats),
+          "program after a failure failed");
+    CHECK(flash_holds(sim, image), "flash does not hold the image after a failure");
+}
+
+static void test_errors() {
+    printf("errors\n");
+    picoboot_simulator sim("sim", 1024 * 1024);
+    picoboot_client client(sim);
+    std::vector<uint8_t> image = make_image(3);
+    picoboot_program_options options;
+    picoboot_stats stats;
+    CHECK(!client.program_flash(PICOBOOT_FLASH_START, image.data(), IMAGE_SIZE, options, stats), "program failed");
+
+    uint8_t page[PICOBOOT_FLASH_PAGE_SIZE] = {};
+    int rc = client.write(PICOBOOT_FLASH_START + 16, page, sizeof(page));
+    CHECK(rc == ERROR_COMMAND, "unaligned write did not fail");
+    CHECK(client.error().find("bad alignment") != std::string::npos, "unaligned write was not a bad alignment");
+    check_recovers(client, sim, image);
+
+    // past the end of the simulated flash, with several commands outstanding when the first fails
+    std::vector<uint8_t> too_big(sim.flash().size() + 4 * PICOBOOT_FLASH_SECTOR_SIZE, 0x5a);
+    rc = client.program_flash(PICOBOOT_FLASH_START, too_big.data(), (uint32_t)too_big.size(), options, stats);
+    CHECK(rc == ERROR_COMMAND, "program beyond the end of flash did not fail");
+    CHECK(client.error().find("invalid address") != std::string::npos,
+          "program beyond the end of flash was not an invalid address");
+    check_recovers(client, sim, image);
+
+    rc = client.exec(0x20000000);
+    CHECK(rc == ERROR_COMMAND, "EXEC did not fail");
+    CHECK(client.error().find("EXEC") != std::string::npos, "the error does not name EXEC");
+    check_recovers(client, sim, image);
+
+    rc = client.program_flash(PICOBOOT_FLASH_START + 16, image.data(), IMAGE_SIZE, options, stats);
+    CHECK(rc == ERROR_ARGS, "program at an unaligned address was not rejected");
+    check_recovers(client, sim, image);
+}
+
+int main() {
+    test_program();
+    test_pipeline_depth();
+    test_errors();
+    if (failures) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <libusb.h>
+#include "picoboot_usb.h"
+
+// long enough for a queued transfer to wait behind the erase of a large range
+#define TRANSFER_TIMEOUT_MS 30000u
+#define CONTROL_TIMEOUT_MS 1000u
+#define MAX_IN_FLIGHT 16u
+
+class picoboot_usb_transport : public picoboot_transport {
+public:
+    picoboot_usb_transport(libusb_context *ctx, libusb_device_handle *handle, int interface, uint8_t out_ep,
+                           uint8_t in_ep, std::string name) :
+            ctx(ctx), handle(handle), interface(interface), out_ep(out_ep), in_ep(in_ep), _name(std::move(name)) {}
+
+    ~picoboot_usb_transport() override {
+        if (!queue.empty()) reset();
+        libusb_release_interface(handle, interface);
+        libusb_close(handle);
+        libusb_exit(ctx);
+    }
+
+    int submit(const picoboot_cmd &cmd, const uint8_t *out_data, uint8_t *in_data) override;
+    int wait(picoboot_cmd_status &status) override;
+    int reset() override;
+    uint max_in_flight() const override { return MAX_IN_FLIGHT; }
+    std::string name() const override { return _name; }
+
+private:
+    struct command {
+        picoboot_cmd cmd;
+        libusb_transfer *transfers[3] = {};
+        uint count = 0;
+        uint outstanding = 0;
+        bool failed = false;
+        uint8_t ack[1] = {};
+
+        ~command() {
+            for (uint i = 0; i < count; i++) libusb_free_transfer(transfers[i]);
+        }
+    };
+
+    static void LIBUSB_CALL on_transfer(libusb_transfer *transfer);
+    void add_transfer(command &c, uint8_t ep, uint8_t *buffer, int length);
+    void cancel_all();
+
+    libusb_context *ctx;
+    libusb_device_handle *handle;
+    int interface;
+    uint8_t out_ep, in_ep;
+    std::string _name;
+    std::deque<std::unique_ptr<command>> queue;
+};
+
+void LIBUSB_CALL picoboot_usb_transport::on_transfer(libusb_transfer *transfer) {
+    auto *c = static_cast<command *>(transfer->user_data);
+    c->outstanding--;
+    // the acknowledgement is a zero length packet; everything else must transfer in full
+    bool is_ack = transfer->buffer == c->ack;
+    if (transfer->status != LIBUSB_TRANSFER_COMPLETED ||
+        transfer->actual_length != (is_ack ? 0 : transfer->length)) {
+        c->failed = true;
+    }
+}
+
+void picoboot_usb_transport::add_transfer(command &c, uint8_t ep, uint8_t *buffer, int length) {
+    libusb_transfer *transfer = libusb_alloc_transfer(0);
+    libusb_fill_bulk_transfer(transfer, handle, ep, buffer, length, on_transfer, &c, TRANSFER_TIMEOUT_MS);
+    c.transfers[c.count++] = transfer;
+}
+
+int picoboot_usb_transport::submit(const picoboot_cmd &cmd, const uint8_t *out_data, uint8_t *in_data) {
+    if (queue.size() >= MAX_IN_FLIGHT) return ERROR_ARGS;
+    std::unique_ptr<command> c(new command());
+    c->cmd = cmd;
+    bool in = cmd.bCmdId & 0x80u;
+    add_transfer(*c, out_ep, reinterpret_cast<uint8_t *>(&c->cmd), sizeof(c->cmd));
+    if (cmd.dTransferLength) {
+        add_transfer(*c, in ? in_ep : out_ep, in ? in_data : const_cast<uint8_t *>(out_data),
+                     (int)cmd.dTransferLength);
+    }
+    // the device acknowledges a command with a zero length packet in the opposite direction to its data
+    add_transfer(*c, in ? out_ep : in_ep, c->ack, in ? 0 : (int)sizeof(c->ack));
+    command &ref = *c;
+    queue.push_back(std::move(c));
+    for (uint i = 0; i < ref.count; i++) {
+        if (libusb_submit_transfer(ref.transfers[i])) {
+            // nothing after this can go through; the transfers which were submitted are cancelled by the reset
+            ref.failed = true;
+            for (uint j = i; j < ref.count; j++) libusb_free_transfer(ref.transfers[j]);
+            ref.count = i;
+            return ERROR_CONNECTION;
+        }
+        ref.outstanding++;
+    }
+    return 0;
+}
+
+void picoboot_usb_transport::cancel_all() {
+    for (auto &c : queue) {
+        for (uint i = 0; i < c->count; i++) libusb_cancel_transfer(c->transfers[i]);
+    }
+    for (auto &c : queue) {
+        while (c->outstanding) libusb_handle_events(ctx);
+    }
+}
+
+int picoboot_usb_transport::wait(picoboot_cmd_status &status) {
+    if (queue.empty()) return ERROR_ARGS;
+    command &c = *queue.front();
+    while (c.outstanding && !c.failed) {
+        if (libusb_handle_events(ctx)) {
+            c.failed = true;
+        }
+    }
+    memset(&status, 0, sizeof(status));
+    status.dToken = c.cmd.dToken;
+    status.bCmdId = c.cmd.bCmdId;
+    if (!c.failed) {
+        queue.pop_front();
+        return 0;
+    }
+    // the device stalls an endpoint when a command fails; everything queued behind it is lost
+    cancel_all();
+    queue.pop_front();
+    int rc = libusb_control_transfer(handle, LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_INTERFACE,
+                                     PICOBOOT_IF_CMD_STATUS, 0, (uint16_t)interface,
+                                     reinterpret_cast<unsigned char *>(&status), sizeof(status), CONTROL_TIMEOUT_MS);
+    if (rc != (int)sizeof(status)) return ERROR_CONNECTION;
+    return ERROR_COMMAND;
+}
+
+int picoboot_usb_transport::reset() {
+    cancel_all();
+    queue.clear();
+    libusb_clear_halt(handle, in_ep);
+    libusb_clear_halt(handle, out_ep);
+    int rc = libusb_control_transfer(handle, LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_INTERFACE,
+                                     PICOBOOT_IF_RESET, 0, (uint16_t)interface, nullptr, 0, CONTROL_TIMEOUT_MS);
+    return rc ? ERROR_CONNECTION : 0;
+}
+
+// Find the PICOBOOT interface (the vendor specific one, with a bulk endpoint each way) of a device
+static bool find_interface(libusb_device *dev, int &interface, uint8_t &out_ep, uint8_t &in_ep) {
+    libusb_config_descriptor *config;
+    if (libusb_get_active_config_descriptor(dev, &config)) return false;
+    bool found = false;
+    for (int i = 0; i < config->bNumInterfaces && !found; i++) {
+        const libusb_interface_descriptor &desc = config->interface[i].altsetting[0];
+        if (desc.bInterfaceClass == LIBUSB_CLASS_VENDOR_SPEC && desc.bNumEndpoints == 2) {
+            interface = desc.bInterfaceNumber;
+            for (int e = 0; e < 2; e++) {
+                uint8_t addr = desc.endpoint[e].bEndpointAddress;
+                if (addr & LIBUSB_ENDPOINT_IN) in_ep = addr; else out_ep = addr;
+            }
+            found = true;
+        }
+    }
+    libusb_free_config_descriptor(config);
+    return found;
+}
+
+static bool is_bootsel_device(libusb_device *dev) {
+    libusb_device_descriptor desc;
+    return !libusb_get_device_descriptor(dev, &desc) && desc.idVendor == PICOBOOT_USB_VID &&
+           desc.idProduct == PICOBOOT_USB_PID;
+}
+
+// Open a device in a libusb context of its own, so that each may be driven from a different thread
+static std::unique_ptr<picoboot_transport> open_device(uint8_t bus, uint8_t address, std::string &error) {
+    char name[32];
+    snprintf(name, sizeof(name), "bus %d address %d", bus, address);
+    libusb_context *ctx;
+    if (libusb_init(&ctx)) {
+        error += std::string(name) + ": can't initialize libusb\n";
+        return nullptr;
+    }
+    libusb_device **list;
+    ssize_t n = libusb_get_device_list(ctx, &list);
+    libusb_device_handle *handle = nullptr;
+    int interface = 0;
+    uint8_t out_ep = 0, in_ep = 0;
+    int rc = LIBUSB_ERROR_NOT_FOUND;
+    for (ssize_t i = 0; i < n; i++) {
+        if (libusb_get_bus_number(list[i]) != bus || libusb_get_device_address(list[i]) != address) continue;
+        if (!find_interface(list[i], interface, out_ep, in_ep)) break;
+        rc = libusb_open(list[i], &handle);
+        if (!rc) {
+            libusb_set_auto_detach_kernel_driver(handle, 1);
+            rc = libusb_claim_interface(handle, interface);
+            if (rc) {
+                libusb_close(handle);
+                handle = nullptr;
+            }
+        }
+        break;
+    }
+    if (n >= 0) libusb_free_device_list(list, 1);
+    if (!handle) {
+        error += std::string(name) + ": can't open the PICOBOOT interface (" + libusb_error_name(rc) + ")\n";
+        libusb_exit(ctx);
+        return nullptr;
+    }
+    return std::unique_ptr<picoboot_transport>(
+            new picoboot_usb_transport(ctx, handle, interface, out_ep, in_ep, name));
+}
+
+std::vector<std::unique_ptr<picoboot_transport>> picoboot_usb_open_all(std::string &error) {
+    std::vector<std::unique_ptr<picoboot_transport>> transports;
+    libusb_context *ctx;
+    if (libusb_init(&ctx)) {
+        error = "can't initialize libusb\n";
+        return transports;
+    }
+    std::vector<std::pair<uint8_t, uint8_t>> devices;
+    libusb_device **list;
+    ssize_t n = libusb_get_device_list(ctx, &list);
+    for (ssize_t i = 0; i < n; i++) {
+        if (is_bootsel_device(list[i])) {
+            devices.emplace_back(libusb_get_bus_number(list[i]), libusb_get_device_address(list[i]));
+        }
+    }
+    if (n >= 0) libusb_free_device_list(list, 1);
+    libusb_exit(ctx);
+    for (auto &d : devices) {
+        auto transport = open_device(d.first, d.second, error);
+        if (transport) transports.push_back(std::move(transport));
+    }
+    return transports;
+}
@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2022 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PICOBOOT_USB_H
+#define _PICOBOOT_USB_H
+
+#include <memory>
+#include "picoboot_client.h"
+
+// The PICOBOOT interface of RP2040s in BOOTSEL mode, over libusb. Commands are sent with asynchronous transfers, so
+// several may be queued at once: the command, its data and the acknowledgement of each are transfers queued on the
+// bulk endpoints in order, and the device accepts each in turn as it gets to it.
+
+#define PICOBOOT_USB_VID 0x2e8a
+#define PICOBOOT_USB_PID 0x0003
+
+// Open every RP2040 in BOOTSEL mode; error describes any which couldn't be opened
+std::vector<std::unique_ptr<picoboot_transport>> picoboot_usb_open_all(std::string &error);
+
+#endif